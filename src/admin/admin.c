@@ -65,7 +65,7 @@ const struct pho_config_item cfg_admin[] = {
 /* ****************************************************************************/
 /* Static Communication-related Functions *************************************/
 /* ****************************************************************************/
-static int _send(struct pho_comm_info *comm, struct proto_req proto_req)
+int _send(struct pho_comm_info *comm, struct proto_req proto_req)
 {
     struct pho_comm_data data_out;
     int rc;
@@ -882,9 +882,11 @@ int phobos_admin_device_unlock(struct admin_handle *adm, struct pho_id *dev_ids,
     return rc;
 }
 
-int phobos_admin_device_status(struct admin_handle *adm,
-                               enum rsc_family family,
-                               char **status)
+/**
+ * Send a monitor request to the LRS and return the JSON string of its response
+ */
+static int _monitor_lrs(struct admin_handle *adm, enum rsc_family family,
+                        bool trace, char **status)
 {
     struct proto_resp proto_resp = {LRS_REQUEST};
     struct proto_req proto_req = {LRS_REQUEST};
@@ -893,8 +895,6 @@ int phobos_admin_device_status(struct admin_handle *adm,
     int rc;
 
     proto_req.msg.lrs_req = &req;
-    if (family < 0 || family >= PHO_RSC_LAST)
-        LOG_RETURN(-EINVAL, "Invalid family %d", family);
 
     rc = pho_srl_request_monitor_alloc(&req);
     if (rc)
@@ -902,6 +902,8 @@ int phobos_admin_device_status(struct admin_handle *adm,
 
     req.id = 0;
     req.monitor->family = family;
+    req.monitor->has_trace = trace;
+    req.monitor->trace = trace;
 
     rc = _send_and_receive(&adm->phobosd_comm, proto_req, &proto_resp);
     if (rc)
@@ -923,6 +925,22 @@ int phobos_admin_device_status(struct admin_handle *adm,
     return rc;
 }
 
+int phobos_admin_device_status(struct admin_handle *adm,
+                               enum rsc_family family,
+                               char **status)
+{
+    if (family < 0 || family >= PHO_RSC_LAST)
+        LOG_RETURN(-EINVAL, "Invalid family %d", family);
+
+    return _monitor_lrs(adm, family, false, status);
+}
+
+int phobos_admin_lrs_trace(struct admin_handle *adm, char **trace)
+{
+    /* the family is required by the protocol but ignored by the LRS */
+    return _monitor_lrs(adm, PHO_RSC_TAPE, true, trace);
+}
+
 int phobos_admin_drive_migrate(struct admin_handle *adm, struct pho_id *dev_ids,
                                unsigned int num_dev, const char *host,
                                unsigned int *num_migrated_dev)
@@ -1287,17 +1305,33 @@ static void phobos_construct_extent(GString *extent_str, const char **res,
         g_string_append_printf(extent_str, "]}");
 }
 
-int phobos_admin_layout_list(struct admin_handle *adm, const char **res,
-                             int n_res, bool is_pattern, const char *medium,
-                             struct layout_info **layouts, int *n_layouts)
+/**
+ * Build the layout list filter from the requested objids or patterns and
+ * medium.
+ *
+ * \param[in]       res             Objids or patterns.
+ * \param[in]       n_res           Number of resources requested.
+ * \param[in]       is_pattern      True if search done using POSIX pattern.
+ * \param[in]       medium          Single medium filter.
+ * \param[out]      filter          Filter to build.
+ * \param[out]      filter_ptr      Set to \a filter if a filter is needed,
+ *                                  NULL otherwise.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ */
+static int phobos_construct_layout_filter(const char **res, int n_res,
+                                          bool is_pattern, const char *medium,
+                                          struct dss_filter *filter,
+                                          struct dss_filter **filter_ptr)
 {
-    struct dss_filter *filter_ptr = NULL;
-    struct dss_filter filter;
     bool medium_is_valid;
     GString *extent_str;
     GString *medium_str;
     int rc = 0;
 
+    *filter_ptr = NULL;
+
     extent_str = g_string_new(NULL);
     medium_str = g_string_new(NULL);
     medium_is_valid = (medium && strcmp(medium, ""));
@@ -1325,20 +1359,33 @@ int phobos_admin_layout_list(struct admin_handle *adm, const char **res,
          * if any is present, which are the second and fourth "%s".
          * Finally, is both are present, a comma is necessary.
          */
-        rc = dss_filter_build(&filter,
+        rc = dss_filter_build(filter,
                               "%s %s %s %s %s",
                               n_res && medium_is_valid ? "{\"$AND\": [" : "",
                               extent_str->str != NULL ? extent_str->str : "",
                               n_res && medium_is_valid ? ", " : "",
                               medium_str->str != NULL ? medium_str->str : "",
                               n_res && medium_is_valid ? "]}" : "");
-
-        filter_ptr = &filter;
+        if (!rc)
+            *filter_ptr = filter;
     }
 
     g_string_free(extent_str, TRUE);
     g_string_free(medium_str, TRUE);
 
+    return rc;
+}
+
+int phobos_admin_layout_list(struct admin_handle *adm, const char **res,
+                             int n_res, bool is_pattern, const char *medium,
+                             struct layout_info **layouts, int *n_layouts)
+{
+    struct dss_filter *filter_ptr;
+    struct dss_filter filter;
+    int rc;
+
+    rc = phobos_construct_layout_filter(res, n_res, is_pattern, medium,
+                                        &filter, &filter_ptr);
     if (rc)
         return rc;
 
@@ -1356,6 +1403,45 @@ int phobos_admin_layout_list(struct admin_handle *adm, const char **res,
     return rc;
 }
 
+int phobos_admin_layout_list_iter(struct admin_handle *adm, const char **res,
+                                  int n_res, bool is_pattern,
+                                  const char *medium, struct dss_iter **iter)
+{
+    struct dss_filter *filter_ptr;
+    struct dss_filter filter;
+    int rc;
+
+    rc = phobos_construct_layout_filter(res, n_res, is_pattern, medium,
+                                        &filter, &filter_ptr);
+    if (rc)
+        return rc;
+
+    rc = dss_layout_iter_open(&adm->dss, filter_ptr, iter);
+    if (rc)
+        pho_error(rc, "Cannot fetch layouts");
+
+    dss_filter_free(filter_ptr);
+
+    return rc;
+}
+
+int phobos_admin_layout_list_next(struct dss_iter *iter,
+                                  struct layout_info **layout)
+{
+    int rc;
+
+    rc = dss_iter_next(iter, (void **)layout);
+    if (rc)
+        pho_error(rc, "Cannot fetch next layout");
+
+    return rc;
+}
+
+void phobos_admin_layout_list_iter_free(struct dss_iter *iter)
+{
+    dss_iter_close(iter);
+}
+
 void phobos_admin_layout_list_free(struct layout_info *layouts, int n_layouts)
 {
     dss_res_free(layouts, n_layouts);
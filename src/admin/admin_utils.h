@@ -39,7 +39,146 @@ struct proto_resp {
     } msg;
 };
 
+int _send(struct pho_comm_info *comm, struct proto_req proto_req);
+
 int _send_and_receive(struct pho_comm_info *comm, struct proto_req proto_req,
                       struct proto_resp *proto_resp);
 
+struct admin_handle;
+struct extent;
+struct io_adapter_module;
+struct layout_info;
+struct pho_attrs;
+struct pho_ext_loc;
+struct pho_id;
+struct stat;
+
+/**
+ * Send a request to the LRS and receive its response, which is checked to
+ * answer \p req and not to be an error.
+ *
+ * \param[out]  resp    Response to free with pho_srl_response_free(), only set
+ *                      on success.
+ */
+int admin_lrs_request(struct admin_handle *adm, pho_req_t *req,
+                      pho_resp_t **resp);
+
+/**
+ * Allocate media through the LRS to access them directly.
+ *
+ * \param[in]   media   Media to allocate, all of them are required.
+ * \param[in]   n_media Number of media in \p media.
+ * \param[out]  resp    Response holding the allocated media in
+ *                      ralloc->media, to free with pho_srl_response_free().
+ */
+int admin_medium_read_alloc(struct admin_handle *adm,
+                            const struct pho_id *media, int n_media,
+                            pho_resp_t **resp);
+
+/**
+ * Release a medium allocated by admin_medium_read_alloc().
+ *
+ * If \p to_sync is set, because the medium was modified, the LRS syncs it and
+ * the release response is waited for.
+ *
+ * \param[in]   rc      Outcome of the accesses to the medium (0 or -errno).
+ */
+int admin_medium_release(struct admin_handle *adm,
+                         const pho_resp_read_elt_t *medium, int rc,
+                         bool to_sync);
+
+/**
+ * Allocate \p source for reading and a medium of the same family for writing
+ * in a single mixed request: the LRS grants both or none, so that concurrent
+ * copies never hold a drive while waiting for another one.
+ *
+ * \param[in]   tags    Tags of the medium to write, may be NULL.
+ * \param[in]   size    Amount of data to write.
+ * \param[out]  resp    Response holding the source in ralloc->media[0] and
+ *                      the destination in walloc->media[0], to free with
+ *                      pho_srl_response_free().
+ */
+int admin_medium_mixed_alloc(struct admin_handle *adm,
+                             const struct pho_id *source,
+                             const struct tags *tags, size_t size,
+                             pho_resp_t **resp);
+
+/** Consumer of the content of an extent read by admin_extent_read() */
+typedef int (*admin_extent_chunk_cb_t)(const void *buffer, size_t size,
+                                       void *udata);
+
+/**
+ * Read an extent and give its content, chunk by chunk, to \p chunk_cb.
+ *
+ * I/O adapters only read extents to a file descriptor, so the extent is read
+ * by a dedicated thread through a pipe. If \p chunk_cb fails, the extent is
+ * still read up to its end but the following chunks are not given to it.
+ *
+ * \param[in,out]  attrs   Extended attributes to retrieve from the extent
+ *                         (keys set with NULL values), or NULL.
+ *
+ * \return 0 on success, the error of the read or of \p chunk_cb, or -EIO if
+ *         the extent is not as long as recorded in \p loc.
+ */
+int admin_extent_read(struct io_adapter_module *ioa, struct pho_ext_loc *loc,
+                      const char *oid, struct pho_attrs *attrs,
+                      admin_extent_chunk_cb_t chunk_cb, void *udata);
+
+/**
+ * Remove an extent from an allocated medium. An extent that is already missing
+ * counts as removed, so that an interrupted removal can be run again.
+ */
+int admin_extent_remove(struct io_adapter_module *ioa,
+                        const pho_resp_read_elt_t *alloc,
+                        struct extent *extent);
+
+/**
+ * Copy one extent from a medium allocated for reading to a medium allocated
+ * for writing, at the same address, along with its extended attributes. On
+ * success, \p dst_ext describes the copy.
+ */
+int admin_extent_copy(const pho_resp_read_elt_t *src,
+                      const pho_resp_write_elt_t *dst, const char *oid,
+                      struct extent *src_ext, struct extent *dst_ext);
+
+/** Remove a copy made by admin_extent_copy(), failures are only logged. */
+void admin_extent_copy_del(const pho_resp_write_elt_t *dst,
+                           struct extent *copy);
+
+/** Sum of the sizes of the extents of a layout */
+size_t admin_layout_size(const struct layout_info *layout);
+
+/**
+ * Migrate the extents of \p lyt_ls from \p source to media of \p family
+ * matching \p tags. Layouts are copied by batches on a single destination
+ * medium synced once per batch, then their location is switched in the DSS
+ * and their copies on \p source are removed. The extents of \p lyt_ls must
+ * all be on \p source, and are updated to their new location.
+ *
+ * \param[out]  n_moved     Number of layouts migrated, which are always the
+ *                          first ones of \p lyt_ls, even on error.
+ */
+int admin_medium_migrate(struct admin_handle *adm, const struct pho_id *source,
+                         enum rsc_family family, const struct tags *tags,
+                         struct layout_info *lyt_ls, int lyt_cnt,
+                         int *n_moved);
+
+/**
+ * Consumer of the files found by admin_medium_walk(), \p address being the
+ * path of the file relative to the root of the medium.
+ */
+typedef int (*admin_medium_file_cb_t)(const char *address,
+                                      const struct stat *st, void *udata);
+
+/**
+ * Walk the file tree of a POSIX or LTFS medium mounted on \p root_path and
+ * give each regular file to \p file_cb. Hidden entries are not phobos extents
+ * and are skipped.
+ *
+ * \return 0 on success, or the first error of the walk or of \p file_cb, the
+ *         walk going on after an error.
+ */
+int admin_medium_walk(const char *root_path, admin_medium_file_cb_t file_cb,
+                      void *udata);
+
 #endif /* _ADMIN_UTILS */
@@ -0,0 +1,109 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: flush of staged objects
+ *
+ * Objects put on the staging family (see the 'staging_family' parameter of
+ * the store) are migrated to their own family by batches, see
+ * admin_medium_migrate().
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+static int flush_group(struct admin_handle *adm,
+                       const struct staging_group *group, int *n_flushed)
+{
+    struct layout_info *lyt_ls;
+    int lyt_cnt = 0;
+    int done = 0;
+    int rc;
+    int i;
+
+    rc = dss_staging_layouts_get(&adm->dss, group, &lyt_ls, &lyt_cnt);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the staged extents of '%s'",
+                   group->medium.name);
+
+    pho_info("Flushing %d objects from '%s' to %s", lyt_cnt,
+             group->medium.name, rsc_family2str(group->family));
+
+    rc = admin_medium_migrate(adm, &group->medium, group->family,
+                              &group->tags, lyt_ls, lyt_cnt, &done);
+    for (i = 0; i < done; i++)
+        *n_flushed += lyt_ls[i].ext_count;
+
+    /* staged objects all the extents of which are migrated are flushed */
+    if (done > 0) {
+        int rc2 = dss_staging_clear(&adm->dss, lyt_ls, done);
+
+        if (rc2)
+            pho_error(rc2, "Cannot clear the staging of %d objects", done);
+        if (!rc)
+            rc = rc2;
+    }
+
+    dss_res_free(lyt_ls, lyt_cnt);
+
+    if (rc)
+        LOG_RETURN(rc, "Flush of '%s' stopped after %d of %d objects",
+                   group->medium.name, done, lyt_cnt);
+
+    return 0;
+}
+
+int phobos_admin_flush(struct admin_handle *adm, int *n_flushed)
+{
+    struct staging_group *groups;
+    int n_groups;
+    int rc = 0;
+    int i;
+
+    *n_flushed = 0;
+
+    rc = dss_staging_groups_get(&adm->dss, &groups, &n_groups);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the staged objects");
+
+    /* a failing staging medium or destination does not stop the others */
+    for (i = 0; i < n_groups; i++) {
+        int rc2 = flush_group(adm, &groups[i], n_flushed);
+
+        if (!rc)
+            rc = rc2;
+    }
+
+    dss_staging_groups_free(groups, n_groups);
+
+    pho_info("Flushed %d extents", *n_flushed);
+    return rc;
+}
@@ -0,0 +1,416 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: garbage collector
+ *
+ * Extents that no object refers to anymore are removed from their media, then
+ * their DSS rows are removed in bulk. The extents are grouped by medium so that
+ * each medium is allocated, and each tape mounted, only once. Files left on
+ * POSIX media by transfers that did not complete, which are unknown to the
+ * DSS, can also be found by scanning the media. The data of deduplicated
+ * objects is only removed with the last extent referring to it.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <glib.h>
+
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_io.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+/** Garbage extent located on the medium being collected */
+struct gc_extent {
+    struct extent *extent;
+    int layout;                 /**< Index of its layout */
+};
+
+/** State of a garbage collection */
+struct gc_ctx {
+    struct admin_handle *adm;
+    unsigned int grace_time;
+    bool scan;
+    struct layout_info *lyt_ls; /**< Garbage layouts */
+    int lyt_cnt;
+    int *n_removed;             /**< Removed extents of each layout */
+    int n_extents;              /**< Removed extents and files */
+};
+
+/** State of the scan of a medium for files unknown to the DSS */
+struct gc_scan {
+    struct io_adapter_module *ioa;
+    const pho_resp_read_elt_t *alloc;
+    GHashTable *known;          /**< Addresses of the extents of the DSS */
+    time_t deadline;            /**< Files modified later may be being put */
+    int n_removed;
+};
+
+static int gc_extent_cmp(const void *a, const void *b)
+{
+    const struct gc_extent *ext_a = a;
+    const struct gc_extent *ext_b = b;
+
+    return strcmp(ext_a->extent->address.buff, ext_b->extent->address.buff);
+}
+
+/**
+ * Gather the garbage extents located on \p medium, sorted by address, which
+ * is the on-media order.
+ */
+static int gc_medium_extents(struct gc_ctx *ctx, const struct pho_id *medium,
+                             struct gc_extent **extents, int *cnt)
+{
+    int i;
+    int j;
+
+    *extents = NULL;
+    *cnt = 0;
+
+    for (i = 0; i < ctx->lyt_cnt; i++)
+        for (j = 0; j < ctx->lyt_ls[i].ext_count; j++)
+            if (pho_id_equal(&ctx->lyt_ls[i].extents[j].media, medium))
+                (*cnt)++;
+
+    if (*cnt == 0)
+        return 0;
+
+    *extents = calloc(*cnt, sizeof(**extents));
+    if (!*extents)
+        return -ENOMEM;
+
+    *cnt = 0;
+    for (i = 0; i < ctx->lyt_cnt; i++) {
+        for (j = 0; j < ctx->lyt_ls[i].ext_count; j++) {
+            struct extent *extent = &ctx->lyt_ls[i].extents[j];
+
+            if (!pho_id_equal(&extent->media, medium))
+                continue;
+
+            (*extents)[*cnt].extent = extent;
+            (*extents)[*cnt].layout = i;
+            (*cnt)++;
+        }
+    }
+
+    qsort(*extents, *cnt, sizeof(**extents), gc_extent_cmp);
+    return 0;
+}
+
+/**
+ * Remove a file found on a medium if it is unknown to the DSS and was not
+ * modified for the grace time.
+ */
+static int gc_scan_file(const char *address, const struct stat *st,
+                        void *udata)
+{
+    struct gc_scan *scan = udata;
+    struct extent extent = {0};
+    int rc;
+
+    if (g_hash_table_contains(scan->known, address) ||
+        st->st_mtime > scan->deadline)
+        return 0;
+
+    extent.media.family = (enum rsc_family)scan->alloc->med_id->family;
+    pho_id_name_set(&extent.media, scan->alloc->med_id->name);
+    extent.address.buff = (char *)address;
+    extent.address.size = strlen(address) + 1;
+
+    pho_info("Removing '%s' from '%s', unknown to the DSS", address,
+             extent.media.name);
+
+    rc = admin_extent_remove(scan->ioa, scan->alloc, &extent);
+    if (rc)
+        LOG_RETURN(rc, "Cannot remove '%s' from '%s'", address,
+                   extent.media.name);
+
+    scan->n_removed++;
+    return 0;
+}
+
+/**
+ * Remove the files of an allocated medium that are not extents known to the
+ * DSS and were not modified for the grace time.
+ */
+static int gc_scan_medium(struct gc_ctx *ctx, struct io_adapter_module *ioa,
+                          const pho_resp_read_elt_t *alloc,
+                          const struct pho_id *medium, int *n_removed)
+{
+    struct gc_scan scan = {
+        .ioa = ioa,
+        .alloc = alloc,
+        .deadline = time(NULL) - ctx->grace_time,
+    };
+    struct layout_info *lyt_ls;
+    int lyt_cnt;
+    int rc;
+    int i;
+    int j;
+
+    *n_removed = 0;
+
+    rc = dss_medium_extents_get(&ctx->adm->dss, medium, &lyt_ls, &lyt_cnt);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the extents of '%s'", medium->name);
+
+    scan.known = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < lyt_cnt; i++)
+        for (j = 0; j < lyt_ls[i].ext_count; j++)
+            g_hash_table_add(scan.known, lyt_ls[i].extents[j].address.buff);
+
+    rc = admin_medium_walk(alloc->root_path, gc_scan_file, &scan);
+
+    g_hash_table_destroy(scan.known);
+    dss_res_free(lyt_ls, lyt_cnt);
+
+    *n_removed = scan.n_removed;
+    return rc;
+}
+
+/** Whether the extents of \p medium can be accessed to be removed */
+static bool gc_medium_is_accessible(const struct media_info *medium)
+{
+    return medium->rsc.adm_status == PHO_RSC_ADM_ST_UNLOCKED &&
+           medium->fs.status != PHO_FS_STATUS_BLANK &&
+           medium->flags.get && medium->flags.delete;
+}
+
+/**
+ * Remove the garbage extents of a medium and, if requested, the files unknown
+ * to the DSS, under a single allocation of the medium.
+ */
+static int gc_medium(struct gc_ctx *ctx, const struct media_info *medium)
+{
+    const struct pho_id *id = &medium->rsc.id;
+    const pho_resp_read_elt_t *alloc;
+    struct io_adapter_module *ioa;
+    struct gc_extent *extents;
+    bool scan;
+    int n_removed = 0;
+    int n_shared = 1;
+    int n_scanned = 0;
+    pho_resp_t *resp;
+    int cnt;
+    int rc2;
+    int rc;
+    int i;
+
+    scan = ctx->scan && (medium->fs.type == PHO_FS_POSIX ||
+                         medium->fs.type == PHO_FS_LTFS);
+
+    rc = gc_medium_extents(ctx, id, &extents, &cnt);
+    if (rc)
+        return rc;
+
+    if (cnt == 0 && !scan)
+        return 0;
+
+    if (!gc_medium_is_accessible(medium)) {
+        if (cnt > 0)
+            pho_warn("%d garbage extents are left on '%s', which is locked, "
+                     "not formatted or closed to get or delete", cnt,
+                     id->name);
+        GOTO(free_extents, rc = 0);
+    }
+
+    rc = admin_medium_read_alloc(ctx->adm, id, 1, &resp);
+    if (rc)
+        LOG_GOTO(free_extents, rc, "Cannot allocate medium '%s'", id->name);
+
+    alloc = resp->ralloc->media[0];
+    rc = get_io_adapter((enum fs_type)alloc->fs_type, &ioa);
+    if (rc)
+        GOTO(release, rc);
+
+    for (i = 0; i < cnt; i += n_shared) {
+        struct extent *extent = extents[i].extent;
+        int refs;
+        int k;
+
+        /* garbage extents sharing the data of an address are sorted together */
+        n_shared = 1;
+        while (i + n_shared < cnt &&
+               !gc_extent_cmp(&extents[i], &extents[i + n_shared]))
+            n_shared++;
+
+        rc2 = dss_extent_refcount_get(&ctx->adm->dss, id, extent->address.buff,
+                                      &refs);
+        if (rc2) {
+            pho_error(rc2, "Cannot count the references to extent '%s' of "
+                      "'%s'", extent->address.buff, id->name);
+            rc = rc ? : rc2;
+            continue;
+        }
+
+        /* the data of deduplicated objects is kept for the live layouts */
+        if (refs > n_shared) {
+            pho_verb("Keeping extent '%s' of '%s', shared with %d other "
+                     "layouts", extent->address.buff, id->name,
+                     refs - n_shared);
+        } else {
+            pho_verb("Removing extent '%s' of object '%s' from '%s'",
+                     extent->address.buff,
+                     ctx->lyt_ls[extents[i].layout].oid, id->name);
+
+            rc2 = admin_extent_remove(ioa, alloc, extent);
+            if (rc2) {
+                pho_error(rc2, "Cannot remove extent '%s' from '%s'",
+                          extent->address.buff, id->name);
+                rc = rc ? : rc2;
+                continue;
+            }
+
+            n_removed++;
+        }
+
+        for (k = i; k < i + n_shared; k++)
+            ctx->n_removed[extents[k].layout]++;
+    }
+
+    if (scan) {
+        rc2 = gc_scan_medium(ctx, ioa, alloc, id, &n_scanned);
+        rc = rc ? : rc2;
+        n_removed += n_scanned;
+    }
+
+release:
+    /* tapes must be synced for the removals to be effective */
+    rc2 = admin_medium_release(ctx->adm, alloc, rc, n_removed > 0);
+    rc = rc ? : rc2;
+    pho_srl_response_free(resp, true);
+
+    if (n_removed > 0)
+        pho_info("Removed %d extents from '%s'", n_removed, id->name);
+
+    ctx->n_extents += n_removed;
+
+free_extents:
+    free(extents);
+    return rc;
+}
+
+/**
+ * Remove the DSS rows of the garbage layouts whose extents were all removed,
+ * in a single transaction. The other ones are left for a later collection.
+ */
+static int gc_layouts_delete(struct gc_ctx *ctx)
+{
+    struct layout_info *done;
+    int n_done = 0;
+    int rc;
+    int i;
+
+    done = calloc(ctx->lyt_cnt, sizeof(*done));
+    if (!done)
+        return -ENOMEM;
+
+    for (i = 0; i < ctx->lyt_cnt; i++)
+        if (ctx->n_removed[i] == ctx->lyt_ls[i].ext_count)
+            done[n_done++] = ctx->lyt_ls[i];
+
+    if (n_done == 0) {
+        free(done);
+        return 0;
+    }
+
+    rc = dss_layouts_delete(&ctx->adm->dss, done, n_done);
+    if (rc)
+        pho_error(rc, "Cannot delete %d garbage layouts", n_done);
+    else
+        pho_verb("Deleted %d garbage layouts", n_done);
+
+    free(done);
+    return rc;
+}
+
+int phobos_admin_gc(struct admin_handle *adm, unsigned int grace_time,
+                    bool scan, int *n_extents, int *n_objects)
+{
+    struct gc_ctx ctx = {
+        .adm = adm,
+        .grace_time = grace_time,
+        .scan = scan,
+    };
+    struct media_info *media;
+    int med_cnt;
+    int rc2;
+    int rc;
+    int i;
+
+    *n_extents = 0;
+    *n_objects = 0;
+
+    rc = dss_garbage_layouts_get(&adm->dss, &ctx.lyt_ls, &ctx.lyt_cnt);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve garbage layouts");
+
+    ctx.n_removed = calloc(ctx.lyt_cnt ? : 1, sizeof(*ctx.n_removed));
+    if (!ctx.n_removed)
+        GOTO(free_layouts, rc = -ENOMEM);
+
+    rc = dss_media_get(&adm->dss, NULL, &media, &med_cnt);
+    if (rc)
+        LOG_GOTO(free_removed, rc, "Cannot retrieve media");
+
+    pho_info("Collecting the extents of %d garbage layouts", ctx.lyt_cnt);
+
+    /* a medium that cannot be collected does not prevent the other ones */
+    for (i = 0; i < med_cnt; i++) {
+        rc2 = gc_medium(&ctx, &media[i]);
+        if (rc2)
+            pho_error(rc2, "Garbage collection of '%s' failed",
+                      media[i].rsc.id.name);
+        rc = rc ? : rc2;
+    }
+
+    dss_res_free(media, med_cnt);
+
+    rc2 = gc_layouts_delete(&ctx);
+    rc = rc ? : rc2;
+
+    rc2 = dss_layoutless_objects_delete(&adm->dss, grace_time, n_objects);
+    if (rc2)
+        pho_error(rc2, "Cannot delete objects without layout");
+    rc = rc ? : rc2;
+
+    *n_extents = ctx.n_extents;
+    pho_info("Removed %d extents and %d objects without layout",
+             *n_extents, *n_objects);
+
+free_removed:
+    free(ctx.n_removed);
+free_layouts:
+    dss_res_free(ctx.lyt_ls, ctx.lyt_cnt);
+    return rc;
+}
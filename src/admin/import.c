@@ -0,0 +1,782 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: medium import
+ *
+ * Extents are self-described by the extended attributes layout modules set on
+ * them: object ID, UUID and version, write time, layout description and index
+ * of the extent in the layout, user metadata and checksums. The object
+ * versions sharing an extent through deduplication are recorded on it as
+ * references, each of which is rebuilt as another extent in the same file.
+ * Media are scanned in parallel, one thread per allocated medium, and the
+ * object, layout and extent rows are rebuilt from these attributes and
+ * inserted in bulk.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#include <glib.h>
+
+#include "pho_attrs.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_io.h"
+#include "pho_layout.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+/**
+ * Minimum number of layouts inserted in the DSS in a single transaction, a
+ * batch is only cut between two oids so that the live object of an oid is
+ * chosen among all of its layouts.
+ */
+#define IMPORT_BATCH_LAYOUTS    1024
+
+/** Extended attributes an extent is rebuilt from */
+static const char * const import_xattrs[] = {
+    PHO_EA_ID_NAME,
+    PHO_EA_UUID_NAME,
+    PHO_EA_VERSION_NAME,
+    PHO_EA_CTIME_NAME,
+    PHO_EA_LAYOUT_NAME,
+    PHO_EA_LAYOUT_IDX_NAME,
+    PHO_EA_UMD_NAME,
+    PHO_EA_MD5_NAME,
+    PHO_EA_XXH128_NAME,
+    PHO_EA_CRC32C_NAME,
+};
+
+/** Attributes of an extent that a reference overrides, see PHO_EA_REF_NAME */
+static const char * const import_ref_xattrs[] = {
+    PHO_EA_ID_NAME,
+    PHO_EA_UUID_NAME,
+    PHO_EA_VERSION_NAME,
+    PHO_EA_CTIME_NAME,
+    PHO_EA_UMD_NAME,
+};
+
+/** Extent found on a medium, along with the object version it belongs to */
+struct import_extent {
+    char *oid;
+    char *uuid;
+    int version;
+    int64_t ctime;              /**< Write time, 0 if not recorded */
+    char *user_md;
+    struct module_desc layout_desc;
+    struct extent extent;
+};
+
+/** Import of one medium, scanned by a dedicated thread once allocated */
+struct import_medium {
+    struct media_info *medium;
+    const pho_resp_read_elt_t *alloc;
+    struct io_adapter_module *ioa;
+    pthread_t thread;
+    GPtrArray *extents;         /**< Extents found on the medium */
+    int n_files;                /**< Files holding these extents */
+    size_t size;                /**< Total size of these files */
+    int n_skipped;              /**< Files that are not self-described */
+    int rc;
+};
+
+static void import_extent_free(gpointer data)
+{
+    struct import_extent *ext = data;
+
+    free(ext->oid);
+    free(ext->uuid);
+    free(ext->user_md);
+    free(ext->layout_desc.mod_name);
+    pho_attrs_free(&ext->layout_desc.mod_attrs);
+    free(ext->extent.address.buff);
+    free(ext);
+}
+
+/** Read \p size bytes from a buffer of exactly 2 * \p size hexadecimal digits */
+static int import_hex(unsigned char *buf, size_t size, const char *hex)
+{
+    size_t i;
+
+    if (strlen(hex) != 2 * size)
+        return -EINVAL;
+
+    for (i = 0; i < size; i++)
+        if (sscanf(hex + 2 * i, "%02hhx", &buf[i]) != 1)
+            return -EINVAL;
+
+    return 0;
+}
+
+/**
+ * Fill \p ext from the extended attributes of its file.
+ *
+ * \return 0 on success, -ENODATA if the file is not a self-described extent,
+ *         another negative error code if its attributes are invalid.
+ */
+static int import_extent_parse(struct import_extent *ext,
+                               struct pho_attrs *attrs)
+{
+    const char *layout_idx = pho_attr_get(attrs, PHO_EA_LAYOUT_IDX_NAME);
+    const char *version = pho_attr_get(attrs, PHO_EA_VERSION_NAME);
+    const char *write_time = pho_attr_get(attrs, PHO_EA_CTIME_NAME);
+    const char *layout = pho_attr_get(attrs, PHO_EA_LAYOUT_NAME);
+    const char *xxh128 = pho_attr_get(attrs, PHO_EA_XXH128_NAME);
+    const char *crc32c = pho_attr_get(attrs, PHO_EA_CRC32C_NAME);
+    const char *user_md = pho_attr_get(attrs, PHO_EA_UMD_NAME);
+    const char *uuid = pho_attr_get(attrs, PHO_EA_UUID_NAME);
+    const char *md5 = pho_attr_get(attrs, PHO_EA_MD5_NAME);
+    const char *oid = pho_attr_get(attrs, PHO_EA_ID_NAME);
+    int64_t value;
+    int rc;
+
+    if (!oid || !uuid || !version || !layout || !layout_idx)
+        return -ENODATA;
+
+    value = str2int64(version);
+    if (value <= 0 || value > INT_MAX)
+        LOG_RETURN(-EINVAL, "Invalid version '%s'", version);
+    ext->version = value;
+
+    /* extents written before the write time was recorded have none */
+    if (write_time) {
+        ext->ctime = str2int64(write_time);
+        if (ext->ctime <= 0)
+            LOG_RETURN(-EINVAL, "Invalid write time '%s'", write_time);
+    }
+
+    value = str2int64(layout_idx);
+    if (value < 0 || value > INT_MAX)
+        LOG_RETURN(-EINVAL, "Invalid layout index '%s'", layout_idx);
+    ext->extent.layout_idx = value;
+
+    rc = dss_layout_desc_decode(&ext->layout_desc, layout);
+    if (rc)
+        LOG_RETURN(rc, "Invalid layout description '%s'", layout);
+
+    if (md5) {
+        rc = import_hex(ext->extent.md5, sizeof(ext->extent.md5), md5);
+        if (rc)
+            LOG_RETURN(rc, "Invalid md5 '%s'", md5);
+        ext->extent.with_md5 = true;
+    }
+
+    if (xxh128) {
+        rc = import_hex(ext->extent.xxh128, sizeof(ext->extent.xxh128),
+                        xxh128);
+        if (rc)
+            LOG_RETURN(rc, "Invalid xxh128 '%s'", xxh128);
+        ext->extent.with_xxh128 = true;
+    }
+
+    if (crc32c) {
+        rc = import_hex(ext->extent.crc32c, sizeof(ext->extent.crc32c),
+                        crc32c);
+        if (rc)
+            LOG_RETURN(rc, "Invalid crc32c '%s'", crc32c);
+        ext->extent.with_crc32c = true;
+    }
+
+    ext->oid = strdup(oid);
+    ext->uuid = strdup(uuid);
+    if (user_md)
+        ext->user_md = strdup(user_md);
+    if (!ext->oid || !ext->uuid || (user_md && !ext->user_md))
+        return -ENOMEM;
+
+    return 0;
+}
+
+static int attr_copy_cb(const char *key, const char *value, void *udata)
+{
+    return pho_attr_set(udata, key, value);
+}
+
+/**
+ * Rebuild the extent of the object version recorded as reference \p ref on
+ * \p ext, the file of which it shares. \p attrs are the attributes of \p ext.
+ */
+static int import_ref(struct import_medium *imp,
+                      const struct import_extent *ext,
+                      const struct pho_attrs *attrs, const char *ref)
+{
+    struct pho_attrs ref_attrs = {0};
+    struct import_extent *ref_ext;
+    size_t i;
+    int rc;
+
+    ref_ext = calloc(1, sizeof(*ref_ext));
+    if (!ref_ext)
+        return -ENOMEM;
+
+    ref_ext->extent.media = ext->extent.media;
+    ref_ext->extent.size = ext->extent.size;
+    ref_ext->extent.address.buff = strdup(ext->extent.address.buff);
+    if (!ref_ext->extent.address.buff)
+        GOTO(free_ext, rc = -ENOMEM);
+    ref_ext->extent.address.size = ext->extent.address.size;
+
+    rc = pho_attrs_foreach(attrs, attr_copy_cb, &ref_attrs);
+    for (i = 0; i < sizeof(import_ref_xattrs) / sizeof(*import_ref_xattrs) &&
+                !rc; i++)
+        rc = pho_attr_set(&ref_attrs, import_ref_xattrs[i], NULL);
+    if (rc)
+        GOTO(free_attrs, rc);
+
+    rc = pho_json_to_attrs(&ref_attrs, ref);
+    rc = rc ? : import_extent_parse(ref_ext, &ref_attrs);
+    if (rc)
+        LOG_GOTO(free_attrs, rc = rc == -ENODATA ? -EINVAL : rc,
+                 "Invalid reference '%s'", ref);
+
+    g_ptr_array_add(imp->extents, ref_ext);
+    pho_attrs_free(&ref_attrs);
+    return 0;
+
+free_attrs:
+    pho_attrs_free(&ref_attrs);
+free_ext:
+    import_extent_free(ref_ext);
+    return rc;
+}
+
+/**
+ * Rebuild the extent stored in a file of a medium from its attributes, along
+ * with the extents of the references recorded on it.
+ */
+static int import_file(const char *address, const struct stat *st,
+                       void *udata)
+{
+    struct import_medium *imp = udata;
+    const char *name = imp->alloc->med_id->name;
+    struct pho_io_descr iod = {0};
+    struct pho_attrs refs = {0};
+    struct import_extent *ext;
+    struct pho_ext_loc loc;
+    int n_refs;
+    size_t i;
+    int rc;
+    int k;
+
+    ext = calloc(1, sizeof(*ext));
+    if (!ext)
+        return -ENOMEM;
+
+    ext->extent.media.family = (enum rsc_family)imp->alloc->med_id->family;
+    pho_id_name_set(&ext->extent.media, name);
+    ext->extent.size = st->st_size;
+    ext->extent.address.buff = strdup(address);
+    if (!ext->extent.address.buff)
+        GOTO(free_ext, rc = -ENOMEM);
+    ext->extent.address.size = strlen(address) + 1;
+
+    for (i = 0; i < sizeof(import_xattrs) / sizeof(*import_xattrs); i++) {
+        rc = pho_attr_set(&iod.iod_attrs, import_xattrs[i], NULL);
+        if (rc)
+            GOTO(free_attrs, rc);
+    }
+
+    loc.root_path = imp->alloc->root_path;
+    loc.extent = &ext->extent;
+    loc.addr_type = (enum address_type)imp->alloc->addr_type;
+    iod.iod_flags = PHO_IO_MD_ONLY;
+    iod.iod_loc = &loc;
+
+    rc = ioa_get(imp->ioa, NULL, NULL, &iod);
+    if (rc)
+        LOG_GOTO(free_attrs, rc, "Cannot read the attributes of '%s' on '%s'",
+                 address, name);
+
+    rc = import_extent_parse(ext, &iod.iod_attrs);
+    if (rc == -ENODATA) {
+        pho_verb("Skipping '%s' on '%s', which is not a self-described "
+                 "extent", address, name);
+        imp->n_skipped++;
+        GOTO(free_attrs, rc = 0);
+    }
+
+    if (rc)
+        LOG_GOTO(free_attrs, rc, "Cannot import '%s' on '%s'", address, name);
+
+    rc = get_extent_refs(imp->ioa, &loc, &refs, &n_refs);
+    if (rc)
+        LOG_GOTO(free_attrs, rc, "Cannot read the references of '%s' on '%s'",
+                 address, name);
+
+    for (k = 0; k < n_refs; k++) {
+        char ref_name[32];
+
+        snprintf(ref_name, sizeof(ref_name), PHO_EA_REF_NAME "%d", k);
+        rc = import_ref(imp, ext, &iod.iod_attrs,
+                        pho_attr_get(&refs, ref_name));
+        if (rc)
+            LOG_GOTO(free_refs, rc, "Cannot import '%s' on '%s'", address,
+                     name);
+    }
+
+    g_ptr_array_add(imp->extents, ext);
+    imp->n_files++;
+    imp->size += ext->extent.size;
+    pho_attrs_free(&refs);
+    pho_attrs_free(&iod.iod_attrs);
+    return 0;
+
+free_refs:
+    pho_attrs_free(&refs);
+free_attrs:
+    pho_attrs_free(&iod.iod_attrs);
+free_ext:
+    import_extent_free(ext);
+    return rc;
+}
+
+static void *import_medium_run(void *arg)
+{
+    struct import_medium *imp = arg;
+
+    imp->rc = admin_medium_walk(imp->alloc->root_path, import_file, imp);
+
+    pho_info("Found %u extents in %d files on '%s', %d files skipped",
+             imp->extents->len, imp->n_files, imp->alloc->med_id->name,
+             imp->n_skipped);
+
+    return NULL;
+}
+
+/**
+ * Retrieve a medium to import from the DSS. A blank medium is marked as
+ * formatted, its label being its ID as on format, so that the LRS accepts to
+ * mount it.
+ */
+static int import_medium_get(struct admin_handle *adm, const struct pho_id *id,
+                             struct media_info **medium)
+{
+    struct dss_filter filter;
+    int mcnt = 0;
+    int rc;
+
+    rc = dss_filter_build(&filter,
+                          "{\"$AND\": ["
+                          "  {\"DSS::MDA::family\": \"%s\"},"
+                          "  {\"DSS::MDA::id\": \"%s\"}"
+                          "]}", rsc_family2str(id->family), id->name);
+    if (rc)
+        return rc;
+
+    rc = dss_media_get(&adm->dss, &filter, medium, &mcnt);
+    dss_filter_free(&filter);
+    if (rc)
+        return rc;
+
+    if (mcnt != 1)
+        LOG_GOTO(free_medium, rc = -ENXIO, "Medium '%s' not found", id->name);
+
+    if ((*medium)->fs.type != PHO_FS_POSIX && (*medium)->fs.type != PHO_FS_LTFS)
+        LOG_GOTO(free_medium, rc = -ENOTSUP,
+                 "Import of '%s' is not supported, its filesystem is %s",
+                 id->name, fs_type2str((*medium)->fs.type));
+
+    if ((*medium)->fs.status != PHO_FS_STATUS_BLANK)
+        return 0;
+
+    pho_verb("Marking blank medium '%s' as formatted", id->name);
+    (*medium)->fs.status = PHO_FS_STATUS_USED;
+    strncpy((*medium)->fs.label, id->name, sizeof((*medium)->fs.label));
+    (*medium)->fs.label[sizeof((*medium)->fs.label) - 1] = '\0';
+    rc = dss_media_set(&adm->dss, *medium, 1, DSS_SET_UPDATE,
+                       FS_STATUS | FS_LABEL);
+    if (rc)
+        LOG_GOTO(free_medium, rc, "Cannot update the status of '%s'",
+                 id->name);
+
+    return 0;
+
+free_medium:
+    dss_res_free(*medium, mcnt);
+    *medium = NULL;
+    return rc;
+}
+
+/**
+ * Allocate a batch of media at once and scan them in parallel, then give
+ * their extents to \p extents.
+ */
+static int import_scan_batch(struct admin_handle *adm,
+                             struct import_medium *imports, int n,
+                             GPtrArray *extents)
+{
+    struct pho_id *ids;
+    pho_resp_t *resp;
+    guint k;
+    int rc2;
+    int rc;
+    int i;
+    int j;
+
+    ids = calloc(n, sizeof(*ids));
+    if (!ids)
+        return -ENOMEM;
+
+    for (i = 0; i < n; i++)
+        ids[i] = imports[i].medium->rsc.id;
+
+    rc = admin_medium_read_alloc(adm, ids, n, &resp);
+    free(ids);
+    if (rc)
+        LOG_RETURN(rc, "Cannot allocate %d media to import", n);
+
+    /* the LRS does not necessarily answer in the requested order */
+    for (i = 0; i < n; i++) {
+        const pho_resp_read_elt_t *alloc = resp->ralloc->media[i];
+
+        for (j = 0; j < n; j++)
+            if (!strcmp(imports[j].medium->rsc.id.name, alloc->med_id->name))
+                imports[j].alloc = alloc;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (!imports[i].alloc)
+            LOG_GOTO(release, rc = -EPROTO, "Medium '%s' was not allocated",
+                     imports[i].medium->rsc.id.name);
+
+        rc = get_io_adapter((enum fs_type)imports[i].alloc->fs_type,
+                            &imports[i].ioa);
+        if (rc)
+            GOTO(release, rc);
+    }
+
+    for (i = 0; i < n; i++) {
+        rc = pthread_create(&imports[i].thread, NULL, import_medium_run,
+                            &imports[i]);
+        if (rc)
+            LOG_GOTO(join, rc = -rc, "Cannot start the scan of '%s'",
+                     imports[i].medium->rsc.id.name);
+    }
+
+join:
+    /* threads that were started are waited for, whatever happened */
+    for (j = 0; j < i; j++) {
+        pthread_join(imports[j].thread, NULL);
+        rc = rc ? : imports[j].rc;
+    }
+
+release:
+    for (i = 0; i < n; i++) {
+        if (!imports[i].alloc)
+            continue;
+
+        rc2 = admin_medium_release(adm, imports[i].alloc, imports[i].rc, false);
+        rc = rc ? : rc2;
+        imports[i].alloc = NULL;
+    }
+
+    pho_srl_response_free(resp, true);
+
+    for (i = 0; i < n; i++)
+        for (k = 0; k < imports[i].extents->len; k++)
+            g_ptr_array_add(extents, g_ptr_array_index(imports[i].extents, k));
+
+    return rc;
+}
+
+/** Order extents by oid, uuid, version and layout index */
+static int import_extent_cmp(gconstpointer a, gconstpointer b)
+{
+    const struct import_extent *ext_a = *(struct import_extent * const *)a;
+    const struct import_extent *ext_b = *(struct import_extent * const *)b;
+    int rc;
+
+    rc = strcmp(ext_a->oid, ext_b->oid);
+    if (rc)
+        return rc;
+
+    rc = strcmp(ext_a->uuid, ext_b->uuid);
+    if (rc)
+        return rc;
+
+    if (ext_a->version != ext_b->version)
+        return ext_a->version < ext_b->version ? -1 : 1;
+
+    return ext_a->extent.layout_idx - ext_b->extent.layout_idx;
+}
+
+/** Insert a batch of layouts and their objects, then release the layouts */
+static int import_layouts_insert(struct admin_handle *adm,
+                                 struct object_info *obj_ls,
+                                 struct layout_info *lyt_ls, int cnt)
+{
+    int rc;
+    int i;
+
+    rc = dss_layouts_import(&adm->dss, obj_ls, lyt_ls, cnt);
+    if (rc)
+        pho_error(rc, "Cannot insert %d imported layouts", cnt);
+
+    for (i = 0; i < cnt; i++)
+        free(lyt_ls[i].extents);
+
+    return rc;
+}
+
+/**
+ * Mark as deprecated every object of the \p cnt layouts of an oid but the live
+ * one. An oid that was deleted and put again has several generations, one per
+ * uuid, the versions of which restart at 1: the live object is the highest
+ * version of the generation written last. Layouts written without a write time
+ * are only ordered by version.
+ */
+static void import_live_choose(struct object_info *obj_ls,
+                               const int64_t *ctimes, int cnt,
+                               const struct timeval *deprec_time)
+{
+    int64_t live_ctime = -1;
+    int live = 0;
+    int k = 0;
+
+    while (k < cnt) {
+        /* layouts of a uuid are sorted by version */
+        int64_t gen_ctime = ctimes[k];
+        int last = k;
+
+        while (last + 1 < cnt &&
+               !strcmp(obj_ls[last + 1].uuid, obj_ls[k].uuid))
+            gen_ctime = MAX(gen_ctime, ctimes[++last]);
+
+        if (gen_ctime > live_ctime ||
+            (gen_ctime == live_ctime &&
+             obj_ls[last].version > obj_ls[live].version)) {
+            live_ctime = gen_ctime;
+            live = last;
+        }
+
+        k = last + 1;
+    }
+
+    for (k = 0; k < cnt; k++)
+        if (k != live)
+            obj_ls[k].deprec_time = *deprec_time;
+}
+
+/**
+ * Group the extents of the same object version into layouts, and insert them
+ * by batches once the live object of each oid is chosen.
+ */
+static int import_layouts(struct admin_handle *adm, GPtrArray *extents,
+                          int *n_layouts)
+{
+    struct timeval deprec_time;
+    struct object_info *obj_ls;
+    struct layout_info *lyt_ls;
+    int64_t *ctimes;
+    int oid_start = 0;
+    guint i = 0;
+    int cnt = 0;
+    int rc = 0;
+
+    if (extents->len == 0)
+        return 0;
+
+    g_ptr_array_sort(extents, import_extent_cmp);
+    gettimeofday(&deprec_time, NULL);
+
+    /* there are at most as many layouts as extents */
+    obj_ls = calloc(extents->len, sizeof(*obj_ls));
+    lyt_ls = calloc(extents->len, sizeof(*lyt_ls));
+    ctimes = calloc(extents->len, sizeof(*ctimes));
+    if (!obj_ls || !lyt_ls || !ctimes)
+        GOTO(free_lists, rc = -ENOMEM);
+
+    while (i < extents->len) {
+        struct import_extent *first = g_ptr_array_index(extents, i);
+        struct layout_info *layout = &lyt_ls[cnt];
+        guint j = i;
+
+        if (cnt > oid_start && strcmp(first->oid, obj_ls[oid_start].oid)) {
+            /* every layout of the previous oid is known */
+            import_live_choose(&obj_ls[oid_start], &ctimes[oid_start],
+                               cnt - oid_start, &deprec_time);
+            oid_start = cnt;
+
+            if (cnt >= IMPORT_BATCH_LAYOUTS) {
+                rc = import_layouts_insert(adm, obj_ls, lyt_ls, cnt);
+                if (rc)
+                    GOTO(free_lists, cnt = 0);
+
+                *n_layouts += cnt;
+                cnt = 0;
+                oid_start = 0;
+                continue;
+            }
+        }
+
+        while (j < extents->len) {
+            struct import_extent *ext = g_ptr_array_index(extents, j);
+
+            if (strcmp(ext->uuid, first->uuid) ||
+                ext->version != first->version)
+                break;
+            j++;
+        }
+
+        layout->extents = calloc(j - i, sizeof(*layout->extents));
+        if (!layout->extents)
+            GOTO(free_lists, rc = -ENOMEM);
+
+        layout->oid = first->oid;
+        layout->uuid = first->uuid;
+        layout->version = first->version;
+        layout->state = PHO_EXT_ST_SYNC;
+        layout->layout_desc = first->layout_desc;
+        ctimes[cnt] = 0;
+
+        for (; i < j; i++) {
+            struct import_extent *ext = g_ptr_array_index(extents, i);
+
+            ctimes[cnt] = MAX(ctimes[cnt], ext->ctime);
+
+            /* a moved extent may be found on both media until collected */
+            if (layout->ext_count > 0 &&
+                layout->extents[layout->ext_count - 1].layout_idx ==
+                    ext->extent.layout_idx)
+                continue;
+
+            layout->extents[layout->ext_count++] = ext->extent;
+        }
+
+        obj_ls[cnt].oid = first->oid;
+        obj_ls[cnt].uuid = first->uuid;
+        obj_ls[cnt].version = first->version;
+        obj_ls[cnt].user_md = first->user_md;
+        obj_ls[cnt].deprec_time = (struct timeval){0};
+        cnt++;
+    }
+
+    import_live_choose(&obj_ls[oid_start], &ctimes[oid_start],
+                       cnt - oid_start, &deprec_time);
+    rc = import_layouts_insert(adm, obj_ls, lyt_ls, cnt);
+    if (!rc)
+        *n_layouts += cnt;
+    cnt = 0;
+
+free_lists:
+    if (lyt_ls)
+        while (cnt-- > 0)
+            free(lyt_ls[cnt].extents);
+    free(lyt_ls);
+    free(obj_ls);
+    free(ctimes);
+    return rc;
+}
+
+/** Record the number and size of the extent files found on each medium */
+static int import_media_stats(struct admin_handle *adm,
+                              struct import_medium *imports, int n)
+{
+    int rc = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        struct media_info *medium = imports[i].medium;
+        int rc2;
+
+        medium->stats.nb_obj = imports[i].n_files;
+        medium->stats.logc_spc_used = imports[i].size;
+        rc2 = dss_media_set(&adm->dss, medium, 1, DSS_SET_UPDATE,
+                            NB_OBJ | LOGC_SPC_USED);
+        if (rc2)
+            pho_error(rc2, "Cannot update the stats of '%s'",
+                      medium->rsc.id.name);
+        rc = rc ? : rc2;
+    }
+
+    return rc;
+}
+
+int phobos_admin_import(struct admin_handle *adm, const struct pho_id *media,
+                        int n_media, unsigned int parallel, int *n_objects)
+{
+    struct import_medium *imports;
+    GPtrArray *extents;
+    int rc = 0;
+    int i;
+
+    *n_objects = 0;
+    if (n_media <= 0 || parallel == 0)
+        LOG_RETURN(-EINVAL, "Invalid import of %d media by %u", n_media,
+                   parallel);
+
+    imports = calloc(n_media, sizeof(*imports));
+    if (!imports)
+        return -ENOMEM;
+
+    /* extents are owned by this array, the ones of each medium borrow them */
+    extents = g_ptr_array_new_with_free_func(import_extent_free);
+
+    for (i = 0; i < n_media; i++) {
+        imports[i].extents = g_ptr_array_new();
+        rc = import_medium_get(adm, &media[i], &imports[i].medium);
+        if (rc)
+            LOG_GOTO(free_imports, rc, "Cannot import medium '%s'",
+                     media[i].name);
+    }
+
+    for (i = 0; i < n_media; i += (int)parallel) {
+        rc = import_scan_batch(adm, &imports[i],
+                               MIN((int)parallel, n_media - i), extents);
+        if (rc)
+            LOG_GOTO(free_imports, rc, "Scan of the media to import failed");
+    }
+
+    pho_info("Importing %u extents found on %d media", extents->len, n_media);
+
+    rc = import_layouts(adm, extents, n_objects);
+    if (rc)
+        LOG_GOTO(free_imports, rc, "Import stopped after %d object versions",
+                 *n_objects);
+
+    rc = import_media_stats(adm, imports, n_media);
+
+    pho_info("Imported %d object versions", *n_objects);
+
+free_imports:
+    for (i = 0; i < n_media; i++) {
+        if (imports[i].medium)
+            dss_res_free(imports[i].medium, 1);
+        g_ptr_array_free(imports[i].extents, true);
+    }
+    g_ptr_array_free(extents, true);
+    free(imports);
+    return rc;
+}
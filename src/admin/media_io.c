@@ -0,0 +1,368 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: direct access to media
+ *
+ * Helpers of the admin commands working on the content of media (repack,
+ * scrub, gc, import): media are allocated by the LRS and extents are read
+ * directly through the I/O adapters.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "pho_common.h"
+#include "pho_io.h"
+#include "pho_srl_common.h"
+#include "pho_srl_lrs.h"
+#include "admin_utils.h"
+
+/** Size of the buffer used to drain the pipe filled by an extent reader */
+#define EXTENT_READ_BUFFER_SIZE (1024 * 1024)
+
+int admin_lrs_request(struct admin_handle *adm, pho_req_t *req,
+                      pho_resp_t **resp)
+{
+    struct proto_resp proto_resp = {LRS_REQUEST};
+    struct proto_req proto_req = {LRS_REQUEST};
+    int rid = req->id;
+    int rc;
+
+    proto_req.msg.lrs_req = req;
+    rc = _send_and_receive(&adm->phobosd_comm, proto_req, &proto_resp);
+    if (rc)
+        LOG_RETURN(rc, "Error with phobosd communication");
+
+    *resp = proto_resp.msg.lrs_resp;
+    if (pho_response_is_error(*resp)) {
+        rc = (*resp)->error->rc;
+        LOG_GOTO(free_resp, rc, "Received error response to %s request",
+                 pho_srl_error_kind_str((*resp)->error));
+    }
+
+    if ((*resp)->req_id != rid)
+        LOG_GOTO(free_resp, rc = -EPROTO,
+                 "Received response does not answer emitted request");
+
+    return 0;
+
+free_resp:
+    pho_srl_response_free(*resp, true);
+    *resp = NULL;
+    return rc;
+}
+
+int admin_medium_read_alloc(struct admin_handle *adm,
+                            const struct pho_id *media, int n_media,
+                            pho_resp_t **resp)
+{
+    pho_req_t req;
+    int rc;
+    int i;
+
+    rc = pho_srl_request_read_alloc(&req, n_media);
+    if (rc)
+        LOG_RETURN(rc, "Cannot create read allocation request");
+
+    req.id = 1;
+    req.ralloc->n_required = n_media;
+    for (i = 0; i < n_media; i++) {
+        req.ralloc->med_ids[i]->family = media[i].family;
+        req.ralloc->med_ids[i]->name = strdup(media[i].name);
+    }
+
+    rc = admin_lrs_request(adm, &req, resp);
+    if (rc)
+        return rc;
+
+    if (!pho_response_is_read(*resp) || (*resp)->ralloc->n_media != n_media) {
+        pho_srl_response_free(*resp, true);
+        LOG_RETURN(-EPROTO, "Invalid response to read allocation of '%s'",
+                   media[0].name);
+    }
+
+    return 0;
+}
+
+int admin_medium_release(struct admin_handle *adm,
+                         const pho_resp_read_elt_t *medium, int rc,
+                         bool to_sync)
+{
+    struct proto_req proto_req = {LRS_REQUEST};
+    pho_resp_t *resp;
+    pho_req_t req;
+    int rc2;
+
+    rc2 = pho_srl_request_release_alloc(&req, 1);
+    if (rc2)
+        LOG_RETURN(rc2, "Cannot create release request");
+
+    req.id = 2;
+    rsc_id_cpy(req.release->media[0]->med_id, medium->med_id);
+    req.release->media[0]->rc = rc;
+    req.release->media[0]->size_written = 0;
+    req.release->media[0]->to_sync = to_sync;
+
+    if (!to_sync) {
+        proto_req.msg.lrs_req = &req;
+        rc2 = _send(&adm->phobosd_comm, proto_req);
+        if (rc2)
+            LOG_RETURN(rc2, "Error with phobosd communication");
+
+        return 0;
+    }
+
+    rc2 = admin_lrs_request(adm, &req, &resp);
+    if (rc2)
+        LOG_RETURN(rc2, "Cannot sync medium '%s'", medium->med_id->name);
+
+    if (!pho_response_is_release(resp))
+        pho_error(rc2 = -EPROTO, "Invalid response to release request");
+
+    pho_srl_response_free(resp, true);
+    return rc2;
+}
+
+int admin_extent_remove(struct io_adapter_module *ioa,
+                        const pho_resp_read_elt_t *alloc,
+                        struct extent *extent)
+{
+    struct pho_io_descr iod = {0};
+    struct pho_ext_loc loc;
+    int rc;
+
+    loc.root_path = alloc->root_path;
+    loc.extent = extent;
+    loc.addr_type = (enum address_type)alloc->addr_type;
+    iod.iod_loc = &loc;
+
+    rc = ioa_del(ioa, &iod);
+    if (rc == -ENOENT) {
+        pho_verb("Extent '%s' is already missing from '%s'",
+                 extent->address.buff, extent->media.name);
+        rc = 0;
+    }
+
+    return rc;
+}
+
+/** Read side of an extent, run by a dedicated thread */
+struct extent_reader {
+    struct io_adapter_module *ioa;
+    struct pho_io_descr iod;
+    const char *oid;
+    int rc;
+};
+
+static void *extent_reader_run(void *arg)
+{
+    struct extent_reader *reader = arg;
+
+    reader->rc = ioa_get(reader->ioa, NULL, reader->oid, &reader->iod);
+
+    /* signal the end of the extent to the consumer */
+    close(reader->iod.iod_fd);
+    reader->iod.iod_fd = -1;
+
+    return NULL;
+}
+
+int admin_extent_read(struct io_adapter_module *ioa, struct pho_ext_loc *loc,
+                      const char *oid, struct pho_attrs *attrs,
+                      admin_extent_chunk_cb_t chunk_cb, void *udata)
+{
+    struct extent_reader reader = {0};
+    const char *address;
+    pthread_t thread;
+    size_t n_read = 0;
+    int pipefd[2];
+    char *buffer;
+    int rc = 0;
+
+    address = loc->extent->address.buff;
+    buffer = malloc(EXTENT_READ_BUFFER_SIZE);
+    if (!buffer)
+        return -ENOMEM;
+
+    if (pipe(pipefd))
+        LOG_GOTO(free_buffer, rc = -errno, "Cannot create pipe");
+
+    reader.ioa = ioa;
+    reader.oid = oid;
+    reader.iod.iod_flags = PHO_IO_NO_REUSE;
+    reader.iod.iod_fd = pipefd[1];
+    reader.iod.iod_size = loc->extent->size;
+    reader.iod.iod_loc = loc;
+    if (attrs)
+        reader.iod.iod_attrs = *attrs;
+
+    rc = pthread_create(&thread, NULL, extent_reader_run, &reader);
+    if (rc) {
+        close(pipefd[1]);
+        close(pipefd[0]);
+        LOG_GOTO(free_buffer, rc = -rc, "Cannot start extent reader");
+    }
+
+    /* the pipe is drained up to its end so that the reader never blocks */
+    while (true) {
+        ssize_t n = read(pipefd[0], buffer, EXTENT_READ_BUFFER_SIZE);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0) {
+            pho_error(rc = -errno, "Cannot read extent '%s' from pipe",
+                      address);
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        if (!rc)
+            rc = chunk_cb(buffer, n, udata);
+
+        n_read += n;
+    }
+
+    close(pipefd[0]);
+    pthread_join(thread, NULL);
+
+    /* retrieved attributes are given back to the caller */
+    if (attrs)
+        *attrs = reader.iod.iod_attrs;
+
+    if (reader.rc)
+        LOG_GOTO(free_buffer, rc = reader.rc, "Cannot read extent '%s' on '%s'",
+                 address, loc->extent->media.name);
+
+    if (rc)
+        goto free_buffer;
+
+    if (n_read != loc->extent->size)
+        LOG_GOTO(free_buffer, rc = -EIO,
+                 "Extent '%s' is %zu bytes long, expected %zd", address,
+                 n_read, loc->extent->size);
+
+free_buffer:
+    free(buffer);
+    return rc;
+}
+
+/** State of a walk of a medium */
+struct medium_walk {
+    const char *root_path;
+    admin_medium_file_cb_t file_cb;
+    void *udata;
+    int rc;                     /**< First error met */
+};
+
+/** Walk the directory \p relpath of the medium root, NULL for the root */
+static void medium_walk_dir(struct medium_walk *walk, const char *relpath)
+{
+    struct dirent *entry;
+    char *path;
+    DIR *dir;
+
+    if (relpath) {
+        if (asprintf(&path, "%s/%s", walk->root_path, relpath) < 0) {
+            walk->rc = walk->rc ? : -ENOMEM;
+            return;
+        }
+    } else {
+        path = strdup(walk->root_path);
+        if (!path) {
+            walk->rc = walk->rc ? : -ENOMEM;
+            return;
+        }
+    }
+
+    dir = opendir(path);
+    if (!dir) {
+        int rc = -errno;
+
+        pho_error(rc, "Cannot open directory '%s'", path);
+        walk->rc = walk->rc ? : rc;
+        free(path);
+        return;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        struct stat st;
+        char *child;
+        int rc;
+
+        if (entry->d_name[0] == '.')
+            continue;
+
+        if (relpath)
+            rc = asprintf(&child, "%s/%s", relpath, entry->d_name);
+        else
+            rc = asprintf(&child, "%s", entry->d_name);
+        if (rc < 0) {
+            walk->rc = walk->rc ? : -ENOMEM;
+            break;
+        }
+
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW)) {
+            rc = -errno;
+            pho_error(rc, "Cannot stat '%s/%s'", path, entry->d_name);
+            walk->rc = walk->rc ? : rc;
+        } else if (S_ISDIR(st.st_mode)) {
+            medium_walk_dir(walk, child);
+        } else if (S_ISREG(st.st_mode)) {
+            rc = walk->file_cb(child, &st, walk->udata);
+            walk->rc = walk->rc ? : rc;
+        }
+
+        free(child);
+    }
+
+    closedir(dir);
+    free(path);
+}
+
+int admin_medium_walk(const char *root_path, admin_medium_file_cb_t file_cb,
+                      void *udata)
+{
+    struct medium_walk walk = {
+        .root_path = root_path,
+        .file_cb = file_cb,
+        .udata = udata,
+    };
+
+    medium_walk_dir(&walk, NULL);
+
+    return walk.rc;
+}
@@ -0,0 +1,369 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: migration of extents between
+ *         families
+ *
+ * The extents of a source medium are copied by batches, each batch being
+ * written one extent after the other on a single destination medium, which
+ * is synced once per batch instead of once per object. Used by the flush of
+ * staged objects and by tiering.
+ *
+ * When the source and destination media belong to the same family, they are
+ * allocated by a single mixed request. Otherwise they are handled by different
+ * LRS schedulers and allocated by two requests, always in the order of their
+ * families, so that concurrent migrations in opposite directions never each
+ * hold the drive the other one waits for.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_io.h"
+#include "pho_srl_common.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+/** Maximum number of layouts migrated under the same pair of allocations */
+#define MIGRATE_BATCH_LAYOUTS   1024
+
+static int migrate_write_alloc(struct admin_handle *adm,
+                               enum rsc_family family, const struct tags *tags,
+                               size_t size, pho_resp_t **resp)
+{
+    size_t n_tags = tags ? tags->n_tags : 0;
+    pho_req_t req;
+    size_t i;
+    int rc;
+
+    rc = pho_srl_request_write_alloc(&req, 1, &n_tags);
+    if (rc)
+        LOG_RETURN(rc, "Cannot create write allocation request");
+
+    req.id = 1;
+    req.walloc->family = family;
+    req.walloc->media[0]->size = size;
+    for (i = 0; i < n_tags; i++)
+        req.walloc->media[0]->tags[i] = strdup(tags->tags[i]);
+
+    rc = admin_lrs_request(adm, &req, resp);
+    if (rc)
+        return rc;
+
+    if (!pho_response_is_write(*resp) || (*resp)->walloc->n_media != 1) {
+        pho_srl_response_free(*resp, true);
+        LOG_RETURN(-EPROTO, "Invalid response to write allocation on %s",
+                   rsc_family2str(family));
+    }
+
+    return 0;
+}
+
+/**
+ * Release the destination medium of a batch, which is synced if anything was
+ * written to it. The copies are only safe once the release response is
+ * received.
+ */
+static int migrate_write_release(struct admin_handle *adm,
+                                 const pho_resp_write_elt_t *dst, int rc,
+                                 size_t written)
+{
+    struct proto_req proto_req = {LRS_REQUEST};
+    pho_resp_t *resp;
+    pho_req_t req;
+    int rc2;
+
+    rc2 = pho_srl_request_release_alloc(&req, 1);
+    if (rc2)
+        LOG_RETURN(rc2, "Cannot create release request");
+
+    req.id = 2;
+    rsc_id_cpy(req.release->media[0]->med_id, dst->med_id);
+    req.release->media[0]->rc = rc;
+    req.release->media[0]->size_written = written;
+    req.release->media[0]->to_sync = written > 0;
+
+    if (written == 0) {
+        proto_req.msg.lrs_req = &req;
+        rc2 = _send(&adm->phobosd_comm, proto_req);
+        if (rc2)
+            LOG_RETURN(rc2, "Error with phobosd communication");
+
+        return 0;
+    }
+
+    rc2 = admin_lrs_request(adm, &req, &resp);
+    if (rc2)
+        LOG_RETURN(rc2, "Cannot flush medium '%s'", dst->med_id->name);
+
+    if (!pho_response_is_release(resp))
+        pho_error(rc2 = -EPROTO, "Invalid response to release request");
+
+    pho_srl_response_free(resp, true);
+    return rc2;
+}
+
+/**
+ * Allocate \p source for reading and a medium of \p family for writing, see
+ * the ordering rules at the top of this file.
+ *
+ * \param[out]  src_resp    Response holding the source in ralloc->media[0]
+ * \param[out]  dst_resp    Response holding the destination in
+ *                          walloc->media[0], NULL if it is \p src_resp (mixed
+ *                          allocation)
+ */
+static int migrate_alloc(struct admin_handle *adm, const struct pho_id *source,
+                         enum rsc_family family, const struct tags *tags,
+                         size_t size, pho_resp_t **src_resp,
+                         pho_resp_t **dst_resp)
+{
+    int rc;
+
+    *dst_resp = NULL;
+
+    if (source->family == family) {
+        rc = admin_medium_mixed_alloc(adm, source, tags, size, src_resp);
+        if (rc)
+            LOG_RETURN(rc, "Cannot allocate '%s' and a medium to migrate it",
+                       source->name);
+        return 0;
+    }
+
+    if (family < source->family) {
+        rc = migrate_write_alloc(adm, family, tags, size, dst_resp);
+        if (rc)
+            LOG_RETURN(rc, "Cannot allocate a %s medium to migrate '%s'",
+                       rsc_family2str(family), source->name);
+    }
+
+    rc = admin_medium_read_alloc(adm, source, 1, src_resp);
+    if (rc) {
+        pho_error(rc, "Cannot allocate source medium '%s'", source->name);
+        if (*dst_resp) {
+            migrate_write_release(adm, (*dst_resp)->walloc->media[0], rc, 0);
+            pho_srl_response_free(*dst_resp, true);
+        }
+        return rc;
+    }
+
+    if (family > source->family) {
+        rc = migrate_write_alloc(adm, family, tags, size, dst_resp);
+        if (rc) {
+            pho_error(rc, "Cannot allocate a %s medium to migrate '%s'",
+                      rsc_family2str(family), source->name);
+            admin_medium_release(adm, (*src_resp)->ralloc->media[0], rc,
+                                 false);
+            pho_srl_response_free(*src_resp, true);
+            return rc;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Remove the source copies of the first \p n_moved layouts of \p lyt_ls,
+ * whose extents now point to their destination. Failures are only logged:
+ * the remaining copies are unknown to the DSS and can be collected by
+ * "phobos gc --scan". The data of deduplicated objects that other layouts
+ * still refer to on the source is kept.
+ *
+ * \return the number of source extents removed, or -errno if none could be.
+ */
+static int migrate_remove_sources(struct dss_handle *dss,
+                                  const struct pho_id *source,
+                                  const pho_resp_read_elt_t *src,
+                                  struct layout_info *lyt_ls, int n_moved)
+{
+    struct io_adapter_module *ioa;
+    int n_removed = 0;
+    int rc;
+    int i;
+    int j;
+
+    rc = get_io_adapter((enum fs_type)src->fs_type, &ioa);
+    if (rc)
+        LOG_RETURN(rc, "Cannot get the I/O adapter of '%s'", source->name);
+
+    for (i = 0; i < n_moved; i++) {
+        for (j = 0; j < lyt_ls[i].ext_count; j++) {
+            struct extent old = lyt_ls[i].extents[j];
+            int refs;
+
+            rc = dss_extent_refcount_get(dss, source, old.address.buff, &refs);
+            if (!rc && refs > 0) {
+                pho_verb("Keeping extent '%s' on '%s', shared with %d other "
+                         "layouts", old.address.buff, source->name, refs);
+                continue;
+            }
+
+            old.media = *source;
+            rc = admin_extent_remove(ioa, src, &old);
+            if (rc)
+                pho_warn("Cannot remove extent '%s' from '%s': %s",
+                         old.address.buff, source->name, strerror(-rc));
+            else
+                n_removed++;
+        }
+    }
+
+    return n_removed;
+}
+
+/**
+ * Copy a batch of layouts to a single medium of \p family, switch their
+ * location in the DSS, then remove their source copies.
+ *
+ * \param[out]  n_moved     Number of layouts of \p lyt_ls migrated.
+ */
+static int migrate_batch(struct admin_handle *adm, const struct pho_id *source,
+                         enum rsc_family family, const struct tags *tags,
+                         struct layout_info *lyt_ls, int lyt_cnt,
+                         int *n_moved)
+{
+    const pho_resp_write_elt_t *dst;
+    const pho_resp_read_elt_t *src;
+    pho_resp_t *src_resp;
+    pho_resp_t *dst_resp;
+    size_t written = 0;
+    int n_removed = 0;
+    size_t size = 0;
+    int rc2;
+    int rc;
+    int i;
+    int j;
+
+    *n_moved = 0;
+    for (i = 0; i < lyt_cnt; i++)
+        size += admin_layout_size(&lyt_ls[i]);
+
+    rc = migrate_alloc(adm, source, family, tags, size, &src_resp,
+                       &dst_resp);
+    if (rc)
+        return rc;
+
+    src = src_resp->ralloc->media[0];
+    dst = (dst_resp ? : src_resp)->walloc->media[0];
+
+    for (i = 0; i < lyt_cnt && !rc; i++) {
+        struct layout_info *layout = &lyt_ls[i];
+        struct extent *moved;
+        size_t lyt_size;
+
+        lyt_size = admin_layout_size(layout);
+        if (written + lyt_size > dst->avail_size) {
+            if (i == 0)
+                LOG_GOTO(release_dst, rc = -ENOSPC,
+                         "Not enough space on '%s' for object '%s'",
+                         dst->med_id->name, layout->oid);
+            break;
+        }
+
+        moved = calloc(layout->ext_count, sizeof(*moved));
+        if (!moved)
+            LOG_GOTO(release_dst, rc = -ENOMEM, "Cannot allocate extents");
+
+        for (j = 0; j < layout->ext_count && !rc; j++)
+            rc = admin_extent_copy(src, dst, layout->oid,
+                                   &layout->extents[j], &moved[j]);
+
+        if (rc) {
+            /* a layout is migrated as a whole or not at all */
+            while (--j > 0)
+                admin_extent_copy_del(dst, &moved[j - 1]);
+
+            free(moved);
+            pho_error(rc, "Cannot migrate object '%s'", layout->oid);
+            break;
+        }
+
+        written += lyt_size;
+
+        for (j = 0; j < layout->ext_count; j++)
+            layout->extents[j].media = moved[j].media;
+
+        free(moved);
+        (*n_moved)++;
+    }
+
+release_dst:
+    rc2 = migrate_write_release(adm, dst, rc, written);
+    if (!rc)
+        rc = rc2;
+
+    if (dst_resp)
+        pho_srl_response_free(dst_resp, true);
+
+    /* the copies are only referenced once the destination is synced */
+    if (*n_moved > 0 && !rc2) {
+        rc2 = dss_layout_extents_move(&adm->dss, source, lyt_ls, *n_moved);
+        if (rc2)
+            pho_error(rc2, "Cannot record the new location of %d objects",
+                      *n_moved);
+        else
+            n_removed = migrate_remove_sources(&adm->dss, source, src, lyt_ls,
+                                               *n_moved);
+        if (!rc)
+            rc = rc2;
+    }
+
+    rc2 = admin_medium_release(adm, src, rc, n_removed > 0);
+    if (!rc)
+        rc = rc2;
+
+    pho_srl_response_free(src_resp, true);
+    return rc;
+}
+
+int admin_medium_migrate(struct admin_handle *adm, const struct pho_id *source,
+                         enum rsc_family family, const struct tags *tags,
+                         struct layout_info *lyt_ls, int lyt_cnt,
+                         int *n_moved)
+{
+    int rc = 0;
+
+    *n_moved = 0;
+    while (*n_moved < lyt_cnt) {
+        int batch = lyt_cnt - *n_moved;
+        int n_batch;
+
+        if (batch > MIGRATE_BATCH_LAYOUTS)
+            batch = MIGRATE_BATCH_LAYOUTS;
+
+        rc = migrate_batch(adm, source, family, tags, lyt_ls + *n_moved,
+                           batch, &n_batch);
+        *n_moved += n_batch;
+        if (rc)
+            break;
+    }
+
+    return rc;
+}
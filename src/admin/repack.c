@@ -0,0 +1,489 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: medium repack
+ *
+ * The live extents of a source medium are copied, batch by batch, to media
+ * allocated by the LRS. Each extent is streamed from the source to the
+ * destination through a pipe, without any local staging, and the DSS is
+ * updated once per batch so that a layout never references a half-moved
+ * extent.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pho_attrs.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_io.h"
+#include "pho_layout.h"
+#include "pho_srl_common.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+/** Maximum number of layouts copied under the same pair of allocations */
+#define REPACK_BATCH_LAYOUTS    256
+
+/** Extended attributes carried from the source extent to its copy */
+static const char * const repack_xattrs[] = {
+    PHO_EA_ID_NAME,
+    PHO_EA_UUID_NAME,
+    PHO_EA_VERSION_NAME,
+    PHO_EA_CTIME_NAME,
+    PHO_EA_LAYOUT_NAME,
+    PHO_EA_LAYOUT_IDX_NAME,
+    PHO_EA_UMD_NAME,
+    PHO_EA_MD5_NAME,
+    PHO_EA_XXH128_NAME,
+    PHO_EA_CRC32C_NAME,
+};
+
+/** Destination of an extent copy */
+struct repack_copy {
+    struct io_adapter_module *ioa;
+    struct pho_io_descr *iod;
+    const char *address;
+    const char *medium;
+};
+
+int admin_medium_mixed_alloc(struct admin_handle *adm,
+                             const struct pho_id *source,
+                             const struct tags *tags, size_t size,
+                             pho_resp_t **resp)
+{
+    size_t n_tags = tags ? tags->n_tags : 0;
+    pho_req_t req;
+    size_t i;
+    int rc;
+
+    rc = pho_srl_request_mixed_alloc(&req, 1, 1, &n_tags);
+    if (rc)
+        LOG_RETURN(rc, "Cannot create mixed allocation request");
+
+    req.id = 1;
+    req.ralloc->med_ids[0]->family = source->family;
+    req.ralloc->med_ids[0]->name = strdup(source->name);
+    req.walloc->family = source->family;
+    req.walloc->media[0]->size = size;
+    for (i = 0; i < n_tags; i++)
+        req.walloc->media[0]->tags[i] = strdup(tags->tags[i]);
+
+    rc = admin_lrs_request(adm, &req, resp);
+    if (rc)
+        return rc;
+
+    if (!pho_response_is_mixed(*resp) || (*resp)->ralloc->n_media != 1 ||
+        (*resp)->walloc->n_media != 1) {
+        pho_srl_response_free(*resp, true);
+        LOG_RETURN(-EPROTO, "Invalid response to mixed allocation of '%s'",
+                   source->name);
+    }
+
+    return 0;
+}
+
+/**
+ * Release the media of a batch. The destination is flushed if anything was
+ * written to it, in which case the release response is waited for.
+ */
+static int repack_release(struct admin_handle *adm,
+                          const pho_resp_read_elt_t *src, int read_rc,
+                          const pho_resp_write_elt_t *dst, size_t written)
+{
+    struct proto_req proto_req = {LRS_REQUEST};
+    pho_resp_t *resp;
+    pho_req_t req;
+    int rc;
+
+    rc = pho_srl_request_release_alloc(&req, dst ? 2 : 1);
+    if (rc)
+        LOG_RETURN(rc, "Cannot create release request");
+
+    req.id = 3;
+    rsc_id_cpy(req.release->media[0]->med_id, src->med_id);
+    req.release->media[0]->rc = read_rc;
+    req.release->media[0]->size_written = 0;
+    req.release->media[0]->to_sync = false;
+
+    if (dst) {
+        rsc_id_cpy(req.release->media[1]->med_id, dst->med_id);
+        req.release->media[1]->rc = 0;
+        req.release->media[1]->size_written = written;
+        req.release->media[1]->to_sync = written > 0;
+    }
+
+    if (!dst || written == 0) {
+        proto_req.msg.lrs_req = &req;
+        rc = _send(&adm->phobosd_comm, proto_req);
+        if (rc)
+            LOG_RETURN(rc, "Error with phobosd communication");
+
+        return 0;
+    }
+
+    rc = admin_lrs_request(adm, &req, &resp);
+    if (rc)
+        LOG_RETURN(rc, "Cannot flush medium '%s'", dst->med_id->name);
+
+    if (!pho_response_is_release(resp))
+        pho_error(rc = -EPROTO, "Invalid response to release request");
+
+    pho_srl_response_free(resp, true);
+    return rc;
+}
+
+static int repack_write_chunk(const void *buffer, size_t size, void *udata)
+{
+    struct repack_copy *copy = udata;
+    int rc;
+
+    rc = ioa_write(copy->ioa, copy->iod, buffer, size);
+    if (rc)
+        pho_error(rc, "Cannot write copy of extent '%s' on '%s'",
+                  copy->address, copy->medium);
+
+    return rc;
+}
+
+static int copy_xattr_cb(const char *key, const char *value, void *udata)
+{
+    /* attributes missing from the source are not created on the copy */
+    if (value == NULL)
+        return 0;
+
+    return pho_attr_set(udata, key, value);
+}
+
+int admin_extent_copy(const pho_resp_read_elt_t *src,
+                      const pho_resp_write_elt_t *dst, const char *oid,
+                      struct extent *src_ext, struct extent *dst_ext)
+{
+    struct pho_attrs src_attrs = {0};
+    struct pho_attrs src_refs = {0};
+    struct io_adapter_module *ioa;
+    struct pho_io_descr iod = {0};
+    struct repack_copy copy;
+    struct pho_ext_loc src_loc;
+    struct pho_ext_loc dst_loc;
+    int n_refs;
+    int rc2;
+    int rc;
+    int i;
+
+    rc = get_io_adapter((enum fs_type)src->fs_type, &ioa);
+    if (rc)
+        return rc;
+
+    *dst_ext = *src_ext;
+    dst_ext->media.family = (enum rsc_family)dst->med_id->family;
+    rc = pho_id_name_set(&dst_ext->media, dst->med_id->name);
+    if (rc)
+        return rc;
+
+    dst_loc.root_path = dst->root_path;
+    dst_loc.extent = dst_ext;
+    dst_loc.addr_type = (enum address_type)dst->addr_type;
+    iod.iod_flags = PHO_IO_REPLACE | PHO_IO_NO_REUSE;
+    iod.iod_loc = &dst_loc;
+
+    rc = ioa_open(ioa, NULL, oid, &iod, true);
+    if (rc)
+        LOG_RETURN(rc, "Cannot open copy of extent '%s' on '%s'",
+                   src_ext->address.buff, dst->med_id->name);
+
+    for (i = 0; i < sizeof(repack_xattrs) / sizeof(*repack_xattrs); i++) {
+        rc = pho_attr_set(&src_attrs, repack_xattrs[i], NULL);
+        if (rc)
+            goto free_attrs;
+    }
+
+    src_loc.root_path = src->root_path;
+    src_loc.extent = src_ext;
+    src_loc.addr_type = (enum address_type)src->addr_type;
+    copy.ioa = ioa;
+    copy.iod = &iod;
+    copy.address = src_ext->address.buff;
+    copy.medium = dst->med_id->name;
+
+    rc = admin_extent_read(ioa, &src_loc, oid, &src_attrs, repack_write_chunk,
+                           &copy);
+    if (rc)
+        goto free_attrs;
+
+    rc = pho_attrs_foreach(&src_attrs, copy_xattr_cb, &iod.iod_attrs);
+    if (rc)
+        goto free_attrs;
+
+    /* the object versions sharing the extent are recorded on its copy too */
+    rc = get_extent_refs(ioa, &src_loc, &src_refs, &n_refs);
+    rc = rc ? : pho_attrs_foreach(&src_refs, copy_xattr_cb, &iod.iod_attrs);
+    if (rc)
+        LOG_GOTO(free_attrs, rc, "Cannot copy the references of extent '%s'",
+                 src_ext->address.buff);
+
+    iod.iod_flags = PHO_IO_MD_ONLY;
+    rc = ioa_set_md(ioa, NULL, oid, &iod);
+    if (rc)
+        pho_error(rc, "Cannot set attributes of copy of extent '%s'",
+                  src_ext->address.buff);
+
+free_attrs:
+    pho_attrs_free(&src_refs);
+    pho_attrs_free(&src_attrs);
+    pho_attrs_free(&iod.iod_attrs);
+    rc2 = ioa_close(ioa, &iod);
+    if (!rc && rc2)
+        pho_error(rc = rc2, "Cannot close copy of extent '%s'",
+                  src_ext->address.buff);
+
+    if (rc) {
+        rc2 = ioa_del(ioa, &iod);
+        if (rc2 && rc2 != -ENOENT)
+            pho_warn("Cannot remove partial copy of extent '%s': %s",
+                     src_ext->address.buff, strerror(-rc2));
+    }
+
+    return rc;
+}
+
+void admin_extent_copy_del(const pho_resp_write_elt_t *dst,
+                           struct extent *copy)
+{
+    struct io_adapter_module *ioa;
+    struct pho_io_descr iod = {0};
+    struct pho_ext_loc loc;
+    int rc;
+
+    rc = get_io_adapter((enum fs_type)dst->fs_type, &ioa);
+    if (rc)
+        return;
+
+    loc.root_path = dst->root_path;
+    loc.extent = copy;
+    loc.addr_type = (enum address_type)dst->addr_type;
+    iod.iod_loc = &loc;
+
+    rc = ioa_del(ioa, &iod);
+    if (rc)
+        pho_warn("Cannot remove copy of extent '%s' from '%s': %s",
+                 copy->address.buff, dst->med_id->name, strerror(-rc));
+}
+
+size_t admin_layout_size(const struct layout_info *layout)
+{
+    size_t size = 0;
+    int i;
+
+    for (i = 0; i < layout->ext_count; i++)
+        size += layout->extents[i].size;
+
+    return size;
+}
+
+/**
+ * Copy a batch of layouts to a newly allocated medium, then record the new
+ * location of the fully copied layouts in a single DSS transaction.
+ *
+ * \param[out]  n_moved     Number of layouts of \p lyt_ls moved to the
+ *                          destination.
+ */
+static int repack_batch(struct admin_handle *adm, const struct pho_id *source,
+                        const struct tags *tags, struct layout_info *lyt_ls,
+                        int lyt_cnt, int *n_moved)
+{
+    const pho_resp_write_elt_t *dst;
+    const pho_resp_read_elt_t *src;
+    pho_resp_t *resp;
+    size_t written = 0;
+    size_t size = 0;
+    int rc2;
+    int rc;
+    int i;
+    int j;
+
+    *n_moved = 0;
+    for (i = 0; i < lyt_cnt; i++)
+        size += admin_layout_size(&lyt_ls[i]);
+
+    rc = admin_medium_mixed_alloc(adm, source, tags, size, &resp);
+    if (rc)
+        LOG_RETURN(rc, "Cannot allocate source medium '%s' and a destination",
+                   source->name);
+
+    src = resp->ralloc->media[0];
+    dst = resp->walloc->media[0];
+    if ((int)dst->med_id->family == (int)source->family &&
+        !strcmp(dst->med_id->name, source->name))
+        LOG_GOTO(release, rc = -EINVAL,
+                 "'%s' was allocated as its own repack destination",
+                 source->name);
+
+    for (i = 0; i < lyt_cnt && !rc; i++) {
+        struct layout_info *layout = &lyt_ls[i];
+        struct extent *moved;
+        size_t lyt_size;
+
+        lyt_size = admin_layout_size(layout);
+        if (written + lyt_size > dst->avail_size) {
+            if (i == 0)
+                LOG_GOTO(release, rc = -ENOSPC,
+                         "Not enough space on '%s' for object '%s'",
+                         dst->med_id->name, layout->oid);
+            break;
+        }
+
+        moved = calloc(layout->ext_count, sizeof(*moved));
+        if (!moved)
+            LOG_GOTO(release, rc = -ENOMEM, "Cannot allocate extents");
+
+        for (j = 0; j < layout->ext_count && !rc; j++)
+            rc = admin_extent_copy(src, dst, layout->oid,
+                                   &layout->extents[j], &moved[j]);
+
+        if (rc) {
+            /* a layout is moved as a whole or not at all */
+            while (--j > 0)
+                admin_extent_copy_del(dst, &moved[j - 1]);
+
+            free(moved);
+            pho_error(rc, "Cannot move object '%s'", layout->oid);
+            break;
+        }
+
+        written += lyt_size;
+
+        /* only the new location is needed from now on */
+        for (j = 0; j < layout->ext_count; j++)
+            layout->extents[j].media = moved[j].media;
+
+        free(moved);
+        (*n_moved)++;
+    }
+
+release:
+    rc2 = repack_release(adm, src, rc, dst, written);
+    if (!rc)
+        rc = rc2;
+
+    pho_srl_response_free(resp, true);
+
+    /* the copies are only referenced once the destination is flushed */
+    if (*n_moved > 0 && !rc2) {
+        rc2 = dss_layout_extents_move(&adm->dss, source, lyt_ls, *n_moved);
+        if (rc2)
+            pho_error(rc2, "Cannot record the new location of %d objects",
+                      *n_moved);
+        if (!rc)
+            rc = rc2;
+    }
+
+    return rc;
+}
+
+/**
+ * Prevent new data from being written on the source medium, which also keeps
+ * the LRS from picking it as a repack destination.
+ */
+static int repack_close_source(struct admin_handle *adm,
+                               const struct pho_id *source)
+{
+    struct dss_filter filter;
+    struct media_info *media;
+    int mcnt = 0;
+    int rc;
+
+    rc = dss_filter_build(&filter,
+                          "{\"$AND\": ["
+                          "  {\"DSS::MDA::family\": \"%s\"},"
+                          "  {\"DSS::MDA::id\": \"%s\"}"
+                          "]}", rsc_family2str(source->family), source->name);
+    if (rc)
+        return rc;
+
+    rc = dss_media_get(&adm->dss, &filter, &media, &mcnt);
+    dss_filter_free(&filter);
+    if (rc)
+        return rc;
+
+    if (mcnt != 1)
+        LOG_GOTO(free_media, rc = -ENXIO, "Medium '%s' not found",
+                 source->name);
+
+    media->flags.put = false;
+    rc = dss_media_set(&adm->dss, media, 1, DSS_SET_UPDATE, PUT_ACCESS);
+
+free_media:
+    dss_res_free(media, mcnt);
+    return rc;
+}
+
+int phobos_admin_repack(struct admin_handle *adm, const struct pho_id *source,
+                        const struct tags *tags)
+{
+    struct layout_info *lyt_ls;
+    int lyt_cnt = 0;
+    int done = 0;
+    int rc;
+
+    if (source->family == PHO_RSC_RADOS_POOL)
+        LOG_RETURN(-ENOTSUP, "Repack of RADOS pools is not supported");
+
+    rc = repack_close_source(adm, source);
+    if (rc)
+        LOG_RETURN(rc, "Cannot disable put access on '%s'", source->name);
+
+    rc = dss_medium_live_extents_get(&adm->dss, source, &lyt_ls, &lyt_cnt);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the extents of '%s'", source->name);
+
+    pho_info("Repacking %d objects from '%s'", lyt_cnt, source->name);
+
+    while (done < lyt_cnt) {
+        int n_moved;
+        int batch = lyt_cnt - done;
+
+        if (batch > REPACK_BATCH_LAYOUTS)
+            batch = REPACK_BATCH_LAYOUTS;
+
+        rc = repack_batch(adm, source, tags, lyt_ls + done, batch, &n_moved);
+        done += n_moved;
+        if (rc)
+            break;
+    }
+
+    dss_res_free(lyt_ls, lyt_cnt);
+
+    if (rc)
+        LOG_RETURN(rc, "Repack of '%s' stopped after %d of %d objects",
+                   source->name, done, lyt_cnt);
+
+    pho_info("Repacked %d objects from '%s'", done, source->name);
+    return 0;
+}
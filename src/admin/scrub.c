@@ -0,0 +1,436 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: medium scrub
+ *
+ * The synced extents of a medium are read in on-media order and their
+ * checksums are recomputed, the same way as when they were written, to detect
+ * silent corruption. The order is given by the I/O adapter of the medium where
+ * it knows the position of the extents, e.g. their start block on LTFS, and is
+ * only approximated by their address otherwise. The medium is allocated by the LRS for a bounded batch of
+ * extents at a time, and the throughput of the scrub is capped, so that
+ * client I/O is not starved.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pho_checksum.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_io.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+/**
+ * Maximum number of extents verified under the same allocation, the medium is
+ * then released so that pending client requests can be scheduled.
+ */
+#define SCRUB_BATCH_EXTENTS     64
+
+/** Bandwidth and IOPS limits of a scrub */
+struct scrub_throttle {
+    size_t bandwidth;           /**< Bytes per second, 0 if unlimited */
+    unsigned int iops;          /**< Extents per second, 0 if unlimited */
+    struct timespec start;      /**< Start of the scrub */
+    size_t bytes;               /**< Bytes read since the start */
+    size_t ios;                 /**< Extents read since the start */
+};
+
+/** Extent to verify */
+struct scrub_entry {
+    struct layout_info *layout;
+    struct extent *extent;
+    uint64_t position;          /**< Position of the extent on the medium */
+    int rank;                   /**< Rank of the extent in address order */
+};
+
+/** Extents to verify and position of the next one */
+struct scrub_cursor {
+    struct scrub_entry *entries;
+    int n_entries;
+    int next;
+};
+
+/** State of the verification of one extent */
+struct scrub_extent {
+    struct pho_checksum checksum;
+    struct scrub_throttle *throttle;
+};
+
+/**
+ * Account for \p bytes and \p ios more, and sleep as long as needed to keep
+ * the scrub under its limits.
+ */
+static void scrub_throttle(struct scrub_throttle *throttle, size_t bytes,
+                           size_t ios)
+{
+    struct timespec elapsed;
+    struct timespec now;
+    double wait = 0.;
+    double spent;
+
+    throttle->bytes += bytes;
+    throttle->ios += ios;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = diff_timespec(&now, &throttle->start);
+    spent = elapsed.tv_sec + elapsed.tv_nsec / 1000000000.;
+
+    if (throttle->bandwidth &&
+        (double)throttle->bytes / throttle->bandwidth - spent > wait)
+        wait = (double)throttle->bytes / throttle->bandwidth - spent;
+
+    if (throttle->iops &&
+        (double)throttle->ios / throttle->iops - spent > wait)
+        wait = (double)throttle->ios / throttle->iops - spent;
+
+    if (wait > 0.) {
+        struct timespec delay = {
+            .tv_sec = (time_t)wait,
+            .tv_nsec = (long)((wait - (time_t)wait) * 1000000000.),
+        };
+
+        nanosleep(&delay, NULL);
+    }
+}
+
+static int scrub_chunk(const void *buffer, size_t size, void *udata)
+{
+    struct scrub_extent *scrub = udata;
+
+    scrub_throttle(scrub->throttle, size, 0);
+
+    return pho_checksum_update(&scrub->checksum, buffer, size);
+}
+
+/** Whether at least one checksum of \p extent can be verified */
+static bool extent_is_verifiable(const struct extent *extent)
+{
+    return extent->with_md5 || extent->with_crc32c ||
+           (extent->with_xxh128 && pho_checksum_xxh128_available());
+}
+
+/**
+ * Read an extent and compare its checksums to the recorded ones.
+ *
+ * \return 0 if the extent matches its checksums, -EBADMSG if not, another
+ *         negative error code if it could not be read.
+ */
+static int scrub_extent(const pho_resp_read_elt_t *medium,
+                        const struct layout_info *layout,
+                        struct extent *extent, struct scrub_throttle *throttle)
+{
+    struct scrub_extent scrub = {
+        .throttle = throttle,
+    };
+    struct io_adapter_module *ioa;
+    struct extent computed = {0};
+    struct pho_ext_loc loc;
+    int rc;
+
+    rc = get_io_adapter((enum fs_type)medium->fs_type, &ioa);
+    if (rc)
+        return rc;
+
+    rc = pho_checksum_init(&scrub.checksum, extent->with_md5,
+                           extent->with_xxh128, extent->with_crc32c);
+    if (rc)
+        return rc;
+
+    rc = pho_checksum_reset(&scrub.checksum);
+    if (rc)
+        goto fini;
+
+    scrub_throttle(throttle, 0, 1);
+
+    loc.root_path = medium->root_path;
+    loc.extent = extent;
+    loc.addr_type = (enum address_type)medium->addr_type;
+    rc = admin_extent_read(ioa, &loc, layout->oid, NULL, scrub_chunk, &scrub);
+    if (rc)
+        goto fini;
+
+    rc = pho_checksum_digest(&scrub.checksum, &computed);
+    if (rc)
+        goto fini;
+
+    if ((computed.with_md5 &&
+         memcmp(computed.md5, extent->md5, sizeof(extent->md5))) ||
+        (computed.with_xxh128 &&
+         memcmp(computed.xxh128, extent->xxh128, sizeof(extent->xxh128))) ||
+        (computed.with_crc32c &&
+         memcmp(computed.crc32c, extent->crc32c, sizeof(extent->crc32c))))
+        rc = -EBADMSG;
+
+fini:
+    pho_checksum_fini(&scrub.checksum);
+    return rc;
+}
+
+/**
+ * List the extents to verify, in address order. Extents of layouts being
+ * written and extents without any usable checksum are skipped.
+ */
+static int scrub_cursor_init(struct scrub_cursor *cursor,
+                             struct layout_info *lyt_ls, int lyt_cnt,
+                             int *n_skipped)
+{
+    int count = 0;
+    int i;
+    int j;
+
+    for (i = 0; i < lyt_cnt; i++)
+        count += lyt_ls[i].ext_count;
+
+    cursor->n_entries = 0;
+    cursor->next = 0;
+    cursor->entries = calloc(count ? : 1, sizeof(*cursor->entries));
+    if (!cursor->entries)
+        return -ENOMEM;
+
+    for (i = 0; i < lyt_cnt; i++) {
+        for (j = 0; j < lyt_ls[i].ext_count; j++) {
+            struct scrub_entry *entry = &cursor->entries[cursor->n_entries];
+            struct extent *extent = &lyt_ls[i].extents[j];
+
+            if (lyt_ls[i].state != PHO_EXT_ST_SYNC ||
+                !extent_is_verifiable(extent)) {
+                (*n_skipped)++;
+                continue;
+            }
+
+            entry->layout = &lyt_ls[i];
+            entry->extent = extent;
+            entry->rank = cursor->n_entries++;
+        }
+    }
+
+    return 0;
+}
+
+static int scrub_entry_cmp(const void *a, const void *b)
+{
+    const struct scrub_entry *entry_a = a;
+    const struct scrub_entry *entry_b = b;
+
+    if (entry_a->position != entry_b->position)
+        return entry_a->position < entry_b->position ? -1 : 1;
+
+    return entry_a->rank - entry_b->rank;
+}
+
+/**
+ * Sort the extents of \p cursor by their position on \p medium, if its I/O
+ * adapter knows it. They are left in address order otherwise.
+ */
+static int scrub_cursor_sort(struct admin_handle *adm,
+                             const struct pho_id *medium,
+                             struct scrub_cursor *cursor)
+{
+    const pho_resp_read_elt_t *alloc;
+    struct io_adapter_module *ioa;
+    pho_resp_t *resp;
+    int rc2;
+    int rc;
+    int i;
+
+    if (cursor->n_entries == 0)
+        return 0;
+
+    rc = admin_medium_read_alloc(adm, medium, 1, &resp);
+    if (rc)
+        LOG_RETURN(rc, "Cannot allocate medium '%s'", medium->name);
+
+    alloc = resp->ralloc->media[0];
+    rc = get_io_adapter((enum fs_type)alloc->fs_type, &ioa);
+    if (rc)
+        goto release;
+
+    for (i = 0; i < cursor->n_entries; i++) {
+        struct pho_ext_loc loc = {
+            .root_path = alloc->root_path,
+            .extent = cursor->entries[i].extent,
+            .addr_type = (enum address_type)alloc->addr_type,
+        };
+
+        rc = ioa_extent_position(ioa, &loc, &cursor->entries[i].position);
+        if (rc == -ENOTSUP)
+            break;
+
+        /* the extent is read last, its read reports the error */
+        if (rc)
+            cursor->entries[i].position = UINT64_MAX;
+    }
+
+    if (rc == -ENOTSUP)
+        pho_verb("Positions of the extents on '%s' are unknown, they are "
+                 "verified in address order", medium->name);
+    else
+        qsort(cursor->entries, cursor->n_entries, sizeof(*cursor->entries),
+              scrub_entry_cmp);
+
+    rc = 0;
+
+release:
+    rc2 = admin_medium_release(adm, alloc, 0, false);
+    pho_srl_response_free(resp, true);
+
+    return rc ? : rc2;
+}
+
+/**
+ * Verify a batch of extents under a single allocation of the medium, then
+ * record their results in a single DSS transaction.
+ */
+static int scrub_batch(struct admin_handle *adm, const struct pho_id *medium,
+                       struct scrub_cursor *cursor,
+                       struct scrub_throttle *throttle,
+                       struct extent_scrub *scrubs, int *n_scrubbed,
+                       int *n_corrupted, int *n_unreadable)
+{
+    const pho_resp_read_elt_t *alloc;
+    pho_resp_t *resp;
+    int read_rc = 0;
+    int n = 0;
+    int rc2;
+    int rc;
+
+    rc = admin_medium_read_alloc(adm, medium, 1, &resp);
+    if (rc)
+        LOG_RETURN(rc, "Cannot allocate medium '%s'", medium->name);
+
+    alloc = resp->ralloc->media[0];
+    while (n < SCRUB_BATCH_EXTENTS && cursor->next < cursor->n_entries) {
+        struct scrub_entry *entry = &cursor->entries[cursor->next++];
+        struct layout_info *layout = entry->layout;
+        struct extent *extent = entry->extent;
+
+        scrubs[n].layout = layout;
+        scrubs[n].extent = extent;
+        scrubs[n].rc = scrub_extent(alloc, layout, extent, throttle);
+        if (scrubs[n].rc == -EBADMSG) {
+            pho_error(scrubs[n].rc,
+                      "Extent '%s' of object '%s' on '%s' is corrupted",
+                      extent->address.buff, layout->oid, medium->name);
+            (*n_corrupted)++;
+        } else if (scrubs[n].rc) {
+            pho_error(scrubs[n].rc,
+                      "Cannot verify extent '%s' of object '%s' on '%s'",
+                      extent->address.buff, layout->oid, medium->name);
+            read_rc = read_rc ? : scrubs[n].rc;
+            (*n_unreadable)++;
+        }
+
+        n++;
+    }
+
+    rc = admin_medium_release(adm, alloc, read_rc, false);
+    pho_srl_response_free(resp, true);
+
+    if (n > 0) {
+        rc2 = dss_extents_scrub_set(&adm->dss, scrubs, n);
+        if (rc2)
+            pho_error(rc2, "Cannot record the verification of %d extents", n);
+        rc = rc ? : rc2;
+    }
+
+    *n_scrubbed += n;
+    return rc;
+}
+
+int phobos_admin_scrub(struct admin_handle *adm, const struct pho_id *medium,
+                       size_t bandwidth, unsigned int iops, int *n_corrupted,
+                       int *n_unreadable)
+{
+    struct scrub_throttle throttle = {
+        .bandwidth = bandwidth,
+        .iops = iops,
+    };
+    struct scrub_cursor cursor = {0};
+    struct extent_scrub *scrubs;
+    struct layout_info *lyt_ls;
+    int n_scrubbed = 0;
+    int n_skipped = 0;
+    int lyt_cnt;
+    int rc;
+
+    *n_corrupted = 0;
+    *n_unreadable = 0;
+    if (medium->family == PHO_RSC_RADOS_POOL)
+        LOG_RETURN(-ENOTSUP, "Scrub of RADOS pools is not supported");
+
+    scrubs = calloc(SCRUB_BATCH_EXTENTS, sizeof(*scrubs));
+    if (!scrubs)
+        return -ENOMEM;
+
+    /* extents are sorted by address */
+    rc = dss_medium_extents_get(&adm->dss, medium, &lyt_ls, &lyt_cnt);
+    if (rc)
+        LOG_GOTO(free_scrubs, rc, "Cannot retrieve the extents of '%s'",
+                 medium->name);
+
+    rc = scrub_cursor_init(&cursor, lyt_ls, lyt_cnt, &n_skipped);
+    if (rc)
+        goto free_layouts;
+
+    rc = scrub_cursor_sort(adm, medium, &cursor);
+    if (rc)
+        goto free_entries;
+
+    pho_info("Scrubbing %d extents of %d objects on '%s'", cursor.n_entries,
+             lyt_cnt, medium->name);
+
+    clock_gettime(CLOCK_MONOTONIC, &throttle.start);
+    while (cursor.next < cursor.n_entries) {
+        rc = scrub_batch(adm, medium, &cursor, &throttle, scrubs, &n_scrubbed,
+                         n_corrupted, n_unreadable);
+        if (rc)
+            break;
+    }
+
+free_entries:
+    free(cursor.entries);
+free_layouts:
+    dss_res_free(lyt_ls, lyt_cnt);
+
+    if (rc)
+        LOG_GOTO(free_scrubs, rc, "Scrub of '%s' stopped after %d extents",
+                 medium->name, n_scrubbed);
+
+    pho_info("Scrubbed %d extents on '%s': %d corrupted, %d unreadable, "
+             "%d skipped", n_scrubbed, medium->name, *n_corrupted,
+             *n_unreadable, n_skipped);
+
+free_scrubs:
+    free(scrubs);
+    return rc;
+}
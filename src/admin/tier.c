@@ -0,0 +1,324 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Administration interface: policy-driven tiering
+ *
+ * A tiering rule selects the objects of a source family by age, size and
+ * user metadata, and migrates their extents to a target family by batches,
+ * see admin_medium_migrate(). Rules are defined in the configuration:
+ *
+ *     [tiering]
+ *     rules = cold
+ *
+ *     [tier "cold"]
+ *     source = dir
+ *     target = tape
+ *     min_age = 86400
+ *
+ * Objects can also be migrated between media of the same family, selected by
+ * their tags: "source_tags" for the source media, "tags" for the target ones.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "phobos_admin.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pho_cfg.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+#include "pho_type_utils.h"
+#include "admin_utils.h"
+
+#define TIER_SECTION_CFG "tier \"%s\""
+
+/**
+ * List of configuration parameters for tiering
+ */
+enum pho_cfg_params_tiering {
+    PHO_CFG_TIERING_FIRST,
+
+    /* tiering parameters */
+    PHO_CFG_TIERING_rules = PHO_CFG_TIERING_FIRST,
+
+    PHO_CFG_TIERING_LAST
+};
+
+const struct pho_config_item cfg_tiering[] = {
+    [PHO_CFG_TIERING_rules] = {
+        .section = "tiering",
+        .name    = "rules",
+        .value   = NULL
+    },
+};
+
+struct tier_rule {
+    const char *name;
+    struct tier_filter filter;  /**< objects migrated by the rule */
+    enum rsc_family target;     /**< family the objects are migrated to */
+    struct tags tags;           /**< tags the target media are selected with */
+    struct tags source_tags;    /**< tags the source media are selected with */
+};
+
+/**
+ * Read an optional non-negative integer parameter of a rule section.
+ *
+ * \return 0 on success, leaving \p value untouched if the parameter is not
+ *         set, -EINVAL if it is not a non-negative integer.
+ */
+static int tier_rule_get_int(const char *section, const char *name,
+                             int64_t *value)
+{
+    const char *cfg_val;
+    int64_t val;
+    int rc;
+
+    rc = pho_cfg_get_val(section, name, &cfg_val);
+    if (rc == -ENODATA)
+        return 0;
+    if (rc)
+        return rc;
+
+    val = str2int64(cfg_val);
+    if (val < 0)
+        LOG_RETURN(-EINVAL, "Invalid value '%s' for '%s' of [%s]", cfg_val,
+                   name, section);
+
+    *value = val;
+    return 0;
+}
+
+/** Read optional tags of a rule section, left empty if not set */
+static int tier_rule_get_tags(const char *section, const char *name,
+                              struct tags *tags)
+{
+    const char *cfg_val;
+    int rc;
+
+    rc = pho_cfg_get_val(section, name, &cfg_val);
+    if (rc == -ENODATA)
+        return 0;
+    if (rc)
+        return rc;
+
+    rc = str2tags(cfg_val, tags);
+    if (rc)
+        LOG_RETURN(rc, "Invalid tags '%s' for '%s' of [%s]", cfg_val, name,
+                   section);
+
+    return 0;
+}
+
+static int tier_rule_get_family(const char *section, const char *name,
+                                enum rsc_family *family)
+{
+    const char *cfg_val;
+    int rc;
+
+    rc = pho_cfg_get_val(section, name, &cfg_val);
+    if (rc == -ENODATA)
+        LOG_RETURN(-EINVAL, "Missing '%s' in [%s]", name, section);
+    if (rc)
+        return rc;
+
+    *family = str2rsc_family(cfg_val);
+    if (*family == PHO_RSC_INVAL)
+        LOG_RETURN(-EINVAL, "Invalid family '%s' for '%s' of [%s]", cfg_val,
+                   name, section);
+
+    return 0;
+}
+
+/** Load the rule \p name from its [tier "name"] configuration section */
+static int tier_rule_load(const char *name, struct tier_rule *rule)
+{
+    int64_t min_size = -1;
+    int64_t max_size = -1;
+    int64_t min_age = 0;
+    const char *cfg_val;
+    char *section;
+    int rc;
+
+    rule->name = name;
+
+    rc = asprintf(&section, TIER_SECTION_CFG, name);
+    if (rc < 0)
+        return -ENOMEM;
+
+    rc = tier_rule_get_family(section, "source", &rule->filter.family);
+    if (rc)
+        goto out;
+
+    rc = tier_rule_get_family(section, "target", &rule->target);
+    if (rc)
+        goto out;
+
+    rc = tier_rule_get_tags(section, "tags", &rule->tags);
+    if (!rc)
+        rc = tier_rule_get_tags(section, "source_tags", &rule->source_tags);
+    if (rc)
+        goto out;
+
+    rule->filter.tags = &rule->source_tags;
+
+    /* the target media of a rule within a family must not be sources too */
+    if (rule->filter.family == rule->target &&
+        (rule->source_tags.n_tags == 0 ||
+         tags_in(&rule->tags, &rule->source_tags)))
+        LOG_GOTO(out, rc = -EINVAL, "Rule '%s' migrates %s to itself", name,
+                 rsc_family2str(rule->target));
+
+    rc = tier_rule_get_int(section, "min_age", &min_age);
+    if (!rc)
+        rc = tier_rule_get_int(section, "min_size", &min_size);
+    if (!rc)
+        rc = tier_rule_get_int(section, "max_size", &max_size);
+    if (rc)
+        goto out;
+
+    rule->filter.min_age = min_age;
+    rule->filter.min_size = min_size;
+    rule->filter.max_size = max_size;
+
+    rc = pho_cfg_get_val(section, "user_md", &cfg_val);
+    if (!rc)
+        rule->filter.user_md = cfg_val;
+    else if (rc == -ENODATA)
+        rc = 0;
+
+out:
+    free(section);
+    return rc;
+}
+
+/** Migrate the objects of \p medium selected by \p rule */
+static int tier_medium(struct admin_handle *adm, const struct tier_rule *rule,
+                       const struct pho_id *medium, int *n_migrated)
+{
+    struct layout_info *lyt_ls;
+    int lyt_cnt = 0;
+    int done = 0;
+    int rc;
+    int i;
+
+    rc = dss_tier_layouts_get(&adm->dss, &rule->filter, medium, &lyt_ls,
+                              &lyt_cnt);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the extents of '%s' to tier",
+                   medium->name);
+
+    pho_info("Rule '%s': migrating %d objects from '%s' to %s", rule->name,
+             lyt_cnt, medium->name, rsc_family2str(rule->target));
+
+    rc = admin_medium_migrate(adm, medium, rule->target, &rule->tags, lyt_ls,
+                              lyt_cnt, &done);
+    for (i = 0; i < done; i++)
+        *n_migrated += lyt_ls[i].ext_count;
+
+    dss_res_free(lyt_ls, lyt_cnt);
+
+    if (rc)
+        LOG_RETURN(rc, "Tiering of '%s' stopped after %d of %d objects",
+                   medium->name, done, lyt_cnt);
+
+    return 0;
+}
+
+static int tier_rule_apply(struct admin_handle *adm, const char *name,
+                           int *n_migrated)
+{
+    struct tier_rule rule = {0};
+    struct pho_id *media;
+    int n_media;
+    int rc;
+    int i;
+
+    rc = tier_rule_load(name, &rule);
+    if (rc)
+        LOG_GOTO(free_tags, rc, "Cannot load tiering rule '%s'", name);
+
+    rc = dss_tier_media_get(&adm->dss, &rule.filter, &media, &n_media);
+    if (rc) {
+        pho_error(rc, "Cannot retrieve the media to tier for rule '%s'", name);
+        goto free_tags;
+    }
+
+    /* a failing source or target medium does not stop the others */
+    for (i = 0; i < n_media; i++) {
+        int rc2 = tier_medium(adm, &rule, &media[i], n_migrated);
+
+        if (!rc)
+            rc = rc2;
+    }
+
+    free(media);
+
+free_tags:
+    tags_free(&rule.source_tags);
+    tags_free(&rule.tags);
+    return rc;
+}
+
+int phobos_admin_tier(struct admin_handle *adm, char **rules, int n_rules,
+                      int *n_migrated)
+{
+    char **cfg_rules = NULL;
+    const char *rules_csv;
+    size_t n_cfg = 0;
+    int rc = 0;
+    size_t j;
+    int i;
+
+    *n_migrated = 0;
+
+    if (n_rules == 0) {
+        rules_csv = PHO_CFG_GET(cfg_tiering, PHO_CFG_TIERING, rules);
+        if (!rules_csv || !*rules_csv)
+            LOG_RETURN(-EINVAL, "No tiering rule given nor configured");
+
+        rc = get_val_csv(rules_csv, &cfg_rules, &n_cfg);
+        if (rc)
+            LOG_RETURN(rc, "Invalid tiering rules '%s'", rules_csv);
+
+        rules = cfg_rules;
+        n_rules = n_cfg;
+    }
+
+    /* rules are applied in order, so that their effects can be chained */
+    for (i = 0; i < n_rules; i++) {
+        int rc2 = tier_rule_apply(adm, rules[i], n_migrated);
+
+        if (!rc)
+            rc = rc2;
+    }
+
+    for (j = 0; j < n_cfg; j++)
+        free(cfg_rules[j]);
+    free(cfg_rules);
+
+    pho_info("Migrated %d extents", *n_migrated);
+    return rc;
+}
@@ -30,9 +30,12 @@
 
 #include "pho_cfg.h"
 #include "pho_common.h"
+#include <ctype.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <time.h>
 #include <ini_config.h>
 
 /** XXX if this is used one day, it must be in a global context, not a global
@@ -44,31 +47,241 @@
 /** thread-wide handle to DSS */
 static __thread void *thr_dss_hdl;
 
+/** Parameter of the config file */
+struct cfg_entry {
+    struct cfg_entry *next;     /**< Next entry of the same bucket */
+    char             *section;
+    char             *name;
+    char             *value;
+    int64_t           int_value; /**< value parsed by str2int64() */
+};
+
+/**
+ * Content of a config file, whose entries are never modified once published
+ * in the global context. The values returned to the callers point into it, so
+ * once replaced by a reload it is kept for PHO_CFG_RELOAD_GRACE_S seconds.
+ */
+struct pho_cfg_snapshot {
+    struct pho_cfg_snapshot  *retired;   /**< Snapshot replaced by this one */
+    time_t                    retire_time; /**< When it was replaced */
+    char                     *path;      /**< Path of the config file */
+    size_t                    n_entries;
+    struct cfg_entry         *entries;
+    size_t                    n_buckets; /**< Power of 2 */
+    struct cfg_entry        **buckets;
+};
+
+static inline struct pho_cfg_snapshot *config_snapshot(void)
+{
+    return __atomic_load_n(&phobos_context()->config.snapshot,
+                           __ATOMIC_ACQUIRE);
+}
+
 static inline bool config_is_loaded(void)
 {
-    return phobos_context()->config.cfg_items != NULL;
+    return config_snapshot() != NULL;
 }
 
-/** load a local config file */
-static int pho_cfg_load_file(const char *cfg)
+/** FNV-1a hash of the section and name, ignoring case like libini does */
+static uint64_t cfg_hash(const char *section, const char *name)
 {
-    struct collection_item *errors = NULL;
-    struct config *config;
-    int rc;
+    uint64_t hash = 14695981039346656037ULL;
+    const char *c;
 
-    MUTEX_LOCK(&phobos_context()->config.lock);
+    for (c = section; *c != '\0'; c++)
+        hash = (hash ^ tolower((unsigned char)*c)) * 1099511628211ULL;
 
-    config = &phobos_context()->config;
+    /* separator, so that "ab"::"c" and "a"::"bc" differ */
+    hash = (hash ^ '\0') * 1099511628211ULL;
 
-    /* Make sure that the config was not loaded by another thread */
-    if (config->cfg_items != NULL)
-        GOTO(unlock, rc = 0);
+    for (c = name; *c != '\0'; c++)
+        hash = (hash ^ tolower((unsigned char)*c)) * 1099511628211ULL;
+
+    return hash;
+}
+
+static const struct cfg_entry *
+snapshot_lookup(const struct pho_cfg_snapshot *snapshot, const char *section,
+                const char *name)
+{
+    const struct cfg_entry *entry;
+    uint64_t hash = cfg_hash(section, name);
+
+    for (entry = snapshot->buckets[hash & (snapshot->n_buckets - 1)];
+         entry != NULL;
+         entry = entry->next)
+        if (!strcasecmp(entry->name, name) &&
+            !strcasecmp(entry->section, section))
+            return entry;
+
+    return NULL;
+}
+
+static void snapshot_free(struct pho_cfg_snapshot *snapshot)
+{
+    while (snapshot) {
+        struct pho_cfg_snapshot *retired = snapshot->retired;
+        size_t i;
+
+        for (i = 0; i < snapshot->n_entries; i++) {
+            free(snapshot->entries[i].section);
+            free(snapshot->entries[i].name);
+            free(snapshot->entries[i].value);
+        }
+        free(snapshot->entries);
+        free(snapshot->buckets);
+        free(snapshot->path);
+        free(snapshot);
+
+        snapshot = retired;
+    }
+}
+
+/** copy the parameters of \p section into the entries of \p snapshot */
+static int snapshot_add_section(struct pho_cfg_snapshot *snapshot,
+                                struct collection_item *cfg_items,
+                                const char *section)
+{
+    struct cfg_entry *entries;
+    char **attrs;
+    int n_attrs;
+    int rc = 0;
+    int i;
+
+    attrs = get_attribute_list(cfg_items, section, &n_attrs, &rc);
+    if (!attrs)
+        return rc ? -rc : 0;
+
+    entries = realloc(snapshot->entries,
+                      (snapshot->n_entries + n_attrs) * sizeof(*entries));
+    if (!entries)
+        GOTO(free_attrs, rc = -ENOMEM);
+    snapshot->entries = entries;
+
+    for (i = 0; i < n_attrs; i++) {
+        struct cfg_entry *entry = &entries[snapshot->n_entries];
+        struct collection_item *item;
+        const char *value;
+
+        rc = get_config_item(section, attrs[i], cfg_items, &item);
+        if (rc)
+            GOTO(free_attrs, rc = -rc);
+
+        value = item ? get_const_string_config_value(item, &rc) : NULL;
+        if (!value)
+            continue;
+
+        entry->section = strdup(section);
+        entry->name = strdup(attrs[i]);
+        entry->value = strdup(value);
+        /* count it now so that snapshot_free() releases it on failure */
+        snapshot->n_entries++;
+        if (!entry->section || !entry->name || !entry->value)
+            GOTO(free_attrs, rc = -ENOMEM);
+
+        entry->int_value = str2int64(value);
+    }
+
+    rc = 0;
+
+free_attrs:
+    free_attribute_list(attrs);
+    return rc;
+}
+
+/** index the entries of \p snapshot by section and name */
+static int snapshot_index(struct pho_cfg_snapshot *snapshot)
+{
+    size_t i;
+
+    snapshot->n_buckets = 16;
+    while (snapshot->n_buckets < 2 * snapshot->n_entries)
+        snapshot->n_buckets *= 2;
+
+    snapshot->buckets = calloc(snapshot->n_buckets,
+                               sizeof(*snapshot->buckets));
+    if (!snapshot->buckets)
+        return -ENOMEM;
+
+    for (i = 0; i < snapshot->n_entries; i++) {
+        struct cfg_entry *entry = &snapshot->entries[i];
+        uint64_t hash;
+
+        /* first one wins, as for get_config_item() */
+        if (snapshot_lookup(snapshot, entry->section, entry->name))
+            continue;
+
+        hash = cfg_hash(entry->section, entry->name);
+        entry->next = snapshot->buckets[hash & (snapshot->n_buckets - 1)];
+        snapshot->buckets[hash & (snapshot->n_buckets - 1)] = entry;
+    }
+
+    return 0;
+}
+
+/** copy the parsed config file \p cfg_items into a new snapshot */
+static int snapshot_build(struct collection_item *cfg_items, const char *path,
+                          struct pho_cfg_snapshot **snapshot_out)
+{
+    struct pho_cfg_snapshot *snapshot;
+    char **sections;
+    int n_sections;
+    int rc = 0;
+    int i;
+
+    snapshot = calloc(1, sizeof(*snapshot));
+    if (!snapshot)
+        return -ENOMEM;
+
+    snapshot->path = strdup(path);
+    if (!snapshot->path)
+        GOTO(free_snapshot, rc = -ENOMEM);
+
+    sections = get_section_list(cfg_items, &n_sections, &rc);
+    if (!sections && rc)
+        GOTO(free_snapshot, rc = -rc);
+
+    for (i = 0; i < n_sections; i++) {
+        rc = snapshot_add_section(snapshot, cfg_items, sections[i]);
+        if (rc)
+            break;
+    }
+    free_section_list(sections);
+    if (rc)
+        GOTO(free_snapshot, rc);
+
+    rc = snapshot_index(snapshot);
+    if (rc)
+        GOTO(free_snapshot, rc);
+
+    *snapshot_out = snapshot;
+    return 0;
 
-    rc = config_from_file("phobos", cfg, &config->cfg_items,
-                          INI_STOP_ON_ERROR, &errors);
+free_snapshot:
+    snapshot_free(snapshot);
+    return rc;
+}
 
+/**
+ * Parse the config file \p cfg into a new snapshot.
+ *
+ * \param[out] snapshot  Parsed content, NULL if \p cfg is the default config
+ *                       file and it does not exist.
+ */
+static int snapshot_load(const char *cfg, struct pho_cfg_snapshot **snapshot)
+{
+    struct collection_item *cfg_items = NULL;
+    struct collection_item *errors = NULL;
+    int rc;
+
+    *snapshot = NULL;
+
+    rc = config_from_file("phobos", cfg, &cfg_items, INI_STOP_ON_ERROR,
+                          &errors);
     if (rc == 0) {
-        config->cfg_file = cfg;
+        rc = snapshot_build(cfg_items, cfg, snapshot);
+        if (rc)
+            pho_error(rc, "failed to load configuration file '%s'", cfg);
     } else {
         /* libini returns positive errno-like error codes */
         if (rc == ENOENT && strcmp(cfg, PHO_DEFAULT_CFG) == 0) {
@@ -78,16 +291,41 @@ static int pho_cfg_load_file(const char *cfg)
             pho_error(rc, "failed to read configuration file '%s'", cfg);
             print_file_parsing_errors(stderr, errors);
             fprintf(stderr, "\n");
-            free_ini_config(config->cfg_items);
+            rc = -rc;
         }
     }
 
+    free_ini_config(cfg_items);
     /* The error collection always has to be freed, even when empty */
     free_ini_config_errors(errors);
-unlock:
+
+    return rc;
+}
+
+/** load a local config file */
+static int pho_cfg_load_file(const char *cfg)
+{
+    struct pho_cfg_snapshot *snapshot;
+    struct config *config;
+    int rc;
+
+    rc = snapshot_load(cfg, &snapshot);
+    if (rc || !snapshot)
+        return rc;
+
+    config = &phobos_context()->config;
+
+    MUTEX_LOCK(&config->lock);
+    /* Make sure that the config was not loaded by another thread */
+    if (config->snapshot == NULL) {
+        __atomic_store_n(&config->snapshot, snapshot, __ATOMIC_RELEASE);
+        snapshot = NULL;
+    }
     MUTEX_UNLOCK(&config->lock);
 
-    return -rc;
+    snapshot_free(snapshot);
+
+    return 0;
 }
 
 /**
@@ -118,15 +356,75 @@ int pho_cfg_init_local(const char *config_file)
     return pho_cfg_load_file(cfg);
 }
 
+/**
+ * Free the snapshots retired by \p snapshot that were replaced more than
+ * PHO_CFG_RELOAD_GRACE_S seconds before \p now, from the oldest ones.
+ */
+static void snapshot_reclaim(struct pho_cfg_snapshot *snapshot, time_t now)
+{
+    for (; snapshot->retired; snapshot = snapshot->retired) {
+        if (now - snapshot->retired->retire_time >= PHO_CFG_RELOAD_GRACE_S) {
+            snapshot_free(snapshot->retired);
+            snapshot->retired = NULL;
+            break;
+        }
+    }
+}
+
+int pho_cfg_reload_local(void)
+{
+    struct pho_cfg_snapshot *snapshot;
+    struct pho_cfg_snapshot *current;
+    struct config *config;
+    struct timespec now;
+    int rc;
+
+    config = &phobos_context()->config;
+
+    MUTEX_LOCK(&config->lock);
+    current = config->snapshot;
+    if (current == NULL)
+        GOTO(unlock, rc = -ENODATA);
+
+    pho_verb("Reloading config %s", current->path);
+
+    rc = snapshot_load(current->path, &snapshot);
+    if (rc)
+        GOTO(unlock, rc);
+
+    /* the default config file was removed since it was loaded */
+    if (!snapshot)
+        GOTO(unlock, rc = -ENOENT);
+
+    /* the readers may still use the values of the current snapshot */
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    current->retire_time = now.tv_sec;
+    snapshot->retired = current;
+    __atomic_store_n(&config->snapshot, snapshot, __ATOMIC_RELEASE);
+
+    /* the readers are done with the snapshots retired long enough ago */
+    snapshot_reclaim(current, now.tv_sec);
+
+unlock:
+    MUTEX_UNLOCK(&config->lock);
+
+    return rc;
+}
+
 void pho_cfg_local_fini(void)
 {
+    struct pho_cfg_snapshot *snapshot;
+
     if (!config_is_loaded())
         return;
 
     MUTEX_LOCK(&phobos_context()->config.lock);
-    free_ini_config(phobos_context()->config.cfg_items);
-    phobos_context()->config.cfg_items = NULL;
+    snapshot = phobos_context()->config.snapshot;
+    __atomic_store_n(&phobos_context()->config.snapshot, NULL,
+                     __ATOMIC_RELEASE);
     MUTEX_UNLOCK(&phobos_context()->config.lock);
+
+    snapshot_free(snapshot);
 }
 
 /**
@@ -142,6 +440,39 @@ int pho_cfg_set_thread_conn(void *dss_handle)
     return 0;
 }
 
+/** Size of the environment variable name of a parameter, with its final '\0'
+ */
+static size_t env_name_size(const char *section, const char *name)
+{
+    /* sizeof returns length + 1, which makes room for first '_'.
+     * Add 2 for 2nd '_' and final '\0'
+     */
+    return sizeof(PHO_ENV_PREFIX) + strlen(section) + strlen(name) + 2;
+}
+
+/** Write the environment variable name of a parameter in \p env, which must
+ * be env_name_size() long.
+ */
+static void fill_env_name(const char *section, const char *name, char *env)
+{
+    char *curr;
+
+    /* copy prefix (strcpy is safe as env is properly sized) */
+    strcpy(env, PHO_ENV_PREFIX"_");
+    curr = end_of_string(env);
+
+    /* copy and upper case section */
+    strcpy(curr, section);
+    upperstr(curr);
+    curr = end_of_string(curr);
+    *curr = '_';
+    curr++;
+
+    /* copy and lower case parameter */
+    strcpy(curr, name);
+    lowerstr(curr);
+}
+
 /** Build environment variable name for a given section and parameter name:
  * PHOBOS_<section(upper case)>_<param_name(lower case)>.
  * @param[in]  section   section name of the configuration item.
@@ -153,39 +484,24 @@ int pho_cfg_set_thread_conn(void *dss_handle)
  */
 static int build_env_name(const char *section, const char *name, char **env)
 {
-    char  *env_var, *curr;
-    size_t strsize;
+    char *env_var;
 
     if (section == NULL || name == NULL)
         return -EINVAL;
 
-    /* sizeof returns length + 1, which makes room for first '_'.
-     * Add 2 for 2nd '_' and final '\0'
-     */
-    strsize = sizeof(PHO_ENV_PREFIX) + strlen(section) + strlen(name) + 2;
-    env_var = malloc(strsize);
+    env_var = malloc(env_name_size(section, name));
     if (env_var == NULL)
         return -ENOMEM;
 
-    /* copy prefix (strcpy is safe as the malloc() is properly sized) */
-    strcpy(env_var, PHO_ENV_PREFIX"_");
-    curr = end_of_string(env_var);
-
-    /* copy and upper case section */
-    strcpy(curr, section);
-    upperstr(curr);
-    curr = end_of_string(curr);
-    *curr = '_';
-    curr++;
-
-    /* copy and lower case parameter */
-    strcpy(curr, name);
-    lowerstr(curr);
+    fill_env_name(section, name, env_var);
 
     *env = env_var;
     return 0;
 }
 
+/** Length of the environment variable names built without allocation */
+#define ENV_NAME_STACK_SIZE 128
+
 /**
  * Get process-wide configuration parameter from environment.
  * @retval 0 on success
@@ -195,16 +511,30 @@ static int build_env_name(const char *section, const char *name, char **env)
 static int pho_cfg_get_env(const char *section, const char *name,
                            const char **value)
 {
-    int   rc;
-    char *env, *val;
+    char  stack_env[ENV_NAME_STACK_SIZE];
+    char *env = stack_env;
+    char *val;
+    size_t size;
 
-    rc = build_env_name(section, name, &env);
-    if (rc != 0)
-        return rc;
+    if (section == NULL || name == NULL)
+        return -EINVAL;
+
+    /* the environment is read on each call, as it may be changed at any time
+     * by pho_cfg_set_val_local()
+     */
+    size = env_name_size(section, name);
+    if (size > sizeof(stack_env)) {
+        env = malloc(size);
+        if (env == NULL)
+            return -ENOMEM;
+    }
+
+    fill_env_name(section, name, env);
 
     val = getenv(env);
     pho_debug("environment: %s=%s", env, val ? val : "<NULL>");
-    free(env);
+    if (env != stack_env)
+        free(env);
 
     if (val == NULL)
         return -ENODATA;
@@ -232,29 +562,19 @@ int pho_cfg_set_val_local(const char *section, const char *name,
 }
 
 /**
- * Get host-wide configuration parameter from config file.
+ * Get host-wide configuration parameter from the config file snapshot.
  * @retval 0 on success
  * @retval -ENODATA if the parameter in not defined.
- * @retval other negative error code on failure.
  */
-static int pho_cfg_get_local(const char *section, const char *name,
-                             const char **value)
+static int pho_cfg_get_local(const struct pho_cfg_snapshot *snapshot,
+                             const char *section, const char *name,
+                             const struct cfg_entry **entry)
 {
-    struct collection_item *item;
-    int rc;
-
-    MUTEX_LOCK(&phobos_context()->config.lock);
-    rc = get_config_item(section, name,
-                         phobos_context()->config.cfg_items, &item);
-    MUTEX_UNLOCK(&phobos_context()->config.lock);
-    if (rc)
-        return -rc;
-
-    *value = get_const_string_config_value(item, &rc);
+    *entry = snapshot_lookup(snapshot, section, name);
     pho_debug("config file: %s::%s=%s", section, name,
-              *value ? *value : "<NULL>");
-    /* ini_config sets rc=EINVAL if the parameter is not found. */
-    return ((*value == NULL) ? -ENODATA : 0);
+              *entry ? (*entry)->value : "<NULL>");
+
+    return *entry ? 0 : -ENODATA;
 }
 
 /**
@@ -278,12 +598,24 @@ int pho_cfg_get_val_from_level(const char *section, const char *name,
         /* from environment */
         return pho_cfg_get_env(section, name, value);
 
-    case PHO_CFG_LEVEL_LOCAL:
+    case PHO_CFG_LEVEL_LOCAL: {
+        const struct pho_cfg_snapshot *snapshot = config_snapshot();
+        const struct cfg_entry *entry;
+        int rc;
+
         /* if config file has not been loaded */
-        if (!config_is_loaded())
+        if (snapshot == NULL)
             return -ENODATA;
 
-        return pho_cfg_get_local(section, name, value);
+        if (section == NULL || name == NULL)
+            return -EINVAL;
+
+        rc = pho_cfg_get_local(snapshot, section, name, &entry);
+        if (!rc)
+            *value = entry->value;
+
+        return rc;
+    }
 
     case PHO_CFG_LEVEL_GLOBAL:
         /* if connection is not set */
@@ -359,20 +691,35 @@ free_dup:
     return rc;
 }
 
-int pho_cfg_get_val(const char *section, const char *name, const char **value)
+/**
+ * Get the value of a parameter from the first level defining it.
+ *
+ * \param[out] entry  Entry of the config file snapshot holding the value, NULL
+ *                    if the value comes from another level.
+ */
+static int cfg_get_entry(const char *section, const char *name,
+                         const char **value, const struct cfg_entry **entry)
 {
+    const struct pho_cfg_snapshot *snapshot;
     int rc;
 
+    *entry = NULL;
+
     /* 1) check process-wide parameter */
     rc = pho_cfg_get_val_from_level(section, name, PHO_CFG_LEVEL_PROCESS,
                                     value);
     if (rc != -ENODATA)
         return rc;
 
-    /* 2) check host-wide parameter */
-    rc = pho_cfg_get_val_from_level(section, name, PHO_CFG_LEVEL_LOCAL, value);
-    if (rc != -ENODATA)
-        return rc;
+    /* 2) check host-wide parameter, without taking any lock */
+    snapshot = config_snapshot();
+    if (snapshot != NULL) {
+        rc = pho_cfg_get_local(snapshot, section, name, entry);
+        if (!rc) {
+            *value = (*entry)->value;
+            return 0;
+        }
+    }
 
     /* 3) check global parameter */
     rc = pho_cfg_get_val_from_level(section, name, PHO_CFG_LEVEL_GLOBAL, value);
@@ -382,13 +729,24 @@ int pho_cfg_get_val(const char *section, const char *name, const char **value)
     return -ENODATA;
 }
 
-const char *_pho_cfg_get(int first_index, int last_index, int param_index,
-                         const struct pho_config_item *module_params)
+int pho_cfg_get_val(const char *section, const char *name, const char **value)
+{
+    const struct cfg_entry *entry;
+
+    return cfg_get_entry(section, name, value, &entry);
+}
+
+static const char *cfg_get_item(int first_index, int last_index,
+                                int param_index,
+                                const struct pho_config_item *module_params,
+                                const struct cfg_entry **entry)
 {
     const struct pho_config_item    *item;
     const char                      *res;
     int                              rc;
 
+    *entry = NULL;
+
     if (param_index > last_index || param_index < first_index)
         return NULL;
 
@@ -398,27 +756,39 @@ const char *_pho_cfg_get(int first_index, int last_index, int param_index,
     if (!item->name)
         return NULL;
 
-    rc = pho_cfg_get_val(item->section, item->name, &res);
+    rc = cfg_get_entry(item->section, item->name, &res, entry);
     if (rc == -ENODATA)
         res = item->value;
 
     return res;
 }
 
+const char *_pho_cfg_get(int first_index, int last_index, int param_index,
+                         const struct pho_config_item *module_params)
+{
+    const struct cfg_entry *entry;
+
+    return cfg_get_item(first_index, last_index, param_index, module_params,
+                        &entry);
+}
+
 int _pho_cfg_get_int(int first_index, int last_index, int param_index,
                      const struct pho_config_item *module_params,
                      int fail_val)
 {
+    const struct cfg_entry *entry;
     const char *opt;
     int64_t     val;
 
-    opt = _pho_cfg_get(first_index, last_index, param_index, module_params);
+    opt = cfg_get_item(first_index, last_index, param_index, module_params,
+                       &entry);
     if (opt == NULL) {
         pho_warn("Failed to retrieve config parameter #%d", param_index);
         return fail_val;
     }
 
-    val = str2int64(opt);
+    /* values of the config file are parsed once, when it is loaded */
+    val = entry ? entry->int_value : str2int64(opt);
     if (val == LLONG_MIN || val < INT_MIN || val > INT_MAX) {
         pho_warn("Invalid value for parameter #%d: '%s' (integer expected)",
                  param_index, opt);
@@ -56,13 +56,14 @@ from phobos.core.const import (PHO_LIB_SCSI, rsc_family2str, # pylint: disable=n
                                PHO_OPERATION_INVALID, fs_type2str,
                                str2operation_type)
 from phobos.core.dss import Client as DSSClient
-from phobos.core.ffi import (DeprecatedObjectInfo, DevInfo, LayoutInfo,
-                             MediaInfo, ObjectInfo, ResourceFamily,
+from phobos.core.ffi import (DeprecatedObjectInfo, DevInfo,
+                             EnrichedMediaStats, LayoutInfo, MediaInfo,
+                             ObjectInfo, ResourceFamily,
                              CLIManagedResourceMixin, FSType, Id, LogFilter,
                              Timeval)
 from phobos.core.log import LogControl, DISABLED, WARNING, INFO, VERBOSE, DEBUG
 from phobos.core.store import XferClient, UtilClient, attrs_as_dict, PutParams
-from phobos.output import dump_object_list
+from phobos.output import dump_object_iter, dump_object_list
 
 def phobos_log_handler(log_record):
     """
@@ -732,6 +733,30 @@ class MediaListOptHandler(ListOptHandler):
     used: medium contains data
     full: medium is full, no more data can be written to it"""
 
+class MediaStatsOptHandler(DSSInteractHandler):
+    """Display the live and deprecated volume of media."""
+    label = 'stats'
+    descr = 'display usage statistics of media'
+
+    @classmethod
+    def add_options(cls, parser):
+        """Add resource-specific options."""
+        super(MediaStatsOptHandler, cls).add_options(parser)
+        parser.add_argument('res', nargs='*', help='resource(s) to query')
+        parser.add_argument('-T', '--tags', type=lambda t: t.split(','),
+                            help='filter on tags (comma-separated: foo,bar)')
+        parser.add_argument('-f', '--format', default='human',
+                            help="output format human/xml/json/csv/yaml " \
+                                 "(default: human)")
+
+        attr = list(EnrichedMediaStats().get_display_fields().keys())
+        attr.sort()
+        parser.add_argument('-o', '--output', type=lambda t: t.split(','),
+                            default='all',
+                            help=("attributes to output, comma-separated, "
+                                  "choose from {" + " ".join(attr) + "} "
+                                  "(default: %(default)s)"))
+
 def check_max_width_is_valid(value):
     """Check that the width 'value' is greater than the one of '...}'"""
     ivalue = int(value)
@@ -987,6 +1012,48 @@ class MediumLocateOptHandler(DSSInteractHandler):
         super(MediumLocateOptHandler, cls).add_options(parser)
         parser.add_argument('res', help='medium to locate')
 
+class MediaRepackOptHandler(DSSInteractHandler):
+    """Move the live extents of a medium to other media."""
+    label = 'repack'
+    descr = 'move the live extents of a medium to other media'
+
+    @classmethod
+    def add_options(cls, parser):
+        super(MediaRepackOptHandler, cls).add_options(parser)
+        parser.add_argument('-T', '--tags', type=lambda t: t.split(','),
+                            help='only use destination media with these tags '
+                                 '(comma-separated, e.g. "-T foo,bar")')
+        parser.add_argument('res', help='medium to repack')
+
+class MediaScrubOptHandler(DSSInteractHandler):
+    """Verify the checksums of the extents of a medium."""
+    label = 'scrub'
+    descr = 'verify the checksums of the extents of a medium'
+
+    @classmethod
+    def add_options(cls, parser):
+        super(MediaScrubOptHandler, cls).add_options(parser)
+        parser.add_argument('--bandwidth', type=int, default=100,
+                            help='maximum read throughput in MB/s, 0 for no '
+                                 'limit (default: 100)')
+        parser.add_argument('--iops', type=int, default=100,
+                            help='maximum number of extents verified per '
+                                 'second, 0 for no limit (default: 100)')
+        parser.add_argument('res', help='medium to scrub')
+
+class MediaImportOptHandler(DSSInteractHandler):
+    """Rebuild the DSS rows of the objects stored on media."""
+    label = 'import'
+    descr = 'rebuild the objects of media from their extended attributes'
+
+    @classmethod
+    def add_options(cls, parser):
+        super(MediaImportOptHandler, cls).add_options(parser)
+        parser.add_argument('--parallel', type=int, default=4,
+                            help='maximum number of media scanned at once '
+                                 '(default: 4)')
+        parser.add_argument('res', nargs='+', help='media to import')
+
 class MediaUpdateOptHandler(DSSInteractHandler):
     """Update an existing media"""
     label = 'update'
@@ -1107,21 +1174,17 @@ class ObjectOptHandler(BaseResourceOptHandler):
                     sys.exit(os.EX_USAGE)
 
         client = UtilClient()
+        max_width = (None if self.params.get('no_trunc')
+                     else self.params.get('max_width'))
 
         try:
-            objs = client.object_list(self.params.get('res'),
-                                      self.params.get('pattern'),
-                                      metadata,
-                                      self.params.get('deprecated'))
-
-            if objs:
-                max_width = (None if self.params.get('no_trunc')
-                             else self.params.get('max_width'))
+            objs = client.object_list_iter(self.params.get('res'),
+                                           self.params.get('pattern'),
+                                           metadata,
+                                           self.params.get('deprecated'))
 
-                dump_object_list(objs, attr=out_attrs, max_width=max_width,
-                                 fmt=self.params.get('format'))
-
-            client.list_free(objs, len(objs))
+            dump_object_iter(objs, attr=out_attrs, max_width=max_width,
+                             fmt=self.params.get('format'))
         except EnvironmentError as err:
             self.logger.error(env_error_format(err))
             sys.exit(abs(err.errno))
@@ -1432,7 +1495,11 @@ class MediaOptHandler(BaseResourceOptHandler):
         LockOptHandler,
         UnlockOptHandler,
         MediaSetAccessOptHandler,
-        MediumLocateOptHandler
+        MediumLocateOptHandler,
+        MediaStatsOptHandler,
+        MediaRepackOptHandler,
+        MediaScrubOptHandler,
+        MediaImportOptHandler,
     ]
 
     def add_medium(self, medium, tags):
@@ -1578,6 +1645,34 @@ class MediaOptHandler(BaseResourceOptHandler):
             dump_object_list(objs, attr=self.params.get('output'),
                              fmt=self.params.get('format'))
 
+    def exec_stats(self):
+        """Display live and deprecated volume of media."""
+        attrs = list(EnrichedMediaStats().get_display_fields().keys())
+        attrs.extend(['*', 'all'])
+        out_attrs = self.params.get('output')
+        bad_attrs = set(out_attrs).difference(set(attrs))
+        if bad_attrs:
+            self.logger.error("Bad output attributes: %s", " ".join(bad_attrs))
+            sys.exit(os.EX_USAGE)
+
+        kwargs = {}
+        if self.params.get('tags'):
+            kwargs["tags"] = self.params.get('tags')
+
+        objs = []
+        if self.params.get('res'):
+            uids = NodeSet.fromlist(self.params.get('res'))
+            for uid in uids:
+                objs.extend(self.client.media_stats.get(family=self.family,
+                                                        id=uid, **kwargs))
+        else:
+            objs = list(self.client.media_stats.get(family=self.family,
+                                                    **kwargs))
+
+        if len(objs) > 0:
+            dump_object_list(objs, attr=out_attrs,
+                             fmt=self.params.get('format'))
+
     def _set_adm_status(self, adm_status):
         """Update media.adm_status"""
         uids = NodeSet.fromlist(self.params.get('res'))
@@ -1633,6 +1728,62 @@ class MediaOptHandler(BaseResourceOptHandler):
             self.logger.error(env_error_format(err))
             sys.exit(abs(err.errno))
 
+    def exec_repack(self):
+        """Repack a medium"""
+        medium = self.params.get('res')
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                adm.repack(self.family, medium, self.params.get('tags'))
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        self.logger.info("Medium '%s' repacked", medium)
+
+    def exec_scrub(self):
+        """Verify the extents of a medium"""
+        medium = self.params.get('res')
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                n_corrupted, n_unreadable = adm.scrub(
+                    self.family, medium,
+                    self.params.get('bandwidth') * 1000000,
+                    self.params.get('iops'))
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        if n_unreadable > 0:
+            self.logger.error("%d extents of medium '%s' could not be read",
+                              n_unreadable, medium)
+
+        if n_corrupted > 0:
+            self.logger.error("%d extents of medium '%s' are corrupted",
+                              n_corrupted, medium)
+            sys.exit(errno.EBADMSG)
+
+        if n_unreadable > 0:
+            sys.exit(errno.EIO)
+
+        self.logger.info("Medium '%s' scrubbed", medium)
+
+    def exec_import(self):
+        """Rebuild the objects stored on media"""
+        media = NodeSet.fromlist(self.params.get('res'))
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                n_objects = adm.media_import(self.family, list(media),
+                                             self.params.get('parallel'))
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        self.logger.info("%d object versions imported from '%s'", n_objects,
+                         media)
+
 class PhobosdPingOptHandler(BaseOptHandler):
     """Phobosd ping"""
     label = 'phobosd'
@@ -1700,6 +1851,43 @@ class PingOptHandler(BaseOptHandler):
 
         self.logger.info("Ping sent to TLC successfully")
 
+class LrsTraceOptHandler(BaseOptHandler):
+    """Phobosd request trace"""
+    label = 'trace'
+    descr = 'dump the trace of the last requests handled by phobosd'
+    epilog = """Each traced event is printed as a JSON object on its own line,
+    from the oldest to the most recent one. The 'id' key identifies a request
+    in phobosd and its 'phase' is one of received, queued, device_chosen,
+    medium_ready and responded."""
+
+class LrsOptHandler(BaseOptHandler):
+    """Phobosd related actions"""
+    label = 'lrs'
+    descr = 'inspect the phobos daemon'
+    verbs = [
+        LrsTraceOptHandler,
+    ]
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        pass
+
+    def exec_trace(self):
+        """Dump the trace of the requests of the lrs daemon."""
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                trace = json.loads(adm.lrs_trace())
+
+        except EnvironmentError as err:
+            self.logger.error("Cannot read the trace of phobosd: %s",
+                              env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        for event in trace:
+            print(json.dumps(event, sort_keys=True))
+
 class DirOptHandler(MediaOptHandler):
     """Directory-related options and actions."""
     label = 'dir'
@@ -1714,6 +1902,10 @@ class DirOptHandler(MediaOptHandler):
         UnlockOptHandler,
         DirSetAccessOptHandler,
         MediumLocateOptHandler,
+        MediaStatsOptHandler,
+        MediaRepackOptHandler,
+        MediaScrubOptHandler,
+        MediaImportOptHandler,
     ]
 
     def add_medium(self, medium, tags):
@@ -1868,6 +2060,10 @@ class TapeOptHandler(MediaOptHandler):
         UnlockOptHandler,
         TapeSetAccessOptHandler,
         MediumLocateOptHandler,
+        MediaStatsOptHandler,
+        MediaRepackOptHandler,
+        MediaScrubOptHandler,
+        MediaImportOptHandler,
     ]
 
 class RadosPoolOptHandler(MediaOptHandler):
@@ -1884,6 +2080,7 @@ class RadosPoolOptHandler(MediaOptHandler):
         RadosPoolSetAccessOptHandler,
         RadosPoolFormatOptHandler,
         MediumLocateOptHandler,
+        MediaStatsOptHandler,
     ]
 
     def add_medium(self, medium, tags):
@@ -1924,17 +2121,13 @@ class ExtentOptHandler(BaseResourceOptHandler):
 
         try:
             with AdminClient(lrs_required=False) as adm:
-                obj_list, p_objs, n_objs = adm.layout_list(
-                    self.params.get('res'),
-                    self.params.get('pattern'),
-                    self.params.get('name'),
-                    self.params.get('degroup'))
+                layouts = adm.layout_list_iter(self.params.get('res'),
+                                               self.params.get('pattern'),
+                                               self.params.get('name'),
+                                               self.params.get('degroup'))
 
-                if len(obj_list) > 0:
-                    dump_object_list(obj_list, attr=out_attrs,
-                                     fmt=self.params.get('format'))
-
-                adm.layout_list_free(p_objs, n_objs)
+                dump_object_iter(layouts, attr=out_attrs,
+                                 fmt=self.params.get('format'))
 
         except EnvironmentError as err:
             self.logger.error(env_error_format(err))
@@ -2060,6 +2253,106 @@ class LocksOptHandler(BaseOptHandler):
 
         self.logger.info("Clean command executed successfully")
 
+class GcOptHandler(BaseOptHandler):
+    """Garbage collector"""
+    label = 'gc'
+    descr = 'remove the extents no object refers to anymore'
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        pass
+
+    @classmethod
+    def add_options(cls, parser):
+        """Add command options."""
+        super(GcOptHandler, cls).add_options(parser)
+        parser.add_argument('--grace-time', type=int, default=86400,
+                            help='minimum age in seconds of the removed files '
+                                 'and objects, so that running puts are left '
+                                 'alone (default: 86400)')
+        parser.add_argument('--scan', action='store_true',
+                            help='also remove the files of dir and tape media '
+                                 'that are unknown to phobos, which mounts '
+                                 'every tape')
+        parser.set_defaults(verb=cls.label)
+
+    def exec_gc(self):
+        """Collect garbage extents"""
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                n_extents, n_objects = adm.garbage_collect(
+                    self.params.get('grace_time'), self.params.get('scan'))
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        self.logger.info("Removed %d extents and %d objects", n_extents,
+                         n_objects)
+
+class FlushOptHandler(BaseOptHandler):
+    """Flush of staged objects"""
+    label = 'flush'
+    descr = 'copy the objects put on the staging family to their own family'
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        pass
+
+    @classmethod
+    def add_options(cls, parser):
+        """Add command options."""
+        super(FlushOptHandler, cls).add_options(parser)
+        parser.set_defaults(verb=cls.label)
+
+    def exec_flush(self):
+        """Flush staged objects"""
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                n_flushed = adm.flush()
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        self.logger.info("Flushed %d extents", n_flushed)
+
+class TierOptHandler(BaseOptHandler):
+    """Policy-driven migration of objects between families"""
+    label = 'tier'
+    descr = 'migrate objects between families following the tiering rules'
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback):
+        pass
+
+    @classmethod
+    def add_options(cls, parser):
+        """Add command options."""
+        super(TierOptHandler, cls).add_options(parser)
+        parser.add_argument('rules', nargs='*',
+                            help='rules to apply, in order, instead of the '
+                                 'ones of the [tiering] section')
+        parser.set_defaults(verb=cls.label)
+
+    def exec_tier(self):
+        """Apply tiering rules"""
+        try:
+            with AdminClient(lrs_required=True) as adm:
+                n_migrated = adm.tier(self.params.get('rules'))
+
+        except EnvironmentError as err:
+            self.logger.error(env_error_format(err))
+            sys.exit(abs(err.errno))
+
+        self.logger.info("Migrated %d extents", n_migrated)
+
 SYSLOG_LOG_LEVELS = ["critical", "error", "warning", "info", "debug"]
 
 class PhobosActionContext(object):
@@ -2083,8 +2376,12 @@ class PhobosActionContext(object):
         DeleteOptHandler,
         UndeleteOptHandler,
         PingOptHandler,
+        LrsOptHandler,
         LocateOptHandler,
         LocksOptHandler,
+        GcOptHandler,
+        FlushOptHandler,
+        TierOptHandler,
         SchedOptHandler,
         LogsOptHandler,
 
@@ -27,17 +27,18 @@ import errno
 import json
 
 from ctypes import (addressof, byref, c_int, c_char_p, c_void_p, cast, pointer,
-                    POINTER, Structure, c_size_t, c_bool)
+                    POINTER, Structure, c_size_t, c_bool, c_uint)
 
 from phobos.core.const import (PHO_FS_LTFS, PHO_FS_POSIX, # pylint: disable=no-name-in-module
                                PHO_FS_RADOS, PHO_RSC_DIR,
                                PHO_RSC_TAPE, PHO_RSC_RADOS_POOL,
                                PHO_RSC_NONE, DSS_NONE,
                                str2rsc_family, str2dss_type)
-from phobos.core.glue import admin_device_status, jansson_dumps  # pylint: disable=no-name-in-module
+from phobos.core.glue import (admin_device_status, admin_lrs_trace, # pylint: disable=no-name-in-module
+                              jansson_dumps)
 from phobos.core.dss import DSSHandle
 from phobos.core.ffi import (CommInfo, ExtentInfo, LayoutInfo, LIBPHOBOS_ADMIN,
-                             Id, LogFilter)
+                             Id, LogFilter, Tags)
 
 def string_list2c_array(l, getter):
     c_string_list = (c_char_p * len(l))()
@@ -242,6 +243,10 @@ class Client(object):
         """Query the status of the local devices"""
         return admin_device_status(addressof(self.handle), family)
 
+    def lrs_trace(self):
+        """Query the trace of the last requests handled by the LRS"""
+        return admin_lrs_trace(addressof(self.handle))
+
     def layout_list(self, res, is_pattern, medium, degroup): # pylint: disable=too-many-locals
         """List layouts."""
         n_layouts = c_int(0)
@@ -295,6 +300,82 @@ class Client(object):
 
         return hostname.value.decode('utf-8') if hostname.value else ""
 
+    def repack(self, rsc_family, medium_id, tags=None):
+        """Move the live extents of a medium to other media"""
+        c_tags = Tags(tags)
+        rc = LIBPHOBOS_ADMIN.phobos_admin_repack(
+            byref(self.handle),
+            byref(Id(rsc_family, name=medium_id)),
+            byref(c_tags) if tags else None)
+        c_tags.free()
+        if rc:
+            raise EnvironmentError(rc, "Failed to repack medium '%s'" %
+                                   medium_id)
+
+    def scrub(self, rsc_family, medium_id, bandwidth, iops):
+        """Verify the checksums of the extents of a medium"""
+        n_corrupted = c_int(0)
+        n_unreadable = c_int(0)
+        rc = LIBPHOBOS_ADMIN.phobos_admin_scrub(
+            byref(self.handle),
+            byref(Id(rsc_family, name=medium_id)),
+            c_size_t(bandwidth), c_uint(iops), byref(n_corrupted),
+            byref(n_unreadable))
+        if rc:
+            raise EnvironmentError(rc, "Failed to scrub medium '%s'" %
+                                   medium_id)
+
+        return n_corrupted.value, n_unreadable.value
+
+    def media_import(self, rsc_family, media_list, parallel):
+        """Rebuild the objects stored on media from their extent attributes"""
+        n_objects = c_int(0)
+        c_id = Id * len(media_list)
+        mstruct = [Id(rsc_family, name=medium_id) for medium_id in media_list]
+        rc = LIBPHOBOS_ADMIN.phobos_admin_import(
+            byref(self.handle), c_id(*mstruct), len(media_list),
+            c_uint(parallel), byref(n_objects))
+        if rc:
+            raise EnvironmentError(rc, "Failed to import media '%s'" %
+                                   ", ".join(media_list))
+
+        return n_objects.value
+
+    def garbage_collect(self, grace_time, scan):
+        """Remove the extents no object refers to anymore"""
+        n_extents = c_int(0)
+        n_objects = c_int(0)
+        rc = LIBPHOBOS_ADMIN.phobos_admin_gc(
+            byref(self.handle), c_uint(grace_time), c_bool(scan),
+            byref(n_extents), byref(n_objects))
+        if rc:
+            raise EnvironmentError(rc, "Garbage collection failed")
+
+        return n_extents.value, n_objects.value
+
+    def flush(self):
+        """Flush the staged objects to their own family"""
+        n_flushed = c_int(0)
+        rc = LIBPHOBOS_ADMIN.phobos_admin_flush(byref(self.handle),
+                                                byref(n_flushed))
+        if rc:
+            raise EnvironmentError(rc, "Flush of staged objects failed")
+
+        return n_flushed.value
+
+    def tier(self, rules):
+        """Apply tiering rules, all the configured ones if none is given"""
+        enc_rules = [rule.encode('utf-8') for rule in rules]
+        c_rules = (c_char_p * len(enc_rules))(*enc_rules)
+        n_migrated = c_int(0)
+        rc = LIBPHOBOS_ADMIN.phobos_admin_tier(byref(self.handle), c_rules,
+                                               len(enc_rules),
+                                               byref(n_migrated))
+        if rc:
+            raise EnvironmentError(rc, "Tiering failed")
+
+        return n_migrated.value
+
     def clean_locks(self, global_mode, force, #pylint: disable=too-many-arguments
                     type_str, family_str, lock_ids):
         """Clean all locks from database based on given parameters."""
@@ -335,6 +416,50 @@ class Client(object):
         """Free a previously obtained layout list."""
         LIBPHOBOS_ADMIN.phobos_admin_layout_list_free(layouts, n_layouts)
 
+    def layout_list_iter(self, res, is_pattern, medium, degroup):
+        """Iterate over the listed layouts without loading them all.
+
+        Each yielded layout is only valid until the next one is requested.
+        """
+        it = c_void_p()
+
+        enc_medium = medium.encode('utf-8') if medium else None
+
+        enc_res = [elt.encode('utf-8') for elt in res]
+        c_res_strlist = c_char_p * len(enc_res)
+
+        rc = LIBPHOBOS_ADMIN.phobos_admin_layout_list_iter(
+            byref(self.handle), c_res_strlist(*enc_res), len(enc_res),
+            is_pattern, enc_medium, byref(it))
+        if rc:
+            raise EnvironmentError(rc, "Failed to list the extent(s) '%s'" %
+                                   res)
+
+        try:
+            layout = POINTER(LayoutInfo)()
+            while True:
+                rc = LIBPHOBOS_ADMIN.phobos_admin_layout_list_next(
+                    it, byref(layout))
+                if rc:
+                    raise EnvironmentError(rc, "Failed to list extents")
+                if not layout:
+                    break
+
+                if not degroup:
+                    yield layout[0]
+                    continue
+
+                extents = layout[0].extents
+                for j in range(layout[0].ext_count):
+                    if medium is None or medium in extents[j].media.name:
+                        lyt = LayoutInfo()
+                        pointer(lyt)[0] = layout[0]
+                        lyt.ext_count = 1
+                        lyt.extents = pointer(extents[j])
+                        yield lyt
+        finally:
+            LIBPHOBOS_ADMIN.phobos_admin_layout_list_iter_free(it)
+
     @staticmethod
     def lib_scan(lib_type, lib_dev_path):
         """Scan and return a list of dictionnaries representing the properties
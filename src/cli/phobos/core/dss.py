@@ -33,8 +33,8 @@ from abc import ABCMeta, abstractmethod, abstractproperty
 from phobos.core.const import (DSS_SET_DELETE, DSS_SET_INSERT, DSS_SET_UPDATE, # pylint: disable=no-name-in-module
                                DSS_MEDIA, PHO_ADDR_HASH1, PHO_ADDR_PATH,
                                PHO_FS_RADOS, str2fs_type)
-from phobos.core.ffi import (DevInfo, MediaInfo, MediaStats, LIBPHOBOS,
-                             OperationFlags)
+from phobos.core.ffi import (DevInfo, EnrichedMediaStats, MediaInfo,
+                             MediaStats, LIBPHOBOS, OperationFlags)
 
 # Valid filter suffix and associated operators.
 FILTER_OPERATORS = (
@@ -213,6 +213,19 @@ class DeviceManager(BaseEntityManager):
         """Invoke device-specific DSS get method."""
         return LIBPHOBOS.dss_device_get(hdl, qry_filter, res, res_cnt)
 
+class MediaStatsManager(BaseEntityManager):
+    """Proxy to retrieve media with their live and deprecated volumes."""
+    wrapped_class = EnrichedMediaStats
+    wrapped_ident = 'media'
+
+    def __init__(self, client, *args, **kwargs):
+        super(MediaStatsManager, self).__init__(client, *args, **kwargs)
+
+    def _dss_get(self, hdl, qry_filter, res, res_cnt):
+        """Invoke media statistics DSS get method."""
+        return LIBPHOBOS.dss_media_enriched_stats(hdl, qry_filter, res,
+                                                  res_cnt)
+
 class MediaManager(BaseEntityManager):
     """Proxy to manipulate media."""
     wrapped_class = MediaInfo
@@ -317,7 +330,9 @@ class DSSHandle(Structure): # pylint: disable=too-few-public-methods
     Wrap connection to the backend. Absolutely opaque and propagated everywhere.
     """
     _fields_ = [
-        ('dh_conn', c_void_p)
+        ('dh_conn', c_void_p),
+        ('dh_pipeline', c_void_p),
+        ('dh_prepared', c_void_p)
     ]
 
 class Client:
@@ -327,6 +342,7 @@ class Client:
         super(Client, self).__init__(*args, **kwargs)
         self.handle = None
         self.media = MediaManager(self)
+        self.media_stats = MediaStatsManager(self)
         self.devices = DeviceManager(self)
 
     def __enter__(self):
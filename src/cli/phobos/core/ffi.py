@@ -550,6 +550,96 @@ class MediaInfo(Structure, CLIManagedResourceMixin):
         if hasattr(self, "_free_tags") and self._free_tags:
             self._tags.free()
 
+def ratio(part, total):
+    """Ratio of part over total, 0 if total is null."""
+    return part / total if total else 0.0
+
+class EnrichedMediaStats(Structure, CLIManagedResourceMixin):
+    """DSS media statistics with live and deprecated volumes."""
+    _fields_ = [
+        ('rsc', Resource),
+        ('fs_status', c_int),
+        ('stats', MediaStats),
+        ('live_size', c_ssize_t),
+        ('live_count', c_longlong),
+        ('deprec_size', c_ssize_t),
+        ('deprec_count', c_longlong),
+    ]
+
+    def get_display_fields(self, max_width=None):
+        """Return a dict of available fields and optional display formatters."""
+        return {
+            'name': None,
+            'adm_status': rsc_adm_status2str,
+            'fs_status': fs_status2str,
+            'nb_errors': None,
+            'occupancy': '{:.2%}'.format,
+            'logc_spc_used': None,
+            'phys_spc_used': None,
+            'live_size': None,
+            'nb_extents': None,
+            'deprecated_size': None,
+            'nb_extents_deprecated': None,
+            'deprecated_ratio': '{:.2%}'.format,
+            'deprecated_nb_ratio': '{:.2%}'.format,
+        }
+
+    @property
+    def name(self):
+        """Wrapper to get medium name"""
+        return self.rsc.id.name
+
+    @property
+    def adm_status(self):
+        """Wrapper to get adm_status"""
+        return self.rsc.adm_status
+
+    @property
+    def nb_errors(self):
+        """Wrapper to get the number of errors"""
+        return self.stats.nb_errors
+
+    @property
+    def logc_spc_used(self):
+        """Wrapper to get the logical space used"""
+        return self.stats.logc_spc_used
+
+    @property
+    def phys_spc_used(self):
+        """Wrapper to get the physical space used"""
+        return self.stats.phys_spc_used
+
+    @property
+    def occupancy(self):
+        """Ratio of physical space used over the medium size"""
+        return ratio(self.stats.phys_spc_used,
+                     self.stats.phys_spc_used + self.stats.phys_spc_free)
+
+    @property
+    def nb_extents(self):
+        """Number of extents of live objects"""
+        return self.live_count
+
+    @property
+    def deprecated_size(self):
+        """Size of the extents of deprecated objects"""
+        return self.deprec_size
+
+    @property
+    def nb_extents_deprecated(self):
+        """Number of extents of deprecated objects"""
+        return self.deprec_count
+
+    @property
+    def deprecated_ratio(self):
+        """Ratio of deprecated size over the size of all objects"""
+        return ratio(self.deprec_size, self.live_size + self.deprec_size)
+
+    @property
+    def deprecated_nb_ratio(self):
+        """Ratio of deprecated extents over the extents of all objects"""
+        return ratio(self.deprec_count, self.live_count + self.deprec_count)
+
 def truncate_user_md(user_md_str, max_width):
     """Truncate user_md."""
     # we check that 'obj' (here, the user_md) is not None because if it
@@ -657,7 +747,9 @@ class ExtentInfo(Structure): # pylint: disable=too-few-public-methods
         ('with_xxh128', c_bool),
         ('xxh128', c_ubyte * 16),
         ('with_md5', c_bool),
-        ('md5', c_ubyte * MD5_BYTE_LENGTH)
+        ('md5', c_ubyte * MD5_BYTE_LENGTH),
+        ('with_crc32c', c_bool),
+        ('crc32c', c_ubyte * 4)
     ]
 
 class PhoAttrs(Structure): # pylint: disable=too-few-public-methods
@@ -708,6 +800,7 @@ class LayoutInfo(Structure, CLIManagedResourceMixin):
             'layout': None,
             'xxh128': None,
             'md5': None,
+            'crc32c': None,
         }
 
     @property
@@ -759,6 +852,15 @@ class LayoutInfo(Structure, CLIManagedResourceMixin):
                     else None
                 for i in range(self.ext_count)]
 
+    @property
+    def crc32c(self):
+        """Wrapper to get extent crc32c."""
+        return [ ''.join('%02x' % one_byte
+                         for one_byte in self.extents[i].crc32c)
+                    if self.extents[i].with_crc32c
+                    else None
+                for i in range(self.ext_count)]
+
     @property
     def layout(self):
         """Wrapper to get object layout."""
@@ -88,6 +88,32 @@ static PyObject *py_admin_device_status(PyObject *self, PyObject *args)
     return py_json_str;
 }
 
+static PyObject *py_admin_lrs_trace(PyObject *self, PyObject *args)
+{
+    struct admin_handle *adm;
+    PyObject *py_json_str;
+    char *str;
+    int rc;
+
+    if (!PyArg_ParseTuple(args, "l", &adm)) {
+        errno = EINVAL;
+        PyErr_SetFromErrno(PyExc_EnvironmentError);
+        return NULL;
+    }
+
+    rc = phobos_admin_lrs_trace(adm, &str);
+    if (rc) {
+        errno = -rc;
+        PyErr_SetFromErrno(PyExc_EnvironmentError);
+        return NULL;
+    }
+
+    py_json_str = Py_BuildValue("s", str);
+    free(str);
+
+    return py_json_str;
+}
+
 static PyMethodDef GlueMethods[] = {
     {"jansson_dumps", py_jansson_dumps, METH_VARARGS,
      "Dump a jansson json_t (pointer as python int) to a python string and "
@@ -95,6 +121,9 @@ static PyMethodDef GlueMethods[] = {
     {"admin_device_status", py_admin_device_status, METH_VARARGS,
      "Call phobos_admin_device_status and copy the result string in a python "
      "string"},
+    {"admin_lrs_trace", py_admin_lrs_trace, METH_VARARGS,
+     "Call phobos_admin_lrs_trace and copy the result string in a python "
+     "string"},
     {NULL, NULL, 0, NULL},
 };
 
@@ -501,6 +501,41 @@ class UtilClient:
         """Free a previously obtained object list."""
         LIBPHOBOS.phobos_store_object_list_free(objs, n_objs)
 
+    @staticmethod
+    def object_list_iter(res, is_pattern, metadata, deprecated):
+        """Iterate over the listed objects without loading them all.
+
+        Each yielded object is only valid until the next one is requested.
+        """
+        obj_type = ObjectInfo if not deprecated else DeprecatedObjectInfo
+        it = c_void_p()
+
+        enc_res = [elt.encode('utf-8') for elt in res]
+        c_res_strlist = c_char_p * len(enc_res)
+
+        enc_metadata = [md.encode('utf-8') for md in metadata]
+        c_md_strlist = c_char_p * len(metadata)
+
+        rc = LIBPHOBOS.phobos_store_object_list_iter(
+            c_res_strlist(*enc_res), len(enc_res), is_pattern,
+            c_md_strlist(*enc_metadata), len(metadata), deprecated, byref(it))
+        if rc:
+            raise EnvironmentError(rc, "Failed to list %s" %
+                                   ("object(s) '%s'" % res
+                                    if res else "all objects"))
+
+        try:
+            obj = POINTER(obj_type)()
+            while True:
+                rc = LIBPHOBOS.phobos_store_object_list_next(it, byref(obj))
+                if rc:
+                    raise EnvironmentError(rc, "Failed to list objects")
+                if not obj:
+                    break
+                yield obj[0]
+        finally:
+            LIBPHOBOS.phobos_store_object_list_iter_free(it)
+
     @staticmethod
     def object_locate(oid, uuid, version, focus_host):
         """Locate an object"""
@@ -30,7 +30,7 @@ import psycopg2
 
 from phobos.core import cfg
 
-ORDERED_SCHEMAS = ["1.1", "1.2", "1.91", "1.92", "1.93", "1.95"]
+ORDERED_SCHEMAS = ["1.1", "1.2", "1.91", "1.92", "1.93", "1.95", "2.0"]
 CURRENT_SCHEMA_VERSION = ORDERED_SCHEMAS[-1]
 AVAIL_SCHEMAS = set(ORDERED_SCHEMAS)
 
@@ -55,12 +55,13 @@ class Migrator:
 
         # { source_version: (target_version, migration_function) }
         self.convert_funcs = {
-            "0": ("1.95", lambda: self.create_schema("1.95")),
+            "0": ("2.0", lambda: self.create_schema("2.0")),
             "1.1": ("1.2", self.convert_1_to_2),
             "1.2": ("1.91", self.convert_2_to_3),
             "1.91": ("1.92", self.convert_3_to_4),
             "1.92": ("1.93", self.convert_4_to_5),
             "1.93": ("1.95", self.convert_1_93_to_1_95),
+            "1.95": ("2.0", self.convert_1_95_to_2_0),
         }
 
         self.reachable_versions = set(
@@ -336,6 +337,285 @@ class Migrator:
         with self.connect():
             self.convert_schema_1_93_to_1_95()
 
+    def convert_schema_1_95_to_2_0(self):
+        """DB schema changes : move extents from jsonb to layout_extent table,
+        add per-medium volume statistics, index user_md and oid of objects,
+        record the creation time of objects
+        """
+        cur = self.conn.cursor()
+        cur.execute("""
+            -- create layout_extent table
+            CREATE TABLE layout_extent(
+                uuid            varchar(36),
+                version         integer,
+                layout_idx      integer,
+                medium_family   dev_family NOT NULL,
+                medium_id       varchar(255) NOT NULL,
+                address         varchar(1024),
+                size            bigint NOT NULL,
+                md5             varchar(32),
+                xxh128          varchar(32),
+                crc32c          varchar(8),
+                -- result (0 or -errno) and time of the last scrub
+                scrub_rc        integer,
+                scrub_time      timestamp,
+
+                PRIMARY KEY (uuid, version, layout_idx),
+                FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+                    ON DELETE CASCADE ON UPDATE CASCADE
+            );
+
+            -- fill it from the extents of the extent table
+            INSERT INTO layout_extent (uuid, version, layout_idx,
+                                       medium_family, medium_id, address,
+                                       size, md5, xxh128)
+                SELECT extent.uuid, extent.version, ext.idx - 1,
+                       (ext.value->>'fam')::dev_family, ext.value->>'media',
+                       ext.value->>'addr', (ext.value->>'sz')::bigint,
+                       ext.value->>'md5', ext.value->>'xxh128'
+                FROM extent,
+                     jsonb_array_elements(extent.extents)
+                        WITH ORDINALITY AS ext(value, idx);
+
+            CREATE INDEX layout_extent_medium_idx
+                ON layout_extent (medium_family, medium_id, address);
+            CREATE INDEX layout_extent_xxh128_idx
+                ON layout_extent (xxh128, size);
+
+            -- drop the jsonb extents and their index
+            DROP INDEX extents_mda_id_idx;
+            DROP FUNCTION extents_mda_idx(jsonb);
+            ALTER TABLE extent DROP COLUMN extents;
+
+            -- create medium_stats table and fill it from existing extents
+            CREATE TABLE medium_stats(
+                medium_family   dev_family,
+                medium_id       varchar(255),
+                live_size       bigint DEFAULT 0 NOT NULL,
+                live_count      bigint DEFAULT 0 NOT NULL,
+                deprec_size     bigint DEFAULT 0 NOT NULL,
+                deprec_count    bigint DEFAULT 0 NOT NULL,
+
+                PRIMARY KEY (medium_family, medium_id)
+            );
+
+            INSERT INTO medium_stats
+                SELECT e.medium_family, e.medium_id,
+                       COALESCE(sum(e.size) FILTER (WHERE o.uuid IS NOT NULL),
+                                0),
+                       count(o.uuid),
+                       COALESCE(sum(e.size) FILTER (WHERE d.uuid IS NOT NULL),
+                                0),
+                       count(d.uuid)
+                FROM layout_extent e
+                    LEFT JOIN object o
+                        ON o.uuid = e.uuid AND o.version = e.version
+                    LEFT JOIN deprecated_object d
+                        ON d.uuid = e.uuid AND d.version = e.version
+                GROUP BY e.medium_family, e.medium_id;
+
+            CREATE FUNCTION medium_stats_add(family dev_family, id varchar,
+                                             live_size bigint,
+                                             live_count bigint,
+                                             deprec_size bigint,
+                                             deprec_count bigint)
+                RETURNS void AS
+            $$
+                INSERT INTO medium_stats AS s
+                    VALUES ($1, $2, $3, $4, $5, $6)
+                ON CONFLICT (medium_family, medium_id) DO UPDATE
+                    SET live_size = s.live_size + EXCLUDED.live_size,
+                        live_count = s.live_count + EXCLUDED.live_count,
+                        deprec_size = s.deprec_size + EXCLUDED.deprec_size,
+                        deprec_count = s.deprec_count + EXCLUDED.deprec_count;
+            $$ LANGUAGE SQL;
+
+            -- state of the object of a layout: 2 if live, 1 if deprecated,
+            -- 0 if none
+            CREATE FUNCTION layout_object_state(uuid varchar, version integer)
+                RETURNS integer AS
+            $$
+                SELECT CASE
+                    WHEN EXISTS (SELECT 1 FROM object o
+                                 WHERE o.uuid = $1 AND o.version = $2) THEN 2
+                    WHEN EXISTS (SELECT 1 FROM deprecated_object d
+                                 WHERE d.uuid = $1 AND d.version = $2) THEN 1
+                    ELSE 0 END;
+            $$ LANGUAGE SQL STABLE;
+
+            -- highest state of the other layouts referring to the file of an
+            -- extent, deduplicated objects sharing their extents
+            CREATE FUNCTION extent_file_state(family dev_family, id varchar,
+                                              address varchar, uuid varchar,
+                                              version integer)
+                RETURNS integer AS
+            $$
+                SELECT COALESCE(max(layout_object_state(le.uuid,
+                                                        le.version)), 0)
+                FROM layout_extent le
+                WHERE le.medium_family = $1 AND le.medium_id = $2
+                  AND le.address = $3 AND (le.uuid, le.version) <> ($4, $5);
+            $$ LANGUAGE SQL STABLE;
+
+            -- files entering (1) or leaving (-1) a state when a layout in
+            -- state 'own' refers to a file whose other layouts are in state
+            -- 'others': a file is accounted for once
+            CREATE FUNCTION extent_file_delta(own integer, others integer,
+                                              state integer)
+                RETURNS integer AS
+            $$
+                SELECT CASE
+                    WHEN $1 <= $2 THEN 0
+                    WHEN $1 = $3 THEN 1
+                    WHEN $2 = $3 THEN -1
+                    ELSE 0 END;
+            $$ LANGUAGE SQL IMMUTABLE;
+
+            CREATE FUNCTION layout_extent_stats_apply(ext layout_extent,
+                                                      sign integer)
+                RETURNS void AS
+            $$
+            DECLARE
+                own integer := layout_object_state(ext.uuid, ext.version);
+                others integer := extent_file_state(ext.medium_family,
+                                                    ext.medium_id, ext.address,
+                                                    ext.uuid, ext.version);
+                live integer := extent_file_delta(own, others, 2);
+                deprec integer := extent_file_delta(own, others, 1);
+            BEGIN
+                IF live <> 0 OR deprec <> 0 THEN
+                    PERFORM medium_stats_add(ext.medium_family, ext.medium_id,
+                                             sign * live * ext.size,
+                                             sign * live,
+                                             sign * deprec * ext.size,
+                                             sign * deprec);
+                END IF;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            CREATE FUNCTION layout_extent_stats()
+                RETURNS trigger AS
+            $$
+            BEGIN
+                IF TG_OP IN ('UPDATE', 'DELETE') THEN
+                    PERFORM layout_extent_stats_apply(OLD, -1);
+                END IF;
+                IF TG_OP IN ('UPDATE', 'INSERT') THEN
+                    PERFORM layout_extent_stats_apply(NEW, 1);
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            CREATE FUNCTION object_stats_apply(uuid varchar, version integer,
+                                               deprecated boolean,
+                                               sign integer)
+                RETURNS void AS
+            $$
+                SELECT medium_stats_add(
+                    medium_family, medium_id,
+                    $4 * sum(live * size)::bigint, $4 * sum(live),
+                    $4 * sum(deprec * size)::bigint, $4 * sum(deprec))
+                FROM (SELECT medium_family, medium_id, size,
+                             extent_file_delta(own, others, 2) AS live,
+                             extent_file_delta(own, others, 1) AS deprec
+                      FROM (SELECT medium_family, medium_id, size,
+                                   CASE WHEN $3 THEN 1 ELSE 2 END AS own,
+                                   extent_file_state(medium_family, medium_id,
+                                                     address, $1, $2)
+                                       AS others
+                            FROM layout_extent
+                            WHERE layout_extent.uuid = $1
+                              AND layout_extent.version = $2) AS file
+                     ) AS delta
+                GROUP BY medium_family, medium_id;
+            $$ LANGUAGE SQL;
+
+            CREATE FUNCTION object_stats()
+                RETURNS trigger AS
+            $$
+            DECLARE
+                deprecated boolean := TG_TABLE_NAME = 'deprecated_object';
+            BEGIN
+                IF TG_OP IN ('UPDATE', 'DELETE') THEN
+                    PERFORM object_stats_apply(OLD.uuid, OLD.version,
+                                               deprecated, -1);
+                END IF;
+                IF TG_OP IN ('UPDATE', 'INSERT') THEN
+                    PERFORM object_stats_apply(NEW.uuid, NEW.version,
+                                               deprecated, 1);
+                END IF;
+                RETURN NULL;
+            END;
+            $$ LANGUAGE plpgsql;
+
+            CREATE TRIGGER layout_extent_stats_trigger
+                AFTER INSERT OR DELETE OR UPDATE OF uuid, version,
+                                                    medium_family, medium_id,
+                                                    size
+                ON layout_extent
+                FOR EACH ROW EXECUTE PROCEDURE layout_extent_stats();
+
+            CREATE TRIGGER object_stats_trigger
+                AFTER INSERT OR DELETE OR UPDATE OF uuid, version ON object
+                FOR EACH ROW EXECUTE PROCEDURE object_stats();
+
+            CREATE TRIGGER deprecated_object_stats_trigger
+                AFTER INSERT OR DELETE OR UPDATE OF uuid, version
+                ON deprecated_object
+                FOR EACH ROW EXECUTE PROCEDURE object_stats();
+
+            -- index user_md and oid for object searches
+            CREATE EXTENSION IF NOT EXISTS pg_trgm;
+            CREATE INDEX object_user_md_idx
+                ON object USING gin(user_md jsonb_path_ops);
+            CREATE INDEX object_oid_trgm_idx
+                ON object USING gin(oid gin_trgm_ops);
+            CREATE INDEX deprecated_object_oid_idx ON deprecated_object (oid);
+            CREATE INDEX deprecated_object_user_md_idx
+                ON deprecated_object USING gin(user_md jsonb_path_ops);
+            CREATE INDEX deprecated_object_oid_trgm_idx
+                ON deprecated_object USING gin(oid gin_trgm_ops);
+
+            -- creation time of objects, used by the garbage collector
+            ALTER TABLE object ADD COLUMN creation_time timestamp
+                DEFAULT now();
+
+            -- layouts of write-back puts, waiting to be flushed
+            CREATE TABLE staging(
+                uuid            varchar(36),
+                version         integer,
+                family          dev_family NOT NULL,
+                tags            jsonb,
+                staging_time    timestamp DEFAULT now(),
+
+                PRIMARY KEY (uuid, version),
+                FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+                    ON DELETE CASCADE ON UPDATE CASCADE
+            );
+
+            -- content of the objects stored in the database
+            CREATE TABLE inline_extent(
+                uuid            varchar(36),
+                version         integer,
+                data            bytea NOT NULL,
+
+                PRIMARY KEY (uuid, version),
+                FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+                    ON DELETE CASCADE ON UPDATE CASCADE
+            );
+
+            -- update current schema version
+            UPDATE schema_info SET version = '2.0';
+        """)
+        self.conn.commit()
+        cur.close()
+
+    def convert_1_95_to_2_0(self):
+        """Convert DB from v1.95 to v2.0"""
+        with self.connect():
+            self.convert_schema_1_95_to_2_0()
+
     def migrate(self, target_version=None):
         """Convert DB schema up to a given phobos version"""
         target_version = target_version if target_version is not None \
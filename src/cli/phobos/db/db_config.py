@@ -79,6 +79,9 @@ def setup_db(database, user, password):
 
                 -- Create uuid-ossp extension
                 CREATE EXTENSION IF NOT EXISTS "uuid-ossp" SCHEMA public;
+
+                -- Create pg_trgm extension
+                CREATE EXTENSION IF NOT EXISTS pg_trgm SCHEMA public;
             """)
 
 def drop_db(database, user):
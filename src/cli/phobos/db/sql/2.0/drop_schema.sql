@@ -0,0 +1,36 @@
+DROP TABLE IF EXISTS
+    schema_info,
+    device,
+    media,
+    object,
+    deprecated_object,
+    extent,
+    layout_extent,
+    staging,
+    inline_extent,
+    medium_stats,
+    lock,
+    logs CASCADE;
+
+DROP TYPE IF EXISTS
+    dev_family,
+    fs_status,
+    adm_status,
+    fs_type,
+    address_type,
+    extent_state,
+    lock_type,
+    operation_type CASCADE;
+
+DROP FUNCTION IF EXISTS medium_stats_add(dev_family, varchar, bigint, bigint,
+                                          bigint, bigint) CASCADE;
+DROP FUNCTION IF EXISTS layout_extent_stats_apply(layout_extent, integer)
+    CASCADE;
+DROP FUNCTION IF EXISTS layout_extent_stats() CASCADE;
+DROP FUNCTION IF EXISTS object_stats_apply(varchar, integer, boolean, integer)
+    CASCADE;
+DROP FUNCTION IF EXISTS object_stats() CASCADE;
+DROP FUNCTION IF EXISTS extent_file_delta(integer, integer, integer) CASCADE;
+DROP FUNCTION IF EXISTS extent_file_state(dev_family, varchar, varchar,
+                                          varchar, integer) CASCADE;
+DROP FUNCTION IF EXISTS layout_object_state(varchar, integer) CASCADE;
@@ -0,0 +1,321 @@
+CREATE EXTENSION IF NOT EXISTS "uuid-ossp";
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
+
+CREATE TYPE dev_family AS ENUM ('tape', 'dir', 'rados_pool');
+CREATE TYPE adm_status AS ENUM ('locked', 'unlocked', 'failed');
+CREATE TYPE fs_type AS ENUM ('POSIX', 'LTFS', 'RADOS');
+CREATE TYPE address_type AS ENUM ('PATH', 'HASH1', 'OPAQUE');
+CREATE TYPE fs_status AS ENUM ('blank', 'empty', 'used', 'full');
+CREATE TYPE extent_state AS ENUM ('pending','sync','orphan');
+CREATE TYPE lock_type AS ENUM('object', 'device', 'media', 'media_update');
+CREATE TYPE operation_type AS ENUM('Library scan', 'Library open',
+                                   'Device lookup', 'Medium lookup',
+                                   'Device load', 'Device unload');
+
+-- to extend enums: ALTER TYPE type ADD VALUE 'value'
+
+-- Database schema information
+CREATE TABLE schema_info (
+    version         varchar(32) PRIMARY KEY
+);
+
+-- Insert current schema version
+INSERT INTO schema_info VALUES ('2.0');
+
+CREATE TABLE device(
+    family          dev_family,
+    model           varchar(32),
+    id              varchar(255) UNIQUE,
+    host            varchar(128),
+    adm_status      adm_status,
+    path            varchar(256),
+
+    PRIMARY KEY (family, id)
+);
+CREATE INDEX ON device USING gin(host);
+
+CREATE TABLE media(
+    family          dev_family,
+    model           varchar(32),
+    id              varchar(255) UNIQUE,
+    adm_status      adm_status,
+    fs_type         fs_type,
+    fs_label        varchar(32),
+    address_type    address_type,
+    fs_status       fs_status,
+    stats           jsonb,
+    tags            jsonb, -- json array (optimized for searching)
+    put             boolean DEFAULT TRUE,
+    get             boolean DEFAULT TRUE,
+    delete          boolean DEFAULT TRUE,
+
+    PRIMARY KEY (family, id)
+);
+CREATE INDEX ON media((stats->>'phys_spc_free'));
+
+CREATE TABLE object(
+    oid             varchar(1024),
+    uuid            varchar(36) UNIQUE DEFAULT uuid_generate_v4(),
+    version         integer DEFAULT 1 NOT NULL,
+    user_md         jsonb,
+    -- tells apart the objects of crashed puts from the ones being put
+    creation_time   timestamp DEFAULT now(),
+
+    PRIMARY KEY (oid)
+);
+-- user_md containment ($KVINJSON) and oid pattern ($REGEXP, $LIKE) filters
+CREATE INDEX object_user_md_idx ON object USING gin(user_md jsonb_path_ops);
+CREATE INDEX object_oid_trgm_idx ON object USING gin(oid gin_trgm_ops);
+
+CREATE TABLE deprecated_object(
+    oid             varchar(1024),
+    uuid            varchar(36),
+    version         integer DEFAULT 1 NOT NULL,
+    user_md         jsonb,
+    deprec_time     timestamp DEFAULT now(),
+
+    PRIMARY KEY (uuid, version)
+);
+CREATE INDEX deprecated_object_oid_idx ON deprecated_object (oid);
+CREATE INDEX deprecated_object_user_md_idx
+    ON deprecated_object USING gin(user_md jsonb_path_ops);
+CREATE INDEX deprecated_object_oid_trgm_idx
+    ON deprecated_object USING gin(oid gin_trgm_ops);
+
+CREATE TABLE extent(
+    oid             varchar(1024),
+    uuid            varchar(36),
+    version         integer DEFAULT 1 NOT NULL,
+    state           extent_state,
+    lyt_info        jsonb,
+
+    PRIMARY KEY (uuid, version)
+);
+
+-- One row per extent of a layout
+CREATE TABLE layout_extent(
+    uuid            varchar(36),
+    version         integer,
+    layout_idx      integer,
+    medium_family   dev_family NOT NULL,
+    medium_id       varchar(255) NOT NULL,
+    address         varchar(1024),
+    size            bigint NOT NULL,
+    md5             varchar(32),
+    xxh128          varchar(32),
+    crc32c          varchar(8),
+    -- result (0 or -errno) and time of the last scrub
+    scrub_rc        integer,
+    scrub_time      timestamp,
+
+    PRIMARY KEY (uuid, version, layout_idx),
+    FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+CREATE INDEX layout_extent_medium_idx
+    ON layout_extent (medium_family, medium_id, address);
+-- lookup of the extents holding given data, for deduplicated puts
+CREATE INDEX layout_extent_xxh128_idx ON layout_extent (xxh128, size);
+
+-- Layouts written on a staging family, waiting to be flushed to their family
+CREATE TABLE staging(
+    uuid            varchar(36),
+    version         integer,
+    family          dev_family NOT NULL,
+    tags            jsonb,
+    staging_time    timestamp DEFAULT now(),
+
+    PRIMARY KEY (uuid, version),
+    FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+
+-- Content of the layouts stored in the database instead of on media
+CREATE TABLE inline_extent(
+    uuid            varchar(36),
+    version         integer,
+    data            bytea NOT NULL,
+
+    PRIMARY KEY (uuid, version),
+    FOREIGN KEY (uuid, version) REFERENCES extent (uuid, version)
+        ON DELETE CASCADE ON UPDATE CASCADE
+);
+
+-- Live and deprecated volume per medium, maintained by the triggers below
+CREATE TABLE medium_stats(
+    medium_family   dev_family,
+    medium_id       varchar(255),
+    live_size       bigint DEFAULT 0 NOT NULL,
+    live_count      bigint DEFAULT 0 NOT NULL,
+    deprec_size     bigint DEFAULT 0 NOT NULL,
+    deprec_count    bigint DEFAULT 0 NOT NULL,
+
+    PRIMARY KEY (medium_family, medium_id)
+);
+
+CREATE TABLE lock(
+    type            lock_type,
+    id              varchar(2048),
+    hostname        varchar(256) NOT NULL,
+    owner           integer NOT NULL,
+    timestamp       timestamp DEFAULT now(),
+
+    PRIMARY KEY (type, id)
+);
+
+CREATE TABLE logs(
+    family    dev_family,
+    device    varchar(2048),
+    medium    varchar(2048),
+    uuid      varchar(36) UNIQUE DEFAULT uuid_generate_v4(),
+    errno     integer NOT NULL,
+    cause     operation_type,
+    message   jsonb,
+    time      timestamp DEFAULT now(),
+
+    PRIMARY KEY (uuid)
+);
+
+-- Add deltas to the live and deprecated volume of a medium
+CREATE OR REPLACE FUNCTION medium_stats_add(family dev_family, id varchar,
+                                            live_size bigint,
+                                            live_count bigint,
+                                            deprec_size bigint,
+                                            deprec_count bigint)
+    RETURNS void AS
+$$
+    INSERT INTO medium_stats AS s
+        VALUES ($1, $2, $3, $4, $5, $6)
+    ON CONFLICT (medium_family, medium_id) DO UPDATE
+        SET live_size = s.live_size + EXCLUDED.live_size,
+            live_count = s.live_count + EXCLUDED.live_count,
+            deprec_size = s.deprec_size + EXCLUDED.deprec_size,
+            deprec_count = s.deprec_count + EXCLUDED.deprec_count;
+$$ LANGUAGE SQL;
+
+-- State of the object of a layout: 2 if live, 1 if deprecated, 0 if none
+CREATE OR REPLACE FUNCTION layout_object_state(uuid varchar, version integer)
+    RETURNS integer AS
+$$
+    SELECT CASE
+        WHEN EXISTS (SELECT 1 FROM object o
+                     WHERE o.uuid = $1 AND o.version = $2) THEN 2
+        WHEN EXISTS (SELECT 1 FROM deprecated_object d
+                     WHERE d.uuid = $1 AND d.version = $2) THEN 1
+        ELSE 0 END;
+$$ LANGUAGE SQL STABLE;
+
+-- Highest state of the other layouts referring to the file of an extent, the
+-- extents of deduplicated objects being shared by several layouts
+CREATE OR REPLACE FUNCTION extent_file_state(family dev_family, id varchar,
+                                             address varchar, uuid varchar,
+                                             version integer)
+    RETURNS integer AS
+$$
+    SELECT COALESCE(max(layout_object_state(le.uuid, le.version)), 0)
+    FROM layout_extent le
+    WHERE le.medium_family = $1 AND le.medium_id = $2 AND le.address = $3
+      AND (le.uuid, le.version) <> ($4, $5);
+$$ LANGUAGE SQL STABLE;
+
+-- Number of files entering (1) or leaving (-1) the given state when a layout
+-- in state 'own' refers to a file whose other layouts are in state 'others':
+-- a file is accounted for once, as live if one of its layouts is live, else
+-- as deprecated.
+CREATE OR REPLACE FUNCTION extent_file_delta(own integer, others integer,
+                                             state integer)
+    RETURNS integer AS
+$$
+    SELECT CASE
+        WHEN $1 <= $2 THEN 0
+        WHEN $1 = $3 THEN 1
+        WHEN $2 = $3 THEN -1
+        ELSE 0 END;
+$$ LANGUAGE SQL IMMUTABLE;
+
+-- An extent is accounted for as long as both itself and its object, live or
+-- deprecated, exist. Whichever of the two rows is removed first withdraws it,
+-- so the statistics do not depend on the order of the store operations.
+CREATE OR REPLACE FUNCTION layout_extent_stats_apply(ext layout_extent,
+                                                     sign integer)
+    RETURNS void AS
+$$
+DECLARE
+    own integer := layout_object_state(ext.uuid, ext.version);
+    others integer := extent_file_state(ext.medium_family, ext.medium_id,
+                                        ext.address, ext.uuid, ext.version);
+    live integer := extent_file_delta(own, others, 2);
+    deprec integer := extent_file_delta(own, others, 1);
+BEGIN
+    IF live <> 0 OR deprec <> 0 THEN
+        PERFORM medium_stats_add(ext.medium_family, ext.medium_id,
+                                 sign * live * ext.size, sign * live,
+                                 sign * deprec * ext.size, sign * deprec);
+    END IF;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION layout_extent_stats()
+    RETURNS trigger AS
+$$
+BEGIN
+    IF TG_OP IN ('UPDATE', 'DELETE') THEN
+        PERFORM layout_extent_stats_apply(OLD, -1);
+    END IF;
+    IF TG_OP IN ('UPDATE', 'INSERT') THEN
+        PERFORM layout_extent_stats_apply(NEW, 1);
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE OR REPLACE FUNCTION object_stats_apply(uuid varchar, version integer,
+                                              deprecated boolean,
+                                              sign integer)
+    RETURNS void AS
+$$
+    SELECT medium_stats_add(medium_family, medium_id,
+                            $4 * sum(live * size)::bigint, $4 * sum(live),
+                            $4 * sum(deprec * size)::bigint, $4 * sum(deprec))
+    FROM (SELECT medium_family, medium_id, size,
+                 extent_file_delta(own, others, 2) AS live,
+                 extent_file_delta(own, others, 1) AS deprec
+          FROM (SELECT medium_family, medium_id, size,
+                       CASE WHEN $3 THEN 1 ELSE 2 END AS own,
+                       extent_file_state(medium_family, medium_id, address,
+                                         $1, $2) AS others
+                FROM layout_extent
+                WHERE layout_extent.uuid = $1
+                  AND layout_extent.version = $2) AS file) AS delta
+    GROUP BY medium_family, medium_id;
+$$ LANGUAGE SQL;
+
+CREATE OR REPLACE FUNCTION object_stats()
+    RETURNS trigger AS
+$$
+DECLARE
+    deprecated boolean := TG_TABLE_NAME = 'deprecated_object';
+BEGIN
+    IF TG_OP IN ('UPDATE', 'DELETE') THEN
+        PERFORM object_stats_apply(OLD.uuid, OLD.version, deprecated, -1);
+    END IF;
+    IF TG_OP IN ('UPDATE', 'INSERT') THEN
+        PERFORM object_stats_apply(NEW.uuid, NEW.version, deprecated, 1);
+    END IF;
+    RETURN NULL;
+END;
+$$ LANGUAGE plpgsql;
+
+CREATE TRIGGER layout_extent_stats_trigger
+    AFTER INSERT OR DELETE OR UPDATE OF uuid, version, medium_family,
+                                        medium_id, size
+    ON layout_extent
+    FOR EACH ROW EXECUTE PROCEDURE layout_extent_stats();
+
+CREATE TRIGGER object_stats_trigger
+    AFTER INSERT OR DELETE OR UPDATE OF uuid, version ON object
+    FOR EACH ROW EXECUTE PROCEDURE object_stats();
+
+CREATE TRIGGER deprecated_object_stats_trigger
+    AFTER INSERT OR DELETE OR UPDATE OF uuid, version ON deprecated_object
+    FOR EACH ROW EXECUTE PROCEDURE object_stats();
@@ -27,6 +27,7 @@ from collections import OrderedDict
 import csv
 from io import StringIO
 import json
+import sys
 import xml.dom.minidom
 import xml.etree.ElementTree
 from tabulate import tabulate
@@ -85,20 +86,20 @@ def human_pretty_dump(data):
     out = tabulate(data, headers="keys", tablefmt="github")
     return out
 
-def filter_display_dict(objs, attrs, max_width):
-    """Filter retrieved information to only display the selected ones."""
-    info = [x.get_display_dict(max_width=max_width) for x in objs]
+def filter_display_item(obj, attrs, max_width):
+    """Filter the information of one object to only display the selected
+    ones."""
+    attr_dict = obj.get_display_dict(max_width=max_width)
 
     # If all/* is an attribute, we fetch them all
-    obj_list = []
     if 'all' in attrs or '*' in attrs:
-        obj_list = info
-    else:
-        for attr_dict in info:
-            obj_list.append(OrderedDict([(k, attr_dict[k]) for k in attrs
-                                         if k in attr_dict]))
+        return attr_dict
 
-    return obj_list
+    return OrderedDict([(k, attr_dict[k]) for k in attrs if k in attr_dict])
+
+def filter_display_dict(objs, attrs, max_width):
+    """Filter retrieved information to only display the selected ones."""
+    return [filter_display_item(x, attrs, max_width) for x in objs]
 
 def dump_object_list(objs, attr=None, max_width=None, fmt="human"):
     """Helper for user friendly object display."""
@@ -120,3 +121,42 @@ def dump_object_list(objs, attr=None, max_width=None, fmt="human"):
 
     # Remove the endstring newline generated by csv, yaml and xml formatters
     print(formats[fmt](objlist).rstrip())
+
+def dump_object_iter(objs, attr=None, max_width=None, fmt="human"):
+    """Helper for user friendly display of objects retrieved one at a time.
+
+    Each object is converted before the next one is requested. The csv and
+    single attribute human formats are printed as objects come, the other
+    formats need the whole list and are printed at the end.
+    """
+    pretty = attr is not None and (len(attr) > 1 or attr == ['*'] or
+                                   attr == ['all'])
+    if fmt == 'csv' or (fmt == 'human' and not pretty):
+        writer = None
+        for obj in objs:
+            item = filter_display_item(obj, attr, max_width)
+            if fmt == 'human':
+                print(str(list(item.values())[0]))
+                continue
+
+            if writer is None:
+                writer = csv.DictWriter(sys.stdout, item.keys(),
+                                        lineterminator='\n')
+                writer.writeheader()
+            writer.writerow(item)
+        return
+
+    objlist = [filter_display_item(obj, attr, max_width) for obj in objs]
+    if not objlist:
+        return
+
+    formats = {
+        'json' : json.dumps,
+        'yaml' : yaml.dump,
+        'xml'  : xml_dump,
+        'csv'  : csv_dump,
+        'human': human_pretty_dump,
+    }
+
+    # Remove the endstring newline generated by csv, yaml and xml formatters
+    print(formats[fmt](objlist).rstrip())
@@ -148,6 +148,7 @@ class CLIParametersTest(unittest.TestCase):
         self.check_cmdline_valid(['undel', 'oid', 'oid1', 'oid2'])
         self.check_cmdline_valid(['ping', 'phobosd'])
         self.check_cmdline_valid(['ping', 'tlc'])
+        self.check_cmdline_valid(['lrs', 'trace'])
         self.check_cmdline_valid(['locate', 'oid1'])
         self.check_cmdline_valid(['locate', '--focus-host', 'vm0', 'oid1'])
         self.check_cmdline_valid(['locate', '--uuid', 'uuid1', 'oid1'])
@@ -186,6 +187,8 @@ class CLIParametersTest(unittest.TestCase):
         self.check_cmdline_exit(['ping'], code=2)
         self.check_cmdline_exit(['ping', 'phobosd', 'tlc'], code=2)
         self.check_cmdline_exit(['ping', 'bad_target'], code=2)
+        self.check_cmdline_exit(['lrs'], code=2)
+        self.check_cmdline_exit(['lrs', 'trace', 'extra'], code=2)
 
     def test_cli_logs_command(self):
         self.check_cmdline_valid(['logs', 'clear'])
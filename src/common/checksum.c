@@ -0,0 +1,286 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos extent checksums
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pho_checksum.h"
+
+#include <endian.h>
+#include <errno.h>
+#include <openssl/evp.h>
+#include <string.h>
+#include <xxhash.h>
+
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#endif
+
+#include "pho_common.h"
+
+/** Reflected CRC32C (Castagnoli) polynomial */
+#define CRC32C_POLY 0x82f63b78
+
+typedef uint32_t (*crc32c_update_t)(uint32_t crc, const unsigned char *buf,
+                                    size_t size);
+
+/** Tables of the slicing-by-8 software implementation */
+static uint32_t crc32c_table[8][256];
+
+/** Fastest implementation available on this CPU, set at load time */
+static crc32c_update_t crc32c_update;
+
+static uint32_t crc32c_sw(uint32_t crc, const unsigned char *buf, size_t size)
+{
+    /* 8 bytes at a time, one table per byte (little endian words) */
+    while (size >= 8) {
+        uint32_t low;
+        uint32_t high;
+
+        memcpy(&low, buf, sizeof(low));
+        memcpy(&high, buf + 4, sizeof(high));
+        low = le32toh(low) ^ crc;
+        high = le32toh(high);
+
+        crc = crc32c_table[7][low & 0xff] ^
+              crc32c_table[6][(low >> 8) & 0xff] ^
+              crc32c_table[5][(low >> 16) & 0xff] ^
+              crc32c_table[4][low >> 24] ^
+              crc32c_table[3][high & 0xff] ^
+              crc32c_table[2][(high >> 8) & 0xff] ^
+              crc32c_table[1][(high >> 16) & 0xff] ^
+              crc32c_table[0][high >> 24];
+
+        buf += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = crc32c_table[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+        size--;
+    }
+
+    return crc;
+}
+
+#if defined(__x86_64__)
+/* inline assembly does not depend on the -msse4.2 flag of the compiler */
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *buf,
+                             size_t size)
+{
+    uint64_t crc64 = crc;
+
+    while (size >= 8) {
+        uint64_t word;
+
+        memcpy(&word, buf, sizeof(word));
+        __asm__("crc32q %1, %0" : "+r"(crc64) : "rm"(word));
+        buf += 8;
+        size -= 8;
+    }
+
+    crc = crc64;
+    while (size > 0) {
+        __asm__("crc32b %1, %0" : "+r"(crc) : "rm"(*buf));
+        buf++;
+        size--;
+    }
+
+    return crc;
+}
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+static uint32_t crc32c_armv8(uint32_t crc, const unsigned char *buf,
+                             size_t size)
+{
+    while (size >= 8) {
+        uint64_t word;
+
+        memcpy(&word, buf, sizeof(word));
+        crc = __crc32cd(crc, word);
+        buf += 8;
+        size -= 8;
+    }
+
+    while (size > 0) {
+        crc = __crc32cb(crc, *buf++);
+        size--;
+    }
+
+    return crc;
+}
+#endif
+
+/**
+ * Build the software tables and select the CRC32C implementation of the CPU.
+ */
+__attribute__((constructor)) static void crc32c_init(void)
+{
+    int i;
+    int j;
+
+    for (i = 0; i < 256; i++) {
+        uint32_t crc = i;
+
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLY : 0);
+
+        crc32c_table[0][i] = crc;
+    }
+
+    for (i = 0; i < 256; i++)
+        for (j = 1; j < 8; j++)
+            crc32c_table[j][i] = crc32c_table[0][crc32c_table[j - 1][i] & 0xff]
+                                 ^ (crc32c_table[j - 1][i] >> 8);
+
+    crc32c_update = crc32c_sw;
+
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2"))
+        crc32c_update = crc32c_sse42;
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        crc32c_update = crc32c_armv8;
+#endif
+}
+
+int pho_checksum_init(struct pho_checksum *checksum, bool md5, bool xxh128,
+                      bool crc32c)
+{
+    memset(checksum, 0, sizeof(*checksum));
+
+    checksum->with_crc32c = crc32c;
+
+#ifdef HAVE_XXH128
+    if (xxh128) {
+        checksum->xxh128state = XXH3_createState();
+        if (!checksum->xxh128state)
+            LOG_RETURN(-ENOMEM, "Unable to create XXH128 state");
+    }
+#endif
+
+    if (md5) {
+        checksum->md5ctx = EVP_MD_CTX_create();
+        if (!checksum->md5ctx) {
+            pho_checksum_fini(checksum);
+            LOG_RETURN(-ENOMEM, "Unable to create MD5 context");
+        }
+    }
+
+    return 0;
+}
+
+bool pho_checksum_xxh128_available(void)
+{
+#ifdef HAVE_XXH128
+    return true;
+#else
+    return false;
+#endif
+}
+
+int pho_checksum_reset(struct pho_checksum *checksum)
+{
+#ifdef HAVE_XXH128
+    if (checksum->xxh128state &&
+        XXH3_128bits_reset(checksum->xxh128state) == XXH_ERROR)
+        LOG_RETURN(-ENOMEM, "Unable to init XXH128 state");
+#endif
+
+    if (checksum->md5ctx &&
+        EVP_DigestInit_ex(checksum->md5ctx, EVP_md5(), NULL) == 0)
+        LOG_RETURN(-ENOMEM, "Unable to init MD5 context");
+
+    checksum->crc32c = 0xffffffff;
+
+    return 0;
+}
+
+int pho_checksum_update(struct pho_checksum *checksum, const void *buffer,
+                        size_t size)
+{
+#ifdef HAVE_XXH128
+    if (checksum->xxh128state &&
+        XXH3_128bits_update(checksum->xxh128state, buffer, size) == XXH_ERROR)
+        LOG_RETURN(-ENOMEM, "Unable to update XXH128 with %zu bytes", size);
+#endif
+
+    if (checksum->md5ctx &&
+        EVP_DigestUpdate(checksum->md5ctx, buffer, size) == 0)
+        LOG_RETURN(-ENOMEM, "Unable to update MD5 with %zu bytes", size);
+
+    if (checksum->with_crc32c)
+        checksum->crc32c = crc32c_update(checksum->crc32c, buffer, size);
+
+    return 0;
+}
+
+int pho_checksum_digest(struct pho_checksum *checksum, struct extent *extent)
+{
+#ifdef HAVE_XXH128
+    if (checksum->xxh128state) {
+        XXH128_canonical_t xxh128_canonical;
+        XXH128_hash_t xxh128;
+
+        xxh128 = XXH3_128bits_digest(checksum->xxh128state);
+        XXH128_canonicalFromHash(&xxh128_canonical, xxh128);
+        memcpy(&extent->xxh128[0], &xxh128_canonical.digest[0],
+               sizeof(extent->xxh128));
+    }
+#endif
+    extent->with_xxh128 = checksum->xxh128state != NULL;
+
+    if (checksum->md5ctx &&
+        EVP_DigestFinal_ex(checksum->md5ctx, extent->md5, NULL) == 0)
+        LOG_RETURN(-ENOMEM, "Unable to produce MD5");
+    extent->with_md5 = checksum->md5ctx != NULL;
+
+    /* stored big endian, as the value is usually printed */
+    if (checksum->with_crc32c) {
+        uint32_t crc32c = htobe32(~checksum->crc32c);
+
+        memcpy(extent->crc32c, &crc32c, sizeof(extent->crc32c));
+    }
+    extent->with_crc32c = checksum->with_crc32c;
+
+    return 0;
+}
+
+void pho_checksum_fini(struct pho_checksum *checksum)
+{
+#ifdef HAVE_XXH128
+    if (checksum->xxh128state) {
+        XXH3_freeState(checksum->xxh128state);
+        checksum->xxh128state = NULL;
+    }
+#endif
+
+    if (checksum->md5ctx) {
+        EVP_MD_CTX_destroy(checksum->md5ctx);
+        checksum->md5ctx = NULL;
+    }
+}
@@ -0,0 +1,154 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos extent compression
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pho_compress.h"
+
+#include <errno.h>
+#include <string.h>
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "pho_common.h"
+
+enum pho_codec str2pho_codec(const char *str)
+{
+    int i;
+
+    for (i = 0; i < PHO_CODEC_LAST; i++)
+        if (!strcmp(str, pho_codec_names[i]))
+            return i;
+    return PHO_CODEC_INVAL;
+}
+
+bool pho_compress_available(enum pho_codec codec)
+{
+    switch (codec) {
+    case PHO_CODEC_NONE:
+        return true;
+#ifdef HAVE_ZSTD
+    case PHO_CODEC_ZSTD:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
+
+int pho_compress_init(struct pho_compress *comp, enum pho_codec codec,
+                      int level, bool decompress)
+{
+    memset(comp, 0, sizeof(*comp));
+
+    if (!pho_compress_available(codec))
+        LOG_RETURN(-ENOTSUP, "Compression codec '%s' is not available",
+                   pho_codec2str(codec) ? : "?");
+
+    comp->codec = codec;
+    comp->decompress = decompress;
+
+#ifdef HAVE_ZSTD
+    if (codec == PHO_CODEC_ZSTD && decompress) {
+        comp->stream = ZSTD_createDCtx();
+        if (!comp->stream)
+            LOG_RETURN(-ENOMEM, "Unable to create zstd decompression context");
+    } else if (codec == PHO_CODEC_ZSTD) {
+        comp->stream = ZSTD_createCCtx();
+        if (!comp->stream)
+            LOG_RETURN(-ENOMEM, "Unable to create zstd compression context");
+
+        if (level &&
+            ZSTD_isError(ZSTD_CCtx_setParameter(comp->stream,
+                                                ZSTD_c_compressionLevel,
+                                                level))) {
+            pho_compress_fini(comp);
+            LOG_RETURN(-EINVAL, "Invalid zstd compression level %d", level);
+        }
+    }
+#else
+    (void)level;
+#endif
+
+    return 0;
+}
+
+size_t pho_compress_out_size(const struct pho_compress *comp)
+{
+#ifdef HAVE_ZSTD
+    if (comp->codec == PHO_CODEC_ZSTD)
+        return comp->decompress ? ZSTD_DStreamOutSize() : ZSTD_CStreamOutSize();
+#endif
+    return 0;
+}
+
+int pho_compress_step(struct pho_compress *comp, struct pho_compress_in *in,
+                      struct pho_compress_out *out, bool end, bool *ended)
+{
+#ifdef HAVE_ZSTD
+    if (comp->codec == PHO_CODEC_ZSTD) {
+        ZSTD_outBuffer zout = { out->buf, out->size, out->pos };
+        ZSTD_inBuffer zin = { in->buf, in->size, in->pos };
+        size_t ret;
+
+        if (comp->decompress)
+            ret = ZSTD_decompressStream(comp->stream, &zout, &zin);
+        else
+            ret = ZSTD_compressStream2(comp->stream, &zout, &zin,
+                                       end ? ZSTD_e_end : ZSTD_e_continue);
+
+        in->pos = zin.pos;
+        out->pos = zout.pos;
+
+        if (ZSTD_isError(ret))
+            LOG_RETURN(comp->decompress ? -EILSEQ : -EIO, "zstd %s error: %s",
+                       comp->decompress ? "decompression" : "compression",
+                       ZSTD_getErrorName(ret));
+
+        /* a frame is complete once nothing is left to flush or to decode */
+        *ended = ret == 0 && (comp->decompress || end);
+        return 0;
+    }
+#endif
+    (void)in;
+    (void)out;
+    (void)end;
+    (void)ended;
+    LOG_RETURN(-ENOTSUP, "No compression stream to run");
+}
+
+void pho_compress_fini(struct pho_compress *comp)
+{
+#ifdef HAVE_ZSTD
+    if (comp->codec == PHO_CODEC_ZSTD && comp->decompress)
+        ZSTD_freeDCtx(comp->stream);
+    else if (comp->codec == PHO_CODEC_ZSTD)
+        ZSTD_freeCCtx(comp->stream);
+#endif
+    comp->stream = NULL;
+}
@@ -29,6 +29,9 @@
 
 #include "pho_common.h"
 #include <ctype.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <sys/syscall.h>
@@ -36,6 +39,72 @@
 
 static void phobos_log_callback_default(const struct pho_logrec *rec);
 
+/** Number of records of the ring of each thread, must be a power of 2 */
+#define LOG_RING_SIZE 1024
+
+/** Size of the messages stored in the rings, longer ones are allocated */
+#define LOG_SLOT_MSG_SIZE 256
+
+/** Time the logger thread waits when there is no record to write */
+#define LOG_IDLE_WAIT_NS (5 * 1000 * 1000)
+
+/** Size of the buffer of the default callback's output in the logger thread */
+#define LOG_BATCH_SIZE (64 * 1024)
+
+/** Record waiting in a ring */
+struct log_slot {
+    enum pho_log_level   level;
+    const char          *file;
+    const char          *func;
+    int                  line;
+    int                  err;
+    struct timeval       time;
+    char                *long_msg;  /**< Allocated message if it did not fit
+                                      * in \p msg, NULL otherwise
+                                      */
+    char                 msg[LOG_SLOT_MSG_SIZE];
+};
+
+/**
+ * Single-producer single-consumer ring of a thread: \p head is only written
+ * by the thread and \p tail by the logger thread.
+ */
+struct log_ring {
+    struct log_ring *next;          /**< Next ring of the list */
+    pid_t            tid;           /**< Thread owning the ring */
+    uint64_t         head;          /**< Number of records pushed */
+    uint64_t         tail;          /**< Number of records written */
+    bool             orphan;        /**< Set once its thread exited */
+    struct log_slot  slots[LOG_RING_SIZE];
+};
+
+struct pho_log_async {
+    pthread_t        thread;        /**< Logger thread */
+    bool             stopping;      /**< Set to stop the logger thread */
+    int              emitters;      /**< Threads pushing a record */
+    pthread_key_t    ring_key;      /**< Ring of the calling thread */
+    struct log_ring *rings;         /**< Rings of all threads, new ones are
+                                      * prepended, only the logger thread
+                                      * removes them
+                                      */
+    uint64_t         dropped;       /**< Records dropped as their ring was
+                                      * full
+                                      */
+    uint64_t         reported;      /**< Dropped records already reported */
+};
+
+/**
+ * Buffered output of the default callback in the logger thread, flushed at the
+ * end of each batch. Other threads write directly to stderr.
+ */
+static __thread FILE *log_output;
+
+/**
+ * Asynchronous logging state, never freed: threads may still hold it once
+ * stopped, see pho_log_async_stop().
+ */
+static struct pho_log_async *log_async_state;
+
 char *rstrip(char *msg)
 {
     int i;
@@ -75,7 +144,8 @@ void phobos_log_callback_default(const struct pho_logrec *rec)
         }
     }
 
-    fprintf(stderr, "%04d-%02d-%02d %02d:%02d:%02d.%09ld <%s>%s %s%s\n",
+    fprintf(log_output ? : stderr,
+            "%04d-%02d-%02d %02d:%02d:%02d.%09ld <%s>%s %s%s\n",
             time.tm_year + 1900, time.tm_mon + 1, time.tm_mday,
             time.tm_hour, time.tm_min, time.tm_sec,
             rec->plr_time.tv_usec * 1000, pho_log_level2str(rec->plr_level),
@@ -120,14 +190,333 @@ void pho_log_callback_set(pho_log_callback_t cb)
         phobos_context()->log_callback = cb;
 }
 
+static void log_ring_orphan(void *ring)
+{
+    __atomic_store_n(&((struct log_ring *)ring)->orphan, true,
+                     __ATOMIC_RELEASE);
+}
+
+static struct log_ring *log_ring_get(struct pho_log_async *async)
+{
+    struct log_ring *ring = pthread_getspecific(async->ring_key);
+
+    if (ring)
+        return ring;
+
+    ring = calloc(1, sizeof(*ring));
+    if (!ring)
+        return NULL;
+
+    ring->tid = syscall(SYS_gettid);
+    if (pthread_setspecific(async->ring_key, ring)) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->next = __atomic_load_n(&async->rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&async->rings, &ring->next, ring,
+                                        false, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+        ;
+
+    return ring;
+}
+
+/**
+ * Push a record to the ring of the calling thread, without waiting.
+ *
+ * \return false if the record could not be pushed because the logger thread
+ *         is stopped or the ring could not be allocated
+ */
+static bool log_async_emit(struct pho_log_async *async,
+                           enum pho_log_level level, const char *file,
+                           int line, const char *func, int errcode,
+                           const char *fmt, va_list args)
+{
+    struct log_ring *ring;
+    struct log_slot *slot;
+    va_list args_copy;
+    uint64_t head;
+    int rc;
+
+    /*
+     * Records emitted once stopped would never be written. The stopping thread
+     * waits for the records being pushed before its last drain, see
+     * pho_log_async_stop().
+     */
+    __atomic_add_fetch(&async->emitters, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&async->stopping, __ATOMIC_SEQ_CST))
+        goto out_fallback;
+
+    ring = log_ring_get(async);
+    if (!ring)
+        goto out_fallback;
+
+    head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >=
+            LOG_RING_SIZE) {
+        __atomic_add_fetch(&async->dropped, 1, __ATOMIC_RELAXED);
+        goto out_pushed;
+    }
+
+    slot = &ring->slots[head % LOG_RING_SIZE];
+    slot->level = level;
+    slot->file = file;
+    slot->func = func;
+    slot->line = line;
+    slot->err = abs(errcode);
+    slot->long_msg = NULL;
+    gettimeofday(&slot->time, NULL);
+
+    va_copy(args_copy, args);
+    rc = vsnprintf(slot->msg, sizeof(slot->msg), fmt, args);
+    if (rc < 0)
+        slot->msg[0] = '\0';
+    else if (rc >= sizeof(slot->msg) &&
+             vasprintf(&slot->long_msg, fmt, args_copy) < 0)
+        /* keep the truncated message */
+        slot->long_msg = NULL;
+    va_end(args_copy);
+
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+out_pushed:
+    __atomic_sub_fetch(&async->emitters, 1, __ATOMIC_RELEASE);
+    return true;
+
+out_fallback:
+    __atomic_sub_fetch(&async->emitters, 1, __ATOMIC_RELEASE);
+    return false;
+}
+
+static void log_report_drops(struct pho_log_async *async, uint64_t dropped)
+{
+    struct pho_logrec rec;
+    char msg[64];
+
+    if (dropped == async->reported)
+        return;
+
+    if (PHO_LOG_WARN <= pho_log_level_get()) {
+        snprintf(msg, sizeof(msg), "%" PRIu64 " log records dropped",
+                 dropped - async->reported);
+        rec.plr_level = PHO_LOG_WARN;
+        rec.plr_tid   = syscall(SYS_gettid);
+        rec.plr_file  = __FILE__;
+        rec.plr_func  = __func__;
+        rec.plr_line  = __LINE__;
+        rec.plr_err   = 0;
+        rec.plr_msg   = msg;
+        gettimeofday(&rec.plr_time, NULL);
+        phobos_context()->log_callback(&rec);
+    }
+
+    async->reported = dropped;
+}
+
+/** Pass the pending records of \p ring to the log callback */
+static size_t log_ring_drain(struct log_ring *ring)
+{
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = ring->tail;
+    size_t count = 0;
+
+    for (; tail != head; tail++, count++) {
+        struct log_slot *slot = &ring->slots[tail % LOG_RING_SIZE];
+        struct pho_logrec rec = {
+            .plr_level = slot->level,
+            .plr_tid   = ring->tid,
+            .plr_file  = slot->file,
+            .plr_func  = slot->func,
+            .plr_line  = slot->line,
+            .plr_err   = slot->err,
+            .plr_time  = slot->time,
+            .plr_msg   = slot->long_msg ? : slot->msg,
+        };
+
+        phobos_context()->log_callback(&rec);
+        free(slot->long_msg);
+        /* the slot is released for each record so that the thread can reuse
+         * it as soon as possible
+         */
+        __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    return count;
+}
+
+/**
+ * Write the pending records of every ring, free the rings of the exited
+ * threads and report the new dropped records.
+ *
+ * \return the number of records written
+ */
+static size_t log_async_drain(struct pho_log_async *async)
+{
+    struct log_ring *ring = __atomic_load_n(&async->rings, __ATOMIC_ACQUIRE);
+    struct log_ring *prev = NULL;
+    size_t count = 0;
+
+    while (ring) {
+        bool orphan = __atomic_load_n(&ring->orphan, __ATOMIC_ACQUIRE);
+        struct log_ring *next = ring->next;
+
+        count += log_ring_drain(ring);
+
+        /* the head of the list may be concurrently updated, it is removed
+         * once another ring is added
+         */
+        if (orphan && prev) {
+            prev->next = next;
+            free(ring);
+        } else {
+            prev = ring;
+        }
+
+        ring = next;
+    }
+
+    log_report_drops(async,
+                     __atomic_load_n(&async->dropped, __ATOMIC_RELAXED));
+    if (log_output)
+        fflush(log_output);
+
+    return count;
+}
+
+static void *log_async_thread(void *data)
+{
+    struct pho_log_async *async = data;
+    struct timespec idle = {0, LOG_IDLE_WAIT_NS};
+    int fd;
+
+    /* batch the writes of the default callback */
+    fd = dup(STDERR_FILENO);
+    if (fd >= 0) {
+        log_output = fdopen(fd, "w");
+        if (!log_output)
+            close(fd);
+        else
+            setvbuf(log_output, NULL, _IOFBF, LOG_BATCH_SIZE);
+    }
+
+    while (true) {
+        bool stopping = __atomic_load_n(&async->stopping, __ATOMIC_ACQUIRE);
+
+        if (log_async_drain(async) > 0)
+            continue;
+
+        if (stopping)
+            break;
+
+        nanosleep(&idle, NULL);
+    }
+
+    if (log_output) {
+        fclose(log_output);
+        log_output = NULL;
+    }
+
+    return NULL;
+}
+
+int pho_log_async_start(void)
+{
+    struct pho_log_async *async = log_async_state;
+    int rc;
+
+    if (async && !__atomic_load_n(&async->stopping, __ATOMIC_ACQUIRE))
+        return -EALREADY;
+
+    /* once stopped, it is started again along with the rings it has */
+    if (!async) {
+        async = calloc(1, sizeof(*async));
+        if (!async)
+            return -ENOMEM;
+
+        rc = pthread_key_create(&async->ring_key, log_ring_orphan);
+        if (rc) {
+            free(async);
+            return -rc;
+        }
+
+        log_async_state = async;
+    }
+
+    __atomic_store_n(&async->dropped, 0, __ATOMIC_RELAXED);
+    async->reported = 0;
+    __atomic_store_n(&async->stopping, false, __ATOMIC_RELEASE);
+
+    rc = pthread_create(&async->thread, NULL, log_async_thread, async);
+    if (rc) {
+        __atomic_store_n(&async->stopping, true, __ATOMIC_RELEASE);
+        return -rc;
+    }
+
+    __atomic_store_n(&phobos_context()->log_async, async, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+void pho_log_async_stop(void)
+{
+    struct pho_log_async *async = log_async_state;
+
+    if (!async || __atomic_load_n(&async->stopping, __ATOMIC_ACQUIRE))
+        return;
+
+    /*
+     * Neither the state nor the rings are freed: a thread still holding them
+     * falls back to synchronous logging.
+     */
+    __atomic_store_n(&async->stopping, true, __ATOMIC_SEQ_CST);
+    pthread_join(async->thread, NULL);
+
+    /*
+     * A thread may have checked the flag before it was set, its record is
+     * pushed after the last drain of the logger thread: wait for it, then
+     * write the rings one last time.
+     */
+    while (__atomic_load_n(&async->emitters, __ATOMIC_SEQ_CST))
+        sched_yield();
+
+    log_async_drain(async);
+}
+
+uint64_t pho_log_async_dropped(void)
+{
+    struct pho_log_async *async;
+
+    async = __atomic_load_n(&phobos_context()->log_async, __ATOMIC_ACQUIRE);
+    if (!async)
+        return 0;
+
+    return __atomic_load_n(&async->dropped, __ATOMIC_RELAXED);
+}
+
 void _log_emit(enum pho_log_level level, const char *file, int line,
                const char *func, int errcode, const char *fmt, ...)
 {
+    struct pho_log_async *async;
     struct pho_logrec   rec;
     va_list             args;
     int                 save_errno = errno;
     int                 rc;
 
+    async = __atomic_load_n(&phobos_context()->log_async, __ATOMIC_ACQUIRE);
+    if (async) {
+        bool pushed;
+
+        va_start(args, fmt);
+        pushed = log_async_emit(async, level, file, line, func, errcode, fmt,
+                                args);
+        va_end(args);
+        if (pushed) {
+            errno = save_errno;
+            return;
+        }
+    }
+
     va_start(args, fmt);
 
     rec.plr_level = level;
@@ -54,6 +54,19 @@ static inline void sa_sigterm(int signum)
     running = false;
 }
 
+/* Set when the configuration file is to be reloaded */
+static volatile sig_atomic_t reload_config;
+
+/**
+ * SIGHUP handler to request a reload of the configuration file
+ *
+ * @param[in] signum    signal to manage by the handler
+ */
+static inline void sa_sighup(int signum)
+{
+    reload_config = 1;
+}
+
 #define DAEMON_PARAMS_DEFAULT {PHO_LOG_INFO, true, false, NULL}
 
 static void print_usage(const char *daemon_name)
@@ -246,6 +259,7 @@ static void phobos_log_callback_def_with_sys(const struct pho_logrec *rec)
 int daemon_init(struct daemon_params param)
 {
     struct sigaction sa;
+    int rc2;
     int rc;
 
     /* signal handler */
@@ -254,6 +268,8 @@ int daemon_init(struct daemon_params param)
     sigemptyset(&sa.sa_mask);
     sigaction(SIGTERM, &sa, NULL);
     sigaction(SIGINT, &sa, NULL);
+    sa.sa_handler = sa_sighup;
+    sigaction(SIGHUP, &sa, NULL);
 
     /* Load configuration */
     rc = pho_cfg_init_local(param.cfg_path);
@@ -265,9 +281,37 @@ int daemon_init(struct daemon_params param)
     if (param.use_syslog)
         pho_log_callback_set(phobos_log_callback_def_with_sys);
 
+    /* the daemon threads must not wait for their logs to be written, they
+     * are flushed by daemon_fini()
+     */
+    rc2 = pho_log_async_start();
+    if (rc2)
+        return rc2;
+
     return rc;
 }
 
+void daemon_reload_config(void)
+{
+    int rc;
+
+    if (!reload_config)
+        return;
+
+    reload_config = 0;
+    rc = pho_cfg_reload_local();
+    if (rc)
+        pho_error(rc, "Cannot reload the configuration, the previous one is "
+                  "kept");
+    else
+        pho_info("Configuration reloaded");
+}
+
+void daemon_fini(void)
+{
+    pho_log_async_stop();
+}
+
 void daemon_notify_init_done(int pipefd_to_close, int *rc)
 {
     sighandler_t current_sigpipe_handler;
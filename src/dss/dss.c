@@ -27,6 +27,7 @@
 #endif
 
 #include "dss_logs.h"
+#include "dss_pipeline.h"
 #include "dss_utils.h"
 #include "pho_common.h"
 #include "pho_type_utils.h"
@@ -66,6 +67,10 @@ static int dss_deprecated_object_from_pg_row(struct dss_handle *handle,
                                              void *void_object, PGresult *res,
                                              int row_num);
 static void dss_object_result_free(void *void_object);
+static int dss_media_enriched_stats_from_pg_row(struct dss_handle *handle,
+                                                void *void_stats,
+                                                PGresult *res, int row_num);
+static void dss_media_enriched_stats_result_free(void *void_stats);
 
 /* This config item is mutualized with lrs_device.c */
 const struct pho_config_item cfg_tape_model[] = {
@@ -171,6 +176,7 @@ struct dss_result {
         struct dev_info     dev[0];
         struct object_info  object[0];
         struct layout_info  layout[0];
+        struct enriched_media_stats media_stats[0];
     } items;
 };
 
@@ -232,6 +238,8 @@ int dss_init(struct dss_handle *handle)
     if (conn_str == NULL)
         return -EINVAL;
 
+    handle->dh_pipeline = NULL;
+    handle->dh_prepared = NULL;
     handle->dh_conn = PQconnectdb(conn_str);
 
     if (PQstatus(handle->dh_conn) != CONNECTION_OK) {
@@ -250,6 +258,16 @@ int dss_init(struct dss_handle *handle)
 
 void dss_fini(struct dss_handle *handle)
 {
+    if (dss_pipeline_is_active(handle)) {
+        pho_warn("Closing DSS connection with pipelined requests pending");
+        dss_pipeline_fini(handle);
+    }
+
+    if (handle->dh_prepared) {
+        g_hash_table_destroy(handle->dh_prepared);
+        handle->dh_prepared = NULL;
+    }
+
     PQfinish(handle->dh_conn);
 }
 
@@ -392,12 +410,19 @@ static const char * const select_query[] = {
     [DSS_MEDIA]  = "SELECT family, model, id, adm_status,"
                    " address_type, fs_type, fs_status, fs_label, stats, tags,"
                    " put, get, delete FROM media",
-    [DSS_LAYOUT] = "SELECT oid, uuid, version, state, lyt_info, extents"
-                   " FROM extent",
+    [DSS_LAYOUT] = "SELECT oid, uuid, version, state, lyt_info, layout_idx,"
+                   " medium_family, medium_id, address, size, md5, xxh128,"
+                   " crc32c FROM extent"
+                   " LEFT JOIN layout_extent USING (uuid, version)",
     [DSS_OBJECT] = "SELECT oid, uuid, version, user_md FROM object",
     [DSS_DEPREC] = "SELECT oid, uuid, version, user_md, deprec_time"
                    " FROM deprecated_object",
     [DSS_LOGS]   = DSS_LOGS_SELECT_QUERY,
+    [DSS_MEDIA_STATS] = "SELECT family, id, adm_status, fs_status, stats,"
+                        " COALESCE(live_size, 0), COALESCE(live_count, 0),"
+                        " COALESCE(deprec_size, 0), COALESCE(deprec_count, 0)"
+                        " FROM media LEFT JOIN medium_stats"
+                        " ON medium_family = family AND medium_id = id",
 };
 
 static const size_t res_size[] = {
@@ -407,6 +432,7 @@ static const size_t res_size[] = {
     [DSS_OBJECT] = sizeof(struct object_info),
     [DSS_DEPREC] = sizeof(struct object_info),
     [DSS_LOGS]   = sizeof(struct pho_log),
+    [DSS_MEDIA_STATS] = sizeof(struct enriched_media_stats),
 };
 
 typedef int (*res_pg_constructor_t)(struct dss_handle *handle, void *item,
@@ -418,6 +444,7 @@ static const res_pg_constructor_t res_pg_constructor[] = {
     [DSS_OBJECT] = dss_object_from_pg_row,
     [DSS_DEPREC] = dss_deprecated_object_from_pg_row,
     [DSS_LOGS]   = dss_logs_from_pg_row,
+    [DSS_MEDIA_STATS] = dss_media_enriched_stats_from_pg_row,
 };
 
 typedef void (*res_destructor_t)(void *item);
@@ -428,6 +455,7 @@ static const res_destructor_t res_destructor[] = {
     [DSS_OBJECT] = dss_object_result_free,
     [DSS_DEPREC] = dss_object_result_free,
     [DSS_LOGS]   = dss_logs_result_free,
+    [DSS_MEDIA_STATS] = dss_media_enriched_stats_result_free,
 };
 
 static const char * const insert_query[] = {
@@ -437,8 +465,6 @@ static const char * const insert_query[] = {
                    " fs_type, address_type, fs_status, fs_label, stats, tags,"
                    " put, get, delete)"
                    " VALUES ",
-    [DSS_LAYOUT] = "INSERT INTO extent (oid, uuid, version, state, lyt_info,"
-                   " extents) VALUES ",
     [DSS_OBJECT] = "INSERT INTO object (oid, user_md) VALUES ",
     [DSS_DEPREC] = "INSERT INTO deprecated_object (oid, uuid, version, user_md)"
                    " VALUES ",
@@ -450,9 +476,8 @@ static const char * const insert_full_query[] = {
 
 static const char * const update_query[] = {
     [DSS_DEVICE] = "UPDATE device SET adm_status = '%s' WHERE id = '%s';",
-    [DSS_LAYOUT] = "UPDATE extent SET (state, lyt_info, extents) ="
-                   " ('%s', '%s', '%s')"
-                   " WHERE uuid = '%s' and version = %d;",
+    [DSS_LAYOUT] = "UPDATE extent SET (state, lyt_info) = ('%s', '%s')"
+                   " WHERE uuid = '%s' AND version = %d",
     [DSS_OBJECT] = "UPDATE object SET user_md = '%s' "
                    " WHERE oid = '%s';",
 };
@@ -475,7 +500,7 @@ static const char * const insert_query_values[] = {
                    " %s, %s, %s)%s",
     [DSS_LAYOUT] = "('%s', (select uuid from object where oid = '%s'), "
                    " (select version from object where oid = '%s'), '%s',"
-                   " '%s', '%s')%s",
+                   " '%s')%s",
     [DSS_OBJECT] = "('%s', '%s')%s",
     [DSS_DEPREC] = "('%s', '%s', %d, '%s')%s",
 };
@@ -484,6 +509,32 @@ static const char * const insert_full_query_values[] = {
     [DSS_OBJECT] = "('%s', '%s', %d, '%s')%s",
 };
 
+/**
+ * Layout extents are stored one per row in the layout_extent table, the
+ * following queries are used to write them along with their layout.
+ */
+static const char * const layout_insert_query =
+    "INSERT INTO extent (oid, uuid, version, state, lyt_info) VALUES ";
+
+static const char * const layout_extent_insert_query =
+    "INSERT INTO layout_extent (uuid, version, layout_idx, medium_family,"
+    " medium_id, address, size, md5, xxh128, crc32c)"
+    " SELECT l.uuid, l.version, e.layout_idx, e.medium_family::dev_family,"
+    " e.medium_id, e.address, e.size, e.md5, e.xxh128, e.crc32c";
+
+static const char * const layout_extent_columns =
+    "layout_idx, medium_family, medium_id, address, size, md5, xxh128, crc32c";
+
+static const char * const layout_extent_trunc_query =
+    "trunc AS (DELETE FROM layout_extent"
+    " WHERE uuid = '%s' AND version = %d AND layout_idx >= %d)";
+
+static const char * const layout_extent_upsert_query =
+    " ON CONFLICT (uuid, version, layout_idx) DO UPDATE SET"
+    " (medium_family, medium_id, address, size, md5, xxh128, crc32c) ="
+    " (EXCLUDED.medium_family, EXCLUDED.medium_id, EXCLUDED.address,"
+    " EXCLUDED.size, EXCLUDED.md5, EXCLUDED.xxh128, EXCLUDED.crc32c);";
+
 enum dss_move_queries {
     DSS_MOVE_INVAL = -1,
     DSS_MOVE_OBJECT_TO_DEPREC = 0,
@@ -735,11 +786,7 @@ out_free:
     return res;
 }
 
-/**
- * Extract layout type and parameters from json
- *
- */
-static int dss_layout_desc_decode(struct module_desc *desc, const char *json)
+int dss_layout_desc_decode(struct module_desc *desc, const char *json)
 {
     json_t          *root;
     json_t          *attrs;
@@ -798,7 +845,7 @@ out_free:
     return rc;
 }
 
-static char *dss_layout_desc_encode(struct module_desc *desc)
+char *dss_layout_desc_encode(const struct module_desc *desc)
 {
     char    *result = NULL;
     json_t  *attrs  = NULL;
@@ -878,258 +925,6 @@ static int read_hex_buffer(unsigned char *digest, size_t size,
     return 0;
 }
 
-/**
- * Extract extents from json
- *
- * \param[out] extents extent list
- * \param[out] count  number of extents decoded
- * \param[in]  json   String with json media stats
- *
- * \return 0 on success, negative error code on failure.
- */
-static int dss_layout_extents_decode(struct extent **extents, int *count,
-                                     const char *json)
-{
-    json_t          *root;
-    json_t          *child;
-    json_error_t     json_error;
-    struct extent   *result = NULL;
-    size_t           extents_res_size;
-    int              rc;
-    int              i;
-    ENTRY;
-
-    pho_debug("Decoding JSON representation for extents: '%s'", json);
-
-    root = json_loads(json, JSON_REJECT_DUPLICATES, &json_error);
-    if (!root)
-        LOG_RETURN(-EINVAL, "Failed to parse json data: %s", json_error.text);
-
-    if (!json_is_array(root))
-        LOG_GOTO(out_decref, rc = -EINVAL, "Invalid extents description");
-
-    *count = json_array_size(root);
-    if (*count == 0) {
-        extents = NULL;
-        LOG_GOTO(out_decref, rc = -EINVAL,
-                 "json parser: extents array is empty");
-    }
-
-    extents_res_size = sizeof(struct extent) * (*count);
-    result = malloc(extents_res_size);
-    if (result == NULL)
-        LOG_GOTO(out_decref, rc = -ENOMEM,
-                 "Memory allocation of size %zu failed", extents_res_size);
-
-    for (i = 0; i < *count; i++) {
-        const char *tmp;
-
-        child = json_array_get(root, i);
-        result[i].layout_idx = i;
-        result[i].size = json_dict2ll(child, "sz");
-        if (result[i].size < 0)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Missing attribute 'sz'");
-
-        result[i].address.buff = json_dict2str(child, "addr");
-        if (!result[i].address.buff)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Missing attribute 'addr'");
-
-        result[i].address.size = strlen(result[i].address.buff) + 1;
-
-        tmp = json_dict2tmp_str(child, "fam");
-        if (!tmp)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Missing attribute 'fam'");
-
-        result[i].media.family = str2rsc_family(tmp);
-
-        /*XXX fs_type & address_type retrieved from media info */
-        if (result[i].media.family == PHO_RSC_INVAL)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Invalid medium family");
-
-        tmp = json_dict2tmp_str(child, "media");
-        if (!tmp)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Missing attribute 'media'");
-
-        rc = pho_id_name_set(&result[i].media, tmp);
-        if (rc)
-            LOG_GOTO(out_decref, rc = -EINVAL, "Failed to set media id");
-
-        /* xxh128 */
-        tmp = json_dict2tmp_str(child, "xxh128");
-        if (tmp) {
-            rc = read_hex_buffer(result[i].xxh128, sizeof(result[i].xxh128),
-                                 tmp);
-            if (rc)
-                LOG_GOTO(out_decref, rc,
-                         "Failed to decode xxh128 extent %d out of %d",
-                         i, *count);
-
-            result[i].with_xxh128 = true;
-        } else {
-            result[i].with_xxh128 = false;
-        }
-
-        /* md5 */
-        tmp = json_dict2tmp_str(child, "md5");
-        if (tmp) {
-            rc = read_hex_buffer(result[i].md5, sizeof(result[i].md5), tmp);
-            if (rc)
-                LOG_GOTO(out_decref, rc,
-                         "Failed to decode md5 extent %d out of %d", i, *count);
-
-            result[i].with_md5 = true;
-        } else {
-            result[i].with_md5 = false;
-        }
-    }
-
-    *extents = result;
-    rc = 0;
-
-out_decref:
-    if (rc)
-        free(result);
-    json_decref(root);
-    return rc;
-}
-
-/**
- * Add a field to a json which is the hexadecimal notation of an input buffer
- *
- * @param[in,out]   json            Json into adding the new field
- * @param[in]       new_field_name  Name of the new field
- * @param[in]       buf             Buffer to encode in json
- * @param[in]       size            Size in bytes of the input buffer
- *
- * @return 0 on success, negative error code on failure.
- */
-static int fill_json_with_hex_buf(json_t *json, const char *new_field_name,
-                                  const unsigned char *buf, size_t size)
-{
-    char *json_field_buf = uchar2hex(buf, size);
-    int rc;
-
-    if (!json_field_buf)
-        return -errno;
-
-    rc = json_object_set_new(json, new_field_name,
-                             json_string(json_field_buf));
-    free(json_field_buf);
-    if (rc)
-        return -EINVAL;
-
-    return 0;
-}
-
-/**
- * Encode extents to json
- *
- * \param[in]   extents extent list
- * \param[in]   count   number of extents
- * \param[out]  error   error count
- *
- * \return json as string
- */
-static char *dss_layout_extents_encode(struct extent *extents,
-                                       unsigned int count, int *error)
-{
-    int err_cnt = 0;
-    json_t *child;
-    json_t *root;
-    char *s;
-    int rc;
-    int i;
-
-    ENTRY;
-
-    root = json_array();
-    if (!root) {
-        pho_error(-ENOMEM, "Failed to create json root object");
-        return NULL;
-    }
-
-    for (i = 0; i < count; i++) {
-        child = json_object();
-        if (!child) {
-            pho_error(-ENOMEM, "Failed to create json child object");
-            err_cnt++;
-            continue;
-        }
-
-        rc = json_object_set_new(child, "sz", json_integer(extents[i].size));
-        if (rc) {
-            pho_error(-EINVAL, "Failed to encode 'sz' (%zu)", extents[i].size);
-            err_cnt++;
-        }
-
-        /* We may have no address yet. */
-        if (extents[i].address.buff != NULL) {
-            rc = json_object_set_new(child, "addr",
-                                     json_string(extents[i].address.buff));
-            if (rc) {
-                pho_error(-EINVAL, "Failed to encode 'addr' (%s)",
-                          extents[i].address.buff);
-                err_cnt++;
-            }
-        }
-
-        rc = json_object_set_new(child, "fam",
-            json_string(rsc_family2str(extents[i].media.family)));
-        if (rc) {
-            pho_error(-EINVAL, "Failed to encode 'fam' (%d:%s)",
-                      extents[i].media.family,
-                      rsc_family2str(extents[i].media.family));
-            err_cnt++;
-        }
-
-        rc = json_object_set_new(child, "media",
-            json_string(extents[i].media.name));
-        if (rc) {
-            pho_error(-EINVAL, "Failed to encode 'media' (%s)",
-                      extents[i].media.name);
-            err_cnt++;
-        }
-
-        /* xxh128: 2 hex char per byte + final '\0' */
-        if (extents[i].with_xxh128) {
-            rc = fill_json_with_hex_buf(child, "xxh128", extents[i].xxh128,
-                                        sizeof(extents[i].xxh128));
-            if (rc) {
-                pho_error(rc, "Failed to encode 'xxh128' in layout");
-                err_cnt++;
-            }
-        }
-
-        /* md5: 2 hex char per byte + final '\0' */
-        if (extents[i].with_md5) {
-            rc = fill_json_with_hex_buf(child, "md5", extents[i].md5,
-                                        sizeof(extents[i].md5));
-            if (rc) {
-                pho_error(rc, "Failed to encode 'md5' in layout");
-                err_cnt++;
-            }
-        }
-
-        rc = json_array_append_new(root, child);
-        if (rc) {
-            pho_error(-EINVAL, "Failed to attach child to root object");
-            err_cnt++;
-        }
-    }
-
-    *error = err_cnt;
-
-    s = json_dumps(root, 0);
-    json_decref(root);
-    if (!s) {
-        pho_error(-EINVAL, "Failed to dump JSON to ASCIIZ");
-        return NULL;
-    }
-
-    pho_debug("Created JSON representation for extents: '%s'", s);
-    return s;
-}
-
 static int get_object_setrequest(PGconn *_conn, struct object_info *item_list,
                                  int item_cnt, enum dss_set_action action,
                                  GString *request)
@@ -1197,49 +992,239 @@ static int get_deprecated_object_setrequest(PGconn *_conn,
     return 0;
 }
 
-static int get_layout_setrequest(PGconn *_conn, struct layout_info *item_list,
+/**
+ * Append the hexadecimal notation of \p buf to \p request as a quoted SQL
+ * string, or NULL if \p is_set is false.
+ */
+static int append_hex_or_null(GString *request, bool is_set,
+                              const unsigned char *buf, size_t size)
+{
+    char *hex;
+
+    if (!is_set) {
+        g_string_append(request, NULL_STR);
+        return 0;
+    }
+
+    hex = uchar2hex(buf, size);
+    if (!hex)
+        return -errno;
+
+    g_string_append_printf(request, "'%s'", hex);
+    free(hex);
+
+    return 0;
+}
+
+/**
+ * Append to \p request one VALUES tuple per extent of \p layout, each tuple
+ * being prefixed by \p key if it is not NULL.
+ *
+ * \param[in]       conn     Connection used to escape strings
+ * \param[in,out]   request  Request to complete
+ * \param[in]       key      Join key of the tuples, as SQL values, may be NULL
+ * \param[in]       layout   Layout whose extents are appended
+ * \param[in]       keep_idx Use the layout_idx of the extents rather than
+ *                           their index in \p layout
+ * \param[in,out]   first    True if no tuple was appended to \p request yet
+ *
+ * \return 0 on success, negative error code on failure.
+ */
+static int append_layout_extents_values(PGconn *conn, GString *request,
+                                        const char *key,
+                                        const struct layout_info *layout,
+                                        bool keep_idx, bool *first)
+{
+    int rc;
+    int i;
+
+    for (i = 0; i < layout->ext_count; i++) {
+        const struct extent *ext = &layout->extents[i];
+        char *medium_id;
+        char *address;
+
+        medium_id = dss_char4sql(conn, ext->media.name);
+        if (!medium_id)
+            return -EINVAL;
+
+        /* We may have no address yet. */
+        address = dss_char4sql(conn, ext->address.buff);
+        if (!address) {
+            free_dss_char4sql(medium_id);
+            return -EINVAL;
+        }
+
+        g_string_append(request, *first ? "(" : ", (");
+        *first = false;
+        if (key)
+            g_string_append_printf(request, "%s, ", key);
+
+        g_string_append_printf(request, "%d, '%s', %s, %s, %zd::bigint, ",
+                               keep_idx ? ext->layout_idx : i,
+                               rsc_family2str(ext->media.family), medium_id,
+                               address, ext->size);
+        free_dss_char4sql(medium_id);
+        free_dss_char4sql(address);
+
+        rc = append_hex_or_null(request, ext->with_md5, ext->md5,
+                                sizeof(ext->md5));
+        if (rc)
+            LOG_RETURN(rc, "Failed to encode 'md5' of extent %d", i);
+
+        g_string_append(request, ", ");
+        rc = append_hex_or_null(request, ext->with_xxh128, ext->xxh128,
+                                sizeof(ext->xxh128));
+        if (rc)
+            LOG_RETURN(rc, "Failed to encode 'xxh128' of extent %d", i);
+
+        g_string_append(request, ", ");
+        rc = append_hex_or_null(request, ext->with_crc32c, ext->crc32c,
+                                sizeof(ext->crc32c));
+        if (rc)
+            LOG_RETURN(rc, "Failed to encode 'crc32c' of extent %d", i);
+
+        g_string_append(request, ")");
+    }
+
+    return 0;
+}
+
+/**
+ * Insert layouts and their extents in a single statement: the extent rows
+ * inserted by a first CTE provide the uuid and version of the layout_extent
+ * rows.
+ */
+static int get_layout_insert_request(PGconn *conn,
+                                     struct layout_info *item_list,
+                                     int item_cnt, GString *request)
+{
+    int ext_total = 0;
+    bool first = true;
+    int rc = 0;
+    int i;
+
+    for (i = 0; i < item_cnt; i++) {
+        if (item_list[i].oid == NULL)
+            LOG_RETURN(-EINVAL, "Extent oid cannot be NULL");
+        ext_total += item_list[i].ext_count;
+    }
+
+    if (ext_total > 0)
+        g_string_append(request, "WITH layouts AS (");
+    g_string_append(request, layout_insert_query);
+
+    for (i = 0; i < item_cnt; i++) {
+        struct layout_info *p_layout = &item_list[i];
+        char *pres;
+
+        pres = dss_layout_desc_encode(&p_layout->layout_desc);
+        if (!pres)
+            LOG_RETURN(-EINVAL, "JSON layout desc encoding error");
+
+        g_string_append_printf(request, insert_query_values[DSS_LAYOUT],
+                               p_layout->oid, p_layout->oid, p_layout->oid,
+                               extent_state2str(p_layout->state), pres,
+                               i < item_cnt - 1 ? "," : "");
+        free(pres);
+    }
+
+    if (ext_total == 0) {
+        g_string_append(request, ";");
+        return 0;
+    }
+
+    g_string_append(request, " RETURNING oid, uuid, version) ");
+    g_string_append(request, layout_extent_insert_query);
+    g_string_append(request, " FROM layouts l JOIN (VALUES ");
+
+    for (i = 0; i < item_cnt && rc == 0; i++) {
+        char *key = g_strdup_printf("'%s'", item_list[i].oid);
+
+        rc = append_layout_extents_values(conn, request, key, &item_list[i],
+                                          false, &first);
+        g_free(key);
+    }
+    if (rc)
+        return rc;
+
+    g_string_append_printf(request, ") AS e(oid, %s) USING (oid);",
+                           layout_extent_columns);
+
+    return 0;
+}
+
+/**
+ * Update a layout and replace its extents: extents beyond the new extent
+ * count are removed, the others are inserted or updated in place.
+ */
+static int get_layout_update_request(PGconn *conn, struct layout_info *layout,
+                                     GString *request)
+{
+    bool first = true;
+    char *pres;
+    int rc;
+
+    pres = dss_layout_desc_encode(&layout->layout_desc);
+    if (!pres)
+        LOG_RETURN(-EINVAL, "JSON layout desc encoding error");
+
+    g_string_append(request, "WITH ");
+    g_string_append_printf(request, layout_extent_trunc_query, layout->uuid,
+                           layout->version, layout->ext_count);
+
+    if (layout->ext_count == 0) {
+        g_string_append_c(request, ' ');
+        g_string_append_printf(request, update_query[DSS_LAYOUT],
+                               extent_state2str(layout->state), pres,
+                               layout->uuid, layout->version);
+        g_string_append(request, ";");
+        free(pres);
+        return 0;
+    }
+
+    g_string_append(request, ", l AS (");
+    g_string_append_printf(request, update_query[DSS_LAYOUT],
+                           extent_state2str(layout->state), pres,
+                           layout->uuid, layout->version);
+    free(pres);
+    g_string_append(request, " RETURNING uuid, version) ");
+    g_string_append(request, layout_extent_insert_query);
+    g_string_append(request, " FROM l, (VALUES ");
+
+    rc = append_layout_extents_values(conn, request, NULL, layout, false,
+                                      &first);
+    if (rc)
+        return rc;
+
+    g_string_append_printf(request, ") AS e(%s)", layout_extent_columns);
+    g_string_append(request, layout_extent_upsert_query);
+
+    return 0;
+}
+
+static int get_layout_setrequest(PGconn *conn, struct layout_info *item_list,
                                  int item_cnt, enum dss_set_action action,
-                                 GString *request, int *error)
+                                 GString *request)
 {
     int rc = 0;
     int i;
     ENTRY;
 
+    if (action == DSS_SET_INSERT)
+        return get_layout_insert_request(conn, item_list, item_cnt, request);
+
     for (i = 0; i < item_cnt && rc == 0; i++) {
-        struct layout_info  *p_layout = &item_list[i];
-        char                *layout = NULL;
-        char                *pres = NULL;
+        struct layout_info *p_layout = &item_list[i];
 
         if (p_layout->oid == NULL)
             LOG_RETURN(-EINVAL, "Extent oid cannot be NULL");
 
-        if (action == DSS_SET_DELETE) {
+        /* layout_extent rows are removed by the foreign key cascade */
+        if (action == DSS_SET_DELETE)
             g_string_append_printf(request, delete_query[DSS_LAYOUT],
                                    p_layout->oid);
-            continue;
-        }
-
-        layout = dss_layout_extents_encode(p_layout->extents,
-                                           p_layout->ext_count, error);
-        if (!layout)
-            LOG_GOTO(out_free, rc = -EINVAL, "JSON layout encoding error");
-
-        pres = dss_layout_desc_encode(&p_layout->layout_desc);
-        if (!pres)
-            LOG_GOTO(out_free, rc = -EINVAL, "JSON layout desc encoding error");
-
-        if (action == DSS_SET_INSERT)
-            g_string_append_printf(request, insert_query_values[DSS_LAYOUT],
-                                   p_layout->oid, p_layout->oid, p_layout->oid,
-                                   extent_state2str(p_layout->state),
-                                   pres, layout, i < item_cnt-1 ? "," : ";");
         else if (action == DSS_SET_UPDATE)
-            g_string_append_printf(request, update_query[DSS_LAYOUT],
-                                   extent_state2str(p_layout->state), pres,
-                                   layout, p_layout->uuid, p_layout->version);
-out_free:
-        free(layout);
-        free(pres);
+            rc = get_layout_update_request(conn, p_layout, request);
     }
 
     return rc;
@@ -1287,6 +1272,76 @@ static void append_media_update_request(GString *request, const char *field,
     *first_field = false;
 }
 
+/**
+ * Append to \p request the update of the stats column from the stat fields
+ * set in \p fields.
+ *
+ * The new value is computed by the database from the stored one, so that
+ * increments (*_ADD fields) from concurrent updates of the same medium are
+ * not lost, without having to lock and fetch it first.
+ */
+static void append_media_stats_update_request(GString *request,
+                                              const struct media_stats *stats,
+                                              uint64_t fields,
+                                              bool *first_field)
+{
+    GString *expr = g_string_new("COALESCE(stats, '{}'::jsonb)");
+
+    if (NB_OBJ & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('nb_obj', %lld)",
+                               stats->nb_obj);
+    else if (NB_OBJ_ADD & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('nb_obj',"
+                               " COALESCE((stats->>'nb_obj')::bigint, 0)"
+                               " + %lld)",
+                               stats->nb_obj);
+
+    if (LOGC_SPC_USED & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('logc_spc_used', %zd)",
+                               stats->logc_spc_used);
+    else if (LOGC_SPC_USED_ADD & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('logc_spc_used',"
+                               " COALESCE((stats->>'logc_spc_used')::bigint, 0)"
+                               " + %zd)",
+                               stats->logc_spc_used);
+
+    if (PHYS_SPC_USED & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('phys_spc_used', %zd)",
+                               stats->phys_spc_used);
+
+    if (PHYS_SPC_FREE & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('phys_spc_free', %zd)",
+                               stats->phys_spc_free);
+
+    if (NB_LOAD_ADD & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('nb_load',"
+                               " COALESCE((stats->>'nb_load')::bigint, 0)"
+                               " + %ld)",
+                               stats->nb_load);
+
+    if (NB_ERRORS_ADD & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('nb_errors',"
+                               " COALESCE((stats->>'nb_errors')::bigint, 0)"
+                               " + %ld)",
+                               stats->nb_errors);
+
+    if (LAST_LOAD & fields)
+        g_string_append_printf(expr,
+                               " || jsonb_build_object('last_load', %lld)",
+                               (long long)stats->last_load);
+
+    append_media_update_request(request, "stats = %s", expr->str, first_field);
+    g_string_free(expr, true);
+}
+
 static int get_media_setrequest(PGconn *conn, struct media_info *item_list,
                                 int item_cnt, enum dss_set_action action,
                                 uint64_t fields, GString *request)
@@ -1393,27 +1448,9 @@ static int get_media_setrequest(PGconn *conn, struct media_info *item_list,
                 free_dss_char4sql(fs_label);
             }
 
-            if (IS_STAT(fields)) {
-                char *tmp_stats = NULL;
-                char *stats = NULL;
-
-                tmp_stats = dss_media_stats_encode(p_media->stats);
-                if (!tmp_stats)
-                    LOG_RETURN(-EINVAL,
-                               "Failed to encode stats for media update");
-
-                stats = dss_char4sql(conn, tmp_stats);
-                free(tmp_stats);
-
-                if (!stats)
-                    LOG_RETURN(-EINVAL,
-                               "Failed to build stats media update SQL "
-                               "request");
-
-                append_media_update_request(request, "stats = %s", stats,
-                                            &first_field);
-                free_dss_char4sql(stats);
-            }
+            if (IS_STAT(fields))
+                append_media_stats_update_request(request, &p_media->stats,
+                                                  fields, &first_field);
 
             if (TAGS & fields) {
                 char *tmp_tags = NULL;
@@ -1510,6 +1547,7 @@ static inline bool is_type_supported(enum dss_type type)
     case DSS_DEVICE:
     case DSS_MEDIA:
     case DSS_LOGS:
+    case DSS_MEDIA_STATS:
         return true;
 
     default:
@@ -1535,17 +1573,61 @@ enum strvalue_type {
     STRVAL_KEYVAL  = 2  /* key/value pair in an array */
 };
 
-static int insert_string(struct dss_handle *handle, GString *qry,
-                         const char *strval, enum strvalue_type type)
+/**
+ * Convert a "key=value" string into the jsonb document {"key": "value"}, so
+ * that the "@>" containment test can be served by the jsonb_path_ops index of
+ * the user_md columns.
+ *
+ * Key and value are JSON-encoded here, the result still has to be escaped for
+ * SQL. It must be freed by the caller.
+ */
+static char *keyval2json(const char *keyval)
 {
-    size_t   esc_len = strlen(strval) * 2 + 1;
-    char    *esc_str;
-    char    *esc_val;
-    int      rc = 0;
+    const char *sep = strchr(keyval, '=');
+    json_t *doc;
+    char *key;
+    char *res;
 
-    esc_str = malloc(esc_len);
-    if (!esc_str)
-        return -ENOMEM;
+    if (!sep)
+        return NULL;
+
+    key = strndup(keyval, sep - keyval);
+    if (!key)
+        return NULL;
+
+    doc = json_pack("{s:s}", key, sep + 1);
+    free(key);
+    if (!doc)
+        return NULL;
+
+    res = json_dumps(doc, JSON_COMPACT);
+    json_decref(doc);
+
+    return res;
+}
+
+static int insert_string(struct dss_handle *handle, GString *qry,
+                         const char *strval, enum strvalue_type type)
+{
+    char    *json_val = NULL;
+    size_t   esc_len;
+    char    *esc_str;
+    int      rc = 0;
+
+    if (type == STRVAL_KEYVAL) {
+        json_val = keyval2json(strval);
+        if (!json_val)
+            LOG_RETURN(-EINVAL, "Invalid key/value filter '%s'", strval);
+
+        strval = json_val;
+    }
+
+    esc_len = strlen(strval) * 2 + 1;
+    esc_str = malloc(esc_len);
+    if (!esc_str) {
+        free(json_val);
+        return -ENOMEM;
+    }
 
     PQescapeStringConn(handle->dh_conn, esc_str, strval, esc_len, NULL);
 
@@ -1554,28 +1636,105 @@ static int insert_string(struct dss_handle *handle, GString *qry,
         g_string_append_printf(qry, "array['%s']", esc_str);
         break;
     case STRVAL_KEYVAL:
-        esc_val = strchr(esc_str, '=');
-        assert(esc_val);
-
-        *esc_val++ = '\0';
-        g_string_append_printf(qry, "'{\"%s\": \"%s\"}'", esc_str, esc_val);
+        g_string_append_printf(qry, "'%s'::jsonb", esc_str);
         break;
     default:
         g_string_append_printf(qry, "'%s'", esc_str);
     }
 
+    free(json_val);
     free(esc_str);
     return rc;
 }
 
-static int json2sql_object_begin(struct saj_parser *parser, const char *key,
-                                 json_t *value, void *priv)
+/**
+ * Tell whether \p strval is a parameter slot of a filter template ("$1",
+ * "$2", ...).
+ */
+static bool is_param_slot(const char *strval)
+{
+    const char *c;
+
+    if (strval[0] != '$' || strval[1] == '\0')
+        return false;
+
+    for (c = strval + 1; *c != '\0'; c++)
+        if (*c < '0' || *c > '9')
+            return false;
+
+    return true;
+}
+
+/**
+ * Insert a parameter slot of a filter template, with the same conversion as
+ * insert_string() applies to literal values. The value bound to a $KVINJSON
+ * slot is thus expected to be a JSON document.
+ */
+static void insert_param_slot(GString *qry, const char *slot,
+                              enum strvalue_type type)
+{
+    switch (type) {
+    case STRVAL_INDEX:
+        g_string_append_printf(qry, "array[%s::text]", slot);
+        break;
+    case STRVAL_KEYVAL:
+        g_string_append_printf(qry, "%s::jsonb", slot);
+        break;
+    default:
+        g_string_append(qry, slot);
+    }
+}
+
+/** Filter field matching the extents that have a layout on a given medium */
+#define DSS_EXT_MEDIA_IDX "DSS::EXT::media_idx"
+
+/**
+ * Translate a filter on DSS_EXT_MEDIA_IDX into a semi-join on layout_extent.
+ * Listing every family lets the planner use layout_extent_medium_idx, whose
+ * first column is the medium family, with one index lookup per family.
+ */
+static int json2sql_media_idx(struct dss_handle *handle,
+                              const char *current_key, json_t *value,
+                              GString *str, bool tmpl)
+{
+    int rc;
+
+    if (current_key && !key_is_logical_op(current_key) &&
+        g_ascii_strcasecmp(current_key, "$INJSON"))
+        LOG_RETURN(-EINVAL, "Unexpected operator for '%s': '%s'",
+                   DSS_EXT_MEDIA_IDX, current_key);
+
+    if (!json_is_string(value))
+        LOG_RETURN(-EINVAL, "'%s' expects a medium name", DSS_EXT_MEDIA_IDX);
+
+    g_string_append(str,
+                    "EXISTS (SELECT 1 FROM layout_extent le"
+                    " WHERE le.uuid = extent.uuid"
+                    " AND le.version = extent.version"
+                    " AND le.medium_family = ANY(enum_range(NULL::dev_family))"
+                    " AND le.medium_id = ");
+
+    if (tmpl && is_param_slot(json_string_value(value))) {
+        insert_param_slot(str, json_string_value(value), STRVAL_DEFAULT);
+    } else {
+        rc = insert_string(handle, str, json_string_value(value),
+                           STRVAL_DEFAULT);
+        if (rc)
+            LOG_RETURN(rc, "Cannot insert string into SQL query");
+    }
+
+    g_string_append(str, ")");
+
+    return 0;
+}
+
+static int json2sql_field(struct saj_parser *parser, const char *key,
+                          json_t *value, GString *str, bool tmpl)
 {
     const char         *current_key = saj_parser_key(parser);
     struct dss_handle  *handle = (struct dss_handle *)parser->sp_handle;
     enum strvalue_type  type = STRVAL_DEFAULT;
     const char         *field_impl;
-    GString            *str = priv;
     int                 rc;
 
     /* out-of-context: nothing to do */
@@ -1586,6 +1745,9 @@ static int json2sql_object_begin(struct saj_parser *parser, const char *key,
     if (key[0] == '$')
         return 0;
 
+    if (!strcmp(key, DSS_EXT_MEDIA_IDX))
+        return json2sql_media_idx(handle, current_key, value, str, tmpl);
+
     /* Not an operator: write the affected field name */
     field_impl = dss_fields_pub2implem(key);
     if (!field_impl)
@@ -1623,6 +1785,11 @@ static int json2sql_object_begin(struct saj_parser *parser, const char *key,
 
     switch (json_typeof(value)) {
     case JSON_STRING:
+        if (tmpl && is_param_slot(json_string_value(value))) {
+            insert_param_slot(str, json_string_value(value), type);
+            break;
+        }
+
         rc = insert_string(handle, str, json_string_value(value), type);
         if (rc)
             LOG_RETURN(rc, "Cannot insert string into SQL query");
@@ -1651,6 +1818,19 @@ static int json2sql_object_begin(struct saj_parser *parser, const char *key,
     return 0;
 }
 
+static int json2sql_object_begin(struct saj_parser *parser, const char *key,
+                                 json_t *value, void *priv)
+{
+    return json2sql_field(parser, key, value, priv, false);
+}
+
+static int json2sql_tmpl_object_begin(struct saj_parser *parser,
+                                      const char *key, json_t *value,
+                                      void *priv)
+{
+    return json2sql_field(parser, key, value, priv, true);
+}
+
 static int json2sql_array_begin(struct saj_parser *parser, void *priv)
 {
     GString     *str = priv;
@@ -1699,25 +1879,31 @@ static const struct saj_parser_operations json2sql_ops = {
     .so_array_end    = json2sql_array_end,
 };
 
-static int clause_filter_convert(struct dss_handle *handle, GString *qry,
-                                 const struct dss_filter *filter)
+/* Same as json2sql_ops, but string values "$<n>" are parameter slots */
+static const struct saj_parser_operations json2sql_tmpl_ops = {
+    .so_object_begin = json2sql_tmpl_object_begin,
+    .so_array_begin  = json2sql_array_begin,
+    .so_array_elt    = json2sql_array_elt,
+    .so_array_end    = json2sql_array_end,
+};
+
+static int clause_json_convert(struct dss_handle *handle, GString *qry,
+                               json_t *json,
+                               const struct saj_parser_operations *ops)
 {
     struct saj_parser   json2sql;
     int                 rc;
 
-    if (!filter)
-        return 0; /* nothing to do */
-
-    if (!json_is_object(filter->df_json))
+    if (!json_is_object(json))
         LOG_RETURN(-EINVAL, "Filter is not a valid JSON object");
 
     g_string_append(qry, " WHERE ");
 
-    rc = saj_parser_init(&json2sql, &json2sql_ops, qry, handle);
+    rc = saj_parser_init(&json2sql, ops, qry, handle);
     if (rc)
         LOG_RETURN(rc, "Cannot initialize JSON to SQL converter");
 
-    rc = saj_parser_run(&json2sql, filter->df_json);
+    rc = saj_parser_run(&json2sql, json);
     if (rc)
         LOG_GOTO(out_free, rc, "Cannot convert filter into SQL query");
 
@@ -1726,6 +1912,15 @@ out_free:
     return rc;
 }
 
+static int clause_filter_convert(struct dss_handle *handle, GString *qry,
+                                 const struct dss_filter *filter)
+{
+    if (!filter)
+        return 0; /* nothing to do */
+
+    return clause_json_convert(handle, qry, filter->df_json, &json2sql_ops);
+}
+
 /**
  * Fill a dev_info from the information in the `row_num`th row of `res`.
  */
@@ -1827,6 +2022,45 @@ static void dss_media_result_free(void *void_media)
     tags_free(&media->tags);
 }
 
+/**
+ * Fill an enriched_media_stats from the information in the `row_num`th row of
+ * `res`.
+ */
+static int dss_media_enriched_stats_from_pg_row(struct dss_handle *handle,
+                                                void *void_stats,
+                                                PGresult *res, int row_num)
+{
+    struct enriched_media_stats *stats = void_stats;
+    int rc;
+
+    (void)handle;
+
+    stats->rsc.id.family  = str2rsc_family(PQgetvalue(res, row_num, 0));
+    pho_id_name_set(&stats->rsc.id, PQgetvalue(res, row_num, 1));
+    stats->rsc.model      = NULL;
+    stats->rsc.adm_status = str2rsc_adm_status(PQgetvalue(res, row_num, 2));
+    stats->fs_status      = str2fs_status(PQgetvalue(res, row_num, 3));
+    stats->live_size      = strtoll(PQgetvalue(res, row_num, 5), NULL, 10);
+    stats->live_count     = strtoll(PQgetvalue(res, row_num, 6), NULL, 10);
+    stats->deprec_size    = strtoll(PQgetvalue(res, row_num, 7), NULL, 10);
+    stats->deprec_count   = strtoll(PQgetvalue(res, row_num, 8), NULL, 10);
+
+    rc = dss_media_stats_decode(&stats->stats, PQgetvalue(res, row_num, 4));
+    if (rc)
+        pho_error(rc, "dss_media stats decode error");
+
+    return rc;
+}
+
+/**
+ * The rows of media statistics hold no allocated field, only the array of rows
+ * is freed by dss_res_free().
+ */
+static void dss_media_enriched_stats_result_free(void *void_stats)
+{
+    (void)void_stats;
+}
+
 /**
  * Fill a layout_info from the information in the `row_num`th row of `res`.
  */
@@ -1849,12 +2083,98 @@ static int dss_layout_from_pg_row(struct dss_handle *handle, void *void_layout,
         return rc;
     }
 
-    rc = dss_layout_extents_decode(&layout->extents,
-                                   &layout->ext_count,
-                                   PQgetvalue(res, row_num, 5));
-    if (rc) {
-        pho_error(rc, "dss_extent tags decode error");
-        return rc;
+    return 0;
+}
+
+/**
+ * Fill an extent from the layout_extent columns of the `row_num`th row of
+ * `res`.
+ */
+static int dss_extent_from_pg_row(struct extent *extent, PGresult *res,
+                                  int row_num)
+{
+    const char *tmp;
+    int rc;
+
+    extent->layout_idx = atoi(PQgetvalue(res, row_num, 5));
+    extent->media.family = str2rsc_family(PQgetvalue(res, row_num, 6));
+    if (extent->media.family == PHO_RSC_INVAL)
+        LOG_RETURN(-EINVAL, "Invalid medium family");
+
+    rc = pho_id_name_set(&extent->media, PQgetvalue(res, row_num, 7));
+    if (rc)
+        LOG_RETURN(-EINVAL, "Failed to set media id");
+
+    tmp = get_str_value(res, row_num, 8);
+    if (tmp) {
+        extent->address.buff = strdup(tmp);
+        if (!extent->address.buff)
+            return -errno;
+        extent->address.size = strlen(tmp) + 1;
+    } else {
+        extent->address.buff = NULL;
+        extent->address.size = 0;
+    }
+
+    extent->size = strtoll(PQgetvalue(res, row_num, 9), NULL, 10);
+
+    tmp = get_str_value(res, row_num, 10);
+    extent->with_md5 = tmp != NULL;
+    if (tmp) {
+        rc = read_hex_buffer(extent->md5, sizeof(extent->md5), tmp);
+        if (rc)
+            LOG_RETURN(rc, "Failed to decode md5 of extent %d",
+                       extent->layout_idx);
+    }
+
+    tmp = get_str_value(res, row_num, 11);
+    extent->with_xxh128 = tmp != NULL;
+    if (tmp) {
+        rc = read_hex_buffer(extent->xxh128, sizeof(extent->xxh128), tmp);
+        if (rc)
+            LOG_RETURN(rc, "Failed to decode xxh128 of extent %d",
+                       extent->layout_idx);
+    }
+
+    tmp = get_str_value(res, row_num, 12);
+    extent->with_crc32c = tmp != NULL;
+    if (tmp) {
+        rc = read_hex_buffer(extent->crc32c, sizeof(extent->crc32c), tmp);
+        if (rc)
+            LOG_RETURN(rc, "Failed to decode crc32c of extent %d",
+                       extent->layout_idx);
+    }
+
+    return 0;
+}
+
+/**
+ * Fill the extents of \p layout from rows [\p first, \p last[ of `res`.
+ *
+ * Rows of a layout without any extent have NULL layout_extent columns.
+ */
+static int dss_layout_extents_from_pg_rows(struct layout_info *layout,
+                                           PGresult *res, int first, int last)
+{
+    int rc;
+    int i;
+
+    layout->extents = NULL;
+    layout->ext_count = 0;
+
+    if (PQgetisnull(res, first, 5))
+        return 0;
+
+    layout->extents = calloc(last - first, sizeof(*layout->extents));
+    if (!layout->extents)
+        LOG_RETURN(-ENOMEM, "Cannot allocate %d extents", last - first);
+
+    for (i = first; i < last; i++) {
+        /* counted first so that a partially filled extent is freed */
+        layout->ext_count++;
+        rc = dss_extent_from_pg_row(&layout->extents[i - first], res, i);
+        if (rc)
+            return rc;
     }
 
     return 0;
@@ -1874,7 +2194,7 @@ static void dss_layout_result_free(void *void_layout)
     free(layout->layout_desc.mod_name);
     pho_attrs_free(&layout->layout_desc.mod_attrs);
 
-    /* Undo dss_layout_extents_decode */
+    /* Undo dss_layout_extents_from_pg_rows */
     layout_info_free_extents(layout);
 }
 
@@ -1941,52 +2261,19 @@ static void _dss_result_free(struct dss_result *dss_res, int item_cnt)
 
 }
 
-static int dss_generic_get(struct dss_handle *handle, enum dss_type type,
-                           const struct dss_filter *filter, void **item_list,
-                           int *item_cnt)
+/**
+ * Build one item of type \p type per row of the select result \p res, which
+ * is owned by the returned list, or freed on error.
+ */
+static int dss_generic_get_result(struct dss_handle *handle,
+                                  enum dss_type type, PGresult *res,
+                                  void **item_list, int *item_cnt)
 {
-    PGconn              *conn = handle->dh_conn;
     size_t               dss_res_size;
     size_t               item_size;
     struct dss_result   *dss_res;
-    GString             *clause;
     int                  rc = 0;
     int                  i = 0;
-    PGresult            *res;
-    ENTRY;
-
-    if (conn == NULL || item_list == NULL || item_cnt == NULL)
-        LOG_RETURN(-EINVAL, "dss - conn: %p, item_list: %p, item_cnt: %p",
-                   conn, item_list, item_cnt);
-
-    *item_list = NULL;
-    *item_cnt  = 0;
-
-    if (!is_type_supported(type))
-        LOG_RETURN(-ENOTSUP, "Unsupported DSS request type %#x", type);
-
-    /* get everything if no criteria */
-    clause = g_string_new(select_query[type]);
-
-    rc = clause_filter_convert(handle, clause, filter);
-    if (rc) {
-        g_string_free(clause, true);
-        return rc;
-    }
-
-    pho_debug("Executing request: '%s'", clause->str);
-
-    res = PQexec(conn, clause->str);
-    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
-        rc = psql_state2errno(res);
-        pho_error(rc, "Query '%s' failed: %s", clause->str,
-                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
-        PQclear(res);
-        g_string_free(clause, true);
-        return rc;
-    }
-
-    g_string_free(clause, true);
 
     item_size = res_size[type];
     dss_res_size = sizeof(struct dss_result) + PQntuples(res) * item_size;
@@ -2019,86 +2306,397 @@ out:
 }
 
 /**
- * fields is only used by DSS_SET_UPDATE on DSS_MEDIA
+ * Execute the select query \p clause and build one item of type \p type per
+ * row of its result.
  */
-static int dss_generic_set(struct dss_handle *handle, enum dss_type type,
-                           void *item_list, int item_cnt,
-                           enum dss_set_action action, uint64_t fields)
+static int dss_generic_get_query(struct dss_handle *handle, enum dss_type type,
+                                 GString *clause, void **item_list,
+                                 int *item_cnt)
 {
-    PGconn      *conn = handle->dh_conn;
-    GString     *request;
-    PGresult    *res = NULL;
-    int          error = 0;
-    int          rc = 0;
+    PGresult *res;
+    int rc;
+
+    dss_pipeline_sync(handle);
+
+    pho_debug("Executing request: '%s'", clause->str);
+
+    res = dss_exec(handle->dh_conn, clause->str);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        rc = psql_state2errno(res);
+        pho_error(rc, "Query '%s' failed: %s", clause->str,
+                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+        PQclear(res);
+        return rc;
+    }
+
+    return dss_generic_get_result(handle, type, res, item_list, item_cnt);
+}
+
+static int dss_generic_get(struct dss_handle *handle, enum dss_type type,
+                           const struct dss_filter *filter, void **item_list,
+                           int *item_cnt)
+{
+    PGconn  *conn = handle->dh_conn;
+    GString *clause;
+    int      rc;
     ENTRY;
 
-    if (conn == NULL || item_list == NULL || item_cnt == 0)
-        LOG_RETURN(-EINVAL, "conn: %p, item_list: %p, item_cnt: %d",
+    if (conn == NULL || item_list == NULL || item_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, item_list: %p, item_cnt: %p",
                    conn, item_list, item_cnt);
 
-    if (action == DSS_SET_FULL_INSERT && type != DSS_OBJECT)
-        LOG_RETURN(-ENOTSUP, "Full insert request is not supported for %s",
-                   dss_type_names[type]);
+    *item_list = NULL;
+    *item_cnt  = 0;
 
-    if (action == DSS_SET_UPDATE_ADM_STATUS && type != DSS_DEVICE)
-        LOG_RETURN(-ENOTSUP,
-                   "Specific adm_status update is not supported for %s",
-                   dss_type_names[type]);
+    if (!is_type_supported(type))
+        LOG_RETURN(-ENOTSUP, "Unsupported DSS request type %#x", type);
 
-    if (action == DSS_SET_UPDATE_HOST && type != DSS_DEVICE)
-        LOG_RETURN(-ENOTSUP, "Specific host update is not supported for %s",
-                   dss_type_names[type]);
+    /* get everything if no criteria */
+    clause = g_string_new(select_query[type]);
 
-    request = g_string_new("BEGIN;");
+    rc = clause_filter_convert(handle, clause, filter);
+    if (!rc)
+        rc = dss_generic_get_query(handle, type, clause, item_list, item_cnt);
 
-    if (action == DSS_SET_INSERT)
-        g_string_append(request, insert_query[type]);
-    else if (action == DSS_SET_FULL_INSERT)
-        g_string_append(request, insert_full_query[type]);
+    g_string_free(clause, true);
+    return rc;
+}
 
-    switch (type) {
-    case DSS_DEVICE:
-        rc = get_device_setrequest(conn, item_list, item_cnt, action, request);
-        if (rc)
-            LOG_GOTO(out_cleanup, rc, "SQL device request failed");
-        break;
+/**
+ * Return in \p stmt_name the name of the statement selecting the items of type
+ * \p type that match the filter template \p tmpl, translating and preparing it
+ * on the connection of \p handle if it was not already.
+ *
+ * Statements are cached by type and template text, for the lifetime of the
+ * connection.
+ */
+static int dss_template_prepare(struct dss_handle *handle, enum dss_type type,
+                                const char *tmpl, const char **stmt_name)
+{
+    GHashTable *prepared = handle->dh_prepared;
+    json_error_t json_error;
+    char *name = NULL;
+    GString *clause;
+    PGresult *res;
+    json_t *json;
+    char *key;
+    int rc;
+
+    if (!prepared) {
+        prepared = g_hash_table_new_full(g_str_hash, g_str_equal, g_free,
+                                         g_free);
+        handle->dh_prepared = prepared;
+    }
+
+    key = g_strdup_printf("%d:%s", type, tmpl);
+    *stmt_name = g_hash_table_lookup(prepared, key);
+    if (*stmt_name) {
+        g_free(key);
+        return 0;
+    }
+
+    json = json_loads(tmpl, JSON_REJECT_DUPLICATES, &json_error);
+    if (!json) {
+        g_free(key);
+        LOG_RETURN(-EINVAL, "Invalid filter template '%s': %s", tmpl,
+                   json_error.text);
+    }
+
+    clause = g_string_new(select_query[type]);
+    rc = clause_json_convert(handle, clause, json, &json2sql_tmpl_ops);
+    json_decref(json);
+    if (rc)
+        goto out_free;
+
+    dss_pipeline_sync(handle);
+
+    name = g_strdup_printf("dss_tmpl_%u", g_hash_table_size(prepared) + 1);
+    pho_debug("Preparing request '%s': '%s'", name, clause->str);
+
+    res = PQprepare(handle->dh_conn, name, clause->str, 0, NULL);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        rc = psql_state2errno(res) ? : -ECOMM;
+        pho_error(rc, "Cannot prepare query '%s': %s", clause->str,
+                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+        PQclear(res);
+        goto out_free;
+    }
+    PQclear(res);
+
+    g_hash_table_insert(prepared, key, name);
+    *stmt_name = name;
+    key = NULL;
+    name = NULL;
+
+out_free:
+    g_string_free(clause, true);
+    g_free(name);
+    g_free(key);
+    return rc;
+}
+
+int dss_template_get(struct dss_handle *hdl, enum dss_type type,
+                     const char *tmpl, const char * const *params,
+                     int n_params, void **item_list, int *item_cnt)
+{
+    const char *stmt_name;
+    PGresult *res;
+    int rc;
+
+    ENTRY;
+
+    if (hdl->dh_conn == NULL || item_list == NULL || item_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, item_list: %p, item_cnt: %p",
+                   hdl->dh_conn, item_list, item_cnt);
+
+    *item_list = NULL;
+    *item_cnt  = 0;
+
+    /* layouts are built from several rows, see dss_layout_get_query() */
+    if (!is_type_supported(type) || type == DSS_LAYOUT)
+        LOG_RETURN(-ENOTSUP, "Unsupported DSS request type %#x", type);
+
+    rc = dss_template_prepare(hdl, type, tmpl, &stmt_name);
+    if (rc)
+        return rc;
+
+    dss_pipeline_sync(hdl);
+
+    res = dss_exec_prepared(hdl->dh_conn, stmt_name, n_params, params);
+    if (PQresultStatus(res) != PGRES_TUPLES_OK) {
+        rc = psql_state2errno(res);
+        pho_error(rc, "Prepared query '%s' failed: %s", stmt_name,
+                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+        PQclear(res);
+        return rc;
+    }
+
+    return dss_generic_get_result(hdl, type, res, item_list, item_cnt);
+}
+
+/**
+ * Tell whether rows \p a and \p b of \p res belong to the same layout.
+ */
+static bool layout_rows_match(PGresult *res, int a, int b)
+{
+    return !strcmp(PQgetvalue(res, a, 1), PQgetvalue(res, b, 1)) &&
+           !strcmp(PQgetvalue(res, a, 2), PQgetvalue(res, b, 2));
+}
+
+/**
+ * Execute the layout select query \p clause and build the layouts from its
+ * result, one layout per run of consecutive rows sharing the same uuid and
+ * version.
+ */
+static int dss_layout_get_query(struct dss_handle *handle, GString *clause,
+                                struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    struct dss_result *dss_res;
+    size_t dss_res_size;
+    int first_row = 0;
+    int cnt = 0;
+    PGresult *res;
+    int nrows;
+    int rc;
+    int i;
+
+    rc = execute(handle, clause, &res, PGRES_TUPLES_OK);
+    if (rc) {
+        PQclear(res);
+        return rc;
+    }
+
+    nrows = PQntuples(res);
+    for (i = 0; i < nrows; i++)
+        if (i == 0 || !layout_rows_match(res, i - 1, i))
+            cnt++;
+
+    dss_res_size = sizeof(struct dss_result) + cnt * res_size[DSS_LAYOUT];
+    dss_res = calloc(1, dss_res_size);
+    if (dss_res == NULL) {
+        PQclear(res);
+        LOG_RETURN(-ENOMEM, "malloc of size %zu failed", dss_res_size);
+    }
+
+    dss_res->item_type = DSS_LAYOUT;
+    dss_res->pg_res = res;
+
+    for (i = 0; i < cnt; i++) {
+        struct layout_info *layout = &dss_res->items.layout[i];
+        int last_row = first_row + 1;
+
+        while (last_row < nrows && layout_rows_match(res, first_row, last_row))
+            last_row++;
+
+        rc = dss_layout_from_pg_row(handle, layout, res, first_row);
+        if (rc)
+            goto out;
+
+        rc = dss_layout_extents_from_pg_rows(layout, res, first_row,
+                                             last_row);
+        if (rc) {
+            /* the layout is partially built, let its destructor clean it */
+            i++;
+            goto out;
+        }
+
+        first_row = last_row;
+    }
+
+    *lyt_ls = dss_res->items.layout;
+    *lyt_cnt = cnt;
+
+out:
+    if (rc)
+        /* Only free elements that were initialized, this also frees res */
+        _dss_result_free(dss_res, i);
+
+    return rc;
+}
+
+/**
+ * Append to \p request the SQL statements applying \p action to the items of
+ * \p item_list.
+ *
+ * fields is only used by DSS_SET_UPDATE on DSS_MEDIA
+ */
+static int get_setrequest(PGconn *conn, enum dss_type type, void *item_list,
+                          int item_cnt, enum dss_set_action action,
+                          uint64_t fields, GString *request)
+{
+    int rc = 0;
+
+    if (action == DSS_SET_INSERT && insert_query[type])
+        g_string_append(request, insert_query[type]);
+    else if (action == DSS_SET_FULL_INSERT)
+        g_string_append(request, insert_full_query[type]);
+
+    switch (type) {
+    case DSS_DEVICE:
+        rc = get_device_setrequest(conn, item_list, item_cnt, action, request);
+        if (rc)
+            LOG_RETURN(rc, "SQL device request failed");
+        break;
     case DSS_MEDIA:
         rc = get_media_setrequest(conn, item_list, item_cnt, action, fields,
                                   request);
         if (rc)
-            LOG_GOTO(out_cleanup, rc, "SQL media request failed");
+            LOG_RETURN(rc, "SQL media request failed");
         break;
     case DSS_LAYOUT:
-        rc = get_layout_setrequest(conn, item_list, item_cnt, action, request,
-                                   &error);
+        rc = get_layout_setrequest(conn, item_list, item_cnt, action,
+                                   request);
         if (rc)
-            LOG_GOTO(out_cleanup, rc, "SQL extent request failed");
+            LOG_RETURN(rc, "SQL extent request failed");
         break;
     case DSS_OBJECT:
         rc = get_object_setrequest(conn, item_list, item_cnt, action, request);
         if (rc)
-            LOG_GOTO(out_cleanup, rc, "SQL object request failed");
+            LOG_RETURN(rc, "SQL object request failed");
         break;
     case DSS_DEPREC:
         rc = get_deprecated_object_setrequest(conn, item_list, item_cnt, action,
                                               request);
         if (rc)
-            LOG_GOTO(out_cleanup, rc, "SQL deprecated object request failed");
+            LOG_RETURN(rc, "SQL deprecated object request failed");
         break;
 
     default:
-        LOG_GOTO(out_cleanup, rc = -ENOTSUP,
-                 "unsupported DSS request type %#x", type);
+        LOG_RETURN(-ENOTSUP, "unsupported DSS request type %#x", type);
+    }
+
+    return 0;
+}
+
+/**
+ * Queue the statements applying \p action to the items of \p item_list on the
+ * pipeline of \p handle.
+ *
+ * Only one statement can be sent at a time in pipeline mode: insertions
+ * already are a single statement, other actions are sent item per item.
+ */
+static int pipeline_generic_set(struct dss_handle *handle, enum dss_type type,
+                                void *item_list, int item_cnt,
+                                enum dss_set_action action, uint64_t fields)
+{
+    PGconn *conn = handle->dh_conn;
+    GString *request;
+    int rc = 0;
+    int i;
+
+    if (action == DSS_SET_INSERT || action == DSS_SET_FULL_INSERT) {
+        request = g_string_new(NULL);
+        rc = get_setrequest(conn, type, item_list, item_cnt, action, fields,
+                            request);
+        if (!rc)
+            rc = dss_pipeline_send(handle, request);
+
+        g_string_free(request, true);
+        return rc;
+    }
+
+    request = g_string_new(NULL);
+    for (i = 0; i < item_cnt; i++) {
+        void *item = (char *)item_list + i * res_size[type];
+
+        g_string_truncate(request, 0);
+        rc = get_setrequest(conn, type, item, 1, action, fields, request);
+        if (rc)
+            break;
 
+        rc = dss_pipeline_send(handle, request);
+        if (rc)
+            break;
     }
 
-    if (error)
-        LOG_GOTO(out_cleanup, rc = -EINVAL,
-                 "JSON parsing failed: %d errors found", error);
+    g_string_free(request, true);
+    return rc;
+}
+
+/**
+ * fields is only used by DSS_SET_UPDATE on DSS_MEDIA
+ */
+static int dss_generic_set(struct dss_handle *handle, enum dss_type type,
+                           void *item_list, int item_cnt,
+                           enum dss_set_action action, uint64_t fields)
+{
+    PGconn      *conn = handle->dh_conn;
+    GString     *request;
+    PGresult    *res = NULL;
+    int          rc = 0;
+    ENTRY;
+
+    if (conn == NULL || item_list == NULL || item_cnt == 0)
+        LOG_RETURN(-EINVAL, "conn: %p, item_list: %p, item_cnt: %d",
+                   conn, item_list, item_cnt);
+
+    if (action == DSS_SET_FULL_INSERT && type != DSS_OBJECT)
+        LOG_RETURN(-ENOTSUP, "Full insert request is not supported for %s",
+                   dss_type_names[type]);
+
+    if (action == DSS_SET_UPDATE_ADM_STATUS && type != DSS_DEVICE)
+        LOG_RETURN(-ENOTSUP,
+                   "Specific adm_status update is not supported for %s",
+                   dss_type_names[type]);
+
+    if (action == DSS_SET_UPDATE_HOST && type != DSS_DEVICE)
+        LOG_RETURN(-ENOTSUP, "Specific host update is not supported for %s",
+                   dss_type_names[type]);
+
+    if (dss_pipeline_is_active(handle))
+        return pipeline_generic_set(handle, type, item_list, item_cnt, action,
+                                    fields);
+
+    request = g_string_new("BEGIN;");
+
+    rc = get_setrequest(conn, type, item_list, item_cnt, action, fields,
+                        request);
+    if (rc)
+        goto out_cleanup;
 
     pho_debug("Executing request: '%s'", request->str);
 
-    res = PQexec(conn, request->str);
+    res = dss_exec(conn, request->str);
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
         rc = psql_state2errno(res);
         pho_error(rc, "Query '%s' failed: %s (%s)", request->str,
@@ -2108,7 +2706,7 @@ static int dss_generic_set(struct dss_handle *handle, enum dss_type type,
 
         pho_info("Attempting to rollback after transaction failure");
 
-        res = PQexec(conn, "ROLLBACK; ");
+        res = dss_exec(conn, "ROLLBACK; ");
         if (PQresultStatus(res) != PGRES_COMMAND_OK)
             pho_error(rc, "Rollback failed: %s",
                       PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
@@ -2117,7 +2715,7 @@ static int dss_generic_set(struct dss_handle *handle, enum dss_type type,
     }
     PQclear(res);
 
-    res = PQexec(conn, "COMMIT; ");
+    res = dss_exec(conn, "COMMIT; ");
     if (PQresultStatus(res) != PGRES_COMMAND_OK) {
         rc = psql_state2errno(res);
         pho_error(rc, "Request failed: %s",
@@ -2166,171 +2764,1458 @@ static int dss_prepare_oid_list(PGconn *conn, GString *list,
 }
 
 /**
- * In obj_list, each obj must have an uuid and a version.
+ * In obj_list, each obj must have an uuid and a version.
+ */
+static int dss_prepare_uuid_version_list(PGconn *conn, GString *list,
+                                         struct object_info *obj_list,
+                                         int obj_cnt)
+{
+    int i;
+
+    for (i = 0; i < obj_cnt; ++i) {
+        /* uuid */
+        char *sql_uuid = PQescapeLiteral(conn, obj_list[i].uuid,
+                                         strlen(obj_list[i].uuid));
+
+        if (!sql_uuid)
+            LOG_RETURN(-EINVAL,
+                       "Cannot escape litteral %s: %s",
+                       obj_list[i].uuid, PQerrorMessage(conn));
+
+        g_string_append_printf(list, "uuid=%s AND ", sql_uuid);
+        PQfreemem(sql_uuid);
+
+        /* version */
+        g_string_append_printf(list, "version='%d'", obj_list[i].version);
+
+        if (i + 1 != obj_cnt)
+            g_string_append(list, " OR ");
+    }
+
+    return 0;
+}
+
+int dss_object_move(struct dss_handle *handle, enum dss_type type_from,
+                    enum dss_type type_to, struct object_info *obj_list,
+                    int obj_cnt)
+{
+    PGconn      *conn = handle->dh_conn;
+    enum dss_move_queries move_type;
+    GString     *clause;
+    GString     *key_list;
+    PGresult    *res = NULL;
+    int          rc = 0;
+
+    ENTRY;
+
+    move_type = move_query_type(type_from, type_to);
+    if (!conn || move_type == DSS_MOVE_INVAL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, move_type: %d", conn, move_type);
+
+    clause = g_string_new(NULL);
+    key_list = g_string_new(NULL);
+
+    switch (move_type) {
+    case DSS_MOVE_OBJECT_TO_DEPREC:
+        rc = dss_prepare_oid_list(conn, key_list, obj_list, obj_cnt);
+        if (rc)
+            LOG_GOTO(err, rc, "OID list could not be built");
+
+        break;
+    case DSS_MOVE_DEPREC_TO_OBJECT:
+        rc = dss_prepare_uuid_version_list(conn, key_list, obj_list, obj_cnt);
+        if (rc)
+            LOG_GOTO(err, rc, "Version list could not be built from deprec");
+
+        break;
+    default:
+            LOG_GOTO(err, -EINVAL, "Unsupported move type");
+    }
+
+    g_string_append_printf(clause, move_query[move_type], key_list->str);
+
+    dss_pipeline_sync(handle);
+
+    pho_debug("Executing request: '%s'", clause->str);
+
+    res = dss_exec(conn, clause->str);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
+        rc = psql_state2errno(res);
+        pho_error(rc, "Query '%s' failed: %s", clause->str,
+                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+    }
+
+    PQclear(res);
+
+err:
+    g_string_free(key_list, true);
+    g_string_free(clause, true);
+    return rc;
+}
+
+void dss_res_free(void *item_list, int item_cnt)
+{
+    struct dss_result *dss_res;
+
+    if (!item_list)
+        return;
+
+    dss_res = res_of_item_list(item_list);
+    _dss_result_free(dss_res, item_cnt);
+}
+
+int dss_get_usable_devices(struct dss_handle *hdl, const enum rsc_family family,
+                           const char *host, struct dev_info **dev_ls,
+                           int *dev_cnt)
+{
+    struct dss_filter filter;
+    char *host_filter = NULL;
+    int rc;
+
+    if (host) {
+        rc = asprintf(&host_filter, "{\"DSS::DEV::host\": \"%s\"},", host);
+        if (rc < 0)
+            return -ENOMEM;
+    }
+
+    rc = dss_filter_build(&filter,
+                          "{\"$AND\": ["
+                          "  %s"
+                          "  {\"DSS::DEV::adm_status\": \"%s\"},"
+                          "  {\"DSS::DEV::family\": \"%s\"}"
+                          "]}",
+                          host ? host_filter : "",
+                          rsc_adm_status2str(PHO_RSC_ADM_ST_UNLOCKED),
+                          rsc_family2str(family));
+    free(host_filter);
+    if (rc)
+        return rc;
+
+    rc = dss_device_get(hdl, &filter, dev_ls, dev_cnt);
+    dss_filter_free(&filter);
+    return rc;
+}
+
+int dss_device_get(struct dss_handle *hdl, const struct dss_filter *filter,
+                   struct dev_info **dev_ls, int *dev_cnt)
+{
+    return dss_generic_get(hdl, DSS_DEVICE, filter, (void **)dev_ls, dev_cnt);
+}
+
+int dss_media_get(struct dss_handle *hdl, const struct dss_filter *filter,
+                  struct media_info **med_ls, int *med_cnt)
+{
+    return dss_generic_get(hdl, DSS_MEDIA, filter, (void **)med_ls, med_cnt);
+}
+
+int dss_media_enriched_stats(struct dss_handle *hdl,
+                             const struct dss_filter *filter,
+                             struct enriched_media_stats **med_ls,
+                             int *med_cnt)
+{
+    return dss_generic_get(hdl, DSS_MEDIA_STATS, filter, (void **)med_ls,
+                           med_cnt);
+}
+
+int dss_layout_get(struct dss_handle *hdl, const struct dss_filter *filter,
+                   struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    GString *clause;
+    int rc;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %p",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    *lyt_ls = NULL;
+    *lyt_cnt = 0;
+
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+
+    rc = clause_filter_convert(hdl, clause, filter);
+    if (!rc) {
+        g_string_append(clause, " ORDER BY uuid, version, layout_idx");
+        rc = dss_layout_get_query(hdl, clause, lyt_ls, lyt_cnt);
+    }
+
+    g_string_free(clause, true);
+    return rc;
+}
+
+static int medium_extents_get(struct dss_handle *hdl,
+                              const struct pho_id *medium, bool live_only,
+                              struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    GString *clause;
+    char *name;
+    int rc;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %p",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    *lyt_ls = NULL;
+    *lyt_cnt = 0;
+
+    name = dss_char4sql(hdl->dh_conn, medium->name);
+    if (!name)
+        return -EINVAL;
+
+    /* served by the (medium_family, medium_id, address) index */
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+    g_string_append_printf(clause,
+                           " WHERE medium_family = '%s' AND medium_id = %s",
+                           rsc_family2str(medium->family), name);
+    free_dss_char4sql(name);
+
+    if (live_only)
+        g_string_append(clause,
+                        " AND state = 'sync' AND EXISTS (SELECT 1 FROM object"
+                        "  WHERE object.uuid = extent.uuid"
+                        "  AND object.version = extent.version)");
+
+    g_string_append(clause, " ORDER BY address, uuid, version, layout_idx");
+
+    rc = dss_layout_get_query(hdl, clause, lyt_ls, lyt_cnt);
+    g_string_free(clause, true);
+
+    return rc;
+}
+
+int dss_medium_extents_get(struct dss_handle *hdl, const struct pho_id *medium,
+                           struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    return medium_extents_get(hdl, medium, false, lyt_ls, lyt_cnt);
+}
+
+int dss_medium_live_extents_get(struct dss_handle *hdl,
+                                const struct pho_id *medium,
+                                struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    return medium_extents_get(hdl, medium, true, lyt_ls, lyt_cnt);
+}
+
+int dss_garbage_layouts_get(struct dss_handle *hdl,
+                            struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    GString *clause;
+    int rc;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %p",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    *lyt_ls = NULL;
+    *lyt_cnt = 0;
+
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+    g_string_append(clause,
+                    " WHERE state <> 'sync' OR"
+                    "  (NOT EXISTS (SELECT 1 FROM object"
+                    "    WHERE object.uuid = extent.uuid"
+                    "    AND object.version = extent.version)"
+                    "   AND NOT EXISTS (SELECT 1 FROM deprecated_object"
+                    "    WHERE deprecated_object.uuid = extent.uuid"
+                    "    AND deprecated_object.version = extent.version))"
+                    " ORDER BY uuid, version, layout_idx");
+
+    rc = dss_layout_get_query(hdl, clause, lyt_ls, lyt_cnt);
+    g_string_free(clause, true);
+
+    return rc;
+}
+
+static const char * const layout_extent_move_query =
+    "UPDATE layout_extent SET medium_family = '%s', medium_id = %s,"
+    " address = %s, scrub_rc = NULL, scrub_time = NULL"
+    " WHERE uuid = '%s' AND version = %d AND layout_idx = %d"
+    " AND medium_family = '%s' AND medium_id = %s;";
+
+static int append_extent_move(PGconn *conn, GString *request,
+                              const struct pho_id *source,
+                              const struct layout_info *layout,
+                              const struct extent *extent)
+{
+    char *source_name = NULL;
+    char *address = NULL;
+    char *name = NULL;
+    int rc = 0;
+
+    name = dss_char4sql(conn, extent->media.name);
+    address = dss_char4sql(conn, extent->address.buff);
+    source_name = dss_char4sql(conn, source->name);
+    if (!name || !address || !source_name)
+        GOTO(free_names, rc = -EINVAL);
+
+    g_string_append_printf(request, layout_extent_move_query,
+                           rsc_family2str(extent->media.family), name,
+                           address, layout->uuid, layout->version,
+                           extent->layout_idx, rsc_family2str(source->family),
+                           source_name);
+
+free_names:
+    free_dss_char4sql(source_name);
+    free_dss_char4sql(address);
+    free_dss_char4sql(name);
+    return rc;
+}
+
+int dss_layout_extents_move(struct dss_handle *hdl,
+                            const struct pho_id *source,
+                            struct layout_info *lyt_ls, int lyt_cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc = 0;
+    int i;
+    int j;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == 0)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %d",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    request = g_string_new(NULL);
+
+    for (i = 0; i < lyt_cnt && !rc; i++)
+        for (j = 0; j < lyt_ls[i].ext_count && !rc; j++)
+            rc = append_extent_move(hdl->dh_conn, request, source, &lyt_ls[i],
+                                    &lyt_ls[i].extents[j]);
+
+    /* the statements of a single query string run in a single transaction */
+    if (!rc) {
+        rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+        PQclear(res);
+    }
+
+    g_string_free(request, true);
+    return rc;
+}
+
+static const char * const layout_extent_scrub_query =
+    "UPDATE layout_extent SET scrub_rc = %d, scrub_time = now()"
+    " WHERE uuid = '%s' AND version = %d AND layout_idx = %d;";
+
+int dss_extents_scrub_set(struct dss_handle *hdl,
+                          const struct extent_scrub *scrubs, int cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+    int i;
+
+    if (hdl->dh_conn == NULL || scrubs == NULL || cnt == 0)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, scrubs: %p, cnt: %d",
+                   hdl->dh_conn, scrubs, cnt);
+
+    request = g_string_new(NULL);
+    for (i = 0; i < cnt; i++)
+        g_string_append_printf(request, layout_extent_scrub_query,
+                               scrubs[i].rc, scrubs[i].layout->uuid,
+                               scrubs[i].layout->version,
+                               scrubs[i].extent->layout_idx);
+
+    rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+    g_string_free(request, true);
+
+    return rc;
+}
+
+static const char * const layout_delete_query =
+    "DELETE FROM extent WHERE uuid = '%s' AND version = %d;";
+
+int dss_layouts_delete(struct dss_handle *hdl,
+                       const struct layout_info *lyt_ls, int lyt_cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+    int i;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == 0)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %d",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    /* layout_extent rows are removed by the foreign key cascade */
+    request = g_string_new(NULL);
+    for (i = 0; i < lyt_cnt; i++)
+        g_string_append_printf(request, layout_delete_query, lyt_ls[i].uuid,
+                               lyt_ls[i].version);
+
+    rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+    g_string_free(request, true);
+
+    return rc;
+}
+
+static const char * const layoutless_objects_delete_query =
+    "WITH obj AS ("
+    "  DELETE FROM object WHERE creation_time < now() - interval '%u seconds'"
+    "  AND NOT EXISTS (SELECT 1 FROM extent"
+    "   WHERE extent.uuid = object.uuid AND extent.version = object.version)"
+    "  RETURNING 1),"
+    " deprec AS ("
+    "  DELETE FROM deprecated_object"
+    "  WHERE deprec_time < now() - interval '%u seconds'"
+    "  AND NOT EXISTS (SELECT 1 FROM extent"
+    "   WHERE extent.uuid = deprecated_object.uuid"
+    "   AND extent.version = deprecated_object.version)"
+    "  RETURNING 1)"
+    " SELECT (SELECT count(*) FROM obj) + (SELECT count(*) FROM deprec);";
+
+int dss_layoutless_objects_delete(struct dss_handle *hdl,
+                                  unsigned int grace_time, int *cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+
+    if (hdl->dh_conn == NULL || cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, cnt: %p", hdl->dh_conn, cnt);
+
+    *cnt = 0;
+
+    request = g_string_new(NULL);
+    g_string_printf(request, layoutless_objects_delete_query, grace_time,
+                    grace_time);
+
+    rc = execute(hdl, request, &res, PGRES_TUPLES_OK);
+    if (!rc)
+        *cnt = atoi(PQgetvalue(res, 0, 0));
+
+    PQclear(res);
+    g_string_free(request, true);
+
+    return rc;
+}
+
+/**
+ * Imported objects: the ones without a deprecation time are inserted as the
+ * objects, the other ones and the live ones whose oid already has an object as
+ * deprecated objects. The rows inserted by the first CTE are not visible to
+ * the outer statement, hence the check of both live and object.
+ */
+static const char * const object_import_query =
+    "WITH imported(oid, uuid, version, user_md, deprec_time) AS (VALUES %s),"
+    " live AS (INSERT INTO object (oid, uuid, version, user_md)"
+    "  SELECT oid, uuid, version, user_md::jsonb FROM imported"
+    "  WHERE deprec_time IS NULL"
+    "  ON CONFLICT DO NOTHING RETURNING uuid, version)"
+    " INSERT INTO deprecated_object (oid, uuid, version, user_md, deprec_time)"
+    " SELECT i.oid, i.uuid, i.version, i.user_md::jsonb,"
+    "  COALESCE(i.deprec_time::timestamp, now()) FROM imported i"
+    " WHERE NOT EXISTS (SELECT 1 FROM live l"
+    "  WHERE l.uuid = i.uuid AND l.version = i.version)"
+    " AND NOT EXISTS (SELECT 1 FROM object o"
+    "  WHERE o.uuid = i.uuid AND o.version = i.version)"
+    " ON CONFLICT DO NOTHING;";
+
+static const char * const layout_import_query =
+    "INSERT INTO extent (oid, uuid, version, state, lyt_info) VALUES %s"
+    " ON CONFLICT DO NOTHING;";
+
+static const char * const layout_extent_import_query =
+    "INSERT INTO layout_extent (uuid, version, layout_idx, medium_family,"
+    " medium_id, address, size, md5, xxh128, crc32c)"
+    " SELECT e.uuid, e.version, e.layout_idx, e.medium_family::dev_family,"
+    " e.medium_id, e.address, e.size, e.md5, e.xxh128, e.crc32c"
+    " FROM (VALUES %s) AS e(uuid, version, %s) ON CONFLICT DO NOTHING;";
+
+/**
+ * Fill \p objects, \p layouts and \p extents with the VALUES tuples of the
+ * object, layout and extent rows of the i-th imported layout.
+ */
+static int append_import_values(PGconn *conn, const struct object_info *obj,
+                                const struct layout_info *layout,
+                                GString *objects, GString *layouts,
+                                GString *extents, bool *first_ext)
+{
+    char quoted_time[PHO_TIMEVAL_MAX_LEN + 2];
+    const char *deprec_time = NULL_STR;
+    char *user_md = NULL;
+    char *lyt_info;
+    char *uuid;
+    char *oid;
+    char *key;
+    int rc;
+
+    if (obj->oid == NULL || obj->uuid == NULL)
+        LOG_RETURN(-EINVAL, "Imported object oid and uuid cannot be NULL");
+
+    /* deprecated objects are quoted as a timestamp, live ones are NULL */
+    if (obj->deprec_time.tv_sec != 0) {
+        char time_str[PHO_TIMEVAL_MAX_LEN];
+
+        timeval2str(&obj->deprec_time, time_str);
+        snprintf(quoted_time, sizeof(quoted_time), "'%s'", time_str);
+        deprec_time = quoted_time;
+    }
+
+    lyt_info = dss_layout_desc_encode(&layout->layout_desc);
+    if (!lyt_info)
+        LOG_RETURN(-EINVAL, "JSON layout desc encoding error");
+
+    oid = dss_char4sql(conn, obj->oid);
+    uuid = dss_char4sql(conn, obj->uuid);
+    if (obj->user_md)
+        user_md = dss_char4sql(conn, obj->user_md);
+    if (!oid || !uuid || (obj->user_md && !user_md))
+        LOG_GOTO(free_values, rc = -EINVAL, "Cannot escape object '%s'",
+                 obj->oid);
+
+    g_string_append_printf(objects, "%s(%s, %s, %d, %s, %s)",
+                           objects->len ? ", " : "", oid, uuid, obj->version,
+                           user_md ? : NULL_STR, deprec_time);
+    g_string_append_printf(layouts, "%s(%s, %s, %d, '%s', '%s')",
+                           layouts->len ? ", " : "", oid, uuid, obj->version,
+                           extent_state2str(PHO_EXT_ST_SYNC), lyt_info);
+
+    key = g_strdup_printf("%s, %d", uuid, obj->version);
+    rc = append_layout_extents_values(conn, extents, key, layout, true,
+                                      first_ext);
+    g_free(key);
+
+free_values:
+    if (user_md)
+        free_dss_char4sql(user_md);
+    if (uuid)
+        free_dss_char4sql(uuid);
+    if (oid)
+        free_dss_char4sql(oid);
+    free(lyt_info);
+    return rc;
+}
+
+int dss_layouts_import(struct dss_handle *hdl,
+                       const struct object_info *obj_ls,
+                       const struct layout_info *lyt_ls, int cnt)
+{
+    GString *request = NULL;
+    GString *extents;
+    GString *layouts;
+    GString *objects;
+    bool first = true;
+    PGresult *res;
+    int rc = 0;
+    int i;
+
+    if (hdl->dh_conn == NULL || obj_ls == NULL || lyt_ls == NULL || cnt == 0)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, obj_ls: %p, lyt_ls: %p, cnt: %d",
+                   hdl->dh_conn, obj_ls, lyt_ls, cnt);
+
+    objects = g_string_new(NULL);
+    layouts = g_string_new(NULL);
+    extents = g_string_new(NULL);
+
+    for (i = 0; i < cnt && rc == 0; i++)
+        rc = append_import_values(hdl->dh_conn, &obj_ls[i], &lyt_ls[i],
+                                  objects, layouts, extents, &first);
+    if (rc)
+        goto free_values;
+
+    request = g_string_new(NULL);
+    g_string_printf(request, object_import_query, objects->str);
+    g_string_append_printf(request, layout_import_query, layouts->str);
+    if (!first)
+        g_string_append_printf(request, layout_extent_import_query,
+                               extents->str, layout_extent_columns);
+
+    rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+    g_string_free(request, true);
+
+free_values:
+    g_string_free(extents, true);
+    g_string_free(layouts, true);
+    g_string_free(objects, true);
+    return rc;
+}
+
+static const char * const layout_staging_query =
+    "INSERT INTO staging (uuid, version, family, tags)"
+    " SELECT uuid, version, '%s', %s FROM object WHERE oid = %s;";
+
+int dss_layout_staging_set(struct dss_handle *hdl,
+                           const struct layout_info *layout,
+                           enum rsc_family family, const struct tags *tags)
+{
+    GString *request;
+    char *json_tags;
+    PGresult *res;
+    char *tags_str;
+    char *oid;
+    int rc;
+
+    if (hdl->dh_conn == NULL || layout == NULL || tags == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, layout: %p, tags: %p",
+                   hdl->dh_conn, layout, tags);
+
+    json_tags = dss_tags_encode(tags);
+    if (!json_tags)
+        return -ENOMEM;
+
+    tags_str = dss_char4sql(hdl->dh_conn, json_tags);
+    oid = dss_char4sql(hdl->dh_conn, layout->oid);
+    free(json_tags);
+    if (!tags_str || !oid)
+        GOTO(free_str, rc = -EINVAL);
+
+    request = g_string_new(NULL);
+    g_string_printf(request, layout_staging_query, rsc_family2str(family),
+                    tags_str, oid);
+
+    if (dss_pipeline_is_active(hdl)) {
+        rc = dss_pipeline_send(hdl, request);
+    } else {
+        rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+        PQclear(res);
+    }
+
+    g_string_free(request, true);
+
+free_str:
+    free_dss_char4sql(oid);
+    free_dss_char4sql(tags_str);
+    return rc;
+}
+
+static const char * const staging_groups_query =
+    "SELECT DISTINCT medium_family, medium_id, s.family, s.tags"
+    " FROM staging s JOIN layout_extent USING (uuid, version)"
+    " WHERE medium_family <> s.family"
+    " ORDER BY medium_family, medium_id, s.family, s.tags;";
+
+int dss_staging_groups_get(struct dss_handle *hdl,
+                           struct staging_group **groups, int *cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+    int i;
+
+    if (hdl->dh_conn == NULL || groups == NULL || cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, groups: %p, cnt: %p",
+                   hdl->dh_conn, groups, cnt);
+
+    *groups = NULL;
+    *cnt = 0;
+
+    request = g_string_new(staging_groups_query);
+    rc = execute(hdl, request, &res, PGRES_TUPLES_OK);
+    g_string_free(request, true);
+    if (rc)
+        goto out;
+
+    if (PQntuples(res) == 0)
+        goto out;
+
+    *groups = calloc(PQntuples(res), sizeof(**groups));
+    if (!*groups)
+        GOTO(out, rc = -ENOMEM);
+
+    for (i = 0; i < PQntuples(res); i++) {
+        struct staging_group *group = &(*groups)[i];
+
+        group->medium.family = str2rsc_family(PQgetvalue(res, i, 0));
+        rc = pho_id_name_set(&group->medium, PQgetvalue(res, i, 1));
+        if (rc)
+            break;
+
+        group->family = str2rsc_family(PQgetvalue(res, i, 2));
+        rc = dss_tags_decode(&group->tags, PQgetvalue(res, i, 3));
+        if (rc)
+            break;
+
+        (*cnt)++;
+    }
+
+    if (rc) {
+        dss_staging_groups_free(*groups, *cnt);
+        *groups = NULL;
+        *cnt = 0;
+    }
+
+out:
+    PQclear(res);
+    return rc;
+}
+
+void dss_staging_groups_free(struct staging_group *groups, int cnt)
+{
+    int i;
+
+    for (i = 0; i < cnt; i++)
+        tags_free(&groups[i].tags);
+    free(groups);
+}
+
+int dss_staging_layouts_get(struct dss_handle *hdl,
+                            const struct staging_group *group,
+                            struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    char *json_tags = NULL;
+    char *tags_str = NULL;
+    char *name = NULL;
+    GString *clause;
+    int rc;
+
+    if (hdl->dh_conn == NULL || group == NULL || lyt_ls == NULL ||
+        lyt_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, group: %p, lyt_ls: %p, "
+                   "lyt_cnt: %p", hdl->dh_conn, group, lyt_ls, lyt_cnt);
+
+    *lyt_ls = NULL;
+    *lyt_cnt = 0;
+
+    json_tags = dss_tags_encode(&group->tags);
+    if (!json_tags)
+        return -ENOMEM;
+
+    name = dss_char4sql(hdl->dh_conn, group->medium.name);
+    tags_str = dss_char4sql(hdl->dh_conn, json_tags);
+    free(json_tags);
+    if (!name || !tags_str)
+        GOTO(free_str, rc = -EINVAL);
+
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+    g_string_append_printf(clause,
+                           " WHERE medium_family = '%s' AND medium_id = %s"
+                           " AND state = 'sync' AND EXISTS (SELECT 1"
+                           "  FROM staging s WHERE s.uuid = extent.uuid"
+                           "  AND s.version = extent.version"
+                           "  AND s.family = '%s' AND s.tags = %s::jsonb)"
+                           " ORDER BY address, uuid, version, layout_idx",
+                           rsc_family2str(group->medium.family), name,
+                           rsc_family2str(group->family), tags_str);
+
+    rc = dss_layout_get_query(hdl, clause, lyt_ls, lyt_cnt);
+    g_string_free(clause, true);
+
+free_str:
+    free_dss_char4sql(tags_str);
+    free_dss_char4sql(name);
+    return rc;
+}
+
+static const char * const staging_clear_query =
+    "DELETE FROM staging s WHERE uuid = '%s' AND version = %d"
+    " AND NOT EXISTS (SELECT 1 FROM layout_extent le"
+    "  WHERE le.uuid = s.uuid AND le.version = s.version"
+    "  AND le.medium_family <> s.family);";
+
+int dss_staging_clear(struct dss_handle *hdl,
+                      const struct layout_info *lyt_ls, int lyt_cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+    int i;
+
+    if (hdl->dh_conn == NULL || lyt_ls == NULL || lyt_cnt == 0)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, lyt_ls: %p, lyt_cnt: %d",
+                   hdl->dh_conn, lyt_ls, lyt_cnt);
+
+    request = g_string_new(NULL);
+    for (i = 0; i < lyt_cnt; i++)
+        g_string_append_printf(request, staging_clear_query, lyt_ls[i].uuid,
+                               lyt_ls[i].version);
+
+    rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+    g_string_free(request, true);
+
+    return rc;
+}
+
+static const char * const layout_inline_query =
+    "INSERT INTO inline_extent (uuid, version, data)"
+    " SELECT uuid, version, '%s'::bytea FROM object WHERE oid = %s;";
+
+int dss_layout_inline_set(struct dss_handle *hdl,
+                          const struct layout_info *layout,
+                          const void *data, size_t size)
+{
+    unsigned char *bytes;
+    GString *request;
+    PGresult *res;
+    size_t len;
+    char *oid;
+    int rc;
+
+    if (hdl->dh_conn == NULL || layout == NULL || (data == NULL && size))
+        LOG_RETURN(-EINVAL, "dss - conn: %p, layout: %p, data: %p",
+                   hdl->dh_conn, layout, data);
+
+    bytes = PQescapeByteaConn(hdl->dh_conn, data ? : (const void *)"", size,
+                              &len);
+    if (!bytes)
+        LOG_RETURN(-ENOMEM, "Cannot escape the content of '%s'", layout->oid);
+
+    oid = dss_char4sql(hdl->dh_conn, layout->oid);
+    if (!oid)
+        GOTO(free_bytes, rc = -EINVAL);
+
+    request = g_string_sized_new(len + strlen(layout_inline_query) + 64);
+    g_string_printf(request, layout_inline_query, bytes, oid);
+
+    if (dss_pipeline_is_active(hdl)) {
+        rc = dss_pipeline_send(hdl, request);
+    } else {
+        rc = execute(hdl, request, &res, PGRES_COMMAND_OK);
+        PQclear(res);
+    }
+
+    g_string_free(request, true);
+    free_dss_char4sql(oid);
+
+free_bytes:
+    PQfreemem(bytes);
+    return rc;
+}
+
+int dss_layout_inline_get(struct dss_handle *hdl,
+                          const struct layout_info *layout,
+                          void **data, size_t *size)
+{
+    unsigned char *bytes;
+    GString *request;
+    PGresult *res;
+    size_t len;
+    char *uuid;
+    int rc;
+
+    if (hdl->dh_conn == NULL || layout == NULL || data == NULL ||
+        size == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, layout: %p, data: %p, size: %p",
+                   hdl->dh_conn, layout, data, size);
+
+    *data = NULL;
+    *size = 0;
+
+    uuid = dss_char4sql(hdl->dh_conn, layout->uuid);
+    if (!uuid)
+        return -EINVAL;
+
+    request = g_string_new(NULL);
+    g_string_printf(request,
+                    "SELECT data FROM inline_extent"
+                    " WHERE uuid = %s AND version = %d;",
+                    uuid, layout->version);
+    free_dss_char4sql(uuid);
+
+    rc = execute(hdl, request, &res, PGRES_TUPLES_OK);
+    g_string_free(request, true);
+    if (rc)
+        goto out;
+
+    if (PQntuples(res) == 0)
+        GOTO(out, rc = -ENOENT);
+
+    bytes = PQunescapeBytea((unsigned char *)PQgetvalue(res, 0, 0), &len);
+    if (!bytes)
+        GOTO(out, rc = -ENOMEM);
+
+    /* the caller frees the content with free(), not PQfreemem() */
+    *data = malloc(len ? : 1);
+    if (*data) {
+        memcpy(*data, bytes, len);
+        *size = len;
+    } else {
+        rc = -ENOMEM;
+    }
+    PQfreemem(bytes);
+
+out:
+    PQclear(res);
+    return rc;
+}
+
+int dss_layout_dedup_get(struct dss_handle *hdl,
+                         const struct dedup_filter *filter,
+                         struct layout_info **layout)
+{
+    struct layout_info *lyt_ls;
+    char *repl_count = NULL;
+    char *tags_str = NULL;
+    char *json_tags;
+    GString *clause;
+    int lyt_cnt;
+    char *hash;
+    int rc;
+
+    if (hdl->dh_conn == NULL || filter == NULL || layout == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, filter: %p, layout: %p",
+                   hdl->dh_conn, filter, layout);
+
+    *layout = NULL;
+
+    hash = uchar2hex(filter->xxh128, sizeof(filter->xxh128));
+    json_tags = dss_tags_encode(filter->tags);
+    if (!hash || !json_tags)
+        GOTO(free_str, rc = -ENOMEM);
+
+    tags_str = dss_char4sql(hdl->dh_conn, json_tags);
+    repl_count = dss_char4sql(hdl->dh_conn, filter->repl_count);
+    if (!tags_str || !repl_count)
+        GOTO(free_str, rc = -EINVAL);
+
+    /*
+     * All the extents of the layout hold the whole data, on media of the
+     * family and with the tags requested: it is a single split, uncompressed
+     */
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+    g_string_append_printf(clause,
+        " WHERE (uuid, version) = (SELECT le.uuid, le.version"
+        "  FROM layout_extent le JOIN extent e USING (uuid, version)"
+        "  WHERE le.xxh128 = '%s' AND le.size = %zd"
+        "  AND le.medium_family = '%s' AND e.state = 'sync'"
+        "  AND e.lyt_info->>'name' = 'raid1'"
+        "  AND e.lyt_info->'attrs'->>'repl_count' = %s"
+        "  AND NOT (e.lyt_info->'attrs' ? 'compression')"
+        "  AND NOT EXISTS (SELECT 1 FROM layout_extent o"
+        "   JOIN media m ON m.family = o.medium_family AND m.id = o.medium_id"
+        "   WHERE o.uuid = le.uuid AND o.version = le.version"
+        "   AND (o.xxh128 IS DISTINCT FROM le.xxh128 OR o.size <> le.size"
+        "        OR o.medium_family <> le.medium_family"
+        "        OR NOT m.tags @> %s::jsonb))"
+        "  AND (EXISTS (SELECT 1 FROM object"
+        "    WHERE object.uuid = le.uuid AND object.version = le.version)"
+        "   OR EXISTS (SELECT 1 FROM deprecated_object d"
+        "    WHERE d.uuid = le.uuid AND d.version = le.version))"
+        "  LIMIT 1)"
+        " ORDER BY layout_idx",
+        hash, filter->size, rsc_family2str(filter->family), repl_count,
+        tags_str);
+
+    rc = dss_layout_get_query(hdl, clause, &lyt_ls, &lyt_cnt);
+    g_string_free(clause, true);
+    if (rc)
+        goto free_str;
+
+    if (lyt_cnt == 0) {
+        dss_res_free(lyt_ls, lyt_cnt);
+        GOTO(free_str, rc = -ENOENT);
+    }
+
+    *layout = lyt_ls;
+
+free_str:
+    free_dss_char4sql(repl_count);
+    free_dss_char4sql(tags_str);
+    free(json_tags);
+    free(hash);
+    return rc;
+}
+
+int dss_extent_refcount_get(struct dss_handle *hdl,
+                            const struct pho_id *medium, const char *address,
+                            int *count)
+{
+    GString *request;
+    char *addr_str;
+    PGresult *res;
+    char *name;
+    int rc;
+
+    if (hdl->dh_conn == NULL || medium == NULL || address == NULL ||
+        count == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, medium: %p, address: %p, "
+                   "count: %p", hdl->dh_conn, medium, address, count);
+
+    name = dss_char4sql(hdl->dh_conn, medium->name);
+    addr_str = dss_char4sql(hdl->dh_conn, address);
+    if (!name || !addr_str)
+        GOTO(free_str, rc = -EINVAL);
+
+    request = g_string_new(NULL);
+    g_string_printf(request,
+                    "SELECT count(*) FROM layout_extent"
+                    " WHERE medium_family = '%s' AND medium_id = %s"
+                    " AND address = %s;",
+                    rsc_family2str(medium->family), name, addr_str);
+
+    rc = execute(hdl, request, &res, PGRES_TUPLES_OK);
+    g_string_free(request, true);
+    if (!rc)
+        *count = atoi(PQgetvalue(res, 0, 0));
+    PQclear(res);
+
+free_str:
+    free_dss_char4sql(addr_str);
+    free_dss_char4sql(name);
+    return rc;
+}
+
+/**
+ * Append to \p clause the conditions on the rows of "extent JOIN
+ * layout_extent" selected by \p filter: synced extents of \p filter->family
+ * that are not staged and whose live object matches the age, size and user_md
+ * of \p filter. The size of an object is the one of one of its replicas.
+ */
+static int dss_tier_filter_append(struct dss_handle *hdl, GString *clause,
+                                  const struct tier_filter *filter)
+{
+    char *user_md = NULL;
+    char *tags = NULL;
+
+    if (filter->user_md) {
+        user_md = dss_char4sql(hdl->dh_conn, filter->user_md);
+        if (!user_md)
+            return -EINVAL;
+    }
+
+    if (filter->tags && filter->tags->n_tags > 0) {
+        char *json_tags = dss_tags_encode(filter->tags);
+
+        if (json_tags)
+            tags = dss_char4sql(hdl->dh_conn, json_tags);
+        free(json_tags);
+        if (!tags) {
+            free_dss_char4sql(user_md);
+            return -EINVAL;
+        }
+    }
+
+    g_string_append_printf(clause,
+                           " medium_family = '%s' AND state = 'sync'"
+                           " AND NOT EXISTS (SELECT 1 FROM staging s"
+                           "  WHERE s.uuid = extent.uuid"
+                           "  AND s.version = extent.version)"
+                           " AND EXISTS (SELECT 1 FROM object o"
+                           "  WHERE o.uuid = extent.uuid"
+                           "  AND o.version = extent.version"
+                           "  AND o.creation_time <= now() - interval '%ld s'",
+                           rsc_family2str(filter->family), filter->min_age);
+    if (user_md)
+        g_string_append_printf(clause, "  AND o.user_md @> %s::jsonb",
+                               user_md);
+    g_string_append(clause, ")");
+
+    if (tags)
+        g_string_append_printf(clause,
+                               " AND EXISTS (SELECT 1 FROM media m"
+                               "  WHERE m.family = layout_extent.medium_family"
+                               "  AND m.id = layout_extent.medium_id"
+                               "  AND m.tags @> %s::jsonb)", tags);
+
+    free_dss_char4sql(user_md);
+    free_dss_char4sql(tags);
+
+    if (filter->min_size < 0 && filter->max_size < 0)
+        return 0;
+
+    g_string_append(clause,
+                    " AND (SELECT sum(le.size) FROM layout_extent le"
+                    "  WHERE le.uuid = extent.uuid"
+                    "  AND le.version = extent.version)"
+                    " / GREATEST(COALESCE("
+                    "(extent.lyt_info->'attrs'->>'repl_count')::int, 1), 1)");
+    if (filter->min_size >= 0 && filter->max_size >= 0)
+        g_string_append_printf(clause, " BETWEEN %zd AND %zd",
+                               filter->min_size, filter->max_size);
+    else if (filter->min_size >= 0)
+        g_string_append_printf(clause, " >= %zd", filter->min_size);
+    else
+        g_string_append_printf(clause, " <= %zd", filter->max_size);
+
+    return 0;
+}
+
+int dss_tier_media_get(struct dss_handle *hdl, const struct tier_filter *filter,
+                       struct pho_id **media, int *cnt)
+{
+    GString *request;
+    PGresult *res;
+    int rc;
+    int i;
+
+    if (hdl->dh_conn == NULL || filter == NULL || media == NULL ||
+        cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, filter: %p, media: %p, cnt: %p",
+                   hdl->dh_conn, filter, media, cnt);
+
+    *media = NULL;
+    *cnt = 0;
+
+    request = g_string_new("SELECT DISTINCT medium_family, medium_id"
+                           " FROM extent JOIN layout_extent"
+                           " USING (uuid, version) WHERE");
+    rc = dss_tier_filter_append(hdl, request, filter);
+    if (rc) {
+        g_string_free(request, true);
+        return rc;
+    }
+
+    g_string_append(request, " ORDER BY medium_family, medium_id;");
+    rc = execute(hdl, request, &res, PGRES_TUPLES_OK);
+    g_string_free(request, true);
+    if (rc)
+        goto out;
+
+    if (PQntuples(res) == 0)
+        goto out;
+
+    *media = calloc(PQntuples(res), sizeof(**media));
+    if (!*media)
+        GOTO(out, rc = -ENOMEM);
+
+    for (i = 0; i < PQntuples(res); i++) {
+        (*media)[i].family = str2rsc_family(PQgetvalue(res, i, 0));
+        rc = pho_id_name_set(&(*media)[i], PQgetvalue(res, i, 1));
+        if (rc) {
+            free(*media);
+            *media = NULL;
+            goto out;
+        }
+    }
+
+    *cnt = PQntuples(res);
+
+out:
+    PQclear(res);
+    return rc;
+}
+
+int dss_tier_layouts_get(struct dss_handle *hdl,
+                         const struct tier_filter *filter,
+                         const struct pho_id *medium,
+                         struct layout_info **lyt_ls, int *lyt_cnt)
+{
+    GString *clause;
+    char *name;
+    int rc;
+
+    if (hdl->dh_conn == NULL || filter == NULL || medium == NULL ||
+        lyt_ls == NULL || lyt_cnt == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, filter: %p, medium: %p, "
+                   "lyt_ls: %p, lyt_cnt: %p", hdl->dh_conn, filter, medium,
+                   lyt_ls, lyt_cnt);
+
+    *lyt_ls = NULL;
+    *lyt_cnt = 0;
+
+    name = dss_char4sql(hdl->dh_conn, medium->name);
+    if (!name)
+        return -EINVAL;
+
+    clause = g_string_new(select_query[DSS_LAYOUT]);
+    g_string_append_printf(clause, " WHERE medium_id = %s AND", name);
+    free_dss_char4sql(name);
+
+    rc = dss_tier_filter_append(hdl, clause, filter);
+    if (!rc) {
+        g_string_append(clause, " ORDER BY address, uuid, version, layout_idx");
+        rc = dss_layout_get_query(hdl, clause, lyt_ls, lyt_cnt);
+    }
+
+    g_string_free(clause, true);
+    return rc;
+}
+
+int dss_object_get(struct dss_handle *hdl, const struct dss_filter *filter,
+                   struct object_info **obj_ls, int *obj_cnt)
+{
+    return dss_generic_get(hdl, DSS_OBJECT, filter, (void **)obj_ls, obj_cnt);
+}
+
+int dss_deprecated_object_get(struct dss_handle *hdl,
+                              const struct dss_filter *filter,
+                              struct object_info **obj_ls, int *obj_cnt)
+{
+    return dss_generic_get(hdl, DSS_DEPREC, filter, (void **)obj_ls, obj_cnt);
+}
+
+int dss_logs_get(struct dss_handle *hdl, const struct dss_filter *filter,
+                 struct pho_log **logs_ls, int *logs_cnt)
+{
+    return dss_generic_get(hdl, DSS_LOGS, filter, (void **)logs_ls, logs_cnt);
+}
+
+/**
+ * Number of rows retrieved from the server at once by an iterator, this bounds
+ * the memory used whatever the size of the result set.
+ */
+#define DSS_ITER_FETCH_COUNT 1000
+
+struct dss_iter {
+    struct dss_handle    di_dss;    /**< Connection holding the cursor */
+    enum dss_type        di_type;   /**< Type of the iterated items */
+    PGresult            *di_res;    /**< Current batch of rows */
+    int                  di_row;    /**< Next row to read in di_res */
+    bool                 di_done;   /**< The cursor is exhausted */
+    bool                 di_valid;  /**< di_item holds an item to release */
+    union {
+        struct object_info  object;
+        struct layout_info  layout;
+    } di_item;                      /**< Item returned by dss_iter_next */
+};
+
+/**
+ * Open an iterator on the items of type \p type matching \p filter.
+ *
+ * The cursor lives on a connection of its own inside a transaction, so that
+ * the iteration is not disturbed by the requests made on \p hdl meanwhile.
+ */
+static int dss_iter_open(struct dss_handle *hdl, enum dss_type type,
+                         const struct dss_filter *filter, const char *order_by,
+                         struct dss_iter **iter)
+{
+    struct dss_iter *it;
+    GString *clause;
+    PGresult *res;
+    int rc;
+
+    if (hdl->dh_conn == NULL || iter == NULL)
+        LOG_RETURN(-EINVAL, "dss - conn: %p, iter: %p", hdl->dh_conn, iter);
+
+    *iter = NULL;
+
+    it = calloc(1, sizeof(*it));
+    if (!it)
+        LOG_RETURN(-ENOMEM, "Cannot allocate DSS iterator");
+
+    it->di_type = type;
+
+    rc = dss_init(&it->di_dss);
+    if (rc) {
+        free(it);
+        LOG_RETURN(rc, "Cannot open DSS iterator connection");
+    }
+
+    /* the iteration must see the statements already queued on hdl */
+    dss_pipeline_sync(hdl);
+
+    clause = g_string_new("BEGIN; DECLARE dss_iter NO SCROLL CURSOR FOR ");
+    g_string_append(clause, select_query[type]);
+
+    rc = clause_filter_convert(&it->di_dss, clause, filter);
+    if (rc)
+        goto out_free;
+
+    if (order_by)
+        g_string_append_printf(clause, " ORDER BY %s", order_by);
+    g_string_append(clause, ";");
+
+    rc = execute(&it->di_dss, clause, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+
+out_free:
+    g_string_free(clause, true);
+    if (rc) {
+        dss_fini(&it->di_dss);
+        free(it);
+        return rc;
+    }
+
+    *iter = it;
+    return 0;
+}
+
+/**
+ * Retrieve the next batch of rows of the cursor of \p it.
+ *
+ * \return 0 on success, even if the cursor is exhausted, negated errno on
+ *         failure
  */
-static int dss_prepare_uuid_version_list(PGconn *conn, GString *list,
-                                         struct object_info *obj_list,
-                                         int obj_cnt)
+static int dss_iter_fetch(struct dss_iter *it)
 {
-    int i;
-
-    for (i = 0; i < obj_cnt; ++i) {
-        /* uuid */
-        char *sql_uuid = PQescapeLiteral(conn, obj_list[i].uuid,
-                                         strlen(obj_list[i].uuid));
-
-        if (!sql_uuid)
-            LOG_RETURN(-EINVAL,
-                       "Cannot escape litteral %s: %s",
-                       obj_list[i].uuid, PQerrorMessage(conn));
+    GString *request;
+    PGresult *res;
+    int rc;
 
-        g_string_append_printf(list, "uuid=%s AND ", sql_uuid);
-        PQfreemem(sql_uuid);
+    PQclear(it->di_res);
+    it->di_res = NULL;
+    it->di_row = 0;
 
-        /* version */
-        g_string_append_printf(list, "version='%d'", obj_list[i].version);
+    if (it->di_done)
+        return 0;
 
-        if (i + 1 != obj_cnt)
-            g_string_append(list, " OR ");
+    request = g_string_new(NULL);
+    g_string_printf(request, "FETCH FORWARD %d FROM dss_iter;",
+                    DSS_ITER_FETCH_COUNT);
+    rc = execute(&it->di_dss, request, &res, PGRES_TUPLES_OK);
+    g_string_free(request, true);
+    if (rc) {
+        PQclear(res);
+        return rc;
     }
 
+    it->di_res = res;
+    if (PQntuples(res) < DSS_ITER_FETCH_COUNT)
+        it->di_done = true;
+
     return 0;
 }
 
-int dss_object_move(struct dss_handle *handle, enum dss_type type_from,
-                    enum dss_type type_to, struct object_info *obj_list,
-                    int obj_cnt)
+/**
+ * Tell whether the cursor of \p it has a row left to read, fetching the next
+ * batch if needed.
+ */
+static int dss_iter_has_row(struct dss_iter *it, bool *has_row)
 {
-    PGconn      *conn = handle->dh_conn;
-    enum dss_move_queries move_type;
-    GString     *clause;
-    GString     *key_list;
-    PGresult    *res = NULL;
-    int          rc = 0;
+    int rc;
 
-    ENTRY;
+    if (!it->di_res || it->di_row >= PQntuples(it->di_res)) {
+        rc = dss_iter_fetch(it);
+        if (rc)
+            return rc;
+    }
 
-    move_type = move_query_type(type_from, type_to);
-    if (!conn || move_type == DSS_MOVE_INVAL)
-        LOG_RETURN(-EINVAL, "dss - conn: %p, move_type: %d", conn, move_type);
+    *has_row = it->di_res && it->di_row < PQntuples(it->di_res);
+    return 0;
+}
 
-    clause = g_string_new(NULL);
-    key_list = g_string_new(NULL);
+static void dss_iter_item_release(struct dss_iter *it)
+{
+    if (!it->di_valid)
+        return;
 
-    switch (move_type) {
-    case DSS_MOVE_OBJECT_TO_DEPREC:
-        rc = dss_prepare_oid_list(conn, key_list, obj_list, obj_cnt);
-        if (rc)
-            LOG_GOTO(err, rc, "OID list could not be built");
+    res_destructor[it->di_type](&it->di_item);
+    if (it->di_type == DSS_LAYOUT) {
+        /* the layout may outlive its first row, see dss_iter_next_layout */
+        free(it->di_item.layout.oid);
+        free(it->di_item.layout.uuid);
+    }
 
-        break;
-    case DSS_MOVE_DEPREC_TO_OBJECT:
-        rc = dss_prepare_uuid_version_list(conn, key_list, obj_list, obj_cnt);
-        if (rc)
-            LOG_GOTO(err, rc, "Version list could not be built from deprec");
+    memset(&it->di_item, 0, sizeof(it->di_item));
+    it->di_valid = false;
+}
 
-        break;
-    default:
-            LOG_GOTO(err, -EINVAL, "Unsupported move type");
-    }
+/**
+ * Build the next layout of \p it from the rows of its cursor, which may span
+ * several batches.
+ */
+static int dss_iter_next_layout(struct dss_iter *it)
+{
+    struct layout_info *layout = &it->di_item.layout;
+    int ext_alloc = 0;
+    bool has_row;
+    int rc;
 
-    g_string_append_printf(clause, move_query[move_type], key_list->str);
+    rc = dss_layout_from_pg_row(&it->di_dss, layout, it->di_res, it->di_row);
+    if (rc)
+        return rc;
 
-    pho_debug("Executing request: '%s'", clause->str);
+    it->di_valid = true;
+    layout->oid = strdup(layout->oid);
+    layout->uuid = strdup(layout->uuid);
+    if (!layout->oid || !layout->uuid)
+        LOG_RETURN(-ENOMEM, "Cannot copy layout identifiers");
 
-    res = PQexec(conn, clause->str);
-    if (PQresultStatus(res) != PGRES_COMMAND_OK) {
-        rc = psql_state2errno(res);
-        pho_error(rc, "Query '%s' failed: %s", clause->str,
-                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
-    }
+    layout->extents = NULL;
+    layout->ext_count = 0;
 
-    PQclear(res);
+    do {
+        PGresult *res = it->di_res;
+        int row = it->di_row;
 
-err:
-    g_string_free(key_list, true);
-    g_string_free(clause, true);
-    return rc;
-}
+        if (strcmp(PQgetvalue(res, row, 1), layout->uuid) ||
+            atoi(PQgetvalue(res, row, 2)) != layout->version)
+            break;
 
-void dss_res_free(void *item_list, int item_cnt)
-{
-    struct dss_result *dss_res;
+        if (!PQgetisnull(res, row, 5)) {
+            if (layout->ext_count == ext_alloc) {
+                struct extent *extents;
+
+                ext_alloc = ext_alloc ? 2 * ext_alloc : 4;
+                extents = realloc(layout->extents,
+                                  ext_alloc * sizeof(*extents));
+                if (!extents)
+                    LOG_RETURN(-ENOMEM, "Cannot allocate %d extents",
+                               ext_alloc);
+                layout->extents = extents;
+            }
 
-    if (!item_list)
-        return;
+            memset(&layout->extents[layout->ext_count], 0,
+                   sizeof(*layout->extents));
+            layout->ext_count++;
+            rc = dss_extent_from_pg_row(
+                &layout->extents[layout->ext_count - 1], res, row);
+            if (rc)
+                return rc;
+        }
 
-    dss_res = res_of_item_list(item_list);
-    _dss_result_free(dss_res, item_cnt);
+        it->di_row++;
+        rc = dss_iter_has_row(it, &has_row);
+        if (rc)
+            return rc;
+    } while (has_row);
+
+    return 0;
 }
 
-int dss_get_usable_devices(struct dss_handle *hdl, const enum rsc_family family,
-                           const char *host, struct dev_info **dev_ls,
-                           int *dev_cnt)
+int dss_iter_next(struct dss_iter *iter, void **item)
 {
-    struct dss_filter filter;
-    char *host_filter = NULL;
+    bool has_row;
     int rc;
 
-    if (host) {
-        rc = asprintf(&host_filter, "{\"DSS::DEV::host\": \"%s\"},", host);
-        if (rc < 0)
-            return -ENOMEM;
+    *item = NULL;
+    dss_iter_item_release(iter);
+
+    rc = dss_iter_has_row(iter, &has_row);
+    if (rc || !has_row)
+        return rc;
+
+    if (iter->di_type == DSS_LAYOUT) {
+        rc = dss_iter_next_layout(iter);
+    } else {
+        rc = res_pg_constructor[iter->di_type](&iter->di_dss, &iter->di_item,
+                                               iter->di_res, iter->di_row);
+        iter->di_valid = !rc;
+        iter->di_row++;
     }
 
-    rc = dss_filter_build(&filter,
-                          "{\"$AND\": ["
-                          "  %s"
-                          "  {\"DSS::DEV::adm_status\": \"%s\"},"
-                          "  {\"DSS::DEV::family\": \"%s\"}"
-                          "]}",
-                          host ? host_filter : "",
-                          rsc_adm_status2str(PHO_RSC_ADM_ST_UNLOCKED),
-                          rsc_family2str(family));
-    free(host_filter);
-    if (rc)
+    if (rc) {
+        dss_iter_item_release(iter);
         return rc;
+    }
 
-    rc = dss_device_get(hdl, &filter, dev_ls, dev_cnt);
-    dss_filter_free(&filter);
-    return rc;
+    *item = &iter->di_item;
+    return 0;
 }
 
-int dss_device_get(struct dss_handle *hdl, const struct dss_filter *filter,
-                   struct dev_info **dev_ls, int *dev_cnt)
+void dss_iter_close(struct dss_iter *iter)
 {
-    return dss_generic_get(hdl, DSS_DEVICE, filter, (void **)dev_ls, dev_cnt);
-}
+    GString *request;
+    PGresult *res;
 
-int dss_media_get(struct dss_handle *hdl, const struct dss_filter *filter,
-                  struct media_info **med_ls, int *med_cnt)
-{
-    return dss_generic_get(hdl, DSS_MEDIA, filter, (void **)med_ls, med_cnt);
-}
+    if (!iter)
+        return;
 
-int dss_layout_get(struct dss_handle *hdl, const struct dss_filter *filter,
-                   struct layout_info **lyt_ls, int *lyt_cnt)
-{
-    return dss_generic_get(hdl, DSS_LAYOUT, filter, (void **)lyt_ls, lyt_cnt);
+    dss_iter_item_release(iter);
+    PQclear(iter->di_res);
+
+    request = g_string_new("CLOSE dss_iter; COMMIT;");
+    execute(&iter->di_dss, request, &res, PGRES_COMMAND_OK);
+    PQclear(res);
+    g_string_free(request, true);
+
+    dss_fini(&iter->di_dss);
+    free(iter);
 }
 
-int dss_object_get(struct dss_handle *hdl, const struct dss_filter *filter,
-                   struct object_info **obj_ls, int *obj_cnt)
+int dss_object_iter_open(struct dss_handle *hdl,
+                         const struct dss_filter *filter,
+                         struct dss_iter **iter)
 {
-    return dss_generic_get(hdl, DSS_OBJECT, filter, (void **)obj_ls, obj_cnt);
+    return dss_iter_open(hdl, DSS_OBJECT, filter, NULL, iter);
 }
 
-int dss_deprecated_object_get(struct dss_handle *hdl,
-                              const struct dss_filter *filter,
-                              struct object_info **obj_ls, int *obj_cnt)
+int dss_deprecated_object_iter_open(struct dss_handle *hdl,
+                                    const struct dss_filter *filter,
+                                    struct dss_iter **iter)
 {
-    return dss_generic_get(hdl, DSS_DEPREC, filter, (void **)obj_ls, obj_cnt);
+    return dss_iter_open(hdl, DSS_DEPREC, filter, NULL, iter);
 }
 
-int dss_logs_get(struct dss_handle *hdl, const struct dss_filter *filter,
-                 struct pho_log **logs_ls, int *logs_cnt)
+int dss_layout_iter_open(struct dss_handle *hdl,
+                         const struct dss_filter *filter,
+                         struct dss_iter **iter)
 {
-    return dss_generic_get(hdl, DSS_LOGS, filter, (void **)logs_ls, logs_cnt);
+    /* extents of a layout must be consecutive to be grouped */
+    return dss_iter_open(hdl, DSS_LAYOUT, filter,
+                         "uuid, version, layout_idx", iter);
 }
 
 int dss_device_insert(struct dss_handle *hdl, struct dev_info *dev_ls,
@@ -2365,26 +4250,6 @@ int dss_device_update_host(struct dss_handle *hdl, struct dev_info *dev_ls,
                            DSS_SET_UPDATE_HOST, 0);
 }
 
-static int media_update_lock_retry(struct dss_handle *hdl,
-                                   struct media_info *med_ls, int med_cnt)
-{
-    unsigned int nb_try = 0;
-    int rc = -1;
-
-    while (rc && nb_try < MAX_UPDATE_LOCK_TRY) {
-        rc = dss_lock(hdl, DSS_MEDIA_UPDATE_LOCK, med_ls, med_cnt);
-        if (rc != -EEXIST)
-            break;
-
-        pho_warn("DSS_MEDIA_UPDATE_LOCK is already locked: waiting %u ms",
-                 UPDATE_LOCK_SLEEP_MICRO_SECONDS);
-        nb_try++;
-        usleep(UPDATE_LOCK_SLEEP_MICRO_SECONDS);
-    }
-
-    return rc;
-}
-
 /**
  * output medium_info must be cleaned by calling dss_res_free(medium_info, 1)
  */
@@ -2432,84 +4297,18 @@ static int dss_one_medium_get_from_id(struct dss_handle *dss,
 int dss_media_set(struct dss_handle *hdl, struct media_info *med_ls,
                   int med_cnt, enum dss_set_action action, uint64_t fields)
 {
-    int rc;
-
     if (action == DSS_SET_UPDATE && !fields) {
         pho_warn("Tried updating media without specifying any field");
         return 0;
     }
 
     /**
-     * The only set action that needs a lock is the stats update action. Indeed,
-     * we need to get the full existing stat SQL column to fill only new fields
-     * and keep old value.
-     *
-     * All other set actions (insert, delete, or update of other fields) are
-     * atomic SQL requests and don't need any lock and prefetch.
+     * Every set action is an atomic SQL request, stats updates included: the
+     * new stats are merged into the stored ones by the database (see
+     * append_media_stats_update_request), so no lock nor prefetch is needed.
      */
-    if (action == DSS_SET_UPDATE && IS_STAT(fields)) {
-        int i;
-
-        rc = media_update_lock_retry(hdl, med_ls, med_cnt);
-        if (rc)
-            LOG_RETURN(rc, "Error when locking media to %s",
-                       dss_set_actions_names[action]);
-
-        for (i = 0; i < med_cnt; i++) {
-            struct media_info *medium_info;
-
-            rc = dss_one_medium_get_from_id(hdl, &med_ls[i].rsc.id,
-                                            &medium_info);
-            if (rc)
-                LOG_GOTO(clean, rc,
-                         "Error on getting medium_info (family %s, name %s) to "
-                         "update stats",
-                         rsc_family2str(med_ls[i].rsc.id.family),
-                         med_ls[i].rsc.id.name);
-
-            if (NB_OBJ & fields)
-                medium_info->stats.nb_obj = med_ls[i].stats.nb_obj;
-
-            if (NB_OBJ_ADD & fields)
-                medium_info->stats.nb_obj += med_ls[i].stats.nb_obj;
-
-            if (LOGC_SPC_USED & fields)
-                medium_info->stats.logc_spc_used =
-                    med_ls[i].stats.logc_spc_used;
-
-            if (LOGC_SPC_USED_ADD & fields)
-                medium_info->stats.logc_spc_used +=
-                    med_ls[i].stats.logc_spc_used;
-
-            if (PHYS_SPC_USED & fields)
-                medium_info->stats.phys_spc_used =
-                    med_ls[i].stats.phys_spc_used;
-
-            if (PHYS_SPC_FREE & fields)
-                medium_info->stats.phys_spc_free =
-                    med_ls[i].stats.phys_spc_free;
-
-            med_ls[i].stats = medium_info->stats;
-            dss_res_free(medium_info, 1);
-        }
-    }
-
-    rc = dss_generic_set(hdl, DSS_MEDIA, (void *)med_ls, med_cnt, action,
-                         fields);
-
-clean:
-    if (action == DSS_SET_UPDATE && IS_STAT(fields)) {
-        int rc2;
-
-        rc2 = dss_unlock(hdl, DSS_MEDIA_UPDATE_LOCK, med_ls, med_cnt, false);
-        if (rc2) {
-            pho_error(rc2, "Error when unlocking media at end of %s",
-                      dss_set_actions_names[action]);
-            rc = rc ? : rc2;
-        }
-    }
-
-    return rc;
+    return dss_generic_set(hdl, DSS_MEDIA, (void *)med_ls, med_cnt, action,
+                           fields);
 }
 
 int dss_layout_set(struct dss_handle *hdl, struct layout_info *lyt_ls,
@@ -2553,42 +4352,67 @@ static void pho_error_oid_uuid_version(int error_code, const char *msg,
     }
 }
 
-static int build_json_filter(char **filter, const char *oid,
-                             const char *uuid, int version)
+/**
+ * Filter templates used to find an object from its identifiers, the values
+ * bound to them are set by lazy_find_params().
+ */
+#define LAZY_FIND_OID_UUID_VERSION \
+    "{\"$AND\": [" \
+        "{\"DSS::OBJ::oid\": \"$1\"}," \
+        "{\"DSS::OBJ::uuid\": \"$2\"}," \
+        "{\"DSS::OBJ::version\": \"$3\"}" \
+    "]}"
+#define LAZY_FIND_OID_UUID \
+    "{\"$AND\": [" \
+        "{\"DSS::OBJ::oid\": \"$1\"}," \
+        "{\"DSS::OBJ::uuid\": \"$2\"}" \
+    "]}"
+#define LAZY_FIND_UUID_VERSION \
+    "{\"$AND\": [" \
+        "{\"DSS::OBJ::uuid\": \"$1\"}," \
+        "{\"DSS::OBJ::version\": \"$2\"}" \
+    "]}"
+#define LAZY_FIND_OID   "{\"DSS::OBJ::oid\": \"$1\"}"
+#define LAZY_FIND_UUID  "{\"DSS::OBJ::uuid\": \"$1\"}"
+
+/**
+ * Select the filter template matching the given object identifiers and fill
+ * \p params with their values.
+ *
+ * \p version_str must be large enough to hold the string representation of
+ * \p version, it is referenced by \p params.
+ *
+ * \return the number of parameters of the template
+ */
+static int lazy_find_params(const char *oid, const char *uuid, int version,
+                            char *version_str, size_t version_size,
+                            const char **tmpl, const char **params)
 {
-    int rc = 0;
+    snprintf(version_str, version_size, "%d", version);
 
     if (uuid && oid) {
+        params[0] = oid;
+        params[1] = uuid;
         if (version) {
-            rc = asprintf(filter,
-                          "{\"$AND\": ["
-                              "{\"DSS::OBJ::oid\": \"%s\"},"
-                              "{\"DSS::OBJ::uuid\": \"%s\"},"
-                              "{\"DSS::OBJ::version\": \"%d\"}"
-                          "]}",
-                          oid, uuid, version);
-        } else {
-            rc = asprintf(filter,
-                          "{\"$AND\": ["
-                              "{\"DSS::OBJ::oid\": \"%s\"},"
-                              "{\"DSS::OBJ::uuid\": \"%s\"}"
-                          "]}",
-                          oid, uuid);
-        }
-    } else {
-        if (version && !oid) {
-            rc = asprintf(filter,
-                          "{\"$AND\": ["
-                              "{\"DSS::OBJ::uuid\": \"%s\"},"
-                              "{\"DSS::OBJ::version\": \"%d\"}"
-                          "]}",
-                          uuid, version);
-        } else {
-            rc = asprintf(filter, "{\"DSS::OBJ::%s\": \"%s\"}",
-                          oid ? "oid" : "uuid", oid ? : uuid);
+            params[2] = version_str;
+            *tmpl = LAZY_FIND_OID_UUID_VERSION;
+            return 3;
         }
+
+        *tmpl = LAZY_FIND_OID_UUID;
+        return 2;
     }
-    return rc;
+
+    if (version && !oid) {
+        params[0] = uuid;
+        params[1] = version_str;
+        *tmpl = LAZY_FIND_UUID_VERSION;
+        return 2;
+    }
+
+    params[0] = oid ? : uuid;
+    *tmpl = oid ? LAZY_FIND_OID : LAZY_FIND_UUID;
+    return 1;
 }
 
 static int lazy_find_deprecated_object(struct dss_handle *hdl,
@@ -2597,25 +4421,21 @@ static int lazy_find_deprecated_object(struct dss_handle *hdl,
 {
     struct object_info *obj_iter;
     struct object_info *obj_list;
-    struct dss_filter filter;
     struct object_info *curr;
-    char *json_filter;
+    char version_str[16];
+    const char *params[3];
+    const char *tmpl;
+    int n_params;
     int obj_cnt;
     int rc;
 
     ENTRY;
 
-    rc = build_json_filter(&json_filter, oid, uuid, version);
-    if (rc < 0)
-        LOG_RETURN(rc = -ENOMEM, "Cannot allocate filter string");
-
-    rc = dss_filter_build(&filter, "%s", json_filter);
-    free(json_filter);
-    if (rc)
-        LOG_RETURN(rc, "Cannot build filter");
+    n_params = lazy_find_params(oid, uuid, version, version_str,
+                                sizeof(version_str), &tmpl, params);
 
-    rc = dss_deprecated_object_get(hdl, &filter, &obj_list, &obj_cnt);
-    dss_filter_free(&filter);
+    rc = dss_template_get(hdl, DSS_DEPREC, tmpl, params, n_params,
+                          (void **)&obj_list, &obj_cnt);
     if (rc) {
         pho_error_oid_uuid_version(rc, "Unable to get deprecated object",
                                    oid, uuid, version);
@@ -2667,24 +4487,20 @@ int dss_lazy_find_object(struct dss_handle *hdl, const char *oid,
                          struct object_info **obj)
 {
     struct object_info *obj_list = NULL;
-    struct dss_filter filter;
-    char *json_filter;
+    char version_str[16];
+    const char *params[3];
+    const char *tmpl;
+    int n_params;
     int obj_cnt;
     int rc;
 
     ENTRY;
 
-    rc = build_json_filter(&json_filter, oid, uuid, version);
-    if (rc < 0)
-        LOG_RETURN(rc = -ENOMEM, "Cannot allocate filter string");
-
-    rc = dss_filter_build(&filter, "%s", json_filter);
-    free(json_filter);
-    if (rc)
-        LOG_RETURN(rc, "Cannot build filter");
+    n_params = lazy_find_params(oid, uuid, version, version_str,
+                                sizeof(version_str), &tmpl, params);
 
-    rc = dss_object_get(hdl, &filter, &obj_list, &obj_cnt);
-    dss_filter_free(&filter);
+    rc = dss_template_get(hdl, DSS_OBJECT, tmpl, params, n_params,
+                          (void **)&obj_list, &obj_cnt);
     if (rc)
         LOG_RETURN(rc, "Cannot fetch objid: '%s'", oid);
 
@@ -2799,67 +4615,41 @@ clean:
 int dss_media_of_object(struct dss_handle *hdl, struct object_info *obj,
                         struct media_info **media, int *cnt)
 {
-    struct layout_info *layout;
-    struct dss_filter filter;
-    struct pho_id medium_id;
-    GString *filter_str;
+    GString *clause;
+    char *uuid;
     int rc;
-    int i;
 
-    rc = dss_filter_build(&filter,
-                          "{\"$AND\": ["
-                            "{\"DSS::EXT::oid\": \"%s\"}, "
-                            "{\"DSS::EXT::uuid\": \"%s\"}, "
-                            "{\"DSS::EXT::version\": \"%d\"}"
-                          "]}",
-                          obj->oid, obj->uuid, obj->version);
-    if (rc)
-        LOG_RETURN(rc, "Cannot build filter");
+    *media = NULL;
+    *cnt = 0;
 
-    rc = dss_layout_get(hdl, &filter, &layout, cnt);
-    dss_filter_free(&filter);
+    uuid = dss_char4sql(hdl->dh_conn, obj->uuid);
+    if (!uuid)
+        return -EINVAL;
+
+    clause = g_string_new(select_query[DSS_MEDIA]);
+    g_string_append_printf(clause,
+                           " WHERE (family, id) IN"
+                           " (SELECT medium_family, medium_id"
+                           "  FROM layout_extent"
+                           "  WHERE uuid = %s AND version = %d)",
+                           uuid, obj->version);
+    free_dss_char4sql(uuid);
+
+    rc = dss_generic_get_query(hdl, DSS_MEDIA, clause, (void **)media, cnt);
+    g_string_free(clause, true);
     if (rc)
-        LOG_RETURN(rc, "Failed to retrieve layout of object '%s'", obj->oid);
+        LOG_RETURN(rc, "Failed to retrieve media of object '%s'", obj->oid);
 
     if (*cnt == 0) {
-        dss_res_free(layout, 0);
+        dss_res_free(*media, 0);
         LOG_RETURN(-EINVAL, "No extent found for object '%s'", obj->oid);
     }
 
-    filter_str = g_string_new(NULL);
-    if (*cnt > 1)
-        g_string_append_printf(filter_str, "{\"OR\": [");
-
-    for (i = 0; i < *cnt; ++i) {
-        medium_id = layout[i].extents->media;
-        g_string_append_printf(filter_str,
-                              "{\"$AND\": ["
-                                "{\"DSS::MDA::family\": \"%s\"}, "
-                                "{\"DSS::MDA::id\": \"%s\"}"
-                              "]}%s",
-                              rsc_family2str(medium_id.family),
-                              medium_id.name, i + 1 < *cnt ? "," : "");
-    }
-
-    if (*cnt > 1)
-        g_string_append_printf(filter_str, "]}");
-
-    dss_res_free(layout, *cnt);
-
-    rc = dss_filter_build(&filter, "%s", filter_str->str);
-    g_string_free(filter_str, true);
-    if (rc)
-        LOG_RETURN(rc, "Cannot build filter");
-
-    rc = dss_media_get(hdl, &filter, media, cnt);
-    dss_filter_free(&filter);
-
-    return rc;
+    return 0;
 }
 
 int dss_logs_delete(struct dss_handle *handle, const struct dss_filter *filter)
 {
-    PGconn *conn = handle->dh_conn;
     GString *clause;
     PGresult *res;
     int rc;
@@ -2874,7 +4664,7 @@ int dss_logs_delete(struct dss_handle *handle, const struct dss_filter *filter)
 
     pho_debug("Executing request: '%s'", clause->str);
 
-    rc = execute(conn, clause, &res, PGRES_COMMAND_OK);
+    rc = execute(handle, clause, &res, PGRES_COMMAND_OK);
     PQclear(res);
 
     g_string_free(clause, true);
@@ -39,50 +39,6 @@
 #include "pho_dss.h"
 #include "pho_type_utils.h"
 
-#define LOCK_ID_LIST_ALLOCATE(_ids, _item_cnt)        \
-do {                                                  \
-    (_ids) = malloc((_item_cnt) * sizeof(*(_ids)));   \
-    if (!(_ids))                                      \
-        LOG_RETURN(-ENOMEM, "Couldn't allocate ids"); \
-                                                      \
-    for (i = 0; i < (_item_cnt); ++i)                 \
-        (_ids)[i] = g_string_new("");                 \
-} while (0)
-
-#define LOCK_ID_LIST_FREE(_ids, _item_cnt)            \
-do {                                                  \
-    for (i = 0; i < (_item_cnt); ++i)                 \
-        g_string_free((_ids)[i], true);               \
-    free((_ids));                                     \
-} while (0)
-
-struct simple_param {
-    struct pho_lock *locks;
-    int (*basic_func)(struct dss_handle *handle, enum dss_type lock_type,
-                      const char *lock_id, struct pho_lock *locks);
-};
-
-struct dual_param {
-    const char *lock_hostname;
-    int lock_owner;
-    int (*basic_func)(struct dss_handle *handle, enum dss_type lock_type,
-                      const char *lock_id, int lock_owner,
-                      const char *lock_hostname);
-};
-
-/** This structure serves as an abstraction for the basic_* calls */
-struct dss_generic_call {
-    union {
-        struct simple_param simple;
-        struct dual_param dual;
-    } params;
-    bool is_simple;
-    int (*rollback_func)(struct dss_handle *handle, enum dss_type type,
-                         GString **ids, int rollback_cnt);
-    bool all_or_nothing;
-    const char *action;
-};
-
 enum lock_query_idx {
     DSS_LOCK_QUERY,
     DSS_REFRESH_QUERY,
@@ -94,59 +50,56 @@ enum lock_query_idx {
     DSS_PURGE_ALL_LOCKS_QUERY,
 };
 
-#define DECLARE_BLOCK " DECLARE lock_type lock_type:= '%s'::lock_type;" \
-                      "         lock_id TEXT:= '%s';"                   \
-                      "         lock_hostname TEXT:="                   \
-                      "             (SELECT hostname FROM lock"         \
-                      "              WHERE type = lock_type AND "       \
-                      "                    id = lock_id);"              \
-                      "         lock_owner INTEGER:="                   \
-                      "             (SELECT owner FROM lock"            \
-                      "              WHERE type = lock_type AND "       \
-                      "                    id = lock_id);"              \
-
-#define CHECK_VALID_OWNER_HOSTNAME " IF lock_owner IS NULL OR "         \
-                                   "    lock_hostname IS NULL THEN"     \
-                                   "  RAISE USING errcode = 'PHLK1';"   \
-                                   " END IF;"
-
-#define CHECK_OWNER_HOSTNAME_EXISTS " IF lock_owner <> '%d' OR "        \
-                                    "    lock_hostname <> '%s' THEN"    \
-                                    "  RAISE USING errcode = 'PHLK2';"  \
-                                    " END IF;"
-
-#define WHERE_CONDITION " WHERE type = lock_type AND id = lock_id AND " \
-                        "       owner = lock_owner AND "                \
-                        "       hostname = lock_hostname;"
+/**
+ * The ids of the locks to handle are given as an array, and the queries below
+ * unnest it to handle every lock in a single statement.
+ *
+ * Refresh and unlock queries return, for each requested id and in the order
+ * of the array, whether the lock exists and whether it was handled, so that
+ * the caller can tell which ids failed and why.
+ */
+#define LOCK_IDS "ids AS (SELECT id, rank FROM unnest(%s)"                \
+                 "        WITH ORDINALITY AS t(id, rank))"
+
+#define LOCK_IDS_RESULT " SELECT ids.id, lock.id IS NOT NULL,"             \
+                        "        ids.id IN (SELECT id FROM done)"          \
+                        "  FROM ids LEFT JOIN lock"                        \
+                        "    ON lock.type = '%s'::lock_type"               \
+                        "   AND lock.id = ids.id"                          \
+                        "  ORDER BY ids.rank;"
 
 static const char * const lock_query[] = {
     [DSS_LOCK_QUERY]         = "INSERT INTO lock (type, id, owner, hostname)"
-                               " VALUES ('%s'::lock_type, '%s', %d, '%s');",
-    [DSS_REFRESH_QUERY]      = "DO $$"
-                                 DECLARE_BLOCK
-                               " BEGIN"
-                                 CHECK_VALID_OWNER_HOSTNAME
-                                 CHECK_OWNER_HOSTNAME_EXISTS
-                               " UPDATE lock SET timestamp = now()"
-                                 WHERE_CONDITION
-                               "END $$;",
-    [DSS_UNLOCK_QUERY]       = "DO $$"
-                                 DECLARE_BLOCK
-                               " BEGIN"
-                                 CHECK_VALID_OWNER_HOSTNAME
-                                 CHECK_OWNER_HOSTNAME_EXISTS
-                               " DELETE FROM lock"
-                                 WHERE_CONDITION
-                               "END $$;",
-    [DSS_UNLOCK_FORCE_QUERY] = "DO $$"
-                                  DECLARE_BLOCK
-                               "  BEGIN"
-                                  CHECK_VALID_OWNER_HOSTNAME
-                               "  DELETE FROM lock"
-                               "   WHERE type = lock_type AND id = lock_id;"
-                               "END $$;",
-    [DSS_STATUS_QUERY]       = "SELECT hostname, owner, timestamp FROM lock "
-                               "  WHERE type = '%s'::lock_type AND id = '%s';",
+                               " SELECT '%s'::lock_type, id, %d, '%s'"
+                               "  FROM unnest(%s) AS id;",
+    [DSS_REFRESH_QUERY]      = "WITH " LOCK_IDS ","
+                               " done AS (UPDATE lock SET timestamp = now()"
+                               "  FROM ids"
+                               "  WHERE type = '%s'::lock_type"
+                               "    AND lock.id = ids.id"
+                               "    AND owner = %d AND hostname = '%s'"
+                               "  RETURNING lock.id)"
+                               LOCK_IDS_RESULT,
+    [DSS_UNLOCK_QUERY]       = "WITH " LOCK_IDS ","
+                               " done AS (DELETE FROM lock USING ids"
+                               "  WHERE type = '%s'::lock_type"
+                               "    AND lock.id = ids.id"
+                               "    AND owner = %d AND hostname = '%s'"
+                               "  RETURNING lock.id)"
+                               LOCK_IDS_RESULT,
+    [DSS_UNLOCK_FORCE_QUERY] = "WITH " LOCK_IDS ","
+                               " done AS (DELETE FROM lock USING ids"
+                               "  WHERE type = '%s'::lock_type"
+                               "    AND lock.id = ids.id"
+                               "  RETURNING lock.id)"
+                               LOCK_IDS_RESULT,
+    [DSS_STATUS_QUERY]       = "SELECT hostname, owner, timestamp, ids.id"
+                               "  FROM unnest(%s) WITH ORDINALITY"
+                               "    AS ids(id, rank)"
+                               "  LEFT JOIN lock"
+                               "    ON lock.type = '%s'::lock_type"
+                               "   AND lock.id = ids.id"
+                               "  ORDER BY ids.rank;",
     [DSS_CLEAN_DEVICE_QUERY] = "WITH id_host AS (SELECT id, host FROM device "
                                "                   WHERE family = '%s') "
                                "DELETE FROM lock "
@@ -198,241 +151,157 @@ static const char *dss_translate(enum dss_type type, const void *item_list,
     return NULL;
 }
 
-static int dss_build_lock_id_list(PGconn *conn, const void *item_list,
-                                  int item_cnt, enum dss_type type,
-                                  GString **ids)
+/**
+ * Build the SQL array of the escaped lock ids of the items of \p item_list.
+ */
+static int dss_build_lock_id_array(PGconn *conn, const void *item_list,
+                                   int item_cnt, enum dss_type type,
+                                   GString *ids)
 {
-    char         *escape_string;
-    unsigned int  escape_len;
-    int           rc = 0;
-    const char   *name;
-    int           i;
+    char *escape_string;
+    const char *name;
+    int i;
+
+    g_string_append(ids, "ARRAY[");
 
     for (i = 0; i < item_cnt; i++) {
         name = dss_translate(type, item_list, i);
         if (!name)
             return -EINVAL;
 
-        escape_len = strlen(name) * 2 + 1;
-        escape_string = malloc(escape_len);
-        if (!escape_string)
-            LOG_GOTO(cleanup, rc = -ENOMEM, "Memory allocation failed");
-
-        PQescapeStringConn(conn, escape_string, name, escape_len, NULL);
-        g_string_append(ids[i], escape_string);
+        if (strlen(name) > PHO_DSS_MAX_LOCK_ID_LEN)
+            LOG_RETURN(-EINVAL, "lock_id name too long");
 
-        if (ids[i]->len > PHO_DSS_MAX_LOCK_ID_LEN)
-            LOG_GOTO(cleanup, rc = -EINVAL, "lock_id name too long");
+        escape_string = PQescapeLiteral(conn, name, strlen(name));
+        if (!escape_string)
+            LOG_RETURN(-ENOMEM, "Cannot escape lock id '%s': %s", name,
+                       PQerrorMessage(conn));
 
-cleanup:
-        free(escape_string);
-        if (rc)
-            break;
+        g_string_append_printf(ids, "%s%s", i ? ", " : "", escape_string);
+        PQfreemem(escape_string);
     }
 
-    return rc;
-}
-
-static int basic_lock(struct dss_handle *handle, enum dss_type lock_type,
-                      const char *lock_id, int lock_owner,
-                      const char *lock_hostname)
-{
-    GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
-    PGresult *res;
-    int rc;
-
-    g_string_printf(request, lock_query[DSS_LOCK_QUERY],
-                    dss_type_names[lock_type], lock_id, lock_owner,
-                    lock_hostname);
-
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+    g_string_append(ids, "]::text[]");
 
-    PQclear(res);
-    g_string_free(request, true);
-
-    return rc;
+    return 0;
 }
 
-static int basic_refresh(struct dss_handle *handle, enum dss_type lock_type,
-                         const char *lock_id, int lock_owner,
-                         const char *lock_hostname)
+/**
+ * Check the result of a refresh or unlock query.
+ *
+ * \return 0 if every lock was handled, the error of the first lock that was
+ *         not otherwise: -ENOLCK if it does not exist, -EACCES if it belongs
+ *         to another owner
+ */
+static int lock_ids_result_check(PGresult *res, const char *action)
 {
-    GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
-    PGresult *res;
     int rc = 0;
+    int i;
 
-    g_string_printf(request, lock_query[DSS_REFRESH_QUERY],
-                    dss_type_names[lock_type], lock_id, lock_owner,
-                    lock_hostname);
+    for (i = 0; i < PQntuples(res); i++) {
+        int rc2;
 
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+        if (*PQgetvalue(res, i, 2) == 't')
+            continue;
 
-    PQclear(res);
-    g_string_free(request, true);
+        rc2 = *PQgetvalue(res, i, 1) == 't' ? -EACCES : -ENOLCK;
+        pho_debug("Failed to %s %s (%s)", action, PQgetvalue(res, i, 0),
+                  strerror(-rc2));
+        rc = rc ? : rc2;
+    }
 
     return rc;
 }
 
-static int basic_unlock(struct dss_handle *handle, enum dss_type lock_type,
-                        const char *lock_id, int lock_owner,
-                        const char *lock_hostname)
+/**
+ * Refresh or unlock the locks of the items of \p item_list in one statement.
+ *
+ * Locks are handled independently: the ones that can be are, even if others
+ * do not exist or belong to another owner.
+ */
+static int dss_lock_ids_update(struct dss_handle *handle, enum dss_type type,
+                               const void *item_list, int item_cnt,
+                               enum lock_query_idx query,
+                               const char *lock_hostname, int lock_owner)
 {
-    GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
+    GString *request;
     PGresult *res;
+    GString *ids;
     int rc;
 
-    if (lock_owner)
-        g_string_printf(request, lock_query[DSS_UNLOCK_QUERY],
-                        dss_type_names[lock_type], lock_id, lock_owner,
-                        lock_hostname);
-    else
-        g_string_printf(request, lock_query[DSS_UNLOCK_FORCE_QUERY],
-                        dss_type_names[lock_type], lock_id);
-
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
-
-    PQclear(res);
-    g_string_free(request, true);
-
-    return rc;
-}
-
-static int basic_status(struct dss_handle *handle, enum dss_type lock_type,
-                        const char *lock_id, struct pho_lock *lock)
-{
-    GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
-    struct timeval lock_timestamp;
-    PGresult *res;
-    int rc = 0;
+    ENTRY;
 
-    g_string_printf(request, lock_query[DSS_STATUS_QUERY],
-                    dss_type_names[lock_type], lock_id);
+    if (item_cnt == 0)
+        return 0;
 
-    rc = execute(conn, request, &res, PGRES_TUPLES_OK);
-    if (rc)
-        goto out_cleanup;
-
-    if (PQntuples(res) == 0) {
-        pho_debug("Requested lock '%s' was not found, request: '%s' ",
-                  lock_id, request->str);
-        rc = -ENOLCK;
-        if (lock) {
-            lock->hostname = NULL;
-            lock->owner = 0;
-        }
-        goto out_cleanup;
+    ids = g_string_new(NULL);
+    rc = dss_build_lock_id_array(handle->dh_conn, item_list, item_cnt, type,
+                                 ids);
+    if (rc) {
+        g_string_free(ids, true);
+        LOG_RETURN(rc, "Ids list build failed");
     }
 
-    if (lock) {
-        str2timeval(PQgetvalue(res, 0, 2), &lock_timestamp);
-        rc = init_pho_lock(lock, PQgetvalue(res, 0, 0),
-                           (int) strtoll(PQgetvalue(res, 0, 1), NULL, 10),
-                           &lock_timestamp);
-    }
+    request = g_string_new(NULL);
+    if (query == DSS_UNLOCK_FORCE_QUERY)
+        g_string_printf(request, lock_query[query], ids->str,
+                        dss_type_names[type], dss_type_names[type]);
+    else
+        g_string_printf(request, lock_query[query], ids->str,
+                        dss_type_names[type], lock_owner, lock_hostname,
+                        dss_type_names[type]);
+    g_string_free(ids, true);
+
+    rc = execute(handle, request, &res, PGRES_TUPLES_OK);
+    if (!rc)
+        rc = lock_ids_result_check(res, query == DSS_REFRESH_QUERY ?
+                                            "refresh" : "unlock");
 
-out_cleanup:
     PQclear(res);
     g_string_free(request, true);
 
     return rc;
 }
 
-static int dss_generic(struct dss_handle *handle, enum dss_type type,
-                       const void *item_list, int item_cnt,
-                       struct dss_generic_call *callee)
+int _dss_lock(struct dss_handle *handle, enum dss_type type,
+              const void *item_list, int item_cnt, const char *lock_hostname,
+              int lock_pid)
 {
-    PGconn *conn = handle->dh_conn;
-    GString **ids;
-    int rc = 0;
-    int i;
+    GString *request;
+    PGresult *res;
+    GString *ids;
+    int rc;
 
     ENTRY;
 
-    LOCK_ID_LIST_ALLOCATE(ids, item_cnt);
-
-    rc = dss_build_lock_id_list(conn, item_list, item_cnt, type, ids);
-    if (rc)
-        LOG_GOTO(cleanup, rc, "Ids list build failed");
-
-    for (i = 0; i < item_cnt; ++i) {
-        int rc2;
-
-        if (callee->is_simple) {
-            struct simple_param *param = &callee->params.simple;
-
-            rc2 = param->basic_func(handle, type, ids[i]->str,
-                                    param->locks ? param->locks + i : NULL);
-
-        } else {
-            struct dual_param *param = &callee->params.dual;
-
-            rc2 = param->basic_func(handle, type, ids[i]->str,
-                                    param->lock_owner, param->lock_hostname);
-        }
+    if (item_cnt == 0)
+        return 0;
 
-        if (rc2) {
-            rc = rc ? : rc2;
-            pho_debug("Failed to %s %s (%s)", callee->action, ids[i]->str,
-                                              strerror(-rc2));
-            if (callee->all_or_nothing)
-                break;
-        }
+    ids = g_string_new(NULL);
+    rc = dss_build_lock_id_array(handle->dh_conn, item_list, item_cnt, type,
+                                 ids);
+    if (rc) {
+        g_string_free(ids, true);
+        LOG_RETURN(rc, "Ids list build failed");
     }
 
-    if (callee->all_or_nothing && rc)
-        callee->rollback_func(handle, type, ids, i - 1);
-
-cleanup:
-    LOCK_ID_LIST_FREE(ids, item_cnt);
-
-    return rc;
-}
+    /* A single statement: if one lock already exists, none is taken */
+    request = g_string_new(NULL);
+    g_string_printf(request, lock_query[DSS_LOCK_QUERY],
+                    dss_type_names[type], lock_pid, lock_hostname, ids->str);
+    g_string_free(ids, true);
 
-static int dss_lock_rollback(struct dss_handle *handle, enum dss_type type,
-                             GString **ids, int rollback_cnt)
-{
-    int rc = 0;
-    int i;
+    rc = execute(handle, request, &res, PGRES_COMMAND_OK);
+    if (rc)
+        pho_debug("Failed to lock %d %s (%s)", item_cnt, dss_type_names[type],
+                  strerror(-rc));
 
-    for (i = rollback_cnt; i >= 0; --i) {
-        int rc2;
+    PQclear(res);
+    g_string_free(request, true);
 
-        /* If a lock failure happens, we force every unlock */
-        rc2 = basic_unlock(handle, type, ids[i]->str, 0, NULL);
-        if (rc2) {
-            rc = rc ? : rc2;
-            pho_error(rc2, "Failed to unlock %s after lock failure, "
-                           "database may be corrupted", ids[i]->str);
-        }
-    }
     return rc;
 }
 
-int _dss_lock(struct dss_handle *handle, enum dss_type type,
-              const void *item_list, int item_cnt, const char *lock_hostname,
-              int lock_pid)
-{
-    struct dss_generic_call callee = {
-        .params = {
-            .dual = {
-                .lock_hostname = lock_hostname,
-                .lock_owner = lock_pid,
-                .basic_func = basic_lock
-            }
-        },
-        .is_simple = false,
-        .all_or_nothing = true,
-        .rollback_func = dss_lock_rollback,
-        .action = "lock"
-    };
-
-    return dss_generic(handle, type, item_list, item_cnt, &callee);
-}
-
 int dss_lock(struct dss_handle *handle, enum dss_type type,
              const void *item_list, int item_cnt)
 {
@@ -461,20 +330,8 @@ int _dss_lock_refresh(struct dss_handle *handle, enum dss_type type,
                       const void *item_list, int item_cnt,
                       const char *lock_hostname, int lock_owner)
 {
-    struct dss_generic_call callee = {
-        .params = {
-            .dual = {
-                .lock_hostname = lock_hostname,
-                .lock_owner = lock_owner,
-                .basic_func = basic_refresh
-            }
-        },
-        .is_simple = false,
-        .all_or_nothing = false,
-        .action = "refresh"
-    };
-
-    return dss_generic(handle, type, item_list, item_cnt, &callee);
+    return dss_lock_ids_update(handle, type, item_list, item_cnt,
+                               DSS_REFRESH_QUERY, lock_hostname, lock_owner);
 }
 
 int dss_lock_refresh(struct dss_handle *handle, enum dss_type type,
@@ -493,20 +350,10 @@ int _dss_unlock(struct dss_handle *handle, enum dss_type type,
                 const void *item_list, int item_cnt, const char *lock_hostname,
                 int lock_owner)
 {
-    struct dss_generic_call callee = {
-        .params = {
-            .dual = {
-                .lock_hostname = lock_hostname,
-                .lock_owner = lock_owner,
-                .basic_func = basic_unlock
-            }
-        },
-        .is_simple = false,
-        .all_or_nothing = false,
-        .action = "unlock"
-    };
-
-    return dss_generic(handle, type, item_list, item_cnt, &callee);
+    return dss_lock_ids_update(handle, type, item_list, item_cnt,
+                               lock_owner ? DSS_UNLOCK_QUERY :
+                                            DSS_UNLOCK_FORCE_QUERY,
+                               lock_hostname, lock_owner);
 }
 
 int dss_unlock(struct dss_handle *handle, enum dss_type type,
@@ -525,26 +372,67 @@ int dss_lock_status(struct dss_handle *handle, enum dss_type type,
                     const void *item_list, int item_cnt,
                     struct pho_lock *locks)
 {
-    struct dss_generic_call callee = {
-        .params = {
-            .simple = {
-                .locks = locks,
-                .basic_func = basic_status
+    struct timeval lock_timestamp;
+    GString *request;
+    PGresult *res;
+    GString *ids;
+    int rc;
+    int i;
+
+    ENTRY;
+
+    if (item_cnt == 0)
+        return 0;
+
+    ids = g_string_new(NULL);
+    rc = dss_build_lock_id_array(handle->dh_conn, item_list, item_cnt, type,
+                                 ids);
+    if (rc) {
+        g_string_free(ids, true);
+        LOG_RETURN(rc, "Ids list build failed");
+    }
+
+    request = g_string_new(NULL);
+    g_string_printf(request, lock_query[DSS_STATUS_QUERY], ids->str,
+                    dss_type_names[type]);
+    g_string_free(ids, true);
+
+    rc = execute(handle, request, &res, PGRES_TUPLES_OK);
+    if (rc)
+        goto out_cleanup;
+
+    for (i = 0; i < PQntuples(res); i++) {
+        int rc2 = 0;
+
+        if (PQgetisnull(res, i, 0)) {
+            pho_debug("Requested lock '%s' was not found",
+                      PQgetvalue(res, i, 3));
+            rc2 = -ENOLCK;
+            if (locks) {
+                locks[i].hostname = NULL;
+                locks[i].owner = 0;
             }
-        },
-        .is_simple = true,
-        .all_or_nothing = false,
-        .action = "status"
-    };
+        } else if (locks) {
+            str2timeval(PQgetvalue(res, i, 2), &lock_timestamp);
+            rc2 = init_pho_lock(&locks[i], PQgetvalue(res, i, 0),
+                                (int) strtoll(PQgetvalue(res, i, 1), NULL, 10),
+                                &lock_timestamp);
+        }
+
+        rc = rc ? : rc2;
+    }
+
+out_cleanup:
+    PQclear(res);
+    g_string_free(request, true);
 
-    return dss_generic(handle, type, item_list, item_cnt, &callee);
+    return rc;
 }
 
 int dss_lock_device_clean(struct dss_handle *handle, const char *lock_family,
                           const char *lock_hostname, int lock_owner)
 {
     GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
     PGresult *res;
     int rc = 0;
 
@@ -552,7 +440,7 @@ int dss_lock_device_clean(struct dss_handle *handle, const char *lock_family,
 
     g_string_printf(request, lock_query[DSS_CLEAN_DEVICE_QUERY],
                     lock_family, lock_hostname, lock_owner);
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+    rc = execute(handle, request, &res, PGRES_COMMAND_OK);
 
     PQclear(res);
     g_string_free(request, true);
@@ -566,7 +454,6 @@ int dss_lock_media_clean(struct dss_handle *handle,
 {
     GString *request = g_string_new("");
     GString *ids = g_string_new("");
-    PGconn *conn = handle->dh_conn;
     PGresult *res;
     int rc = 0;
     int i;
@@ -585,7 +472,7 @@ int dss_lock_media_clean(struct dss_handle *handle,
 
     g_string_printf(request, lock_query[DSS_CLEAN_MEDIA_QUERY],
                     lock_hostname, lock_owner, ids->str);
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+    rc = execute(handle, request, &res, PGRES_COMMAND_OK);
 
     PQclear(res);
     g_string_free(request, true);
@@ -599,7 +486,6 @@ int dss_lock_clean_select(struct dss_handle *handle,
                           const char *dev_family, char **lock_ids, int n_ids)
 {
     GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
     bool and_clause = false;
     PGresult *res;
     int rc = 0;
@@ -640,7 +526,7 @@ int dss_lock_clean_select(struct dss_handle *handle,
     }
 
     g_string_append_printf(request, " RETURNING *;");
-    rc = execute(conn, request, &res, PGRES_TUPLES_OK);
+    rc = execute(handle, request, &res, PGRES_TUPLES_OK);
 
     pho_info("%d lock(s) cleaned.", PQntuples(res));
 
@@ -653,14 +539,13 @@ int dss_lock_clean_select(struct dss_handle *handle,
 int dss_lock_clean_all(struct dss_handle *handle)
 {
     GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
     PGresult *res;
     int rc = 0;
 
     ENTRY;
 
     g_string_printf(request, "%s", lock_query[DSS_PURGE_ALL_LOCKS_QUERY]);
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+    rc = execute(handle, request, &res, PGRES_COMMAND_OK);
 
     PQclear(res);
     g_string_free(request, true);
@@ -35,6 +35,7 @@
 #include <libpq-fe.h>
 
 #include "dss_logs.h"
+#include "dss_pipeline.h"
 #include "dss_utils.h"
 #include "pho_common.h"
 #include "pho_dss.h"
@@ -43,7 +44,6 @@
 int dss_emit_log(struct dss_handle *handle, struct pho_log *log)
 {
     GString *request = g_string_new("");
-    PGconn *conn = handle->dh_conn;
     char *message;
     PGresult *res;
     int rc;
@@ -59,7 +59,12 @@ int dss_emit_log(struct dss_handle *handle, struct pho_log *log)
                     operation_type2str(log->cause), message);
     free(message);
 
-    rc = execute(conn, request, &res, PGRES_COMMAND_OK);
+    if (dss_pipeline_is_active(handle)) {
+        rc = dss_pipeline_send(handle, request);
+        goto free_request;
+    }
+
+    rc = execute(handle, request, &res, PGRES_COMMAND_OK);
     PQclear(res);
 
 free_request:
@@ -0,0 +1,287 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Distributed State Service pipelined requests.
+ *
+ * When libpq supports it (PostgreSQL 14 and later), statements are sent using
+ * the pipeline mode: they are all written to the connection without waiting
+ * for the server, and their results are collected at once when the pipeline
+ * is synchronized. With an older libpq, statements are executed as soon as
+ * they are queued, in a transaction committed when the pipeline is
+ * synchronized, and only the error reporting is deferred.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <libpq-fe.h>
+
+#include "dss_pipeline.h"
+#include "dss_utils.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+
+struct dss_pipeline {
+    int dp_depth;       /**< Number of nested dss_pipeline_begin calls */
+    int dp_pending;     /**< Statements sent and not synchronized yet */
+    int dp_rc;          /**< First error met since dss_pipeline_begin */
+#ifndef LIBPQ_HAS_PIPELINING
+    int dp_batch_rc;    /**< First error of the pending statements */
+#endif
+};
+
+bool dss_pipeline_is_active(struct dss_handle *handle)
+{
+    return handle->dh_pipeline != NULL;
+}
+
+int dss_pipeline_begin(struct dss_handle *handle)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+
+    if (handle->dh_conn == NULL)
+        LOG_RETURN(-EINVAL, "Cannot pipeline requests without a connection");
+
+    if (pipeline) {
+        pipeline->dp_depth++;
+        return 0;
+    }
+
+    pipeline = calloc(1, sizeof(*pipeline));
+    if (!pipeline)
+        LOG_RETURN(-ENOMEM, "Cannot allocate DSS pipeline");
+
+    pipeline->dp_depth = 1;
+    handle->dh_pipeline = pipeline;
+
+    return 0;
+}
+
+static void pipeline_set_error(struct dss_pipeline *pipeline, int rc)
+{
+    if (!pipeline->dp_rc)
+        pipeline->dp_rc = rc;
+}
+
+#ifdef LIBPQ_HAS_PIPELINING
+
+int dss_pipeline_send(struct dss_handle *handle, GString *request)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+    PGconn *conn = handle->dh_conn;
+    int rc;
+
+    if (PQpipelineStatus(conn) == PQ_PIPELINE_OFF &&
+        !PQenterPipelineMode(conn))
+        LOG_RETURN(-ECOMM, "Cannot enter pipeline mode: %s",
+                   PQerrorMessage(conn));
+
+    pho_debug("Queuing request: '%s'", request->str);
+
+    /* The simple query protocol is not available in pipeline mode */
+    if (!PQsendQueryParams(conn, request->str, 0, NULL, NULL, NULL, NULL, 0)) {
+        rc = -ECOMM;
+        pho_error(rc, "Cannot send request '%s': %s", request->str,
+                  PQerrorMessage(conn));
+        pipeline_set_error(pipeline, rc);
+        if (!pipeline->dp_pending)
+            PQexitPipelineMode(conn);
+
+        return rc;
+    }
+
+    pipeline->dp_pending++;
+    if (pipeline->dp_pending >= DSS_PIPELINE_MAX_PENDING)
+        return dss_pipeline_sync(handle);
+
+    return 0;
+}
+
+int dss_pipeline_sync(struct dss_handle *handle)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+    PGconn *conn = handle->dh_conn;
+    PGresult *res;
+    int rc = 0;
+
+    if (!pipeline || !pipeline->dp_pending)
+        return 0;
+
+    if (!PQpipelineSync(conn)) {
+        rc = -ECOMM;
+        pho_error(rc, "Cannot synchronize pipeline: %s", PQerrorMessage(conn));
+        goto out;
+    }
+
+    /* Each statement yields its results followed by a NULL result */
+    while (pipeline->dp_pending > 0) {
+        res = PQgetResult(conn);
+        if (!res) {
+            pipeline->dp_pending--;
+            continue;
+        }
+
+        switch (PQresultStatus(res)) {
+        case PGRES_COMMAND_OK:
+        case PGRES_TUPLES_OK:
+            break;
+        case PGRES_PIPELINE_ABORTED:
+            /* A previous statement of this pipeline already failed */
+            break;
+        default:
+            if (!rc) {
+                rc = psql_state2errno(res) ? : -ECOMM;
+                pho_error(rc, "Pipelined request failed: %s",
+                          PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+            }
+        }
+        PQclear(res);
+    }
+
+    res = PQgetResult(conn);
+    if (PQresultStatus(res) != PGRES_PIPELINE_SYNC) {
+        rc = rc ? : -ECOMM;
+        pho_error(rc, "Unexpected pipeline synchronization result: %s",
+                  PQerrorMessage(conn));
+    }
+    PQclear(res);
+
+out:
+    pipeline->dp_pending = 0;
+    if (!PQexitPipelineMode(conn)) {
+        rc = rc ? : -ECOMM;
+        pho_error(rc, "Cannot exit pipeline mode: %s", PQerrorMessage(conn));
+    }
+
+    if (rc)
+        pipeline_set_error(pipeline, rc);
+
+    return rc;
+}
+
+#else /* !LIBPQ_HAS_PIPELINING */
+
+static int pipeline_exec(struct dss_handle *handle, const char *request)
+{
+    PGresult *res;
+    int rc = 0;
+
+    pho_debug("Executing request: '%s'", request);
+
+    res = dss_exec(handle->dh_conn, request);
+    if (PQresultStatus(res) != PGRES_COMMAND_OK &&
+        PQresultStatus(res) != PGRES_TUPLES_OK) {
+        rc = psql_state2errno(res) ? : -ECOMM;
+        pho_error(rc, "Request failed: %s",
+                  PQresultErrorField(res, PG_DIAG_MESSAGE_PRIMARY));
+    }
+    PQclear(res);
+
+    return rc;
+}
+
+int dss_pipeline_send(struct dss_handle *handle, GString *request)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+    int rc;
+
+    /* The pending statements are committed by the next dss_pipeline_sync */
+    if (!pipeline->dp_pending) {
+        rc = pipeline_exec(handle, "BEGIN");
+        if (rc) {
+            pipeline_set_error(pipeline, rc);
+            return rc;
+        }
+    }
+
+    pipeline->dp_pending++;
+
+    /* Once a statement failed, the transaction only waits for its rollback */
+    if (!pipeline->dp_batch_rc) {
+        rc = pipeline_exec(handle, request->str);
+        if (rc) {
+            pipeline->dp_batch_rc = rc;
+            pipeline_set_error(pipeline, rc);
+        }
+    }
+
+    /* The error is reported by dss_pipeline_end as with a real pipeline */
+    if (pipeline->dp_pending >= DSS_PIPELINE_MAX_PENDING)
+        dss_pipeline_sync(handle);
+
+    return 0;
+}
+
+int dss_pipeline_sync(struct dss_handle *handle)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+    int rc;
+
+    if (!pipeline || !pipeline->dp_pending)
+        return 0;
+
+    /* The transaction of a failed statement is rolled back by its COMMIT */
+    rc = pipeline_exec(handle, "COMMIT");
+    if (rc)
+        pipeline_set_error(pipeline, rc);
+
+    rc = pipeline->dp_batch_rc ? : rc;
+    pipeline->dp_batch_rc = 0;
+    pipeline->dp_pending = 0;
+
+    return rc;
+}
+
+#endif /* LIBPQ_HAS_PIPELINING */
+
+int dss_pipeline_end(struct dss_handle *handle)
+{
+    struct dss_pipeline *pipeline = handle->dh_pipeline;
+    int rc;
+
+    if (!pipeline)
+        LOG_RETURN(-EINVAL, "No pipeline to end on this DSS handle");
+
+    if (--pipeline->dp_depth > 0)
+        return 0;
+
+    dss_pipeline_sync(handle);
+    rc = pipeline->dp_rc;
+
+    free(pipeline);
+    handle->dh_pipeline = NULL;
+
+    return rc;
+}
+
+void dss_pipeline_fini(struct dss_handle *handle)
+{
+    if (!handle->dh_pipeline)
+        return;
+
+    dss_pipeline_sync(handle);
+    free(handle->dh_pipeline);
+    handle->dh_pipeline = NULL;
+}
@@ -0,0 +1,81 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Distributed State Service internal API for pipelined requests
+ */
+#ifndef _PHO_DSS_PIPELINE_H
+#define _PHO_DSS_PIPELINE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib.h>
+
+#include "pho_dss.h"
+
+/**
+ * Maximum number of statements queued on the connection before the pipeline
+ * is synchronized. This bounds the amount of results the server has to
+ * buffer while the client is still sending.
+ */
+#define DSS_PIPELINE_MAX_PENDING 128
+
+/**
+ * Queue a statement that does not return any tuple on the pipeline of
+ * \p handle. The statement result is only checked at the next
+ * synchronization point and its error, if any, is reported by
+ * dss_pipeline_end().
+ *
+ * \p request must hold a single SQL statement.
+ *
+ * \param handle[in]   DSS handle with an active pipeline
+ * \param request[in]  Statement to send
+ *
+ * \return 0 if the statement was sent, negated errno if it could not be
+ *         sent to the server
+ */
+int dss_pipeline_send(struct dss_handle *handle, GString *request);
+
+/**
+ * Wait for the results of every statement queued on \p handle.
+ *
+ * Statements queued since the previous synchronization point are applied as a
+ * single implicit transaction: if one fails, none of them is committed.
+ * The first error met is also kept to be returned by dss_pipeline_end().
+ *
+ * This is a no-op if there is no active pipeline or no pending statement, and
+ * is called before any synchronous request on \p handle, so that those always
+ * see the effects of previously queued statements.
+ *
+ * \return 0 on success, negated errno of the first failed statement otherwise
+ */
+int dss_pipeline_sync(struct dss_handle *handle);
+
+/**
+ * Wait for the pending statements of \p handle and release its pipeline,
+ * whatever the number of nested dss_pipeline_begin() calls. Errors are only
+ * logged.
+ */
+void dss_pipeline_fini(struct dss_handle *handle);
+
+#endif
@@ -0,0 +1,208 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos Distributed State Service connection pool.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <glib.h>
+#include <libpq-fe.h>
+
+#include "dss_pipeline.h"
+#include "pho_common.h"
+#include "pho_dss.h"
+
+/**
+ * Connections idle for longer than this are checked with a round trip to
+ * the server before being handed out, as the client only notices that the
+ * server closed a connection when using it.
+ */
+#define DSS_POOL_CHECK_IDLE_S 30
+
+/** A connection waiting in the pool */
+struct dss_pool_conn {
+    struct dss_handle   dpc_handle;
+    time_t              dpc_released_at;
+};
+
+struct dss_pool {
+    pthread_mutex_t     dpl_mutex;
+    pthread_cond_t      dpl_released;   /**< Signaled on connection release */
+    GQueue             *dpl_idle;       /**< Idle dss_pool_conn, most recently
+                                          *  released first
+                                          */
+    int                 dpl_size;       /**< Maximum number of connections */
+    int                 dpl_opened;     /**< Connections currently open or
+                                          *  being opened
+                                          */
+};
+
+int dss_pool_init(struct dss_pool **pool, int size)
+{
+    struct dss_pool *new_pool;
+
+    if (size <= 0)
+        LOG_RETURN(-EINVAL, "Invalid DSS pool size: %d", size);
+
+    new_pool = calloc(1, sizeof(*new_pool));
+    if (!new_pool)
+        LOG_RETURN(-ENOMEM, "Cannot allocate DSS pool");
+
+    pthread_mutex_init(&new_pool->dpl_mutex, NULL);
+    pthread_cond_init(&new_pool->dpl_released, NULL);
+    new_pool->dpl_idle = g_queue_new();
+    new_pool->dpl_size = size;
+
+    *pool = new_pool;
+    return 0;
+}
+
+void dss_pool_fini(struct dss_pool *pool)
+{
+    struct dss_pool_conn *conn;
+
+    if (!pool)
+        return;
+
+    while ((conn = g_queue_pop_head(pool->dpl_idle)) != NULL) {
+        dss_fini(&conn->dpc_handle);
+        free(conn);
+        pool->dpl_opened--;
+    }
+
+    if (pool->dpl_opened)
+        pho_warn("Freeing DSS pool with %d connection(s) still in use",
+                 pool->dpl_opened);
+
+    g_queue_free(pool->dpl_idle);
+    pthread_cond_destroy(&pool->dpl_released);
+    pthread_mutex_destroy(&pool->dpl_mutex);
+    free(pool);
+}
+
+/**
+ * Make sure the connection of \p handle, idle since \p idle_since, is still
+ * usable, reopening it otherwise.
+ */
+static int dss_pool_check(struct dss_handle *handle, time_t idle_since)
+{
+    bool healthy = PQstatus(handle->dh_conn) == CONNECTION_OK;
+
+    if (healthy && time(NULL) - idle_since >= DSS_POOL_CHECK_IDLE_S) {
+        PGresult *res = PQexec(handle->dh_conn, "SELECT 1");
+
+        healthy = PQresultStatus(res) == PGRES_TUPLES_OK;
+        PQclear(res);
+    }
+
+    if (healthy)
+        return 0;
+
+    pho_warn("DSS connection lost (%s), reconnecting",
+             PQerrorMessage(handle->dh_conn));
+    dss_fini(handle);
+
+    return dss_init(handle);
+}
+
+/* Forget a connection that was closed or could not be opened */
+static void dss_pool_drop(struct dss_pool *pool)
+{
+    MUTEX_LOCK(&pool->dpl_mutex);
+    pool->dpl_opened--;
+    pthread_cond_signal(&pool->dpl_released);
+    MUTEX_UNLOCK(&pool->dpl_mutex);
+}
+
+int dss_pool_acquire(struct dss_pool *pool, struct dss_handle *handle)
+{
+    struct dss_pool_conn *conn;
+    int rc;
+
+    MUTEX_LOCK(&pool->dpl_mutex);
+    while (g_queue_is_empty(pool->dpl_idle) &&
+           pool->dpl_opened >= pool->dpl_size)
+        pthread_cond_wait(&pool->dpl_released, &pool->dpl_mutex);
+
+    conn = g_queue_pop_head(pool->dpl_idle);
+    if (!conn)
+        /* reserve a slot for the connection opened below */
+        pool->dpl_opened++;
+    MUTEX_UNLOCK(&pool->dpl_mutex);
+
+    if (conn) {
+        *handle = conn->dpc_handle;
+        rc = dss_pool_check(handle, conn->dpc_released_at);
+        free(conn);
+    } else {
+        rc = dss_init(handle);
+    }
+
+    if (rc) {
+        memset(handle, 0, sizeof(*handle));
+        dss_pool_drop(pool);
+        LOG_RETURN(rc, "Cannot get a DSS connection from the pool");
+    }
+
+    return 0;
+}
+
+void dss_pool_release(struct dss_pool *pool, struct dss_handle *handle)
+{
+    struct dss_pool_conn *conn;
+
+    if (handle->dh_conn == NULL)
+        return;
+
+    if (dss_pipeline_is_active(handle)) {
+        pho_warn("Releasing DSS connection with pipelined requests pending");
+        dss_pipeline_fini(handle);
+    }
+
+    conn = malloc(sizeof(*conn));
+    if (!conn || PQstatus(handle->dh_conn) != CONNECTION_OK ||
+        PQtransactionStatus(handle->dh_conn) != PQTRANS_IDLE) {
+        /* not worth keeping */
+        free(conn);
+        dss_fini(handle);
+        memset(handle, 0, sizeof(*handle));
+        dss_pool_drop(pool);
+        return;
+    }
+
+    conn->dpc_handle = *handle;
+    conn->dpc_released_at = time(NULL);
+    memset(handle, 0, sizeof(*handle));
+
+    MUTEX_LOCK(&pool->dpl_mutex);
+    g_queue_push_head(pool->dpl_idle, conn);
+    pthread_cond_signal(&pool->dpl_released);
+    MUTEX_UNLOCK(&pool->dpl_mutex);
+}
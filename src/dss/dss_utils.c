@@ -26,11 +26,13 @@
 #include "config.h"
 #endif
 
+#include "dss_pipeline.h"
 #include "dss_utils.h"
 #include "pho_common.h"
 
 #include <errno.h>
 #include <libpq-fe.h>
+#include <time.h>
 
 struct sqlerr_map_item {
     const char *smi_prefix;  /**< SQL error code or class (prefix) */
@@ -64,12 +66,69 @@ static const struct sqlerr_map_item sqlerr_map[] = {
     {"", -ECOMM}
 };
 
-int execute(PGconn *conn, GString *request, PGresult **res,
+/** Function reporting the duration of the requests, see dss_query_hook_set() */
+static dss_query_hook_t query_hook;
+
+void dss_query_hook_set(dss_query_hook_t hook)
+{
+    __atomic_store_n(&query_hook, hook, __ATOMIC_RELEASE);
+}
+
+static void query_time_start(dss_query_hook_t *hook, struct timespec *start)
+{
+    *hook = __atomic_load_n(&query_hook, __ATOMIC_ACQUIRE);
+    if (*hook)
+        clock_gettime(CLOCK_MONOTONIC, start);
+}
+
+static void query_time_end(dss_query_hook_t hook, const struct timespec *start)
+{
+    struct timespec end;
+    struct timespec diff;
+
+    if (!hook)
+        return;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    diff = diff_timespec(&end, start);
+    hook(diff.tv_sec + diff.tv_nsec / 1e9);
+}
+
+PGresult *dss_exec(PGconn *conn, const char *query)
+{
+    struct timespec start;
+    dss_query_hook_t hook;
+    PGresult *res;
+
+    query_time_start(&hook, &start);
+    res = PQexec(conn, query);
+    query_time_end(hook, &start);
+
+    return res;
+}
+
+PGresult *dss_exec_prepared(PGconn *conn, const char *stmt_name, int n_params,
+                            const char * const *params)
+{
+    struct timespec start;
+    dss_query_hook_t hook;
+    PGresult *res;
+
+    query_time_start(&hook, &start);
+    res = PQexecPrepared(conn, stmt_name, n_params, params, NULL, NULL, 0);
+    query_time_end(hook, &start);
+
+    return res;
+}
+
+int execute(struct dss_handle *handle, GString *request, PGresult **res,
             ExecStatusType tested)
 {
+    dss_pipeline_sync(handle);
+
     pho_debug("Executing request: '%s'", request->str);
 
-    *res = PQexec(conn, request->str);
+    *res = dss_exec(handle->dh_conn, request->str);
     if (PQresultStatus(*res) != tested)
         LOG_RETURN(psql_state2errno(*res), "Request failed: %s",
                    PQresultErrorField(*res, PG_DIAG_MESSAGE_PRIMARY));
@@ -32,20 +32,39 @@
 #include <glib.h>
 #include <libpq-fe.h>
 
+#include "pho_dss.h"
+
 /**
  * Execute a PSQL \p request, verify the result is as expected with \p tested
  * and put the result in \p res.
  *
- * \param conn[in]    The connection to the database
+ * If requests are pipelined on \p handle, the pending ones are completed
+ * before \p request is executed.
+ *
+ * \param handle[in]  The DSS handle holding the connection to the database
  * \param request[in] Request to execute
  * \param res[out]    Result holder of the request
  * \param tested[in]  The expected result of the request
  *
  * \return            0 on success, or the error as returned by PSQL
  */
-int execute(PGconn *conn, GString *request, PGresult **res,
+int execute(struct dss_handle *handle, GString *request, PGresult **res,
             ExecStatusType tested);
 
+/**
+ * PQexec() wrapper reporting the duration of \p query to the hook set by
+ * dss_query_hook_set().
+ */
+PGresult *dss_exec(PGconn *conn, const char *query);
+
+/**
+ * PQexecPrepared() wrapper reporting the duration of the request to the hook
+ * set by dss_query_hook_set(). The parameters are given as text and the result
+ * is returned as text.
+ */
+PGresult *dss_exec_prepared(PGconn *conn, const char *stmt_name, int n_params,
+                            const char * const *params);
+
 /**
  * Convert PostgreSQL status codes to meaningful errno values.
  * \param   res[in]         Failed query result descriptor
@@ -37,6 +37,9 @@
 /** default path to local config file */
 #define PHO_DEFAULT_CFG "/etc/phobos.conf"
 
+/** seconds the values replaced by pho_cfg_reload_local remain valid */
+#define PHO_CFG_RELOAD_GRACE_S 60
+
 enum pho_cfg_level {
     PHO_CFG_LEVEL_PROCESS, /**< consider the parameter only for current process
                              */
@@ -67,6 +70,19 @@ struct pho_config_item {
  */
 int pho_cfg_init_local(const char *config_file);
 
+/**
+ * Parse again the config file loaded by pho_cfg_init_local and atomically
+ * replace the values read from it. This can be called while other threads
+ * read parameters: the values they got from the previous content of the file
+ * remain valid for PHO_CFG_RELOAD_GRACE_S seconds, callers keeping them longer
+ * must copy them. The previous contents are released by the next reloads once
+ * this grace period is over.
+ *
+ * @return 0 on success, -ENODATA if no config file is loaded, another negative
+ *         error code on failure, in which case the previous content is kept.
+ */
+int pho_cfg_reload_local(void);
+
 /**
  * Release the memory allocated by pho_cfg_init_local. Once called, no pho_cfg_*
  * function can be used.
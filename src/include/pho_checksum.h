@@ -0,0 +1,95 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos extent checksums
+ *
+ * The checksums of an extent are computed while it is written by a layout,
+ * and recomputed in the same way when its content is verified.
+ *
+ * CRC32C is computed with the SSE4.2 or ARMv8 CRC32 instructions when the CPU
+ * provides them, and with lookup tables otherwise.
+ */
+#ifndef _PHO_CHECKSUM_H
+#define _PHO_CHECKSUM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pho_types.h"
+
+/**
+ * Contexts of the checksums computed on an extent, NULL if not computed.
+ */
+struct pho_checksum {
+    void *xxh128state;  /**< XXH3 128 bits state */
+    void *md5ctx;       /**< OpenSSL MD5 digest context */
+    bool with_crc32c;   /**< Whether CRC32C is computed */
+    uint32_t crc32c;    /**< CRC32C of the data given since the last reset */
+};
+
+/**
+ * Create the contexts of the requested checksums.
+ *
+ * XXH128 is silently left out if phobos is built without a 128 bits XXH3
+ * implementation, use pho_checksum_xxh128_available() to check it.
+ *
+ * @param[out]  checksum    Checksum contexts to initialize
+ * @param[in]   md5         Whether MD5 is computed
+ * @param[in]   xxh128      Whether XXH128 is computed
+ * @param[in]   crc32c      Whether CRC32C is computed
+ *
+ * @return 0 on success, -ENOMEM on failure
+ */
+int pho_checksum_init(struct pho_checksum *checksum, bool md5, bool xxh128,
+                      bool crc32c);
+
+/**
+ * Whether XXH128 can be computed by this build of phobos.
+ */
+bool pho_checksum_xxh128_available(void);
+
+/**
+ * Restart the computation of the checksums, to be called before the first
+ * pho_checksum_update() of each extent.
+ */
+int pho_checksum_reset(struct pho_checksum *checksum);
+
+/**
+ * Add \p size bytes of \p buffer to the checksums.
+ */
+int pho_checksum_update(struct pho_checksum *checksum, const void *buffer,
+                        size_t size);
+
+/**
+ * Set the checksums of \p extent from the data given since the last reset, and
+ * its with_md5, with_xxh128 and with_crc32c flags according to the computed
+ * checksums.
+ */
+int pho_checksum_digest(struct pho_checksum *checksum, struct extent *extent);
+
+/**
+ * Free the contexts of \p checksum.
+ */
+void pho_checksum_fini(struct pho_checksum *checksum);
+
+#endif
@@ -89,6 +89,31 @@ enum pho_log_level pho_log_level_get(void);
  */
 void pho_log_callback_set(pho_log_callback_t cb);
 
+/**
+ * Make the emission of log records asynchronous. Each thread then writes its
+ * records to its own lock-free ring, from which a logger thread passes them to
+ * the log callback in batches. A record emitted while the ring of its thread is
+ * full is dropped and counted, see pho_log_async_dropped(): emitting never
+ * waits for the records to be written.
+ *
+ * \return 0 on success, -EALREADY if already started, negative error code on
+ *         failure
+ */
+int pho_log_async_start(void);
+
+/**
+ * Write the pending records and make the emission of log records synchronous
+ * again. Other threads may keep on logging: their records are either written
+ * before it returns or emitted synchronously, and the rings are never freed.
+ */
+void pho_log_async_stop(void);
+
+/**
+ * Number of records dropped since pho_log_async_start() because the ring of
+ * their thread was full.
+ */
+uint64_t pho_log_async_dropped(void);
+
 /**
  * Internal wrapper, do not call directly!
  * Use the pho_{dbg, msg, err} wrappers below instead.
@@ -460,16 +485,16 @@ struct timespec add_timespec(const struct timespec *a,
 struct timespec diff_timespec(const struct timespec *a,
                               const struct timespec *b);
 
-struct collection_item;
+struct pho_cfg_snapshot;
 
 /** global cached configuration */
 struct config {
-    const char *cfg_file;              /** pointer to the loaded config file */
-    struct collection_item *cfg_items; /** pointer to the loaded configuration
-                                         * structure
+    struct pho_cfg_snapshot *snapshot; /** immutable parsed content of the
+                                         * loaded config file, read without
+                                         * lock
                                          */
-    pthread_mutex_t lock;              /** lock to prevent concurrent load and
-                                         * read.
+    pthread_mutex_t lock;              /** lock to prevent concurrent loads
+                                         * and reloads.
                                          */
 };
 
@@ -493,6 +518,9 @@ struct phobos_global_context {
     bool log_dev_output;             /** Whether to display additional
                                        * information on each logs.
                                        */
+    struct pho_log_async *log_async; /** Asynchronous logging state, NULL if
+                                       * the logs are emitted synchronously
+                                       */
 
     pthread_mutex_t ldm_lib_scsi_mutex;
 
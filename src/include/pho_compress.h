@@ -0,0 +1,124 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Phobos extent compression
+ *
+ * The data of a layout may be compressed as a single stream while it is
+ * written, the compressed stream being split on the extents of the layout,
+ * and decompressed in the same way when it is read.
+ */
+#ifndef _PHO_COMPRESS_H
+#define _PHO_COMPRESS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Compression codecs */
+enum pho_codec {
+    PHO_CODEC_INVAL = -1,
+    PHO_CODEC_NONE  = 0,
+    PHO_CODEC_ZSTD  = 1,
+    PHO_CODEC_LAST,
+};
+
+static const char * const pho_codec_names[] = {
+    [PHO_CODEC_NONE] = "none",
+    [PHO_CODEC_ZSTD] = "zstd",
+};
+
+static inline const char *pho_codec2str(enum pho_codec codec)
+{
+    if (codec >= PHO_CODEC_LAST || codec < 0)
+        return NULL;
+    return pho_codec_names[codec];
+}
+
+/** Codec named \p str, PHO_CODEC_INVAL if unknown */
+enum pho_codec str2pho_codec(const char *str);
+
+/** Data given to a compression step, consumed from \a pos */
+struct pho_compress_in {
+    const void *buf;
+    size_t size;
+    size_t pos;
+};
+
+/** Data produced by a compression step, appended from \a pos */
+struct pho_compress_out {
+    void *buf;
+    size_t size;
+    size_t pos;
+};
+
+/** Compression or decompression stream */
+struct pho_compress {
+    enum pho_codec codec;
+    bool decompress;
+    void *stream;       /**< codec context, NULL for PHO_CODEC_NONE */
+};
+
+/**
+ * Whether \p codec can be used by this build of phobos.
+ */
+bool pho_compress_available(enum pho_codec codec);
+
+/**
+ * Create a compression or decompression stream.
+ *
+ * @param[out]  comp        Stream to initialize
+ * @param[in]   codec       Codec of the stream
+ * @param[in]   level       Compression level, 0 for the codec default
+ * @param[in]   decompress  Whether the stream decompresses
+ *
+ * @return 0 on success, -ENOTSUP if the codec is not available, -ENOMEM
+ */
+int pho_compress_init(struct pho_compress *comp, enum pho_codec codec,
+                      int level, bool decompress);
+
+/**
+ * Recommended size of the output buffers of \p comp, so that a step always
+ * makes progress.
+ */
+size_t pho_compress_out_size(const struct pho_compress *comp);
+
+/**
+ * Compress or decompress as much of \p in as \p out can hold.
+ *
+ * When compressing, \p end tells that \p in holds the last data of the
+ * stream: steps then have to be repeated with the same \p in until \p ended
+ * is set, once the whole stream is in output buffers. When decompressing,
+ * \p end is ignored and \p ended is set once the end of the stream is
+ * decoded; steps have to be repeated while \p in is not consumed or \p out
+ * is filled.
+ *
+ * @return 0 on success, -EILSEQ if the stream to decompress is corrupted,
+ *         -EIO on other codec errors
+ */
+int pho_compress_step(struct pho_compress *comp, struct pho_compress_in *in,
+                      struct pho_compress_out *out, bool end, bool *ended);
+
+/**
+ * Free the context of \p comp.
+ */
+void pho_compress_fini(struct pho_compress *comp);
+
+#endif
@@ -64,7 +64,8 @@ int daemon_creation(int argc, char **argv, struct daemon_params *param,
 /**
  * Init the daemon
  *
- * Signal handler is set. Configuration is loaded. Log level is set.
+ * Signal handlers are set. Configuration is loaded. Log level is set and logs are
+ * emitted asynchronously until daemon_fini().
  *
  * @param[in]   param   Daemon parsed parameters
  *
@@ -72,6 +73,24 @@ int daemon_creation(int argc, char **argv, struct daemon_params *param,
  */
 int daemon_init(struct daemon_params param);
 
+/**
+ * Reload the configuration file if the daemon received a SIGHUP since the
+ * last call
+ *
+ * Parameters read when they are used take the new values into account, the
+ * ones read at initialization are unchanged until the daemon restarts. If the
+ * file cannot be parsed, the previous configuration is kept.
+ */
+void daemon_reload_config(void);
+
+/**
+ * Clean the daemon
+ *
+ * Pending logs are written and logs are emitted synchronously again. Must be
+ * called once the threads of the daemon are joined.
+ */
+void daemon_fini(void);
+
 /**
  * Finished the daemon initialization
  *
@@ -49,6 +49,7 @@ enum dss_type {
     DSS_MEDIA,
     DSS_MEDIA_UPDATE_LOCK,
     DSS_LOGS,
+    DSS_MEDIA_STATS,
     DSS_LAST,
 };
 
@@ -60,11 +61,9 @@ static const char * const dss_type_names[] = {
     [DSS_MEDIA]  = "media",
     [DSS_MEDIA_UPDATE_LOCK]  = "media_update",
     [DSS_LOGS] = "logs",
+    [DSS_MEDIA_STATS] = "media_stats",
 };
 
-#define MAX_UPDATE_LOCK_TRY 5
-#define UPDATE_LOCK_SLEEP_MICRO_SECONDS 5000
-
 /**
  * get dss_type enum from string
  * @param[in]  str  dss_type string representation.
@@ -151,7 +150,6 @@ static struct dss_field_def dss_fields_names[] = {
     {"DSS::EXT::layout_info", "lyt_info"},
     {"DSS::EXT::layout_type", "lyt_info->>'name'"},
     {"DSS::EXT::info", "info"},
-    {"DSS::EXT::media_idx", "extents_mda_idx(extent.extents)"},
     /* Media related fields */
     {"DSS::MDA::family", "family"},
     {"DSS::MDA::model", "model"},
@@ -218,9 +216,13 @@ static inline const char *dss_fields_pub2implem(const char *public_name)
 #define DELETE_ACCESS       (1<<10)
 #define NB_OBJ              (1<<11)
 #define LOGC_SPC_USED       (1<<12)
+#define NB_LOAD_ADD         (1<<13)
+#define NB_ERRORS_ADD       (1<<14)
+#define LAST_LOAD           (1<<15)
 
 #define IS_STAT(_f) ((NB_OBJ | NB_OBJ_ADD | LOGC_SPC_USED | LOGC_SPC_USED_ADD |\
-                      PHYS_SPC_USED | PHYS_SPC_FREE) & (_f))
+                      PHYS_SPC_USED | PHYS_SPC_FREE | NB_LOAD_ADD |         \
+                      NB_ERRORS_ADD | LAST_LOAD) & (_f))
 
 struct dss_filter {
     json_t  *df_json;
@@ -245,6 +247,8 @@ void dss_filter_free(struct dss_filter *filter);
 /* Exposed externally for python bindings generation */
 struct dss_handle {
     void  *dh_conn;
+    void  *dh_pipeline;     /**< Pending pipelined requests, if any */
+    void  *dh_prepared;     /**< Statements prepared from filter templates */
 };
 
 /**
@@ -260,6 +264,105 @@ int dss_init(struct dss_handle *handle);
  */
 void dss_fini(struct dss_handle *handle);
 
+/**
+ * Start pipelining the requests sent on a connection handle.
+ *
+ * Until the matching dss_pipeline_end(), update requests that do not return
+ * any data (dss_*_set, dss_*_insert, dss_*_delete, dss_*_update_*, and
+ * dss_emit_log) are sent to the database without waiting for their result.
+ * They return 0 as soon as the request is sent, their errors being reported by
+ * dss_pipeline_end(). Any other request (get, lock, move...) first waits for
+ * the completion of the pending ones, then runs synchronously.
+ *
+ * The pending requests are applied as a single transaction each time the
+ * pipeline is synchronized: if one fails, none of them is committed.
+ *
+ * Calls can be nested, only the outermost dss_pipeline_end() waits for the
+ * results.
+ *
+ * @param[in,out]   handle  Connection handle
+ * @return 0 on success, negated errno code on failure.
+ */
+int dss_pipeline_begin(struct dss_handle *handle);
+
+/**
+ * Wait for every request pipelined since dss_pipeline_begin() and stop
+ * pipelining requests on \p handle.
+ *
+ * @param[in,out]   handle  Connection handle
+ * @return 0 if all the pipelined requests succeeded, the negated errno code of
+ *         the first one that failed otherwise.
+ */
+int dss_pipeline_end(struct dss_handle *handle);
+
+/**
+ * Tell whether requests sent on \p handle are currently pipelined, ie. whether
+ * dss_pipeline_begin() was called without a matching dss_pipeline_end().
+ */
+bool dss_pipeline_is_active(struct dss_handle *handle);
+
+/**
+ * Function called with the duration in seconds of each request that is run
+ * synchronously on the database, see dss_query_hook_set().
+ */
+typedef void (*dss_query_hook_t)(double duration);
+
+/**
+ * Set the function called after each synchronous request of any handle of the
+ * process, or remove it if \p hook is NULL. Pipelined requests are not
+ * reported.
+ *
+ * The hook is called from the threads running the requests.
+ */
+void dss_query_hook_set(dss_query_hook_t hook);
+
+/**
+ * Pool of DSS connections shared by several threads.
+ *
+ * Connections are opened on demand up to the size of the pool and stay open
+ * when they are given back, to be reused by the next borrower. When every
+ * connection is borrowed, dss_pool_acquire() waits for one to be released,
+ * which bounds the number of connections to the database.
+ */
+struct dss_pool;
+
+/**
+ * Create a pool of at most \p size DSS connections.
+ *
+ * @param[out]  pool    Allocated pool, to be freed with dss_pool_fini()
+ * @param[in]   size    Maximum number of connections open at the same time
+ * @return 0 on success, negated errno code on failure.
+ */
+int dss_pool_init(struct dss_pool **pool, int size);
+
+/**
+ * Close the connections of \p pool and free it. Every borrowed connection
+ * must have been released.
+ */
+void dss_pool_fini(struct dss_pool *pool);
+
+/**
+ * Borrow a connection from \p pool and set it in \p handle, waiting for one
+ * to be released if they are all in use.
+ *
+ * The connection is checked before being handed out, and reopened if the
+ * server closed it.
+ *
+ * @param[in]   pool    Connection pool
+ * @param[out]  handle  Handle to use the connection through
+ * @return 0 on success, negated errno code if no connection could be opened.
+ */
+int dss_pool_acquire(struct dss_pool *pool, struct dss_handle *handle);
+
+/**
+ * Give the connection of \p handle back to \p pool. The handle must not be
+ * used anymore until the next dss_pool_acquire().
+ *
+ * A connection left in a broken state or in a transaction is closed instead
+ * of being kept in the pool.
+ */
+void dss_pool_release(struct dss_pool *pool, struct dss_handle *handle);
+
 /**
  * Retrieve usable devices information from DSS, meaning devices that are
  * unlocked.
@@ -301,6 +404,25 @@ int dss_device_get(struct dss_handle *hdl, const struct dss_filter *filter,
 int dss_media_get(struct dss_handle *hdl, const struct dss_filter *filter,
                   struct media_info **med_ls, int *med_cnt);
 
+/**
+ * Retrieve media with their live and deprecated volume from DSS
+ *
+ * The live and deprecated volumes are maintained by the DSS each time an
+ * object or an extent is added, deprecated or removed, so this does not
+ * depend on the number of extents stored on the media.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   assembled DSS filtering criteria on media
+ * @param[out] med_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] med_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_media_enriched_stats(struct dss_handle *hdl,
+                             const struct dss_filter *filter,
+                             struct enriched_media_stats **med_ls,
+                             int *med_cnt);
+
 /**
  * Retrieve media containing extents of an object from DSS
  * @param[in]  hdl      valid connection handle
@@ -326,6 +448,55 @@ int dss_media_of_object(struct dss_handle *hdl, struct object_info *obj,
 int dss_layout_get(struct dss_handle *hdl, const struct dss_filter *filter,
                    struct layout_info **lyt_ls, int *lyt_cnt);
 
+/**
+ * Retrieve the extents stored on a medium from DSS, sorted by address
+ *
+ * Each retrieved layout only holds the extents located on \p medium, a
+ * layout is returned several times if its extents on \p medium are not
+ * contiguous in address order.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  medium   medium to look for
+ * @param[out] lyt_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] lyt_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_medium_extents_get(struct dss_handle *hdl, const struct pho_id *medium,
+                           struct layout_info **lyt_ls, int *lyt_cnt);
+
+/**
+ * Same as dss_medium_extents_get(), restricted to the synced extents of live
+ * objects: extents of deprecated objects or of layouts being written are left
+ * out.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  medium   medium to look for
+ * @param[out] lyt_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] lyt_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_medium_live_extents_get(struct dss_handle *hdl,
+                                const struct pho_id *medium,
+                                struct layout_info **lyt_ls, int *lyt_cnt);
+
+/**
+ * Retrieve the layouts whose extents can be garbage collected: layouts that
+ * belong to neither an object nor a deprecated object, and layouts left in a
+ * state other than sync by an interrupted transfer.
+ *
+ * All the extents of each layout are retrieved, whatever their medium.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[out] lyt_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] lyt_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_garbage_layouts_get(struct dss_handle *hdl,
+                            struct layout_info **lyt_ls, int *lyt_cnt);
+
 /**
  * Retrieve object information from DSS
  * @param[in]  hdl      valid connection handle
@@ -351,6 +522,97 @@ int dss_deprecated_object_get(struct dss_handle *hdl,
                               const struct dss_filter *filter,
                               struct object_info **obj_ls, int *obj_cnt);
 
+/**
+ * Retrieve the items of type \p type matching a filter template.
+ *
+ * A filter template is written like the filters of dss_filter_build(), except
+ * that string values "$1", "$2", ... are parameter slots filled with
+ * \p params at each call (the value of a $KVINJSON slot is a JSON document).
+ * The template is translated into SQL and prepared on the connection of
+ * \p hdl the first time it is used, later calls with the same template only
+ * bind the new values. Templates should thus have a small number of distinct
+ * shapes, with their values given as parameters.
+ *
+ * Layouts cannot be retrieved this way.
+ *
+ * @param[in]  hdl       valid connection handle
+ * @param[in]  type      type of the items to retrieve
+ * @param[in]  tmpl      filter template
+ * @param[in]  params    values of the parameter slots, in order
+ * @param[in]  n_params  number of values in \p params
+ * @param[out] item_list list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] item_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_template_get(struct dss_handle *hdl, enum dss_type type,
+                     const char *tmpl, const char * const *params,
+                     int n_params, void **item_list, int *item_cnt);
+
+/**
+ * Iterator on the result of a DSS request, retrieving the items by batches
+ * instead of loading the whole result set in memory.
+ */
+struct dss_iter;
+
+/**
+ * Open an iterator on the objects matching a filter
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   assembled DSS filtering criteria
+ * @param[out] iter     iterator to be released w/ dss_iter_close()
+ *
+ * The iterator uses a connection of its own: requests made on \p hdl while
+ * iterating are not seen by the iteration.
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_object_iter_open(struct dss_handle *hdl,
+                         const struct dss_filter *filter,
+                         struct dss_iter **iter);
+
+/**
+ * Open an iterator on the deprecated objects matching a filter
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   assembled DSS filtering criteria
+ * @param[out] iter     iterator to be released w/ dss_iter_close()
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_deprecated_object_iter_open(struct dss_handle *hdl,
+                                    const struct dss_filter *filter,
+                                    struct dss_iter **iter);
+
+/**
+ * Open an iterator on the layouts matching a filter, with all their extents
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   assembled DSS filtering criteria
+ * @param[out] iter     iterator to be released w/ dss_iter_close()
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layout_iter_open(struct dss_handle *hdl,
+                         const struct dss_filter *filter,
+                         struct dss_iter **iter);
+
+/**
+ * Retrieve the next item of an iterator
+ * @param[in]  iter     iterator opened by one of the dss_*_iter_open()
+ * @param[out] item     next item, of the type of the iterator, or NULL if
+ *                      there is no item left
+ *
+ * The item belongs to the iterator and is only valid until the next call to
+ * dss_iter_next() or dss_iter_close().
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_iter_next(struct dss_iter *iter, void **item);
+
+/**
+ * Release an iterator and the resources it holds
+ * @param[in]  iter     iterator to release, may be NULL
+ */
+void dss_iter_close(struct dss_iter *iter);
+
 /**
  * Retrieve logs information from DSS
  *
@@ -435,6 +697,11 @@ int dss_device_update_host(struct dss_handle *hdl, struct dev_info *dev_ls,
  * @param[in]  action   operation code (insert, update, delete)
  * @param[in]  fields   fields to update (ignored for insert and delete)
  *
+ * Stats updates are merged into the stored stats by the database itself, in a
+ * single statement per medium: values of the *_ADD fields are increments added
+ * to the stored values, other stat fields replace them. The stats of \p med_ls
+ * are left untouched.
+ *
  * @return 0 on success, negated errno on failure
  */
 int dss_media_set(struct dss_handle *hdl, struct media_info *med_ls,
@@ -452,6 +719,304 @@ int dss_media_set(struct dss_handle *hdl, struct media_info *med_ls,
 int dss_layout_set(struct dss_handle *hdl, struct layout_info *lyt_ls,
                    int lyt_cnt, enum dss_set_action action);
 
+/**
+ * Build the JSON representation of a layout description, as stored in the
+ * lyt_info column of the extent table.
+ *
+ * @param[in]  desc     layout description to encode
+ *
+ * @return the JSON string, to be freed by the caller, or NULL on failure
+ */
+char *dss_layout_desc_encode(const struct module_desc *desc);
+
+/**
+ * Extract a layout description from its JSON representation.
+ *
+ * @param[out] desc     layout description to fill, to be freed by the caller
+ * @param[in]  json     JSON representation of the description
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layout_desc_decode(struct module_desc *desc, const char *json);
+
+/**
+ * Move extents from a medium to other locations, in a single transaction.
+ *
+ * The extents of each layout of \p lyt_ls, identified by their layout_idx, are
+ * given their new medium and address. An extent is only updated if it is still
+ * located on \p source, extents removed or moved meanwhile are left untouched.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  source   medium the extents are moved from
+ * @param[in]  lyt_ls   layouts holding the moved extents
+ * @param[in]  lyt_cnt  number of items in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layout_extents_move(struct dss_handle *hdl,
+                            const struct pho_id *source,
+                            struct layout_info *lyt_ls, int lyt_cnt);
+
+/** Result of the verification of the checksums of an extent */
+struct extent_scrub {
+    const struct layout_info *layout;   /**< layout of the extent */
+    const struct extent *extent;        /**< verified extent */
+    int rc;                             /**< 0 if the extent matches its
+                                          *  checksums, -EBADMSG if not,
+                                          *  another -errno if it could not
+                                          *  be read
+                                          */
+};
+
+/**
+ * Record the result of the verification of extents, along with the current
+ * time, in a single transaction.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  scrubs   verification results
+ * @param[in]  cnt      number of items in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_extents_scrub_set(struct dss_handle *hdl,
+                          const struct extent_scrub *scrubs, int cnt);
+
+/**
+ * Delete layouts, identified by their uuid and version, along with their
+ * extents, in a single transaction.
+ *
+ * Unlike dss_layout_set() with DSS_SET_DELETE, which removes the layouts of
+ * every version of an object, only the given versions are removed.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  lyt_ls   layouts to delete
+ * @param[in]  lyt_cnt  number of items in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layouts_delete(struct dss_handle *hdl,
+                       const struct layout_info *lyt_ls, int lyt_cnt);
+
+/**
+ * Delete the objects and deprecated objects that have no layout, such as the
+ * ones left by a put that did not complete, and were created or deprecated
+ * more than \p grace_time seconds ago.
+ *
+ * @param[in]  hdl          valid connection handle
+ * @param[in]  grace_time   minimum age of the deleted objects, in seconds
+ * @param[out] cnt          number of deleted objects
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layoutless_objects_delete(struct dss_handle *hdl,
+                                  unsigned int grace_time, int *cnt);
+
+/**
+ * Insert synced layouts, their extents and the objects they belong to, in a
+ * single transaction. Rows that already exist are left untouched.
+ *
+ * \p obj_ls[i] describes the object version stored by \p lyt_ls[i]. The
+ * caller chooses the live object of each oid: versions with a zero deprec_time
+ * become objects, the other ones deprecated objects, as does a live version
+ * whose oid already has another object.
+ *
+ * Unlike dss_layout_set(), extents keep their own layout_idx, so that a layout
+ * some extents of which are missing can be inserted.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  obj_ls   objects of the layouts
+ * @param[in]  lyt_ls   layouts to insert
+ * @param[in]  cnt      number of items in both lists
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layouts_import(struct dss_handle *hdl,
+                       const struct object_info *obj_ls,
+                       const struct layout_info *lyt_ls, int cnt);
+
+/**
+ * Record that the layout of an object was written on a staging family and
+ * has to be flushed to \p family, on media matching \p tags.
+ *
+ * The layout is identified by the oid of \p layout, as the current version of
+ * the object, like when it is inserted by dss_layout_set(). The request is
+ * queued on the pipeline of \p hdl if one is active.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  layout   staged layout, already inserted
+ * @param[in]  family   family the layout is flushed to
+ * @param[in]  tags     tags the destination media are selected with
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layout_staging_set(struct dss_handle *hdl,
+                           const struct layout_info *layout,
+                           enum rsc_family family, const struct tags *tags);
+
+/** Staged extents of a medium that are flushed to the same destination */
+struct staging_group {
+    struct pho_id medium;       /**< staging medium holding the extents */
+    enum rsc_family family;     /**< family the extents are flushed to */
+    struct tags tags;           /**< tags the destination is selected with */
+};
+
+/**
+ * Retrieve the media holding staged extents, grouped by flush destination.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[out] groups   groups to free with dss_staging_groups_free()
+ * @param[out] cnt      number of groups
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_staging_groups_get(struct dss_handle *hdl,
+                           struct staging_group **groups, int *cnt);
+
+/** Free the groups retrieved by dss_staging_groups_get(). */
+void dss_staging_groups_free(struct staging_group *groups, int cnt);
+
+/**
+ * Retrieve the synced staged extents of a staging group, in the same way as
+ * dss_medium_extents_get().
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  group    staging medium and destination to look for
+ * @param[out] lyt_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] lyt_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_staging_layouts_get(struct dss_handle *hdl,
+                            const struct staging_group *group,
+                            struct layout_info **lyt_ls, int *lyt_cnt);
+
+/**
+ * Forget the staging of the layouts of \p lyt_ls whose extents all are on
+ * their destination family.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  lyt_ls   flushed layouts
+ * @param[in]  lyt_cnt  number of items in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_staging_clear(struct dss_handle *hdl,
+                      const struct layout_info *lyt_ls, int lyt_cnt);
+
+/**
+ * Save the content of a layout stored in the database, see
+ * dss_layout_staging_set() for the identification of the layout.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  layout   inline layout, already inserted
+ * @param[in]  data     content of the object
+ * @param[in]  size     size of \p data
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_layout_inline_set(struct dss_handle *hdl,
+                          const struct layout_info *layout,
+                          const void *data, size_t size);
+
+/**
+ * Retrieve the content of a layout stored in the database.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  layout   inline layout, identified by its uuid and version
+ * @param[out] data     content of the object, to be freed w/ free()
+ * @param[out] size     size of \p data
+ *
+ * @return 0 on success, -ENOENT if the layout has no content, negated errno
+ *         on failure
+ */
+int dss_layout_inline_get(struct dss_handle *hdl,
+                          const struct layout_info *layout,
+                          void **data, size_t *size);
+
+/** Data a deduplicated PUT looks for */
+struct dedup_filter {
+    unsigned char xxh128[16];   /**< XXH128 of the whole data */
+    ssize_t size;               /**< size of the data */
+    enum rsc_family family;     /**< family of the media holding the data */
+    const struct tags *tags;    /**< tags of these media */
+    const char *repl_count;     /**< number of copies of the data */
+};
+
+/**
+ * Retrieve a layout holding the data described by \p filter, so that a new
+ * object can share its extents instead of writing the data again: a synced,
+ * uncompressed raid1 layout of a live or deprecated object, whose extents are
+ * all copies of the whole data.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   data to look for
+ * @param[out] layout   layout found, to be freed w/ dss_res_free()
+ *
+ * @return 0 on success, -ENOENT if there is none, negated errno on failure
+ */
+int dss_layout_dedup_get(struct dss_handle *hdl,
+                         const struct dedup_filter *filter,
+                         struct layout_info **layout);
+
+/**
+ * Count the extents located at \p address on \p medium: the extents of
+ * deduplicated objects are shared by several layouts, and their data must be
+ * kept on the medium as long as one of them refers to it.
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  medium   medium of the extent
+ * @param[in]  address  address of the extent on \p medium
+ * @param[out] count    number of layout extents referring to it
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_extent_refcount_get(struct dss_handle *hdl,
+                            const struct pho_id *medium, const char *address,
+                            int *count);
+
+/** Objects selected by a tiering rule */
+struct tier_filter {
+    enum rsc_family family;     /**< family the extents are migrated from */
+    long min_age;               /**< minimal age of the objects, in seconds */
+    ssize_t min_size;           /**< minimal object size, -1 for no bound */
+    ssize_t max_size;           /**< maximal object size, -1 for no bound */
+    const char *user_md;        /**< JSON the user_md of the objects contain,
+                                  *  NULL for any */
+    const struct tags *tags;    /**< tags the source media have, NULL for
+                                  *  any */
+};
+
+/**
+ * Retrieve the media holding synced extents of the live objects matching
+ * \p filter. Staged objects are left to dss_staging_groups_get().
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   objects to look for
+ * @param[out] media    list of media to be freed w/ free()
+ * @param[out] cnt      number of media in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_tier_media_get(struct dss_handle *hdl, const struct tier_filter *filter,
+                       struct pho_id **media, int *cnt);
+
+/**
+ * Retrieve the extents of \p medium that belong to the objects matching
+ * \p filter, in the same way as dss_medium_extents_get().
+ *
+ * @param[in]  hdl      valid connection handle
+ * @param[in]  filter   objects to look for
+ * @param[in]  medium   medium holding the extents
+ * @param[out] lyt_ls   list of retrieved items to be freed w/ dss_res_free()
+ * @param[out] lyt_cnt  number of items retrieved in the list
+ *
+ * @return 0 on success, negated errno on failure
+ */
+int dss_tier_layouts_get(struct dss_handle *hdl,
+                         const struct tier_filter *filter,
+                         const struct pho_id *medium,
+                         struct layout_info **lyt_ls, int *lyt_cnt);
+
 /**
  * Store information for one or many objects in DSS.
  * @param[in]  hdl      valid connection handle
@@ -563,9 +1128,8 @@ int dss_object_move(struct dss_handle *handle, enum dss_type type_from,
 /**
  * Take locks.
  *
- * If any lock cannot be taken, then the ones that already are will be
- * forcefully unlocked, and the function will not try to lock any other
- * ressource (all-or-nothing policy).
+ * All locks are taken by a single statement: if any lock cannot be taken,
+ * none of them is (all-or-nothing policy).
  *
  * @param[in]   handle          DSS handle.
  * @param[in]   type            Type of the ressources to lock.
@@ -582,9 +1146,8 @@ int dss_lock(struct dss_handle *handle, enum dss_type type,
 /**
  * Take locks on a specific hostname.
  *
- * If any lock cannot be taken, then the ones that already are will be
- * forcefully unlocked, and the function will not try to lock any other
- * ressource (all-or-nothing policy).
+ * All locks are taken by a single statement: if any lock cannot be taken,
+ * none of them is (all-or-nothing policy).
  *
  * @param[in]   handle          DSS handle.
  * @param[in]   type            Type of the resources to lock.
@@ -603,9 +1166,9 @@ int dss_lock_hostname(struct dss_handle *handle, enum dss_type type,
 /**
  * Refresh lock timestamps.
  *
- * The function will attempt to refresh as many locks as possible. Should any
- * refresh fail, the first error code obtained will be returned after
- * attempting to refresh all other locks (as-much-as-possible policy).
+ * All locks are refreshed by a single statement, which refreshes as many locks
+ * as possible. Should any refresh fail, the first error code obtained is
+ * returned (as-much-as-possible policy).
  *
  * @param[in]   handle          DSS handle.
  * @param[in]   type            Type of the ressources's lock to refresh.
@@ -625,9 +1188,9 @@ int dss_lock_refresh(struct dss_handle *handle, enum dss_type type,
  * If \p force_unlock is true, the lock's hostname and owner are not matched
  * against the caller's.
  *
- * The function will attempt to unlock as many locks as possible. Should any
- * unlock fail, the first error code obtained will be returned after
- * attempting to unlock all other locks (as-much-as-possible policy).
+ * All locks are released by a single statement, which releases as many locks
+ * as possible. Should any unlock fail, the first error code obtained is
+ * returned (as-much-as-possible policy).
  *
  * @param[in]   handle          DSS handle.
  * @param[in]   type            Type of the ressources to unlock.
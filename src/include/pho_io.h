@@ -82,6 +82,8 @@ struct pho_io_adapter_module_ops {
     ssize_t (*ioa_preferred_io_size)(struct pho_io_descr *iod);
     int (*ioa_set_md)(const char *extent_key, const char *extent_desc,
                       struct pho_io_descr *iod);
+    int (*ioa_extent_position)(const struct pho_ext_loc *loc,
+                               uint64_t *position);
 };
 
 struct io_adapter_module {
@@ -95,6 +97,23 @@ struct io_adapter_module {
  */
 int get_io_adapter(enum fs_type fstype, struct io_adapter_module **ioa);
 
+/**
+ * Retrieve the references that deduplicated object versions recorded on an
+ * extent, named PHO_EA_REF_NAME and their number (see pho_layout.h).
+ *
+ * \param[in]   ioa     Suitable I/O adapter for the medium of the extent.
+ * \param[in]   loc     Location of the extent.
+ * \param[out]  refs    References found, keyed by their name, to be freed with
+ *                      pho_attrs_free().
+ * \param[out]  n_refs  Number of references found, which is the number of the
+ *                      next one.
+ *
+ * \return 0 on success, negative error code on failure
+ */
+int get_extent_refs(const struct io_adapter_module *ioa,
+                    struct pho_ext_loc *loc, struct pho_attrs *refs,
+                    int *n_refs);
+
 /**
  * Get an object from a media.
  * All I/O adapters must implement this call.
@@ -169,6 +188,31 @@ static inline int ioa_medium_sync(const struct io_adapter_module *ioa,
     return ioa->ops->ioa_medium_sync(root_path);
 }
 
+/**
+ * Retrieve the position of an extent on its medium, so that several extents
+ * can be read in on-media order.
+ * I/O adapters may implement this call.
+ *
+ * \param[in]   ioa         Suitable I/O adapter for the media
+ * \param[in]   loc         Location of the extent
+ * \param[out]  position    Position of the extent, extents with increasing
+ *                          positions are read without seeking back
+ *
+ * \retval -ENOTSUP the I/O adapter does not provide this function
+ * \return 0 on success, negative error code on failure
+ */
+static inline int ioa_extent_position(const struct io_adapter_module *ioa,
+                                      const struct pho_ext_loc *loc,
+                                      uint64_t *position)
+{
+    assert(ioa != NULL);
+    assert(ioa->ops != NULL);
+    if (ioa->ops->ioa_extent_position == NULL)
+        return -ENOTSUP;
+
+    return ioa->ops->ioa_extent_position(loc, position);
+}
+
 /**
  * Retrieves the preferred IO size for the given IO descriptor.
  *
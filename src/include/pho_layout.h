@@ -41,6 +41,33 @@
  */
 #define PLM_OP_INIT         "pho_layout_mod_register"
 
+/**
+ * Names of the extended attributes set by layout modules on each extent, so
+ * that extents are self-described. They are carried along when an extent is
+ * moved to another medium.
+ *
+ * PHO_EA_CTIME_NAME is the time the extent was written, in microseconds since
+ * the Epoch, which orders the generations of an oid that was deleted and put
+ * again.
+ *
+ * The extents of a deduplicated object version are the ones of the version
+ * that wrote its data: the version is recorded on them as a reference,
+ * "ref.<n>" with n numbered from 0, holding its PHO_EA_ID_NAME,
+ * PHO_EA_UUID_NAME, PHO_EA_VERSION_NAME, PHO_EA_CTIME_NAME and PHO_EA_UMD_NAME
+ * attributes as a JSON object.
+ */
+#define PHO_EA_ID_NAME          "id"
+#define PHO_EA_UUID_NAME        "uuid"
+#define PHO_EA_VERSION_NAME     "version"
+#define PHO_EA_CTIME_NAME       "ctime"
+#define PHO_EA_LAYOUT_NAME      "layout"
+#define PHO_EA_LAYOUT_IDX_NAME  "layout_idx"
+#define PHO_EA_UMD_NAME         "user_md"
+#define PHO_EA_MD5_NAME         "md5"
+#define PHO_EA_XXH128_NAME      "xxh128"
+#define PHO_EA_CRC32C_NAME      "crc32c"
+#define PHO_EA_REF_NAME         "ref."
+
 struct pho_io_descr;
 struct layout_info;
 
@@ -64,7 +64,7 @@ typedef PhoResponse__Error          pho_resp_error_t;
  * If the protocol version is greater than 127, need to increase its size
  * to an integer size (4 bytes).
  */
-#define PHO_PROTOCOL_VERSION      6
+#define PHO_PROTOCOL_VERSION      7
 /**
  * Protocol version size in bytes.
  */
@@ -100,6 +100,21 @@ static inline bool pho_request_is_read(const pho_req_t *req)
     return req->ralloc != NULL;
 }
 
+/**
+ * Request mixed alloc checker.
+ *
+ * A mixed alloc request is also a read alloc one and a write alloc one.
+ *
+ * \param[in]       req         Request.
+ *
+ * \return                      true if the request is a mixed alloc one,
+ *                              false else.
+ */
+static inline bool pho_request_is_mixed(const pho_req_t *req)
+{
+    return req->walloc != NULL && req->ralloc != NULL;
+}
+
 /**
  * Request release checker.
  *
@@ -203,6 +218,19 @@ static inline bool pho_response_is_read(const pho_resp_t *resp)
     return resp->ralloc != NULL;
 }
 
+/**
+ * Response mixed alloc checker.
+ *
+ * \param[in]       resp        Response.
+ *
+ * \return                      true if the response is a mixed alloc one,
+ *                              false else.
+ */
+static inline bool pho_response_is_mixed(const pho_resp_t *resp)
+{
+    return resp->walloc != NULL && resp->ralloc != NULL;
+}
+
 /**
  * Response release checker.
  *
@@ -350,6 +378,23 @@ int pho_srl_request_write_alloc(pho_req_t *req, size_t n_media, size_t *n_tags);
  */
 int pho_srl_request_read_alloc(pho_req_t *req, size_t n_media);
 
+/**
+ * Allocation of mixed request contents, reading some media while writing on
+ * others.
+ *
+ * \param[out]      req            Pointer to the request data structure.
+ * \param[in]       n_read_media   Number of media targeted by the read part
+ *                                 of the request.
+ * \param[in]       n_write_media  Number of media targeted by the write part
+ *                                 of the request.
+ * \param[in]       n_tags         Array which contains, for each medium to
+ *                                 write, the number of tags it is defined by.
+ *
+ * \return                         0 on success, -ENOMEM on failure.
+ */
+int pho_srl_request_mixed_alloc(pho_req_t *req, size_t n_read_media,
+                                size_t n_write_media, size_t *n_tags);
+
 /**
  * Allocation of release request contents.
  *
@@ -434,6 +479,18 @@ int pho_srl_response_write_alloc(pho_resp_t *resp, size_t n_media);
  */
 int pho_srl_response_read_alloc(pho_resp_t *resp, size_t n_media);
 
+/**
+ * Allocation of mixed response contents.
+ *
+ * \param[out]      resp           Pointer to the response data structure.
+ * \param[in]       n_read_media   Number of media allocated for reading.
+ * \param[in]       n_write_media  Number of media allocated for writing.
+ *
+ * \return                         0 on success, -ENOMEM on failure.
+ */
+int pho_srl_response_mixed_alloc(pho_resp_t *resp, size_t n_read_media,
+                                 size_t n_write_media);
+
 /**
  * Allocation of release response contents.
  *
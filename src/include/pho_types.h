@@ -384,6 +384,9 @@ struct extent {
     bool                with_md5;   /**< true if extent md5 field is set */
     unsigned char       md5[MD5_BYTE_LENGTH];
                                     /**< MD5 checksum */
+    bool                with_crc32c;
+                                    /**< true if extent crc32c field is set */
+    unsigned char       crc32c[4];  /**< CRC32C checksum, big endian */
 };
 
 /**
@@ -503,6 +506,21 @@ struct media_info {
     struct operation_flags flags;        /**< Media operation flags */
 };
 
+/**
+ * Media information enriched with the volume of the objects it holds
+ */
+struct enriched_media_stats {
+    struct pho_resource    rsc;             /**< Name and adm_status */
+    enum fs_status         fs_status;       /**< Filesystem status */
+    struct media_stats     stats;           /**< Usage metrics */
+    ssize_t                live_size;       /**< Size of live extents */
+    long long              live_count;      /**< Number of live extents */
+    ssize_t                deprec_size;     /**< Size of deprecated extents */
+    long long              deprec_count;    /**< Number of deprecated
+                                              *  extents
+                                              */
+};
+
 struct object_info {
     char *oid;
     char *uuid;
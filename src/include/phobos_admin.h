@@ -199,6 +199,19 @@ int phobos_admin_device_unlock(struct admin_handle *adm, struct pho_id *dev_ids,
 int phobos_admin_device_status(struct admin_handle *adm, enum rsc_family family,
                                char **status);
 
+/**
+ * Query the trace of the last requests handled by the LRS.
+ *
+ * @param[in]  adm     Admin module handler.
+ * @param[out] trace   allocated JSON string containing the traced events,
+ *                     from the oldest to the most recent one
+ *
+ * @return             0 on success, negative error on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_lrs_trace(struct admin_handle *adm, char **trace);
+
 /**
  * Migrate given devices to a new host.
  *
@@ -306,6 +319,57 @@ int phobos_admin_layout_list(struct admin_handle *adm, const char **res,
  */
 void phobos_admin_layout_list_free(struct layout_info *layouts, int n_layouts);
 
+struct dss_iter;
+
+/**
+ * Open an iterator on the layouts of objects whose IDs match the given name or
+ * pattern, with the same filtering as phobos_admin_layout_list().
+ *
+ * Layouts are retrieved by batches, so that the memory used does not depend
+ * on the number of listed layouts.
+ *
+ * The caller must release the iterator calling
+ * phobos_admin_layout_list_iter_free().
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       res             Objids or patterns, depending on
+ *                                  \a is_pattern.
+ * \param[in]       n_res           Number of resources requested.
+ * \param[in]       is_pattern      True if search done using POSIX pattern.
+ * \param[in]       medium          Single medium filter.
+ * \param[out]      iter            Iterator on the retrieved layouts.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_layout_list_iter(struct admin_handle *adm, const char **res,
+                                  int n_res, bool is_pattern,
+                                  const char *medium, struct dss_iter **iter);
+
+/**
+ * Retrieve the next layout of an iterator.
+ *
+ * \param[in]       iter            Iterator opened with
+ *                                  phobos_admin_layout_list_iter().
+ * \param[out]      layout          Next layout, NULL if there is none left.
+ *                                  It is only valid until the next call on
+ *                                  \a iter.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ */
+int phobos_admin_layout_list_next(struct dss_iter *iter,
+                                  struct layout_info **layout);
+
+/**
+ * Release an iterator opened with phobos_admin_layout_list_iter().
+ *
+ * \param[in]       iter            Iterator to release.
+ */
+void phobos_admin_layout_list_iter_free(struct dss_iter *iter);
+
 /**
  * Retrieve the name of the node which holds a medium or NULL if any node can
  * access this media.
@@ -322,6 +386,153 @@ int phobos_admin_medium_locate(struct admin_handle *adm,
                                const struct pho_id *medium_id,
                                char **node_name);
 
+/**
+ * Move the live extents of a medium to other media of the same family.
+ *
+ * Put access is first disabled on \p source. Its live extents are then copied,
+ * by batches, to media allocated by the LRS, and the DSS is updated once per
+ * batch. Extents of deprecated objects are left on \p source, as are the old
+ * copies of moved extents, until the medium is formatted again.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       source          ID of the medium to repack.
+ * \param[in]       tags            Tags the destination media must have, or
+ *                                  NULL.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_repack(struct admin_handle *adm, const struct pho_id *source,
+                        const struct tags *tags);
+
+/**
+ * Verify the checksums of the extents stored on a medium.
+ *
+ * The synced extents of \p medium are read by batches allocated by the LRS,
+ * and their checksums are compared to the ones recorded in the DSS. The result
+ * of each verification is recorded in the DSS. Extents are read in on-media
+ * order on LTFS, by start block, and in address order on other media.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       medium          ID of the medium to scrub.
+ * \param[in]       bandwidth       Maximum read throughput in bytes per
+ *                                  second, 0 for no limit.
+ * \param[in]       iops            Maximum number of extents verified per
+ *                                  second, 0 for no limit.
+ * \param[out]      n_corrupted     Number of extents whose checksums do not
+ *                                  match.
+ * \param[out]      n_unreadable    Number of extents that could not be read.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_scrub(struct admin_handle *adm, const struct pho_id *medium,
+                       size_t bandwidth, unsigned int iops, int *n_corrupted,
+                       int *n_unreadable);
+
+/**
+ * Remove the extents that no object refers to anymore.
+ *
+ * The extents of layouts that belong to neither an object nor a deprecated
+ * object, or that were left unsynced, are removed from their media, one
+ * allocation per medium, then their layouts are deleted from the DSS. Objects
+ * left without layout by interrupted puts are deleted too.
+ *
+ * If \p scan is set, the files of POSIX and LTFS media that are unknown to the
+ * DSS are removed as well, which requires every such medium to be mounted.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       grace_time      Minimum age, in seconds, of the removed
+ *                                  files and objects, so that transfers still
+ *                                  running are not collected.
+ * \param[in]       scan            Whether media are scanned for files unknown
+ *                                  to the DSS.
+ * \param[out]      n_extents       Number of extents and files removed.
+ * \param[out]      n_objects       Number of objects without layout deleted.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_gc(struct admin_handle *adm, unsigned int grace_time,
+                    bool scan, int *n_extents, int *n_objects);
+
+/**
+ * Rebuild the DSS rows of the objects stored on media from the extended
+ * attributes of their extents.
+ *
+ * The media, which must already be added to the DSS, are allocated by batches
+ * of \p parallel and scanned by one thread each. Blank media are first marked
+ * as formatted, as they are when the DSS is rebuilt. The layouts found are
+ * then inserted in bulk, along with their objects: the highest version of the
+ * last written uuid of each oid becomes the object, the other ones deprecated
+ * objects. Rows already in the DSS are left untouched.
+ *
+ * Only POSIX and LTFS media can be imported, and only the extents written
+ * along with their uuid, version and layout attributes.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       media           IDs of the media to import.
+ * \param[in]       n_media         Number of media in \p media.
+ * \param[in]       parallel        Maximum number of media scanned at once.
+ * \param[out]      n_objects       Number of object versions imported.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_import(struct admin_handle *adm, const struct pho_id *media,
+                        int n_media, unsigned int parallel, int *n_objects);
+
+/**
+ * Flush the objects written on the staging family to their own family.
+ *
+ * The staged extents are grouped by staging medium and destination, then
+ * copied by large batches, each batch to a single medium allocated by the
+ * LRS and synced once. The location of the extents of a batch is switched in
+ * a single DSS transaction, after which their staged copies are removed.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[out]      n_flushed       Number of extents flushed.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_flush(struct admin_handle *adm, int *n_flushed);
+
+/**
+ * Apply tiering rules, migrating objects between families.
+ *
+ * Each rule is defined by a [tier "<name>"] section of the configuration,
+ * selecting the live objects of its 'source' family by age ('min_age' in
+ * seconds), size ('min_size' and 'max_size' in bytes) and user metadata
+ * ('user_md', a JSON object they must contain). Their extents are migrated
+ * medium per medium to media of the 'target' family matching 'tags', by
+ * batches synced once, as for phobos_admin_flush(). A rule within a family
+ * only migrates the objects of the media matching its 'source_tags'.
+ *
+ * \param[in]       adm             Admin module handler.
+ * \param[in]       rules           Names of the rules to apply, in order.
+ * \param[in]       n_rules         Number of rules, 0 to apply the 'rules' of
+ *                                  the [tiering] section.
+ * \param[out]      n_migrated      Number of extents migrated.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called with an admin_handle initialized with phobos_admin_init.
+ */
+int phobos_admin_tier(struct admin_handle *adm, char **rules, int n_rules,
+                      int *n_migrated);
+
 /**
  * Clean locks
  *
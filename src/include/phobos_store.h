@@ -370,4 +370,57 @@ int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
  */
 void phobos_store_object_list_free(struct object_info *objs, int n_objs);
 
+struct dss_iter;
+
+/**
+ * Open an iterator on the objects that match the given pattern and metadata,
+ * with the same filtering as phobos_store_object_list().
+ *
+ * Objects are retrieved by batches, so that the memory used does not depend
+ * on the number of listed objects.
+ *
+ * The caller must release the iterator calling
+ * phobos_store_object_list_iter_free().
+ *
+ * \param[in]       res             Objids or patterns, depending on
+ *                                  \a is_pattern.
+ * \param[in]       n_res           Number of requested objids or patterns.
+ * \param[in]       is_pattern      True if search using POSIX pattern.
+ * \param[in]       metadata        Metadata filter.
+ * \param[in]       n_metadata      Number of requested metadata.
+ * \param[in]       deprecated      true if search from deprecated objects.
+ * \param[out]      iter            Iterator on the retrieved objects.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ *
+ * This must be called after phobos_init.
+ */
+int phobos_store_object_list_iter(const char **res, int n_res,
+                                  bool is_pattern, const char **metadata,
+                                  int n_metadata, bool deprecated,
+                                  struct dss_iter **iter);
+
+/**
+ * Retrieve the next object of an iterator.
+ *
+ * \param[in]       iter            Iterator opened with
+ *                                  phobos_store_object_list_iter().
+ * \param[out]      obj             Next object, NULL if there is none left.
+ *                                  It is only valid until the next call on
+ *                                  \a iter.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ */
+int phobos_store_object_list_next(struct dss_iter *iter,
+                                  struct object_info **obj);
+
+/**
+ * Release an iterator opened with phobos_store_object_list_iter().
+ *
+ * \param[in]       iter            Iterator to release.
+ */
+void phobos_store_object_list_iter_free(struct dss_iter *iter);
+
 #endif
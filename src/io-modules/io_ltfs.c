@@ -27,6 +27,7 @@
 #include "pho_module_loader.h"
 
 #include <attr/xattr.h>
+#include <stdlib.h>
 #include <sys/types.h>
 
 #define PLUGIN_NAME     "ltfs"
@@ -40,6 +41,7 @@ static struct module_desc IO_ADAPTER_LTFS_MODULE_DESC = {
 };
 
 #define LTFS_SYNC_ATTR_NAME "user.ltfs.sync"
+#define LTFS_STARTBLOCK_ATTR_NAME "user.ltfs.startblock"
 
 static int pho_ltfs_sync(const char *root_path)
 {
@@ -56,6 +58,40 @@ static int pho_ltfs_sync(const char *root_path)
     return 0;
 }
 
+/** Position of an extent: the tape block its data starts at */
+static int pho_ltfs_extent_position(const struct pho_ext_loc *loc,
+                                    uint64_t *position)
+{
+    char buff[32];
+    char *fpath;
+    int64_t block;
+    ssize_t len;
+    int rc = 0;
+
+    ENTRY;
+
+    fpath = pho_posix_fullpath(loc);
+    if (fpath == NULL)
+        return -EINVAL;
+
+    len = getxattr(fpath, LTFS_STARTBLOCK_ATTR_NAME, buff, sizeof(buff) - 1);
+    if (len < 0)
+        LOG_GOTO(free_path, rc = -errno, "failed to get LTFS special xattr "
+                 LTFS_STARTBLOCK_ATTR_NAME " of '%s'", fpath);
+
+    buff[len] = '\0';
+    block = str2int64(buff);
+    if (block < 0)
+        LOG_GOTO(free_path, rc = -EINVAL, "invalid start block '%s' of '%s'",
+                 buff, fpath);
+
+    *position = block;
+
+free_path:
+    free(fpath);
+    return rc;
+}
+
 /** LTFS adapter */
 static const struct pho_io_adapter_module_ops IO_ADAPTER_LTFS_OPS = {
     .ioa_get               = pho_posix_get,
@@ -66,6 +102,7 @@ static const struct pho_io_adapter_module_ops IO_ADAPTER_LTFS_OPS = {
     .ioa_medium_sync       = pho_ltfs_sync,
     .ioa_preferred_io_size = pho_posix_preferred_io_size,
     .ioa_set_md            = pho_posix_set_md,
+    .ioa_extent_position   = pho_ltfs_extent_position,
 };
 
 /** IO adapter module registration entry point */
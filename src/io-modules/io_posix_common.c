@@ -63,7 +63,7 @@ static struct posix_io_ctx *alloc_posix_io_ctx(void)
 }
 
 /** build the full posix path from a pho_ext_loc structure */
-static char *pho_posix_fullpath(const struct pho_ext_loc *loc)
+char *pho_posix_fullpath(const struct pho_ext_loc *loc)
 {
     char *p;
 
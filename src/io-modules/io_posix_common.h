@@ -55,4 +55,6 @@ int build_addr_path(const char *extent_key, const char *extent_desc,
 
 char *full_xattr_name(const char *name);
 
+char *pho_posix_fullpath(const struct pho_ext_loc *loc);
+
 #endif
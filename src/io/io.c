@@ -26,8 +26,11 @@
 
 #include "pho_common.h"
 #include "pho_io.h"
+#include "pho_layout.h"
 #include "pho_module_loader.h"
 
+#include <stdio.h>
+
 /** retrieve IO functions for the given filesystem and addressing type */
 int get_io_adapter(enum fs_type fstype, struct io_adapter_module **ioa)
 {
@@ -53,3 +56,42 @@ int get_io_adapter(enum fs_type fstype, struct io_adapter_module **ioa)
 
     return rc;
 }
+
+int get_extent_refs(const struct io_adapter_module *ioa,
+                    struct pho_ext_loc *loc, struct pho_attrs *refs,
+                    int *n_refs)
+{
+    int rc = 0;
+
+    *n_refs = 0;
+
+    /* references are numbered without gap, the first missing one ends them */
+    while (true) {
+        struct pho_io_descr iod = {0};
+        const char *value = NULL;
+        char name[32];
+
+        snprintf(name, sizeof(name), PHO_EA_REF_NAME "%d", *n_refs);
+        rc = pho_attr_set(&iod.iod_attrs, name, NULL);
+        if (rc)
+            break;
+
+        iod.iod_flags = PHO_IO_MD_ONLY;
+        iod.iod_loc = loc;
+        rc = ioa_get(ioa, NULL, NULL, &iod);
+        if (!rc)
+            value = pho_attr_get(&iod.iod_attrs, name);
+        if (value)
+            rc = pho_attr_set(refs, name, value);
+        pho_attrs_free(&iod.iod_attrs);
+        if (rc || !value)
+            break;
+
+        (*n_refs)++;
+    }
+
+    if (rc)
+        pho_attrs_free(refs);
+
+    return rc;
+}
@@ -29,14 +29,19 @@
 #include <assert.h>
 #include <errno.h>
 #include <glib.h>
-#include <openssl/evp.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/time.h>
 #include <unistd.h>
-#include <xxhash.h>
 
 #include "pho_attrs.h"
 #include "pho_cfg.h"
+#include "pho_checksum.h"
 #include "pho_common.h"
+#include "pho_compress.h"
 #include "pho_dss.h"
 #include "pho_io.h"
 #include "pho_layout.h"
@@ -47,15 +52,14 @@
 
 /* @FIXME: taken from store.c, will be needed in raid1 too */
 #define PHO_ATTR_BACKUP_JSON_FLAGS (JSON_COMPACT | JSON_SORT_KEYS)
-#define PHO_EA_ID_NAME      "id"
-#define PHO_EA_UMD_NAME     "user_md"
-#define PHO_EA_MD5_NAME     "md5"
-#define PHO_EA_XXH128_NAME  "xxh128"
 
 #define PLUGIN_NAME     "raid1"
 #define PLUGIN_MAJOR    0
 #define PLUGIN_MINOR    2
 
+/** Size of the buffer extents are read into when they are verified */
+#define VERIFY_BUF_SIZE (1024 * 1024)
+
 static struct module_desc RAID1_MODULE_DESC = {
     .mod_name  = PLUGIN_NAME,
     .mod_major = PLUGIN_MAJOR,
@@ -88,6 +92,13 @@ static struct module_desc RAID1_MODULE_DESC = {
  *
  * To put an object of a written size of 0, we create an extent of null size to
  * really have a residual null size object on media.
+ *
+ * If the layout is compressed, the data is compressed as a single stream
+ * which is split on the extents instead of the data itself. The extents and
+ * their checksums then describe the compressed stream, and to_write only
+ * counts the data not read yet.
+ *
+ * The CRC32C of the extents, when recorded, is verified as they are read.
  */
 struct raid1_encoder {
     unsigned int repl_count;
@@ -125,20 +136,27 @@ struct raid1_encoder {
     size_t n_released_media;
 
     /**
-     *  A ready to use context to compute XXH128 when needed.
-     *  NULL if not used.
+     *  Ready to use contexts to compute XXH128, MD5 and CRC32C when needed.
+     *  Their fields are NULL if not used. Decoders only compute CRC32C.
      */
-    #ifdef HAVE_XXH128
-        XXH3_state_t *xxh128state;
-    #else
-        void *xxh128state;
-    #endif
+    struct pho_checksum checksum;
 
-    /**
-     *  A ready to use context to compute MD5 when needed.
-     *  NULL if not used.
-     */
-    EVP_MD_CTX *md5ctx;
+    /* The following fields are only used when the data is compressed */
+    struct pho_compress compress;   /**< PHO_CODEC_NONE if not compressed */
+    struct pho_compress_in in;      /**< Data read, not compressed yet, or
+                                      *  extent being verified
+                                      */
+    size_t in_buf_size;             /**< Allocated size of in.buf */
+    struct pho_compress_out out;    /**< Data compressed, from out_sent to
+                                      *  out.pos not written yet
+                                      */
+    size_t out_sent;
+    bool compress_ended;            /**< The whole stream has been produced */
+    unsigned int compress_ratio;    /**< Expected compressed size, in percent
+                                      *  of the data size
+                                      */
+    size_t raw_size;                /**< Decoder: size of the data */
+    size_t raw_read;                /**< Decoder: data decompressed so far */
 };
 
 /**
@@ -149,10 +167,14 @@ enum pho_cfg_params_raid1 {
     PHO_CFG_LYT_RAID1_repl_count,
     PHO_CFG_LYT_RAID1_extent_xxh128,
     PHO_CFG_LYT_RAID1_extent_md5,
+    PHO_CFG_LYT_RAID1_extent_crc32c,
+    PHO_CFG_LYT_RAID1_compression,
+    PHO_CFG_LYT_RAID1_compression_level,
+    PHO_CFG_LYT_RAID1_compression_ratio,
 
     /* Delimiters, update when modifying options */
     PHO_CFG_LYT_RAID1_FIRST = PHO_CFG_LYT_RAID1_repl_count,
-    PHO_CFG_LYT_RAID1_LAST  = PHO_CFG_LYT_RAID1_extent_md5,
+    PHO_CFG_LYT_RAID1_LAST  = PHO_CFG_LYT_RAID1_compression_ratio,
 };
 
 const struct pho_config_item cfg_lyt_raid1[] = {
@@ -179,6 +201,26 @@ const struct pho_config_item cfg_lyt_raid1[] = {
         .value   = "yes" /* extent MD5 calculation is set if XXH128 is unset */
 #endif
     },
+    [PHO_CFG_LYT_RAID1_extent_crc32c] = {
+        .section = "layout_raid1",
+        .name    = EXTENT_CRC32C_ATTR_KEY,
+        .value   = "no"  /* extent CRC32C calculation is unset by default */
+    },
+    [PHO_CFG_LYT_RAID1_compression] = {
+        .section = "layout_raid1",
+        .name    = COMPRESSION_ATTR_KEY,
+        .value   = "none"
+    },
+    [PHO_CFG_LYT_RAID1_compression_level] = {
+        .section = "layout_raid1",
+        .name    = "compression_level",
+        .value   = "3"
+    },
+    [PHO_CFG_LYT_RAID1_compression_ratio] = {
+        .section = "layout_raid1",
+        .name    = "compression_ratio",
+        .value   = "50" /* data expected to be compressed to half its size */
+    },
 };
 
 /**
@@ -294,24 +336,14 @@ static void set_extent_info(struct extent *extent,
  * Bytes are read from input_fd and stored to an intermediate buffer before
  * being written into each iod.
  *
- * @input[in,out]   xxh128state     XXH128 context to update if not NULL
- * @input[in,out]   md5ctx          MD5 context to update if not NULL
+ * @input[in,out]   checksum        checksum contexts to update
  *
  * @return 0 if success, else a negative error code
  */
-#ifdef HAVE_XXH128
 static int write_all_chunks(int input_fd, struct io_adapter_module **ioa,
                             struct pho_io_descr *iod,
                             unsigned int replica_count, size_t buffer_size,
-                            size_t count, XXH3_state_t *xxh128state,
-                            EVP_MD_CTX *md5ctx)
-#else
-static int write_all_chunks(int input_fd, struct io_adapter_module **ioa,
-                            struct pho_io_descr *iod,
-                            unsigned int replica_count, size_t buffer_size,
-                            size_t count, void *xxh128state,
-                            EVP_MD_CTX *md5ctx)
-#endif
+                            size_t count, struct pho_checksum *checksum)
 {
 #define MAX_NULL_READ_TRY 10
     int nb_null_read_try = 0;
@@ -355,18 +387,11 @@ static int write_all_chunks(int input_fd, struct io_adapter_module **ioa,
             iod[i].iod_size += buf_size;
         }
 
-#ifdef HAVE_XXH128
-        if (xxh128state &&
-            XXH3_128bits_update(xxh128state, buffer, buf_size) == XXH_ERROR)
-            LOG_GOTO(out, rc = -ENOMEM,
-                     "Unable to update XXH128 in raid1 write, buffer of %zu "
+        rc = pho_checksum_update(checksum, buffer, buf_size);
+        if (rc)
+            LOG_GOTO(out, rc,
+                     "Unable to update checksums in raid1 write, buffer of %zu "
                      "bytes with %zu remaining bytes", buf_size, to_write);
-#endif
-
-        if (md5ctx && EVP_DigestUpdate(md5ctx, buffer, buf_size) == 0)
-            LOG_GOTO(out, rc = -ENOMEM,
-                     "Unable to update MD5 in raid1 write, buffer of %zu bytes "
-                     "with %zu remaining bytes", buf_size, to_write);
 
         to_write -= buf_size;
     }
@@ -376,6 +401,115 @@ out:
     return rc;
 }
 
+/**
+ * Size still to be written by an encoder. For a compressed layout, the size
+ * of the data not compressed yet is estimated from the expected compression
+ * ratio, so this is only the size to allocate for the next extent.
+ */
+static size_t raid1_left_to_write(const struct raid1_encoder *raid1)
+{
+    size_t pending;
+    size_t raw_left;
+
+    if (raid1->compress.codec == PHO_CODEC_NONE || raid1->compress.decompress)
+        return raid1->to_write;
+
+    pending = raid1->out.pos - raid1->out_sent;
+    if (raid1->compress_ended)
+        return pending;
+
+    raw_left = raid1->to_write + raid1->in.size - raid1->in.pos;
+    /* the end of the stream is still to be produced */
+    return pending + raw_left * raid1->compress_ratio / 100 + 1;
+}
+
+/**
+ * Compress data from input_fd and write the compressed stream in each iod, up
+ * to \p capacity bytes, and update the corresponding checksums if needed.
+ *
+ * The compressed data that does not fit in \p capacity is kept in the output
+ * buffer of the encoder, for the next extent.
+ *
+ * @param[out]  written     Number of bytes written in each iod
+ *
+ * @return 0 if success, else a negative error code
+ */
+static int write_compressed_chunks(int input_fd, struct io_adapter_module **ioa,
+                                   struct pho_io_descr *iod,
+                                   struct raid1_encoder *raid1,
+                                   size_t capacity, size_t *written)
+{
+    int nb_null_read_try = 0;
+    int rc;
+    int i;
+
+    *written = 0;
+
+    while (true) {
+        size_t pending = raid1->out.pos - raid1->out_sent;
+        const char *chunk = (char *)raid1->out.buf + raid1->out_sent;
+        ssize_t buf_size;
+
+        if (pending > 0) {
+            size_t len = min(pending, capacity - *written);
+
+            /* the extent is full */
+            if (len == 0)
+                break;
+
+            for (i = 0; i < raid1->repl_count; ++i) {
+                rc = ioa_write(ioa[i], &iod[i], chunk, len);
+                if (rc)
+                    LOG_RETURN(rc, "Unable to write %zu bytes in replica %d "
+                                   "in raid1 write", len, i);
+
+                iod[i].iod_size += len;
+            }
+
+            rc = pho_checksum_update(&raid1->checksum, chunk, len);
+            if (rc)
+                LOG_RETURN(rc, "Unable to update checksums in raid1 write");
+
+            raid1->out_sent += len;
+            *written += len;
+            continue;
+        }
+
+        raid1->out.pos = 0;
+        raid1->out_sent = 0;
+        if (raid1->compress_ended)
+            break;
+
+        if (raid1->in.pos == raid1->in.size && raid1->to_write > 0) {
+            buf_size = read(input_fd, (void *)raid1->in.buf,
+                            min(raid1->to_write, raid1->out.size));
+            if (buf_size < 0)
+                LOG_RETURN(-errno, "Error on loading buffer in raid1 write, "
+                                   "%zu remaning bytes", raid1->to_write);
+
+            if (buf_size == 0) {
+                ++nb_null_read_try;
+                if (nb_null_read_try > MAX_NULL_READ_TRY)
+                    LOG_RETURN(-EIO, "Too many null read in raid1 write, "
+                                     "%zu remaining bytes", raid1->to_write);
+
+                continue;
+            }
+
+            raid1->in.size = buf_size;
+            raid1->in.pos = 0;
+            raid1->to_write -= buf_size;
+        }
+
+        rc = pho_compress_step(&raid1->compress, &raid1->in, &raid1->out,
+                               raid1->to_write == 0, &raid1->compress_ended);
+        if (rc)
+            LOG_RETURN(rc, "Unable to compress data in raid1 write");
+    }
+
+    return 0;
+}
+
 /**
  * Retrieve the preferred IO size from the backend storage
  * if it was not set in the global "io" configuration.
@@ -407,36 +541,78 @@ static void set_block_io_size(size_t *io_size,
 
 /**
  * Write xattrs to a split and all of its replicates, here the oid, user md,
- * md5/xxh128 if available.
+ * md5/xxh128/crc32c if available.
  *
  * Uses function ioa_set_md to use the same file descriptor already contained
  * in the I/O descriptor without initializing a new file context.
- * In order to have md5/xxh128, the function ioa_open must be called before
- * this function.
+ * In order to have md5/xxh128/crc32c, the function ioa_open must be called
+ * before this function.
+ *
+ * Along with the object ID, the object UUID and version, the write time, the
+ * layout description and the index of the extent in the layout are stored, so
+ * that the DSS rows of the extent can be rebuilt from the medium alone.
  *
+ * @param[in]       enc         Encoder of the current object.
  * @param[in]       repl_count  Number of replicates of the extent.
  * @param[in,out]   iod         I/O descriptor to access the current object.
  * @param[in,out]   extent      Extent to write the xattrs to.
- * @param[in]       oid         Object descriptor.
  * @param[in]       user_md     User metadata.
  * @param[in,out]   ioa         I/O adapter to access the current storage
  *                              backend.
  *
  * @return 0 if success, else a negative error code.
  */
-static int put_xattr_to_extent(int repl_count, struct pho_io_descr *iod,
-                               struct extent *extent, const char *oid,
+static int put_xattr_to_extent(struct pho_encoder *enc, int repl_count,
+                               struct pho_io_descr *iod, struct extent *extent,
                                GString *user_md,
                                struct io_adapter_module **ioa)
 {
+    struct timeval now;
+    char layout_idx[16];
+    char version[16];
+    char write_time[24];
+    char *lyt_info;
     int rc = 0;
     int i;
 
+    lyt_info = dss_layout_desc_encode(&enc->layout->layout_desc);
+    if (!lyt_info)
+        LOG_RETURN(-EINVAL, "Unable to encode layout description");
+
+    snprintf(version, sizeof(version), "%d", enc->xfer->xd_version);
+    gettimeofday(&now, NULL);
+    snprintf(write_time, sizeof(write_time), "%" PRId64,
+             (int64_t)now.tv_sec * 1000000 + now.tv_usec);
+
     for (i = 0; i < repl_count; ++i) {
 
         iod[i].iod_flags = PHO_IO_MD_ONLY;
 
-        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_ID_NAME, oid);
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_ID_NAME,
+                          enc->xfer->xd_objid);
+        if (rc)
+            LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
+
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_UUID_NAME,
+                          enc->xfer->xd_objuuid);
+        if (rc)
+            LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
+
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_VERSION_NAME, version);
+        if (rc)
+            LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
+
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_CTIME_NAME, write_time);
+        if (rc)
+            LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
+
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_LAYOUT_NAME, lyt_info);
+        if (rc)
+            LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
+
+        snprintf(layout_idx, sizeof(layout_idx), "%d", extent[i].layout_idx);
+        rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_LAYOUT_IDX_NAME,
+                          layout_idx);
         if (rc)
             LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d", i);
 
@@ -474,18 +650,33 @@ static int put_xattr_to_extent(int repl_count, struct pho_io_descr *iod,
                 LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d",
                          i);
         }
+
+        if (extent[i].with_crc32c) {
+            const char *crc32c_buffer = uchar2hex(extent[i].crc32c,
+                                                  sizeof(extent[i].crc32c));
+            if (!crc32c_buffer)
+                LOG_GOTO(attrs, rc = -ENOMEM, "Unable to construct hex crc32c");
+
+            rc = pho_attr_set(&iod[i].iod_attrs, PHO_EA_CRC32C_NAME,
+                              crc32c_buffer);
+            free((char *)crc32c_buffer);
+            if (rc)
+                LOG_GOTO(attrs, rc, "Unable to set iod_attrs for extent %d",
+                         i);
+        }
     }
 
     for (i = 0; i < repl_count; ++i) {
         rc = ioa_set_md(ioa[i], NULL, NULL, &iod[i]);
         if (rc)
-            LOG_RETURN(rc, "Unable to set md for extent number %i in raid1",
-                       i);
+            LOG_GOTO(attrs, rc,
+                     "Unable to set md for extent number %i in raid1", i);
     }
 
 attrs:
     for (i = 0; i < repl_count; ++i)
         pho_attrs_free(&iod[i].iod_attrs);
+    free(lyt_info);
     return rc;
 }
 
@@ -509,15 +700,11 @@ static int multiple_enc_write_chunk(struct pho_encoder *enc,
     struct raid1_encoder *raid1 = enc->priv_enc;
 #define EXTENT_TAG_SIZE 128
     struct io_adapter_module **ioa = NULL;
-    unsigned char md5[MD5_BYTE_LENGTH];
     struct pho_io_descr *iod = NULL;
     struct pho_ext_loc *loc = NULL;
     struct extent *extent = NULL;
     char *extent_tag = NULL;
     char *extent_key = NULL;
-#ifdef HAVE_XXH128
-    XXH128_hash_t xxh128;
-#endif
     size_t extent_size;
     GString *str;
     int rc = 0;
@@ -546,8 +733,12 @@ static int multiple_enc_write_chunk(struct pho_encoder *enc,
                      "Unable to get io_adapter in raid1 encoder write");
     }
 
-    /* write size is limited by the smallest available place on all media */
-    extent_size = raid1->to_write;
+    /*
+     * write size is limited by the smallest available place on all media, the
+     * size of a compressed extent is only known once it is written
+     */
+    extent_size = raid1->compress.codec == PHO_CODEC_NONE ? raid1->to_write :
+                                                            SIZE_MAX;
     for (i = 0; i < raid1->repl_count; ++i)
         if (wresp->media[i]->avail_size < extent_size)
             extent_size = wresp->media[i]->avail_size;
@@ -633,70 +824,45 @@ static int multiple_enc_write_chunk(struct pho_encoder *enc,
         pho_debug("I/O size for replicate %d: %zu", i, enc->io_block_size);
     }
 
-#ifdef HAVE_XXH128
-    /* Init xxh128state */
-    if (raid1->xxh128state) {
-        if (XXH3_128bits_reset(raid1->xxh128state) == XXH_ERROR)
-            LOG_GOTO(close, rc = -ENOMEM,
-                     "Unable to init XXH128 state in raid1 encoder write");
-    }
-#endif
-
-    /* Init md5ctx */
-    if (raid1->md5ctx) {
-        if (EVP_DigestInit_ex(raid1->md5ctx, EVP_md5(), NULL) == 0)
-            LOG_GOTO(close, rc = -ENOMEM,
-                     "Unable to init MD5 context in raid1 encoder write");
-    }
+    /* Init checksums */
+    rc = pho_checksum_reset(&raid1->checksum);
+    if (rc)
+        LOG_GOTO(close, rc, "Unable to init checksums in raid1 encoder write");
 
     /* write all extents by chunk of buffer size*/
-    rc = write_all_chunks(enc->xfer->xd_fd, ioa, iod,
-                          raid1->repl_count, enc->io_block_size,
-                          extent_size, raid1->xxh128state, raid1->md5ctx);
+    if (raid1->compress.codec == PHO_CODEC_NONE) {
+        rc = write_all_chunks(enc->xfer->xd_fd, ioa, iod,
+                              raid1->repl_count, enc->io_block_size,
+                              extent_size, &raid1->checksum);
+    } else {
+        rc = write_compressed_chunks(enc->xfer->xd_fd, ioa, iod, raid1,
+                                     extent_size, &extent_size);
+        for (i = 0; i < raid1->repl_count; ++i)
+            extent[i].size = extent_size;
+    }
     if (rc)
         LOG_GOTO(close, rc, "Unable to write in raid1 encoder write");
 
-#ifdef HAVE_XXH128
-    /* compute extent XXH128 */
-    if (raid1->xxh128state)
-        xxh128 = XXH3_128bits_digest(raid1->xxh128state);
-#endif
-
-    /* compute extent MD5 */
-    if (raid1->md5ctx) {
-        if (EVP_DigestFinal_ex(raid1->md5ctx, md5, NULL) == 0)
-            LOG_GOTO(close, rc = -ENOMEM,
-                     "Unable to produce MD5 in raid1 encoder write");
-    }
-
-    if (rc == 0) {
-        /* copy XXH128 into extent */
-        for (i = 0; i < raid1->repl_count; i++) {
-#ifdef HAVE_XXH128
-            if (raid1->xxh128state) {
-                XXH128_canonical_t xxh128_canonical;
-
-                XXH128_canonicalFromHash(&xxh128_canonical, xxh128);
-                memcpy(&extent[i].xxh128[0], &xxh128_canonical.digest[0],
-                       sizeof(extent[i].xxh128));
-            }
-#endif
-
-            extent[i].with_xxh128 = raid1->xxh128state;
-        }
-
-        /* copy MD5 into extent */
-        for (i = 0; i < raid1->repl_count; i++) {
-            if (raid1->md5ctx)
-                memcpy(&extent[i].md5[0], &md5[0], MD5_BYTE_LENGTH);
-
-            extent[i].with_md5 = raid1->md5ctx;
-        }
+    /* compute extent checksums */
+    rc = pho_checksum_digest(&raid1->checksum, &extent[0]);
+    if (rc)
+        LOG_GOTO(close, rc, "Unable to produce checksums in raid1 encoder "
+                            "write");
+
+    /* copy checksums into the extents of all replicas */
+    for (i = 1; i < raid1->repl_count; i++) {
+        extent[i].with_xxh128 = extent[0].with_xxh128;
+        memcpy(&extent[i].xxh128[0], &extent[0].xxh128[0],
+               sizeof(extent[i].xxh128));
+        extent[i].with_md5 = extent[0].with_md5;
+        memcpy(&extent[i].md5[0], &extent[0].md5[0], MD5_BYTE_LENGTH);
+        extent[i].with_crc32c = extent[0].with_crc32c;
+        memcpy(&extent[i].crc32c[0], &extent[0].crc32c[0],
+               sizeof(extent[i].crc32c));
     }
 
 
-    rc = put_xattr_to_extent(raid1->repl_count, iod,
-                             extent, enc->xfer->xd_objid, str, ioa);
+    rc = put_xattr_to_extent(enc, raid1->repl_count, iod, extent, str, ioa);
 
 close:
     for (i = 0; i < raid1->repl_count; ++i) {
@@ -707,9 +873,10 @@ close:
             rc = rc2;
     }
 
-    /* update size in write encoder */
+    /* update size in write encoder, compressed data is counted when read */
     if (rc == 0) {
-        raid1->to_write -= extent_size;
+        if (raid1->compress.codec == PHO_CODEC_NONE)
+            raid1->to_write -= extent_size;
         raid1->cur_extent_idx++;
     }
 
@@ -737,6 +904,137 @@ out:
     return rc;
 }
 
+/** Extent read by a dedicated thread into a pipe, to be decompressed */
+struct extent_reader {
+    struct io_adapter_module *ioa;
+    const char *extent_key;
+    const char *objid;
+    struct pho_io_descr *iod;
+    int rc;
+};
+
+static void *extent_reader_run(void *arg)
+{
+    struct extent_reader *reader = arg;
+
+    reader->rc = ioa_get(reader->ioa, reader->extent_key, reader->objid,
+                         reader->iod);
+
+    /* signal the end of the extent to the decompression */
+    close(reader->iod->iod_fd);
+    reader->iod->iod_fd = -1;
+
+    return NULL;
+}
+
+/** Write \p size bytes of \p buf to \p fd */
+static int write_full(int fd, const char *buf, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = write(fd, buf, size);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0)
+            return -errno;
+
+        buf += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+/**
+ * Read the extent described by \a iod and write its data, decompressed if the
+ * layout is compressed, into the output fd of dec->xfer.
+ *
+ * The extent is retrieved by the I/O adapter into a pipe from another thread,
+ * and added to the checksums of the decoder then decompressed as it comes out
+ * of the pipe.
+ */
+static int pipe_extent(struct pho_encoder *dec, struct io_adapter_module *ioa,
+                       const char *extent_key, struct pho_io_descr *iod)
+{
+    struct raid1_encoder *raid1 = dec->priv_enc;
+    struct extent_reader reader = {0};
+    pthread_t thread;
+    int pipefd[2];
+    int rc = 0;
+
+    if (pipe(pipefd))
+        LOG_RETURN(-errno, "Cannot create pipe to read extent");
+
+    iod->iod_fd = pipefd[1];
+    reader.ioa = ioa;
+    reader.extent_key = extent_key;
+    reader.objid = dec->xfer->xd_objid;
+    reader.iod = iod;
+
+    rc = pthread_create(&thread, NULL, extent_reader_run, &reader);
+    if (rc) {
+        close(pipefd[1]);
+        close(pipefd[0]);
+        LOG_RETURN(-rc, "Cannot start extent reader");
+    }
+
+    /* the pipe is drained up to its end so that the reader never blocks */
+    while (true) {
+        ssize_t n = read(pipefd[0], (void *)raid1->in.buf, raid1->in_buf_size);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+
+        if (n < 0) {
+            pho_error(rc = -errno, "Cannot read extent from pipe");
+            break;
+        }
+
+        if (n == 0)
+            break;
+
+        /* after an error, the rest of the extent is only drained */
+        if (rc)
+            continue;
+
+        rc = pho_checksum_update(&raid1->checksum, raid1->in.buf, n);
+        if (rc)
+            continue;
+
+        if (raid1->compress.codec == PHO_CODEC_NONE) {
+            rc = write_full(dec->xfer->xd_fd, raid1->in.buf, n);
+            if (rc)
+                pho_error(rc, "Cannot write extent data");
+            continue;
+        }
+
+        raid1->in.size = n;
+        raid1->in.pos = 0;
+
+        /* the output is flushed until the input is consumed */
+        while (!rc && (raid1->in.pos < raid1->in.size ||
+                       raid1->out.pos == raid1->out.size)) {
+            raid1->out.pos = 0;
+            rc = pho_compress_step(&raid1->compress, &raid1->in, &raid1->out,
+                                   false, &raid1->compress_ended);
+            if (rc)
+                break;
+
+            rc = write_full(dec->xfer->xd_fd, raid1->out.buf, raid1->out.pos);
+            if (rc)
+                pho_error(rc, "Cannot write decompressed data");
+
+            raid1->raw_read += raid1->out.pos;
+        }
+    }
+
+    close(pipefd[0]);
+    pthread_join(thread, NULL);
+
+    return reader.rc ? : rc;
+}
+
 /**
  * Read the data specified by \a extent from \a medium into the output fd of
  * dec->xfer.
@@ -806,13 +1104,44 @@ static int simple_dec_read_chunk(struct pho_encoder *dec,
     if (rc)
         LOG_RETURN(rc, "Extent key build failed");
 
-    rc = ioa_get(ioa, extent_key, dec->xfer->xd_objid, &iod);
+    rc = pho_checksum_reset(&raid1->checksum);
+    if (rc) {
+        free(extent_key);
+        return rc;
+    }
+
+    if (raid1->compress.codec == PHO_CODEC_NONE && !extent->with_crc32c)
+        rc = ioa_get(ioa, extent_key, dec->xfer->xd_objid, &iod);
+    else
+        rc = pipe_extent(dec, ioa, extent_key, &iod);
     free(extent_key);
+
+    if (rc == 0 && extent->with_crc32c) {
+        struct extent computed = {0};
+
+        rc = pho_checksum_digest(&raid1->checksum, &computed);
+        if (rc)
+            return rc;
+
+        if (memcmp(computed.crc32c, extent->crc32c, sizeof(extent->crc32c)))
+            LOG_RETURN(-EBADMSG, "CRC32C mismatch on extent %d of '%s' read "
+                       "from '%s'", extent->layout_idx, dec->xfer->xd_objid,
+                       extent->media.name);
+    }
+
     if (rc == 0) {
         raid1->to_write -= extent->size;
         raid1->cur_extent_idx++;
     }
 
+    /* The whole stream must have been decompressed to the original size */
+    if (rc == 0 && raid1->to_write <= 0 &&
+        raid1->compress.codec != PHO_CODEC_NONE &&
+        (!raid1->compress_ended || raid1->raw_read != raid1->raw_size))
+        LOG_RETURN(-EIO, "Decompressed %zu bytes of '%s', expected %zu%s",
+                   raid1->raw_read, dec->xfer->xd_objid, raid1->raw_size,
+                   raid1->compress_ended ? "" : " (truncated stream)");
+
     /* Nothing more to write: the decoder is done */
     if (raid1->to_write <= 0) {
         pho_debug("Decoder for '%s' is now done", dec->xfer->xd_objid);
@@ -884,7 +1213,7 @@ static int raid1_enc_handle_release_resp(struct pho_encoder *enc,
      * If we wrote everything and all the releases have been received, mark the
      * encoder as done.
      */
-    if (raid1->to_write == 0 && /* no more data to write */
+    if (raid1_left_to_write(raid1) == 0 && /* no more data to write */
             /* at least one extent is created, special test for null size put */
             raid1->written_extents->len > 0 &&
             /* we got releases of all extents */
@@ -929,7 +1258,7 @@ static int raid1_enc_next_write_req(struct pho_encoder *enc, pho_req_t *req)
         return rc;
 
     for (i = 0; i < raid1->repl_count; ++i) {
-        req->walloc->media[i]->size = raid1->to_write;
+        req->walloc->media[i]->size = raid1_left_to_write(raid1);
 
         for (j = 0; j < enc->xfer->xd_params.put.tags.n_tags; ++j)
             req->walloc->media[i]->tags[j] =
@@ -1059,7 +1388,7 @@ static bool no_more_alloc(const struct pho_encoder *enc)
         return true;
 
     /* still something to write */
-    if (raid1->to_write > 0)
+    if (raid1_left_to_write(raid1) > 0)
         return false;
 
     /* decoder with no more to read */
@@ -1151,17 +1480,10 @@ static void raid1_encoder_destroy(struct pho_encoder *enc)
         raid1->to_release_media = NULL;
     }
 
-#ifdef HAVE_XXH128
-    if (raid1->xxh128state != NULL) {
-        XXH3_freeState(raid1->xxh128state);
-        raid1->xxh128state = NULL;
-    }
-#endif
-
-    if (raid1->md5ctx != NULL) {
-        EVP_MD_CTX_destroy(raid1->md5ctx);
-        raid1->md5ctx = NULL;
-    }
+    pho_checksum_fini(&raid1->checksum);
+    pho_compress_fini(&raid1->compress);
+    free((void *)raid1->in.buf);
+    free(raid1->out.buf);
 
     free(raid1);
     enc->priv_enc = NULL;
@@ -1172,6 +1494,165 @@ static const struct pho_enc_ops RAID1_ENCODER_OPS = {
     .destroy    = raid1_encoder_destroy,
 };
 
+/**
+ * Allocate the compression buffers of \p raid1, both of the size recommended
+ * for the output of its stream.
+ */
+static int raid1_compress_buffers_alloc(struct raid1_encoder *raid1)
+{
+    size_t size = pho_compress_out_size(&raid1->compress);
+
+    raid1->in.buf = malloc(size);
+    raid1->out.buf = malloc(size);
+    if (raid1->in.buf == NULL || raid1->out.buf == NULL)
+        LOG_RETURN(-ENOMEM, "Unable to alloc raid1 compression buffers");
+
+    raid1->in_buf_size = size;
+    raid1->out.size = size;
+    return 0;
+}
+
+/**
+ * Set up the compression of an encoder from the "compression" layout
+ * parameter of the put, or else from the configuration, and record the codec
+ * and the size of the data in the layout.
+ */
+static int raid1_enc_compress_init(struct pho_encoder *enc,
+                                   struct raid1_encoder *raid1)
+{
+    const char *codec_name = NULL;
+    enum pho_codec codec;
+    char raw_size[32];
+    const char *value;
+    int64_t level;
+    int64_t ratio;
+    int rc;
+
+    if (!pho_attrs_is_empty(&enc->xfer->xd_params.put.lyt_params))
+        codec_name = pho_attr_get(&enc->xfer->xd_params.put.lyt_params,
+                                  COMPRESSION_ATTR_KEY);
+
+    if (codec_name == NULL)
+        codec_name = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1,
+                                 compression);
+
+    if (codec_name == NULL)
+        return 0;
+
+    codec = str2pho_codec(codec_name);
+    if (codec == PHO_CODEC_INVAL)
+        LOG_RETURN(-EINVAL, "Unknown raid1 compression codec '%s'",
+                   codec_name);
+
+    if (codec == PHO_CODEC_NONE)
+        return 0;
+
+    value = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1, compression_level);
+    level = value ? str2int64(value) : 0;
+    if (level == INT64_MIN || level > INT_MAX || level < INT_MIN)
+        LOG_RETURN(-EINVAL, "Invalid raid1 compression level '%s'", value);
+
+    value = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1, compression_ratio);
+    ratio = value ? str2int64(value) : 100;
+    if (ratio <= 0 || ratio > UINT_MAX)
+        LOG_RETURN(-EINVAL, "Invalid raid1 compression ratio '%s'", value);
+
+    raid1->compress_ratio = ratio;
+
+    rc = pho_compress_init(&raid1->compress, codec, level, false);
+    if (rc)
+        return rc;
+
+    rc = raid1_compress_buffers_alloc(raid1);
+    if (rc)
+        return rc;
+
+    rc = pho_attr_set(&enc->layout->layout_desc.mod_attrs,
+                      COMPRESSION_ATTR_KEY, pho_codec2str(codec));
+    if (rc)
+        LOG_RETURN(rc, "Unable to set raid1 layout compression attr");
+
+    snprintf(raw_size, sizeof(raw_size), "%zu", raid1->to_write);
+    rc = pho_attr_set(&enc->layout->layout_desc.mod_attrs, RAW_SIZE_ATTR_KEY,
+                      raw_size);
+    if (rc)
+        LOG_RETURN(rc, "Unable to set raid1 layout raw_size attr");
+
+    return 0;
+}
+
+/**
+ * Set up the decompression of a decoder if its layout is compressed.
+ */
+static int raid1_dec_compress_init(struct pho_encoder *dec,
+                                   struct raid1_encoder *raid1)
+{
+    struct pho_attrs *attrs = &dec->layout->layout_desc.mod_attrs;
+    const char *codec_name;
+    enum pho_codec codec;
+    const char *value;
+    int64_t raw_size;
+    int rc;
+
+    codec_name = pho_attr_get(attrs, COMPRESSION_ATTR_KEY);
+    if (codec_name == NULL)
+        return 0;
+
+    codec = str2pho_codec(codec_name);
+    if (codec == PHO_CODEC_INVAL)
+        LOG_RETURN(-EINVAL, "Unknown raid1 compression codec '%s' in layout",
+                   codec_name);
+
+    if (codec == PHO_CODEC_NONE)
+        return 0;
+
+    value = pho_attr_get(attrs, RAW_SIZE_ATTR_KEY);
+    raw_size = value ? str2int64(value) : -1;
+    if (raw_size < 0)
+        LOG_RETURN(-EINVAL, "Invalid raw_size in compressed raid1 layout");
+
+    raid1->raw_size = raw_size;
+
+    rc = pho_compress_init(&raid1->compress, codec, 0, true);
+    if (rc)
+        return rc;
+
+    return raid1_compress_buffers_alloc(raid1);
+}
+
+/**
+ * Set up the verification of the CRC32C of the extents of a decoder, if any
+ * of them has one.
+ */
+static int raid1_dec_verify_init(struct pho_encoder *dec,
+                                 struct raid1_encoder *raid1)
+{
+    bool crc32c = false;
+    int rc;
+    int i;
+
+    for (i = 0; i < dec->layout->ext_count; i++)
+        crc32c |= dec->layout->extents[i].with_crc32c;
+
+    if (!crc32c)
+        return 0;
+
+    rc = pho_checksum_init(&raid1->checksum, false, false, true);
+    if (rc)
+        return rc;
+
+    /* compressed extents are verified from the decompression buffer */
+    if (raid1->in.buf != NULL)
+        return 0;
+
+    raid1->in.buf = malloc(VERIFY_BUF_SIZE);
+    if (raid1->in.buf == NULL)
+        LOG_RETURN(-ENOMEM, "Unable to alloc raid1 verification buffer");
+
+    raid1->in_buf_size = VERIFY_BUF_SIZE;
+    return 0;
+}
+
 /**
  * Create an encoder.
  *
@@ -1184,6 +1665,7 @@ static int layout_raid1_encode(struct pho_encoder *enc)
 {
     struct raid1_encoder *raid1 = calloc(1, sizeof(*raid1));
     const char *string_repl_count = NULL;
+    const char *extent_crc32c = NULL;
     const char *extent_xxh128 = NULL;
     const char *extent_md5 = NULL;
     int rc;
@@ -1250,27 +1732,31 @@ static int layout_raid1_encode(struct pho_encoder *enc)
                                                     free, free);
     raid1->n_released_media = 0;
 
-    /* init XXH3 state */
+    /* init checksums */
     extent_xxh128 = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1,
                                 extent_xxh128);
-    if (extent_xxh128 && !strcmp(extent_xxh128, "yes")) {
-#ifdef HAVE_XXH128
-        raid1->xxh128state = XXH3_createState();
-        if (raid1->xxh128state == NULL)
-            LOG_RETURN(-ENOMEM,
-                       "Unable to create XXH128 state when creating raid1 "
-                       "encoder");
-#else
+    if (extent_xxh128 && !strcmp(extent_xxh128, "yes") &&
+        !pho_checksum_xxh128_available())
         pho_warn("extent_xxh128 is set to 'yes' in config for raid1 layout but "
                  "xxhash-devel does not contain 128-bit XXH3 algorithm "
                  "(required xxhash-devel >= 0.8.0)");
-#endif
-    }
 
-    /* init EVP_MD_CTX */
     extent_md5 = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1, extent_md5);
-    if (extent_md5 && !strcmp(extent_md5, "yes"))
-        raid1->md5ctx = EVP_MD_CTX_create();
+    extent_crc32c = PHO_CFG_GET(cfg_lyt_raid1, PHO_CFG_LYT_RAID1,
+                                extent_crc32c);
+
+    rc = pho_checksum_init(&raid1->checksum,
+                           extent_md5 && !strcmp(extent_md5, "yes"),
+                           extent_xxh128 && !strcmp(extent_xxh128, "yes"),
+                           extent_crc32c && !strcmp(extent_crc32c, "yes"));
+    if (rc)
+        LOG_RETURN(rc, "Unable to create checksums when creating raid1 "
+                       "encoder");
+
+    rc = raid1_enc_compress_init(enc, raid1);
+    if (rc)
+        LOG_RETURN(rc, "Unable to set up compression when creating raid1 "
+                       "encoder");
 
     return 0;
 }
@@ -1331,6 +1817,16 @@ static int layout_raid1_decode(struct pho_encoder *enc)
     for (i = 0; i < enc->layout->ext_count / raid1->repl_count; i++)
         raid1->to_write += enc->layout->extents[i * raid1->repl_count].size;
 
+    rc = raid1_dec_compress_init(enc, raid1);
+    if (rc)
+        LOG_RETURN(rc, "Unable to set up decompression when creating raid1 "
+                       "decoder");
+
+    rc = raid1_dec_verify_init(enc, raid1);
+    if (rc)
+        LOG_RETURN(rc, "Unable to set up extent verification when creating "
+                       "raid1 decoder");
+
     /* Empty GET does not need any IO */
     if (raid1->to_write == 0) {
         enc->done = true;
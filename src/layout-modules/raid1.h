@@ -47,6 +47,21 @@
  */
 #define EXTENT_MD5_ATTR_KEY "extent_md5"
 
+/**
+ * Computing the CRC32C of each extent, which is then also verified when the
+ * extent is read, is enabled by the configuration if EXTENT_CRC32C_ATTR_KEY is
+ * set to "yes"
+ */
+#define EXTENT_CRC32C_ATTR_KEY "extent_crc32c"
+
+/**
+ * Codec compressing the data of a layout, see pho_compress.h. It is saved in
+ * the layout COMPRESSION_ATTR_KEY attr along with the size of the data before
+ * compression in the RAW_SIZE_ATTR_KEY attr.
+ */
+#define COMPRESSION_ATTR_KEY "compression"
+#define RAW_SIZE_ATTR_KEY "raw_size"
+
 /**
  * Set unsigned int replica count value from char * layout attr
  *
@@ -32,7 +32,9 @@
 #include "io_sched.h"
 #include "pho_common.h"
 #include "lrs_device.h"
+#include "lrs_metrics.h"
 #include "lrs_sched.h"
+#include "lrs_trace.h"
 #include "io_schedulers/schedulers.h"
 
 struct pho_config_item cfg_io_sched[] = {
@@ -109,19 +111,35 @@ int io_sched_dispatch_devices(struct io_sched_handle *io_sched_hdl,
     return io_sched_hdl->dispatch_devices(io_sched_hdl, devices);
 }
 
+/** Update the queue depth metric of \p queue by \p delta */
+static void queue_depth_add(struct io_sched_handle *io_sched_hdl,
+                            const char *queue, int delta)
+{
+    lrs_metric_add(LRS_METRIC_QUEUE_DEPTH,
+                   rsc_family2str(io_sched_hdl->family), queue, delta);
+}
+
 int io_sched_push_request(struct io_sched_handle *io_sched_hdl,
                           struct req_container *reqc)
 {
-    if (pho_request_is_read(reqc->req)) {
+    /* Mixed requests are also write requests: they are queued with the write
+     * requests, whose I/O scheduler chooses their media to write.
+     */
+    lrs_trace_request(reqc, LRS_TRACE_QUEUED, NULL);
+    if (pho_request_is_write(reqc->req)) {
+        io_sched_hdl->io_stats.nb_writes++;
+        queue_depth_add(io_sched_hdl, "write", 1);
+        pho_debug("lrs received %s request (%p)",
+                  pho_srl_request_kind_str(reqc->req), reqc->req);
+        return io_sched_hdl->write.ops.push_request(&io_sched_hdl->write, reqc);
+    } else if (pho_request_is_read(reqc->req)) {
         io_sched_hdl->io_stats.nb_reads++;
+        queue_depth_add(io_sched_hdl, "read", 1);
         pho_debug("lrs received read allocation request (%p)", reqc->req);
         return io_sched_hdl->read.ops.push_request(&io_sched_hdl->read, reqc);
-    } else if (pho_request_is_write(reqc->req)) {
-        io_sched_hdl->io_stats.nb_writes++;
-        pho_debug("lrs received write allocation request (%p)", reqc->req);
-        return io_sched_hdl->write.ops.push_request(&io_sched_hdl->write, reqc);
     } else if (pho_request_is_format(reqc->req)) {
         io_sched_hdl->io_stats.nb_formats++;
+        queue_depth_add(io_sched_hdl, "format", 1);
         pho_debug("lrs received format request (%p)", reqc->req);
         return io_sched_hdl->format.ops.push_request(&io_sched_hdl->format,
                                                      reqc);
@@ -133,10 +151,10 @@ int io_sched_push_request(struct io_sched_handle *io_sched_hdl,
 int io_sched_requeue(struct io_sched_handle *io_sched_hdl,
                      struct req_container *reqc)
 {
-    if (pho_request_is_read(reqc->req))
-        return io_sched_hdl->read.ops.requeue(&io_sched_hdl->read, reqc);
-    else if (pho_request_is_write(reqc->req))
+    if (pho_request_is_write(reqc->req))
         return io_sched_hdl->write.ops.requeue(&io_sched_hdl->write, reqc);
+    else if (pho_request_is_read(reqc->req))
+        return io_sched_hdl->read.ops.requeue(&io_sched_hdl->read, reqc);
     else if (pho_request_is_format(reqc->req))
         return io_sched_hdl->format.ops.requeue(&io_sched_hdl->format, reqc);
 
@@ -146,15 +164,18 @@ int io_sched_requeue(struct io_sched_handle *io_sched_hdl,
 int io_sched_remove_request(struct io_sched_handle *io_sched_hdl,
                          struct req_container *reqc)
 {
-    if (pho_request_is_read(reqc->req)) {
-        io_sched_hdl->io_stats.nb_reads--;
-        return io_sched_hdl->read.ops.remove_request(&io_sched_hdl->read, reqc);
-    } else if (pho_request_is_write(reqc->req)) {
+    if (pho_request_is_write(reqc->req)) {
         io_sched_hdl->io_stats.nb_writes--;
+        queue_depth_add(io_sched_hdl, "write", -1);
         return io_sched_hdl->write.ops.remove_request(&io_sched_hdl->write,
                                                       reqc);
+    } else if (pho_request_is_read(reqc->req)) {
+        io_sched_hdl->io_stats.nb_reads--;
+        queue_depth_add(io_sched_hdl, "read", -1);
+        return io_sched_hdl->read.ops.remove_request(&io_sched_hdl->read, reqc);
     } else if (pho_request_is_format(reqc->req)) {
         io_sched_hdl->io_stats.nb_formats--;
+        queue_depth_add(io_sched_hdl, "format", -1);
         return io_sched_hdl->format.ops.remove_request(&io_sched_hdl->format,
                                                        reqc);
     }
@@ -195,10 +216,10 @@ int io_sched_get_device_medium_pair(struct io_sched_handle *io_sched_hdl,
 {
     struct io_scheduler *io_sched;
 
-    if (pho_request_is_read(reqc->req))
-        io_sched = &io_sched_hdl->read;
-    else if (pho_request_is_write(reqc->req))
+    if (pho_request_is_write(reqc->req))
         io_sched = &io_sched_hdl->write;
+    else if (pho_request_is_read(reqc->req))
+        io_sched = &io_sched_hdl->read;
     else if (pho_request_is_format(reqc->req))
         io_sched = &io_sched_hdl->format;
     else
@@ -214,10 +235,10 @@ int io_sched_retry(struct io_sched_handle *io_sched_hdl,
 {
     struct io_scheduler *io_sched;
 
-    if (pho_request_is_read(sreq->reqc->req))
-        io_sched = &io_sched_hdl->read;
-    else if (pho_request_is_write(sreq->reqc->req))
+    if (pho_request_is_write(sreq->reqc->req))
         io_sched = &io_sched_hdl->write;
+    else if (pho_request_is_read(sreq->reqc->req))
+        io_sched = &io_sched_hdl->read;
     else if (pho_request_is_format(sreq->reqc->req))
         io_sched = &io_sched_hdl->format;
     else
@@ -464,6 +485,7 @@ int io_sched_handle_load_from_config(struct io_sched_handle *io_sched_hdl,
 {
     int rc;
 
+    io_sched_hdl->family = family;
     io_sched_hdl->read.type = IO_REQ_READ;
     io_sched_hdl->write.type = IO_REQ_WRITE;
     io_sched_hdl->format.type = IO_REQ_FORMAT;
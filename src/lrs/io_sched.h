@@ -255,6 +255,7 @@ struct io_sched_handle {
     struct lock_handle *lock_handle;
     struct tsqueue     *response_queue; /* reference to the response queue */
     struct io_stats     io_stats;
+    enum rsc_family     family;         /* family of the requests */
     GPtrArray          *global_device_list; /* reference to
                                              * lrs_sched::devices::ldh_devices
                                              */
@@ -361,6 +362,9 @@ int io_sched_requeue(struct io_sched_handle *io_sched_hdl,
  * If \p is_error is true on read, valid media IDs are stored between index
  * reqc->req->ralloc->n_required and reqc->req->ralloc->n_med_ids - 1 inclusive.
  *
+ * For a mixed request, which is handled by the write I/O scheduler, only the
+ * media to write are chosen by this function.
+ *
  * \param[in]   io_sched  a valid I/O scheduler
  * \param[in]   reqc      the request container used to generate sub-requests
  * \param[out]  dev       the device that must be used to handle \p sreq. It can
@@ -368,12 +368,15 @@ static int generic_get_device_medium_pair(struct io_scheduler *io_sched,
     struct queue_element *elem;
     bool is_retry = false;
     GQueue *queue;
+    bool is_read;
     int rc;
 
     queue = (GQueue *) io_sched->private_data;
+    /* only the media to write of a mixed request are chosen here */
+    is_read = !pho_request_is_write(reqc->req) &&
+              pho_request_is_read(reqc->req);
 
-    if (pho_request_is_read(reqc->req) &&
-        *reqc_get_medium_to_alloc(reqc, sreq->medium_index)) {
+    if (is_read && *reqc_get_medium_to_alloc(reqc, sreq->medium_index)) {
         /* This is a retry on a medium previously allocated for this request. */
         media_info_free(*reqc_get_medium_to_alloc(reqc, sreq->medium_index));
         *reqc_get_medium_to_alloc(reqc, sreq->medium_index) = NULL;
@@ -386,7 +389,7 @@ static int generic_get_device_medium_pair(struct io_scheduler *io_sched,
                        "Request '%p' is not the first element of the queue",
                        reqc);
 
-        if (pho_request_is_read(reqc->req)) {
+        if (is_read) {
             if (elem->num_media_allocated >= reqc->req->ralloc->n_med_ids)
                 LOG_RETURN(-ERANGE, "get_device_medium_pair called too many "
                                     "times on the same request");
@@ -397,7 +400,7 @@ static int generic_get_device_medium_pair(struct io_scheduler *io_sched,
         }
     }
 
-    if (pho_request_is_read(reqc->req)) {
+    if (is_read) {
         size_t index = is_error ?
             /* Select the first non-failed medium. */
             (sreq->failure_on_medium ? reqc->req->ralloc->n_required :
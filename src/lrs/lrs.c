@@ -43,7 +43,9 @@
 #include "pho_type_utils.h"
 
 #include "lrs_cfg.h"
+#include "lrs_metrics.h"
 #include "lrs_sched.h"
+#include "lrs_trace.h"
 
 /**
  * Local Resource Scheduler instance, composed of two parts:
@@ -59,10 +61,16 @@ struct lrs {
                                                 * completed after the LRS
                                                 * stopped.
                                                 */
-    struct dss_handle     dss;                 /*!< DSS handle of the
-                                                * communication thread
+    struct dss_pool      *dss_pool;            /*!< DSS connections shared by
+                                                * the scheduler and device
+                                                * threads, NULL if each thread
+                                                * has its own
                                                 */
-    const char *lock_file;                     /*!< Daemon lock file path */
+    char *lock_file;                           /*!< Daemon lock file path,
+                                                * copied from the config that
+                                                * may be reloaded
+                                                */
+    struct lrs_metrics_exporter metrics;       /*!< Metrics HTTP server */
 };
 
 /* ****************************************************************************/
@@ -142,6 +150,15 @@ static int _delete_lock_file(const char *lock_file)
 
 static enum rsc_family _determine_family(const pho_req_t *req)
 {
+    if (pho_request_is_mixed(req)) {
+        size_t i;
+
+        /* both parts of a mixed request are granted by the same scheduler */
+        for (i = 0; i < req->ralloc->n_med_ids; i++)
+            if (req->ralloc->med_ids[i]->family != req->walloc->family)
+                return PHO_RSC_INVAL;
+    }
+
     if (pho_request_is_write(req))
         return (enum rsc_family)req->walloc->family;
 
@@ -256,7 +273,9 @@ static void notify_device_request_is_canceled(struct resp_container *respc)
 
 static int request_kind_from_response(pho_resp_t *resp)
 {
-    if (pho_response_is_write(resp))
+    if (pho_response_is_mixed(resp))
+        return PHO_REQUEST_KIND__RQ_MIXED;
+    else if (pho_response_is_write(resp))
         return PHO_REQUEST_KIND__RQ_WRITE;
     else if (pho_response_is_read(resp))
         return PHO_REQUEST_KIND__RQ_READ;
@@ -312,6 +331,57 @@ static inline bool client_disconnected_error(int rc)
     return rc == -EPIPE || rc == -ECONNRESET;
 }
 
+/** Value of the 'type' label of the request duration metric */
+static const char *request_kind2metric_type(int kind)
+{
+    switch (kind) {
+    case PHO_REQUEST_KIND__RQ_READ:
+        return "read";
+    case PHO_REQUEST_KIND__RQ_WRITE:
+        return "write";
+    case PHO_REQUEST_KIND__RQ_MIXED:
+        return "mixed";
+    case PHO_REQUEST_KIND__RQ_RELEASE:
+        return "release";
+    case PHO_REQUEST_KIND__RQ_FORMAT:
+        return "format";
+    default:
+        /* quick requests are not measured */
+        return NULL;
+    }
+}
+
+static void observe_request_duration(struct resp_container *respc)
+{
+    const char *type;
+    struct timespec now;
+    struct timespec diff;
+
+    type = request_kind2metric_type(request_kind_from_response(respc->resp));
+    /* errors answered before the request was timestamped are ignored */
+    if (!type || respc->received_at.tv_sec == 0)
+        return;
+
+    if (clock_gettime(CLOCK_REALTIME, &now) ||
+        cmp_timespec(&now, &respc->received_at) < 0)
+        return;
+
+    diff = diff_timespec(&now, &respc->received_at);
+    lrs_metric_observe(LRS_METRIC_REQUEST_DURATION, type,
+                       diff.tv_sec + diff.tv_nsec / 1e9);
+}
+
+static void trace_response(struct resp_container *respc)
+{
+    /* the containers of the quick requests' responses are not initialized */
+    if (request_kind_from_response(respc->resp) == -1)
+        return;
+
+    lrs_trace_record(respc->trace_id, respc->resp->req_id,
+                     pho_srl_response_kind_str(respc->resp),
+                     LRS_TRACE_RESPONDED, NULL);
+}
+
 static int _send_message(struct pho_comm_info *comm,
                          struct resp_container *respc)
 {
@@ -333,6 +403,12 @@ static int _send_message(struct pho_comm_info *comm,
          */
         LOG_GOTO(cancel, rc, "Response cannot be packed");
 
+    /* measured and traced before the response is sent so that it is
+     * accounted for as soon as the client gets it
+     */
+    observe_request_duration(respc);
+    trace_response(respc);
+
     /* XXX: \p running could change just before the call to send.
      * Which means that new I/O responses would be sent with running = false
      */
@@ -423,6 +499,54 @@ static int _process_ping_request(struct lrs *lrs,
     return rc;
 }
 
+/* Monitor request asking for the trace of the requests */
+static int _process_trace_request(struct lrs *lrs,
+                                  const struct req_container *req_cont)
+{
+    struct resp_container resp_cont;
+    json_t *trace;
+    int rc;
+
+    resp_cont.resp = malloc(sizeof(*resp_cont.resp));
+    if (!resp_cont.resp)
+        LOG_GOTO(send_error, rc = -ENOMEM,
+                 "Failed to allocate trace response");
+
+    trace = json_array();
+    if (!trace)
+        LOG_GOTO(free_resp, rc = -ENOMEM, "Failed to allocate json array");
+
+    resp_cont.socket_id = req_cont->socket_id;
+    pho_srl_response_monitor_alloc(resp_cont.resp);
+    resp_cont.resp->req_id = req_cont->req->id;
+
+    rc = lrs_trace_dump(trace);
+    if (rc)
+        LOG_GOTO(free_trace, rc, "Failed to dump the request trace");
+
+    resp_cont.resp->monitor->status = json_dumps(trace, 0);
+    json_decref(trace);
+    if (!resp_cont.resp->monitor->status)
+        LOG_GOTO(free_resp, rc = -ENOMEM, "Failed to dump trace string");
+
+    rc = _send_message(&lrs->comm, &resp_cont);
+    pho_srl_response_free(resp_cont.resp, false);
+    free(resp_cont.resp);
+    if (rc)
+        LOG_GOTO(send_error, rc, "Failed to send trace response");
+
+    return 0;
+
+free_trace:
+    json_decref(trace);
+free_resp:
+    free(resp_cont.resp);
+send_error:
+    _send_error(lrs, rc, req_cont);
+
+    return rc;
+}
+
 static int _process_monitor_request(struct lrs *lrs,
                                     const struct req_container *req_cont)
 {
@@ -431,6 +555,9 @@ static int _process_monitor_request(struct lrs *lrs,
     json_t *status;
     int rc;
 
+    if (req_cont->req->monitor->has_trace && req_cont->req->monitor->trace)
+        return _process_trace_request(lrs, req_cont);
+
     family = (enum rsc_family) req_cont->req->monitor->family;
 
     if (family < 0 || family >= PHO_RSC_LAST)
@@ -483,11 +610,17 @@ send_error:
 static int init_rwalloc_container(struct req_container *reqc)
 {
     struct rwalloc_params *rwalloc_params = &reqc->params.rwalloc;
+    bool is_mixed = pho_request_is_mixed(reqc->req);
     bool is_write = pho_request_is_write(reqc->req);
     size_t i;
     int rc;
 
-    if (is_write) {
+    if (is_mixed) {
+        /* write media first, then read media */
+        rwalloc_params->n_media = reqc->req->walloc->n_media +
+                                  reqc->req->ralloc->n_required;
+        rwalloc_params->original_n_req_media = reqc->req->ralloc->n_med_ids;
+    } else if (is_write) {
         rwalloc_params->n_media = reqc->req->walloc->n_media;
         rwalloc_params->original_n_req_media = reqc->req->walloc->n_media;
     } else {
@@ -508,12 +641,18 @@ static int init_rwalloc_container(struct req_container *reqc)
         GOTO(out_free_media, rc = -ENOMEM);
 
     rwalloc_params->respc->socket_id = reqc->socket_id;
+    rwalloc_params->respc->received_at = reqc->received_at;
+    rwalloc_params->respc->trace_id = reqc->trace_id;
     rwalloc_params->respc->resp = calloc(1,
                                          sizeof(*rwalloc_params->respc->resp));
     if (!rwalloc_params->respc->resp)
         GOTO(out_free_respc, rc = -ENOMEM);
 
-    if (is_write)
+    if (is_mixed)
+        rc = pho_srl_response_mixed_alloc(rwalloc_params->respc->resp,
+                                          reqc->req->ralloc->n_required,
+                                          reqc->req->walloc->n_media);
+    else if (is_write)
         rc = pho_srl_response_write_alloc(rwalloc_params->respc->resp,
                                           rwalloc_params->n_media);
     else
@@ -560,21 +699,21 @@ static int init_request_container_param(struct req_container *reqc)
     return 0;
 }
 
-static int update_phys_spc_free(struct dss_handle *dss,
-                                struct media_info *dss_media_info,
-                                size_t written_size)
+/**
+ * Update the phys_spc_free stat of the medium loaded in \p dev, it is written
+ * to the DSS later by the device thread.
+ *
+ * Must be called with dev->ld_mutex locked.
+ */
+static void update_phys_spc_free(struct lrs_dev *dev, size_t written_size)
 {
     if (written_size > 0) {
-        dss_media_info->stats.phys_spc_free -= written_size;
-        return dss_media_set(dss, dss_media_info, 1, DSS_SET_UPDATE,
-                             PHYS_SPC_FREE);
+        dev->ld_dss_media_info->stats.phys_spc_free -= written_size;
+        dev_media_stats_dirty(dev, PHYS_SPC_FREE);
     }
-
-    return 0;
 }
 
 static int release_medium(struct lrs_sched *sched,
-                          struct dss_handle *comm_dss,
                           struct req_container *reqc,
                           pho_req_release_elt_t *release,
                           size_t medium_index,
@@ -607,19 +746,9 @@ static int release_medium(struct lrs_sched *sched,
     }
 
     /* update media phys_spc_free stats in advance, before next sync */
-    /**
-     * TODO: we can save media status into DSS but we can also use local cached
-     * values.
-     *
-     * Many modifications are needed:
-     * - remove sched_load_dev_state from format/read/write
-     * - take into account current cached value for loaded media into
-     *   sched_select_medium
-     */
     MUTEX_LOCK(&dev->ld_mutex);
     if (release->rc == 0)
-        rc = update_phys_spc_free(comm_dss, dev->ld_dss_media_info,
-                                  release->size_written);
+        update_phys_spc_free(dev, release->size_written);
 
     /* Acknowledgement of the request */
     dev->ld_ongoing_io = false;
@@ -649,7 +778,6 @@ static int release_medium(struct lrs_sched *sched,
  * an error message.
  */
 static int process_release_request(struct lrs_sched *sched,
-                                   struct dss_handle *comm_dss,
                                    struct req_container *reqc)
 {
     int release_index = -1;
@@ -662,8 +790,8 @@ static int process_release_request(struct lrs_sched *sched,
         pho_req_release_elt_t *release_elt = reqc->req->release->media[i];
         int req_rc = 0;
 
-        rc = release_medium(sched, comm_dss, reqc, release_elt,
-                             release_index + 1, &req_rc);
+        rc = release_medium(sched, reqc, release_elt, release_index + 1,
+                            &req_rc);
         if (rc)
             /* system error, stop */
             break;
@@ -882,18 +1010,18 @@ static int _prepare_requests(struct lrs *lrs, bool *schedulers_to_signal,
 {
     enum rsc_family fam;
     int rc = 0;
+    int rc2;
     int i;
 
     for (i = 0; i < n_data; ++i) {
         struct req_container *req_cont;
-        int rc2;
 
         if (data[i].buf.size == -1) /* close notification, ignore */
             continue;
 
         req_cont = calloc(1, sizeof(*req_cont));
         if (!req_cont)
-            LOG_RETURN(-ENOMEM, "Cannot allocate request structure");
+            LOG_RETURN(rc = -ENOMEM, "Cannot allocate request structure");
 
         /* request processing */
         req_cont->socket_id = data[i].fd;
@@ -921,6 +1049,9 @@ static int _prepare_requests(struct lrs *lrs, bool *schedulers_to_signal,
                      "Unable to get CLOCK_REALTIME at request container init");
         }
 
+        req_cont->trace_id = lrs_trace_next_id();
+        lrs_trace_request(req_cont, LRS_TRACE_RECEIVED, NULL);
+
         fam = _determine_family(req_cont->req);
         if (fam == PHO_RSC_INVAL)
             LOG_GOTO(send_err, rc2 = -EINVAL,
@@ -935,7 +1066,7 @@ static int _prepare_requests(struct lrs *lrs, bool *schedulers_to_signal,
             LOG_GOTO(send_err, rc2, "Cannot init request container");
 
         if (pho_request_is_release(req_cont->req)) {
-            rc2 = process_release_request(lrs->sched[fam], &lrs->dss, req_cont);
+            rc2 = process_release_request(lrs->sched[fam], req_cont);
             rc = rc ? : rc2;
             if (!rc2)
                 schedulers_to_signal[fam] = true;
@@ -997,7 +1128,8 @@ static int _load_schedulers(struct lrs *lrs)
             if (!lrs->sched[family])
                 LOG_GOTO(out_free, rc = -ENOMEM,
                          "Error on lrs scheduler allocation");
-            rc = sched_init(lrs->sched[family], family, &lrs->response_queue);
+            rc = sched_init(lrs->sched[family], family, &lrs->response_queue,
+                            lrs->dss_pool);
             if (rc) {
                 free(lrs->sched[family]);
                 lrs->sched[family] = NULL;
@@ -1062,9 +1194,12 @@ static void lrs_fini(struct lrs *lrs)
         pho_error(rc, "Failed to close the phobosd socket");
 
     tsqueue_destroy(&lrs->response_queue, sched_resp_free_with_cont);
-    dss_fini(&lrs->dss);
+    dss_pool_fini(lrs->dss_pool);
+    lrs_metrics_fini(&lrs->metrics);
+    lrs_trace_fini();
 
     _delete_lock_file(lrs->lock_file);
+    free(lrs->lock_file);
 }
 
 /**
@@ -1081,18 +1216,34 @@ static void lrs_fini(struct lrs *lrs)
 static int lrs_init(struct lrs *lrs)
 {
     union pho_comm_addr sock_addr;
+    const char *lock_file;
+    int pool_size;
     int rc;
 
     umask(0000);
 
-    lrs->lock_file = PHO_CFG_GET(cfg_lrs, PHO_CFG_LRS, lock_file);
-    if (lrs->lock_file == NULL)
+    lock_file = PHO_CFG_GET(cfg_lrs, PHO_CFG_LRS, lock_file);
+    if (lock_file == NULL)
         LOG_RETURN(-ENODATA, "PHO_CFG_LRS_lock_file is not defined");
 
+    lrs->lock_file = strdup(lock_file);
+    if (lrs->lock_file == NULL)
+        LOG_RETURN(-errno, "Unable to copy the lock file path");
+
     rc = _create_lock_file(lrs->lock_file);
-    if (rc)
+    if (rc) {
+        free(lrs->lock_file);
         LOG_RETURN(rc, "Error while creating the daemon lock file %s",
-                   lrs->lock_file);
+                   lock_file);
+    }
+
+    rc = lrs_metrics_init(&lrs->metrics,
+                          PHO_CFG_GET(cfg_lrs, PHO_CFG_LRS, metrics_address));
+    if (rc) {
+        _delete_lock_file(lrs->lock_file);
+        free(lrs->lock_file);
+        LOG_RETURN(rc, "Failed to start the metrics exporter");
+    }
 
     rc = tsqueue_init(&lrs->response_queue);
     if (rc)
@@ -1100,6 +1251,17 @@ static int lrs_init(struct lrs *lrs)
 
     lrs->stopped = false;
 
+    pool_size = PHO_CFG_GET_INT(cfg_lrs, PHO_CFG_LRS, dss_pool_size, -1);
+    if (pool_size < 0)
+        LOG_GOTO(err, rc = -EINVAL,
+                 "Invalid value for PHO_CFG_LRS_dss_pool_size");
+
+    if (pool_size > 0) {
+        rc = dss_pool_init(&lrs->dss_pool, pool_size);
+        if (rc)
+            LOG_GOTO(err, rc, "Failed to init DSS connection pool");
+    }
+
     rc = _load_schedulers(lrs);
     if (rc)
         LOG_GOTO(err, rc, "Error while loading the schedulers");
@@ -1109,10 +1271,6 @@ static int lrs_init(struct lrs *lrs)
     if (rc)
         LOG_GOTO(err, rc, "Failed to open the phobosd socket");
 
-    rc = dss_init(&lrs->dss);
-    if (rc)
-        LOG_GOTO(err, rc, "Failed to init comm dss handle");
-
     return rc;
 
 err:
@@ -1231,12 +1389,16 @@ int main(int argc, char **argv)
         if (lrs_init_done)
             lrs_fini(&lrs);
 
+        daemon_fini();
         return -rc;
     }
 
-    while (running || !lrs.stopped)
+    while (running || !lrs.stopped) {
+        daemon_reload_config();
         lrs_process(&lrs);
+    }
 
     lrs_fini(&lrs);
+    daemon_fini();
     return EXIT_SUCCESS;
 }
@@ -77,6 +77,21 @@ const struct pho_config_item cfg_lrs[] = {
         .name    = "sync_wsize_kb",
         .value   = "tape=1048576,dir=1048576,rados_pool=1048576"
     },
+    [PHO_CFG_LRS_stats_flush_time_ms] = {
+        .section = "lrs",
+        .name    = "stats_flush_time_ms",
+        .value   = "tape=10000,dir=1000,rados_pool=1000"
+    },
+    [PHO_CFG_LRS_dss_pool_size] = {
+        .section = "lrs",
+        .name    = "dss_pool_size",
+        .value   = "16"
+    },
+    [PHO_CFG_LRS_metrics_address] = {
+        .section = "lrs",
+        .name    = "metrics_address",
+        .value   = ""
+    },
 };
 
 static int _get_substring_value_from_token(const char *cfg_param,
@@ -152,14 +167,14 @@ static int _get_unsigned_long_from_string(const char *value,
     return 0;
 }
 
-int get_cfg_sync_time_ms_value(enum rsc_family family,
-                               struct timespec *threshold)
+static int _get_timespec_ms_value(const char *cfg_param, enum rsc_family family,
+                                  struct timespec *threshold)
 {
     unsigned long num_milliseconds;
     char *value;
     int rc;
 
-    rc = _get_substring_value_from_token("sync_time_ms", family, &value);
+    rc = _get_substring_value_from_token(cfg_param, family, &value);
     if (rc)
         return rc;
 
@@ -174,6 +189,18 @@ int get_cfg_sync_time_ms_value(enum rsc_family family,
     return 0;
 }
 
+int get_cfg_sync_time_ms_value(enum rsc_family family,
+                               struct timespec *threshold)
+{
+    return _get_timespec_ms_value("sync_time_ms", family, threshold);
+}
+
+int get_cfg_stats_flush_time_ms_value(enum rsc_family family,
+                                      struct timespec *threshold)
+{
+    return _get_timespec_ms_value("stats_flush_time_ms", family, threshold);
+}
+
 int get_cfg_sync_nb_req_value(enum rsc_family family, unsigned int *threshold)
 {
     unsigned long ul_value;
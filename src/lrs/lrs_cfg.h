@@ -42,6 +42,9 @@ enum pho_cfg_params_lrs {
     PHO_CFG_LRS_sync_time_ms,
     PHO_CFG_LRS_sync_nb_req,
     PHO_CFG_LRS_sync_wsize_kb,
+    PHO_CFG_LRS_stats_flush_time_ms,
+    PHO_CFG_LRS_dss_pool_size,
+    PHO_CFG_LRS_metrics_address,
 
     PHO_CFG_LRS_LAST
 };
@@ -79,4 +82,16 @@ int get_cfg_sync_nb_req_value(enum rsc_family family, unsigned int *threshold);
  */
 int get_cfg_sync_wsize_value(enum rsc_family family, unsigned long *threshold);
 
+/**
+ * Getter of the maximum delay before media statistics updates are flushed to
+ * the DSS for a given family.
+ *
+ * @param[in]   family      Targeted family.
+ * @param[out]  threshold   Returned threshold value.
+ * @return                  0 on success,
+ *                         -errno on failure.
+ */
+int get_cfg_stats_flush_time_ms_value(enum rsc_family family,
+                                      struct timespec *threshold);
+
 #endif
@@ -30,7 +30,9 @@
 
 #include "lrs_cfg.h"
 #include "lrs_device.h"
+#include "lrs_metrics.h"
 #include "lrs_sched.h"
+#include "lrs_trace.h"
 
 #include "pho_common.h"
 #include "pho_daemon.h"
@@ -71,6 +73,11 @@ int lrs_dev_hdl_init(struct lrs_dev_hdl *handle, enum rsc_family family)
     if (rc)
         return rc;
 
+    rc = get_cfg_stats_flush_time_ms_value(family,
+                                           &handle->stats_flush_time_ms);
+    if (rc)
+        return rc;
+
     return 0;
 }
 
@@ -96,7 +103,7 @@ static int lrs_dev_init_from_info(struct lrs_dev_hdl *handle,
 
     sync_params_init(&(*dev)->ld_sync_params);
 
-    rc = dss_init(&(*dev)->ld_device_thread.dss);
+    rc = thread_dss_init(&(*dev)->ld_device_thread, sched->dss_pool);
     if (rc)
         GOTO(err_info, rc);
 
@@ -138,7 +145,7 @@ static int lrs_dev_init_from_info(struct lrs_dev_hdl *handle,
 err_techno:
     free((void *)(*dev)->ld_technology);
 err_dss:
-    dss_fini(&(*dev)->ld_device_thread.dss);
+    thread_dss_fini(&(*dev)->ld_device_thread);
 err_info:
     g_ptr_array_free((*dev)->ld_sync_params.tosync_array, true);
     dev_info_free((*dev)->ld_dss_dev_info, 1);
@@ -179,7 +186,7 @@ static void lrs_dev_info_clean(struct lrs_dev_hdl *handle,
     g_ptr_array_unref(dev->ld_sync_params.tosync_array);
     sub_request_free(dev->ld_sub_request);
     dev_info_free(dev->ld_dss_dev_info, 1);
-    dss_fini(&dev->ld_device_thread.dss);
+    thread_dss_fini(&dev->ld_device_thread);
 
     free(dev);
 }
@@ -423,6 +430,22 @@ static int compute_wakeup_date(struct lrs_dev *dev, struct timespec *date)
             *date = add_timespec(&MINSLEEP, &now);
     }
 
+    /* wake up in time to flush the pending media statistics */
+    MUTEX_LOCK(&dev->ld_mutex);
+    if (dev->ld_stats_update.fields) {
+        struct timespec flush_date;
+
+        flush_date = add_timespec(&dev->ld_stats_update.oldest_update,
+                                  &dev->ld_handle->stats_flush_time_ms);
+        if (cmp_timespec(&flush_date, date) == -1) {
+            *date = flush_date;
+            diff = diff_timespec(date, &now);
+            if (cmp_timespec(&diff, &MINSLEEP) == -1)
+                *date = add_timespec(&MINSLEEP, &now);
+        }
+    }
+    MUTEX_UNLOCK(&dev->ld_mutex);
+
     return 0;
 }
 
@@ -459,6 +482,8 @@ int queue_release_response(struct tsqueue *response_queue,
         LOG_GOTO(err, rc = -ENOMEM, "Unable to allocate respc");
 
     respc->socket_id = reqc->socket_id;
+    respc->received_at = reqc->received_at;
+    respc->trace_id = reqc->trace_id;
     respc->resp = malloc(sizeof(*respc->resp));
     if (!respc->resp)
         LOG_GOTO(err_respc, rc = -ENOMEM, "Unable to allocate respc->resp");
@@ -734,6 +759,183 @@ static void check_needs_sync(struct lrs_dev_hdl *handle, struct lrs_dev *dev)
     MUTEX_UNLOCK(&dev->ld_mutex);
 }
 
+static void media_stats_mark_dirty(struct lrs_dev *dev, uint64_t fields)
+{
+    struct media_stats_update *update = &dev->ld_stats_update;
+    bool was_clean = !update->fields;
+
+    /* an absolute value supersedes the pending increments */
+    if (fields & NB_OBJ) {
+        update->fields &= ~NB_OBJ_ADD;
+        update->increments.nb_obj = 0;
+    }
+
+    if (fields & LOGC_SPC_USED) {
+        update->fields &= ~LOGC_SPC_USED_ADD;
+        update->increments.logc_spc_used = 0;
+    }
+
+    update->fields |= fields;
+
+    if (was_clean) {
+        if (clock_gettime(CLOCK_REALTIME, &update->oldest_update))
+            pho_error(-errno, "Unable to get CLOCK_REALTIME");
+
+        /* the device thread may be sleeping past the flush delay */
+        thread_signal(&dev->ld_device_thread);
+    }
+}
+
+void dev_media_stats_dirty(struct lrs_dev *dev, uint64_t fields)
+{
+    assert(!(fields & (NB_OBJ_ADD | LOGC_SPC_USED_ADD | NB_LOAD_ADD |
+                       NB_ERRORS_ADD)));
+
+    media_stats_mark_dirty(dev, fields);
+}
+
+/**
+ * Add \p value to the \p field stat of the loaded medium, and to the
+ * increments to flush to the DSS.
+ *
+ * Must be called with dev->ld_mutex locked.
+ */
+static void dev_media_stats_add(struct lrs_dev *dev, uint64_t field,
+                                long long value)
+{
+    struct media_stats *increments = &dev->ld_stats_update.increments;
+    struct media_stats *stats = &dev->ld_dss_media_info->stats;
+
+    if (!value)
+        return;
+
+    switch (field) {
+    case NB_OBJ_ADD:
+        stats->nb_obj += value;
+        /* a pending absolute value already includes the increment */
+        if (dev->ld_stats_update.fields & NB_OBJ)
+            return;
+        increments->nb_obj += value;
+        break;
+    case LOGC_SPC_USED_ADD:
+        stats->logc_spc_used += value;
+        if (dev->ld_stats_update.fields & LOGC_SPC_USED)
+            return;
+        increments->logc_spc_used += value;
+        break;
+    case NB_LOAD_ADD:
+        stats->nb_load += value;
+        increments->nb_load += value;
+        break;
+    case NB_ERRORS_ADD:
+        stats->nb_errors += value;
+        increments->nb_errors += value;
+        break;
+    default:
+        assert(false);
+    }
+
+    media_stats_mark_dirty(dev, field);
+}
+
+/**
+ * Write the pending statistics updates of the loaded medium to the DSS, along
+ * with the other \p fields of dev->ld_dss_media_info, in a single update.
+ *
+ * Must be called with dev->ld_mutex locked. On failure, the updates are kept
+ * pending and will be retried after another flush delay.
+ */
+static int dev_media_stats_flush(struct lrs_dev *dev, uint64_t fields)
+{
+    struct media_stats_update *update = &dev->ld_stats_update;
+    struct media_info media_update;
+    int rc;
+
+    if (!dev->ld_dss_media_info)
+        return 0;
+
+    fields |= update->fields;
+    if (!fields)
+        return 0;
+
+    /* The DSS adds the increments to the stored values by itself */
+    media_update = *dev->ld_dss_media_info;
+    if (fields & NB_OBJ_ADD)
+        media_update.stats.nb_obj = update->increments.nb_obj;
+    if (fields & LOGC_SPC_USED_ADD)
+        media_update.stats.logc_spc_used = update->increments.logc_spc_used;
+    media_update.stats.nb_load = update->increments.nb_load;
+    media_update.stats.nb_errors = update->increments.nb_errors;
+
+    rc = dss_media_set(&dev->ld_device_thread.dss, &media_update, 1,
+                       DSS_SET_UPDATE, fields);
+    if (rc) {
+        if (update->fields &&
+            clock_gettime(CLOCK_REALTIME, &update->oldest_update))
+            pho_error(-errno, "Unable to get CLOCK_REALTIME");
+
+        LOG_RETURN(rc, "Cannot write statistics of medium '%s' to the DSS",
+                   dev->ld_dss_media_info->rsc.id.name);
+    }
+
+    memset(update, 0, sizeof(*update));
+    return 0;
+}
+
+/**
+ * Flush the pending statistics updates of the loaded medium if the oldest one
+ * is older than the flush delay, or if the device is stopping.
+ *
+ * A failure is not fatal for the device: the updates are retried later.
+ */
+static void dev_media_stats_flush_if_due(struct lrs_dev *dev)
+{
+    struct media_stats_update *update = &dev->ld_stats_update;
+    int rc;
+
+    MUTEX_LOCK(&dev->ld_mutex);
+    if (update->fields &&
+        (thread_is_stopping(&dev->ld_device_thread) ||
+         is_past(add_timespec(&update->oldest_update,
+                              &dev->ld_handle->stats_flush_time_ms)))) {
+        rc = dev_media_stats_flush(dev, 0);
+        if (rc)
+            pho_error(rc, "Statistics of medium '%s' will be written later",
+                      dev->ld_dss_media_info->rsc.id.name);
+    }
+    MUTEX_UNLOCK(&dev->ld_mutex);
+}
+
+/**
+ * Give the pooled DSS connection of the device thread back during an
+ * operation on the device that may take minutes (tape load, mount, sync...),
+ * so that the other device threads can use it meanwhile. The connection is
+ * taken again by dev_dss_resume() before the next DSS call.
+ */
+static void dev_dss_pause(struct lrs_dev *dev)
+{
+    thread_dss_release(&dev->ld_device_thread);
+}
+
+/**
+ * Take a pooled DSS connection again after dev_dss_pause().
+ *
+ * The device thread may hold dev->ld_mutex while waiting here: this cannot
+ * deadlock as the threads taking that mutex either have their own connection
+ * (scheduler, communication) or do not wait for another device.
+ */
+static int dev_dss_resume(struct lrs_dev *dev)
+{
+    int rc;
+
+    rc = thread_dss_acquire(&dev->ld_device_thread);
+    if (rc)
+        pho_error(rc, "device '%s': cannot get a DSS connection back",
+                  dev->ld_dss_dev_info->rsc.id.name);
+
+    return rc;
+}
+
 static int medium_sync(struct media_info *media_info, const char *fsroot)
 {
     struct io_adapter_module *ioa;
@@ -754,12 +956,24 @@ static int medium_sync(struct media_info *media_info, const char *fsroot)
     return rc;
 }
 
-/** Update media_info stats and push its new state to the DSS */
-static int lrs_dev_media_update(struct dss_handle *dss,
-                                struct media_info *media_info,
-                                size_t size_written, int media_rc,
-                                const char *fsroot, long long nb_new_obj)
+/** Increment the counter \p metric of \p dev, see lrs_metrics.h */
+static void dev_metric_inc(struct lrs_dev *dev, enum lrs_metric metric)
 {
+    lrs_metric_add(metric, rsc_family2str(dev->ld_dss_dev_info->rsc.id.family),
+                   dev->ld_dss_dev_info->rsc.id.name, 1);
+}
+
+/**
+ * Update the loaded medium after a sync and push its new state to the DSS,
+ * along with its pending statistics updates.
+ *
+ * Must be called with dev->ld_mutex locked.
+ */
+static int lrs_dev_media_update(struct lrs_dev *dev, size_t size_written,
+                                int media_rc, long long nb_new_obj)
+{
+    struct media_info *media_info = dev->ld_dss_media_info;
+    const char *fsroot = dev->ld_mnt_path;
     struct ldm_fs_space space = {0};
     struct fs_adapter_module *fsa;
     uint64_t fields = 0;
@@ -792,7 +1006,7 @@ static int lrs_dev_media_update(struct dss_handle *dss,
         } else {
             media_info->stats.phys_spc_used = space.spc_used;
             media_info->stats.phys_spc_free = space.spc_avail;
-            fields |= PHYS_SPC_USED | PHYS_SPC_FREE;
+            dev_media_stats_dirty(dev, PHYS_SPC_USED | PHYS_SPC_FREE);
             if (media_info->stats.phys_spc_free == 0) {
                 media_info->fs.status = PHO_FS_STATUS_FULL;
                 fields |= FS_STATUS;
@@ -806,21 +1020,18 @@ static int lrs_dev_media_update(struct dss_handle *dss,
                   media_info->rsc.id.name);
         fields |= ADM_STATUS;
     } else {
-        if (nb_new_obj) {
-            media_info->stats.nb_obj = nb_new_obj;
-            fields |= NB_OBJ_ADD;
-        }
-
-        if (size_written) {
-            media_info->stats.logc_spc_used = size_written;
-            fields |= LOGC_SPC_USED_ADD;
-        }
+        dev_media_stats_add(dev, NB_OBJ_ADD, nb_new_obj);
+        dev_media_stats_add(dev, LOGC_SPC_USED_ADD, size_written);
+        lrs_metric_add(LRS_METRIC_MEDIUM_WRITTEN_BYTES,
+                       rsc_family2str(media_info->rsc.id.family),
+                       media_info->rsc.id.name, size_written);
     }
 
-    /* TODO update nb_load, nb_errors, last_load */
+    if (fields & ADM_STATUS)
+        dev_media_stats_add(dev, NB_ERRORS_ADD, 1);
 
-    assert(fields);
-    rc2 = dss_media_set(dss, media_info, 1, DSS_SET_UPDATE, fields);
+    /* A sync always writes the medium state and statistics to the DSS */
+    rc2 = dev_media_stats_flush(dev, fields);
     if (rc2)
         rc = rc ? : rc2;
 
@@ -837,15 +1048,19 @@ static int dev_sync(struct lrs_dev *dev)
     MUTEX_LOCK(&dev->ld_mutex);
 
     /* Do not sync on error as we don't know what happened on the tape. */
-    if (dev->ld_last_client_rc == 0)
+    if (dev->ld_last_client_rc == 0) {
+        dev_dss_pause(dev);
         rc = medium_sync(dev->ld_dss_media_info, dev->ld_mnt_path);
-    else
+        rc2 = dev_dss_resume(dev);
+        if (!rc)
+            dev_metric_inc(dev, LRS_METRIC_DEVICE_SYNCS);
+        rc = rc ? : rc2;
+    } else {
         /* this will cause the device thread to stop */
         rc = dev->ld_last_client_rc;
+    }
 
-    rc2 = lrs_dev_media_update(&dev->ld_device_thread.dss,
-                               dev->ld_dss_media_info,
-                               sync_params->tosync_size, rc, dev->ld_mnt_path,
+    rc2 = lrs_dev_media_update(dev, sync_params->tosync_size, rc,
                                sync_params->tosync_array->len);
     dev->ld_last_client_rc = 0;
 
@@ -885,7 +1100,10 @@ static int dev_umount(struct lrs_dev *dev)
                  "device '%s'", fs_type_names[dev->ld_dss_media_info->fs.type],
                  dev->ld_dss_media_info->rsc.id.name, dev->ld_dev_path);
 
+    dev_dss_pause(dev);
     rc = ldm_fs_umount(fsa, dev->ld_dev_path, dev->ld_mnt_path);
+    rc2 = dev_dss_resume(dev);
+    rc = rc ? : rc2;
     rc2 = clean_tosync_array(dev, rc);
     if (rc)
         LOG_GOTO(out, rc, "Failed to unmount device '%s' mounted at '%s'",
@@ -970,9 +1188,12 @@ int dev_unload(struct lrs_dev *dev)
                  "'%s'", rsc_family_names[dev->ld_dss_dev_info->rsc.id.family],
                  dev->ld_dss_media_info->rsc.id.name, dev->ld_dev_path);
 
+    dev_dss_pause(dev);
     rc = ldm_lib_media_move(&lib_hdl, &dev->ld_lib_dev_info.ldi_addr,
                             &free_slot, log.message);
+    rc2 = dev_dss_resume(dev);
     log.error_number = rc;
+    rc = rc ? : rc2;
     if (rc != 0)
         /* Set operational failure state on this drive. It is incomplete since
          * the error can originate from a defective tape too...
@@ -984,6 +1205,12 @@ int dev_unload(struct lrs_dev *dev)
 
     MUTEX_LOCK(&dev->ld_mutex);
     dev->ld_op_status = PHO_DEV_OP_ST_EMPTY;
+    /* the pending statistics cannot be kept once the medium is unloaded */
+    rc2 = dev_media_stats_flush(dev, 0);
+    if (rc2)
+        pho_error(rc2, "Statistics updates of medium '%s' are lost",
+                  dev->ld_dss_media_info->rsc.id.name);
+    memset(&dev->ld_stats_update, 0, sizeof(dev->ld_stats_update));
     medium_to_unlock_free = dev->ld_dss_media_info;
     dev->ld_dss_media_info = NULL;
     MUTEX_UNLOCK(&dev->ld_mutex);
@@ -995,6 +1222,7 @@ out_close:
 
 out:
     if (!rc) {
+        dev_metric_inc(dev, LRS_METRIC_DEVICE_UNLOADS);
         rc = dss_medium_release(&dev->ld_device_thread.dss,
                                 medium_to_unlock_free);
         media_info_free(medium_to_unlock_free);
@@ -1043,18 +1271,38 @@ static int dev_empty(struct lrs_dev *dev)
 static int dss_set_medium_to_failed(struct dss_handle *dss,
                                     struct media_info *media_info)
 {
+    struct media_info media_update;
+
     pho_error(0, "setting medium '%s' to failed", media_info->rsc.id.name);
     media_info->rsc.adm_status = PHO_RSC_ADM_ST_FAILED;
-    return dss_media_set(dss, media_info, 1, DSS_SET_UPDATE, ADM_STATUS);
+    media_info->stats.nb_errors++;
+
+    /* The DSS adds the increment to the stored value by itself */
+    media_update = *media_info;
+    media_update.stats.nb_errors = 1;
+    return dss_media_set(dss, &media_update, 1, DSS_SET_UPDATE,
+                         ADM_STATUS | NB_ERRORS_ADD);
 }
 
 static void fail_release_free_medium(struct lrs_dev *dev,
                                      struct media_info **medium,
                                      bool free_medium)
 {
+    bool loaded = (medium == &dev->ld_dss_media_info);
     int rc;
 
-    rc = dss_set_medium_to_failed(&dev->ld_device_thread.dss, *medium);
+    if (loaded) {
+        /* write the pending statistics along with the failure */
+        MUTEX_LOCK(&dev->ld_mutex);
+        pho_error(0, "setting medium '%s' to failed", (*medium)->rsc.id.name);
+        (*medium)->rsc.adm_status = PHO_RSC_ADM_ST_FAILED;
+        dev_media_stats_add(dev, NB_ERRORS_ADD, 1);
+        rc = dev_media_stats_flush(dev, ADM_STATUS);
+        MUTEX_UNLOCK(&dev->ld_mutex);
+    } else {
+        rc = dss_set_medium_to_failed(&dev->ld_device_thread.dss, *medium);
+    }
+
     if (rc) {
         pho_error(rc,
                   "Warning we keep medium %s locked because we can't set it to "
@@ -1071,6 +1319,8 @@ static void fail_release_free_medium(struct lrs_dev *dev,
         MUTEX_LOCK(&dev->ld_mutex);
         media_info_free(*medium);
         *medium = NULL;
+        if (loaded)
+            memset(&dev->ld_stats_update, 0, sizeof(dev->ld_stats_update));
         MUTEX_UNLOCK(&dev->ld_mutex);
     }
 }
@@ -1137,9 +1387,12 @@ int dev_load(struct lrs_dev *dev, struct media_info **medium,
 
     destroy_json(medium_lookup_json);
 
+    dev_dss_pause(dev);
     rc = ldm_lib_media_move(&lib_hdl, &medium_addr,
                             &dev->ld_lib_dev_info.ldi_addr, log.message);
+    rc2 = dev_dss_resume(dev);
     log.error_number = rc;
+    rc = rc ? : rc2;
     /* A movement from drive to drive can be prohibited by some libraries.
      * If a failure is encountered in such a situation, it probably means that
      * the state of the library has changed between the moment it has been
@@ -1175,6 +1428,9 @@ int dev_load(struct lrs_dev *dev, struct media_info **medium,
     MUTEX_LOCK(&dev->ld_mutex);
     dev->ld_op_status = PHO_DEV_OP_ST_LOADED;
     dev->ld_dss_media_info = *medium;
+    dev->ld_dss_media_info->stats.last_load = time(NULL);
+    dev_media_stats_dirty(dev, LAST_LOAD);
+    dev_media_stats_add(dev, NB_LOAD_ADD, 1);
     if (free_medium)
         *medium = NULL;
     MUTEX_UNLOCK(&dev->ld_mutex);
@@ -1215,13 +1471,17 @@ static int dev_format(struct lrs_dev *dev, struct fs_adapter_module *fsa,
     struct media_info *medium = dev->ld_dss_media_info;
     struct ldm_fs_space space = {0};
     uint64_t fields = 0;
+    int rc2;
     int rc;
 
     ENTRY;
 
     pho_verb("format: medium '%s'", medium->rsc.id.name);
 
+    dev_dss_pause(dev);
     rc = ldm_fs_format(fsa, dev->ld_dev_path, medium->rsc.id.name, &space);
+    rc2 = dev_dss_resume(dev);
+    rc = rc ? : rc2;
     if (rc)
         LOG_RETURN(rc, "Cannot format medium '%s'", medium->rsc.id.name);
 
@@ -1235,7 +1495,8 @@ static int dev_format(struct lrs_dev *dev, struct fs_adapter_module *fsa,
     medium->stats.logc_spc_used = 0;
     medium->stats.phys_spc_used = space.spc_used;
     medium->stats.phys_spc_free = space.spc_avail;
-    fields |= NB_OBJ | LOGC_SPC_USED | PHYS_SPC_USED | PHYS_SPC_FREE;
+    dev_media_stats_dirty(dev, NB_OBJ | LOGC_SPC_USED | PHYS_SPC_USED |
+                               PHYS_SPC_FREE);
 
     /* Post operation: update media information in DSS */
     medium->fs.status = PHO_FS_STATUS_EMPTY;
@@ -1248,9 +1509,8 @@ static int dev_format(struct lrs_dev *dev, struct fs_adapter_module *fsa,
         fields |= ADM_STATUS;
     }
 
+    rc = dev_media_stats_flush(dev, fields);
     MUTEX_UNLOCK(&dev->ld_mutex);
-    rc = dss_media_set(&dev->ld_device_thread.dss, medium, 1, DSS_SET_UPDATE,
-                       fields);
     if (rc != 0)
         LOG_RETURN(rc, "Failed to update state of media '%s' after format",
                    medium->rsc.id.name);
@@ -1268,6 +1528,8 @@ static int queue_format_response(struct tsqueue *response_queue,
         LOG_GOTO(send_err, rc = -ENOMEM, "Unable to allocate format respc");
 
     respc->socket_id = reqc->socket_id;
+    respc->received_at = reqc->received_at;
+    respc->trace_id = reqc->trace_id;
     respc->resp = malloc(sizeof(*respc->resp));
     if (!respc->resp)
         LOG_GOTO(err_respc, rc = -ENOMEM,
@@ -1362,6 +1624,8 @@ static int dev_handle_format(struct lrs_dev *dev)
         }
     }
 
+    lrs_trace_request(reqc, LRS_TRACE_MEDIUM_READY,
+                      dev->ld_dss_media_info->rsc.id.name);
     rc = dev_format(dev, reqc->params.format.fsa, reqc->req->format->unlock);
 
 out_response:
@@ -1462,14 +1726,16 @@ static bool cancel_subrequest_on_error(struct sub_request *sub_request)
 static int fill_rwalloc_resp_container(struct lrs_dev *dev,
                                        struct sub_request *sub_request)
 {
-    struct resp_container *respc = sub_request->reqc->params.rwalloc.respc;
+    struct req_container *reqc = sub_request->reqc;
+    struct resp_container *respc = reqc->params.rwalloc.respc;
     pho_resp_t *resp = respc->resp;
     int rc = 0;
 
-    if (pho_request_is_read(sub_request->reqc->req)) {
+    if (!rwalloc_index_is_write(reqc, sub_request->medium_index)) {
+        size_t index = rwalloc_read_index(reqc, sub_request->medium_index);
         pho_resp_read_elt_t *rresp;
 
-        rresp = resp->ralloc->media[sub_request->medium_index];
+        rresp = resp->ralloc->media[index];
         rresp->fs_type = dev->ld_dss_media_info->fs.type;
         rresp->addr_type = dev->ld_dss_media_info->addr_type;
         rresp->root_path = strdup(dev->ld_mnt_path);
@@ -1523,7 +1789,7 @@ static bool rwalloc_can_be_requeued(struct sub_request *sub_request)
     struct req_container *reqc = sub_request->reqc;
     pho_req_read_t *ralloc;
 
-    if (pho_request_is_write(reqc->req))
+    if (rwalloc_index_is_write(reqc, sub_request->medium_index))
         return true;
 
     if (!sub_request->failure_on_medium)
@@ -1667,6 +1933,7 @@ static int dev_mount(struct lrs_dev *dev)
     struct fs_adapter_module *fsa;
     char *mnt_root;
     const char *id;
+    int rc2;
     int rc;
 
     rc = get_fs_adapter(dev->ld_dss_media_info->fs.type, &fsa);
@@ -1702,13 +1969,18 @@ static int dev_mount(struct lrs_dev *dev)
              dev->ld_dss_dev_info->rsc.id.name,
              mnt_root);
 
+    dev_dss_pause(dev);
     rc = ldm_fs_mount(fsa, dev->ld_dev_path, mnt_root,
                       dev->ld_dss_media_info->fs.label);
+    rc2 = dev_dss_resume(dev);
+    rc = rc ? : rc2;
     if (rc)
         LOG_GOTO(out_free, rc, "Failed to mount '%s' in device '%s'",
                  dev->ld_dss_media_info->rsc.id.name,
                  dev->ld_dev_path);
 
+    dev_metric_inc(dev, LRS_METRIC_DEVICE_MOUNTS);
+
     /* update device state and set mount point */
     MUTEX_LOCK(&dev->ld_mutex);
     dev->ld_op_status = PHO_DEV_OP_ST_MOUNTED;
@@ -1846,7 +2118,7 @@ mount:
      * damaged disks. Mark the media as full, let it be mounted and try to find
      * a new one.
      */
-    if (pho_request_is_write(reqc->req) &&
+    if (rwalloc_index_is_write(reqc, sub_request->medium_index) &&
         !dev_mount_is_writable(dev->ld_mnt_path,
                                dev->ld_dss_media_info->fs.type)) {
         pho_warn("Media '%s' OK but mounted R/O, marking full and retrying...",
@@ -1857,10 +2129,8 @@ mount:
 
         MUTEX_LOCK(&dev->ld_mutex);
         dev->ld_dss_media_info->fs.status = PHO_FS_STATUS_FULL;
+        rc2 = dev_media_stats_flush(dev, FS_STATUS);
         MUTEX_UNLOCK(&dev->ld_mutex);
-        rc2 = dss_media_set(&dev->ld_device_thread.dss,
-                            dev->ld_dss_media_info, 1,
-                            DSS_SET_UPDATE, FS_STATUS);
         if (rc2) {
             rc = rc2;
             failure_on_device = true;
@@ -1871,6 +2141,10 @@ mount:
 
 
 alloc_result:
+    if (!rc)
+        lrs_trace_request(reqc, LRS_TRACE_MEDIUM_READY,
+                          dev->ld_dss_media_info->rsc.id.name);
+
     MUTEX_LOCK(&dev->ld_mutex);
     locked = true;
     rc2 = handle_rwalloc_sub_request_result(dev, sub_request, rc,
@@ -1993,6 +2267,22 @@ static void cancel_pending_format(struct lrs_dev *device)
     device->ld_sub_request = NULL;
 }
 
+/**
+ * Write the pending statistics of the loaded medium to the DSS at device
+ * thread end, whatever the delay since their update.
+ */
+static void dev_thread_end_media_stats(struct lrs_dev *device)
+{
+    int rc;
+
+    MUTEX_LOCK(&device->ld_mutex);
+    rc = dev_media_stats_flush(device, 0);
+    if (rc)
+        pho_error(rc, "Statistics updates of medium '%s' are lost",
+                  device->ld_dss_media_info->rsc.id.name);
+    MUTEX_UNLOCK(&device->ld_mutex);
+}
+
 /**
  * Manage a mounted medium at device thread end.
  *
@@ -2147,6 +2437,7 @@ static void dev_thread_end(struct lrs_dev *device)
     }
 
     cancel_pending_format(device);
+    dev_thread_end_media_stats(device);
     dev_thread_end_mounted_medium(device);
     dev_thread_end_loaded_medium(device);
     dev_thread_end_device(device);
@@ -2165,6 +2456,12 @@ static void *lrs_dev_thread(void *tdata)
     while (!thread_is_stopped(thread)) {
         int rc = 0;
 
+        rc = thread_dss_acquire(thread);
+        if (rc)
+            LOG_GOTO(end_thread, thread->status = rc,
+                     "device thread '%s': cannot get a DSS connection",
+                     device->ld_dss_dev_info->rsc.id.name);
+
         if (device->ld_sub_request &&
             cancel_subrequest_on_error(device->ld_sub_request)) {
             MUTEX_LOCK(&device->ld_mutex);
@@ -2177,6 +2474,8 @@ static void *lrs_dev_thread(void *tdata)
         if (!device->ld_needs_sync)
             check_needs_sync(device->ld_handle, device);
 
+        dev_media_stats_flush_if_due(device);
+
         if (thread_is_stopping(thread) && !device->ld_ongoing_io &&
             !device->ld_sub_request &&
             device->ld_sync_params.tosync_array->len == 0) {
@@ -2216,6 +2515,8 @@ static void *lrs_dev_thread(void *tdata)
         }
 
         if (!thread_is_stopped(thread)) {
+            /* do not hold a pooled connection while idle */
+            thread_dss_release(thread);
             rc = dev_wait_for_signal(device);
             if (rc < 0)
                 LOG_GOTO(end_thread, thread->status = rc,
@@ -2225,7 +2526,13 @@ static void *lrs_dev_thread(void *tdata)
     }
 
 end_thread:
+    /* the DSS locks of the device and its medium are released below */
+    if (thread_dss_acquire(thread))
+        pho_warn("device thread '%s': no DSS connection to clean up at exit",
+                 device->ld_dss_dev_info->rsc.id.name);
+
     dev_thread_end(device);
+    thread_dss_release(thread);
     pthread_exit(&device->ld_device_thread.status);
 }
 
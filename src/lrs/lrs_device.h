@@ -55,6 +55,10 @@ struct lrs_dev_hdl {
     unsigned long   sync_wsize_kb; /**< Written size threshold for
                                      *  medium synchronization
                                      */
+    struct timespec stats_flush_time_ms; /**< Maximum delay before media
+                                           *  statistics updates are flushed
+                                           *  to the DSS
+                                           */
 };
 
 /** Request pushed to a device */
@@ -154,6 +158,21 @@ struct sync_params {
                                       */
 };
 
+/**
+ * Statistics updates of the loaded medium not written to the DSS yet.
+ *
+ * The values of the absolute stat fields are the ones of ld_dss_media_info,
+ * which is kept up to date by the LRS. Only the increments of the *_ADD
+ * fields are accumulated here.
+ */
+struct media_stats_update {
+    uint64_t            fields;         /**< DSS media fields to flush */
+    struct media_stats  increments;     /**< Values of the *_ADD fields */
+    struct timespec     oldest_update;  /**< Date of the oldest update not
+                                          *  flushed
+                                          */
+};
+
 /**
  * Data specific to the device thread.
  */
@@ -187,6 +206,10 @@ struct lrs_dev {
     struct sync_params   ld_sync_params;        /**< pending synchronization
                                                   * requests
                                                   */
+    struct media_stats_update ld_stats_update;  /**< pending statistics
+                                                  * updates of the loaded
+                                                  * medium
+                                                  */
     struct tsqueue      *ld_response_queue;     /**< reference to the response
                                                   * queue
                                                   */
@@ -247,6 +270,18 @@ static inline bool is_device_shared_between_schedulers(struct lrs_dev *dev)
     return __builtin_popcount(dev->ld_io_request_type & 0b111) != 0;
 }
 
+/**
+ * Record that some stat fields of the medium loaded in \p dev were updated in
+ * dev->ld_dss_media_info, to be written to the DSS by the device thread
+ * within the stats_flush_time_ms delay.
+ *
+ * Must be called with dev->ld_mutex locked.
+ *
+ * \param[in,out]   dev     device holding the updated medium
+ * \param[in]       fields  absolute stat fields updated (no *_ADD field)
+ */
+void dev_media_stats_dirty(struct lrs_dev *dev, uint64_t fields);
+
 /**
  *  TODO: will become a device thread static function when all media operations
  *  will be moved to device thread
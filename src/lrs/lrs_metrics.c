@@ -0,0 +1,609 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  LRS metrics, served in the Prometheus text format
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lrs_metrics.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "pho_common.h"
+#include "pho_dss.h"
+
+/** Upper bounds in seconds of the buckets of the histograms */
+static const double histogram_bounds[] = {
+    0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5, 10, 60, 300, 1800
+};
+
+#define N_BUCKETS (ARRAY_SIZE(histogram_bounds) + 1) /* last one is +Inf */
+
+/** Maximum length of the rendered labels of a series */
+#define LABELS_MAX_LEN 512
+
+/** Time the exporter waits for a connection before checking it must stop */
+#define EXPORTER_POLL_MS 200
+
+/** Time given to a client to send its request */
+#define EXPORTER_RECV_TIMEOUT_S 1
+
+enum metric_type {
+    METRIC_COUNTER,
+    METRIC_GAUGE,
+    METRIC_HISTOGRAM,
+};
+
+static const char * const metric_type_names[] = {
+    [METRIC_COUNTER]   = "counter",
+    [METRIC_GAUGE]     = "gauge",
+    [METRIC_HISTOGRAM] = "histogram",
+};
+
+/** Values of a metric for a given set of labels */
+struct metric_series {
+    struct metric_series *next;         /**< Next series of the metric */
+    char     *labels;                   /**< Rendered labels, eg.
+                                          * family="dir",device="d1"
+                                          */
+    int64_t   value;                    /**< Counter or gauge value */
+    uint64_t  buckets[N_BUCKETS];       /**< Histogram samples per bucket,
+                                          * not cumulated
+                                          */
+    uint64_t  sum_ns;                   /**< Sum of the histogram samples */
+};
+
+struct metric {
+    const char           *name;
+    const char           *help;
+    enum metric_type      type;
+    const char           *labels[2];    /**< Label names, NULL if unused */
+    struct metric_series *series;       /**< Series, only ever prepended to */
+};
+
+static struct metric metrics[] = {
+    [LRS_METRIC_REQUEST_DURATION] = {
+        .name   = "phobosd_request_duration_seconds",
+        .help   = "Time between the reception of a request and its response",
+        .type   = METRIC_HISTOGRAM,
+        .labels = { "type" },
+    },
+    [LRS_METRIC_QUEUE_DEPTH] = {
+        .name   = "phobosd_io_sched_queue_depth",
+        .help   = "Requests waiting in an I/O scheduler",
+        .type   = METRIC_GAUGE,
+        .labels = { "family", "queue" },
+    },
+    [LRS_METRIC_DEVICE_MOUNTS] = {
+        .name   = "phobosd_device_mounts_total",
+        .help   = "Media mounted by a device",
+        .type   = METRIC_COUNTER,
+        .labels = { "family", "device" },
+    },
+    [LRS_METRIC_DEVICE_UNLOADS] = {
+        .name   = "phobosd_device_unloads_total",
+        .help   = "Media unloaded from a device",
+        .type   = METRIC_COUNTER,
+        .labels = { "family", "device" },
+    },
+    [LRS_METRIC_DEVICE_SYNCS] = {
+        .name   = "phobosd_device_syncs_total",
+        .help   = "Media synced by a device",
+        .type   = METRIC_COUNTER,
+        .labels = { "family", "device" },
+    },
+    [LRS_METRIC_MEDIUM_WRITTEN_BYTES] = {
+        .name   = "phobosd_medium_written_bytes_total",
+        .help   = "Bytes written and synced on a medium",
+        .type   = METRIC_COUNTER,
+        .labels = { "family", "medium" },
+    },
+    [LRS_METRIC_DSS_QUERY_DURATION] = {
+        .name   = "phobosd_dss_query_duration_seconds",
+        .help   = "Duration of the synchronous requests to the DSS",
+        .type   = METRIC_HISTOGRAM,
+    },
+};
+
+/** Whether the metrics are updated, set by lrs_metrics_init() */
+static bool metrics_enabled;
+
+/**
+ * Render the labels of a series of \p metric in \p buf, escaping their values
+ * as required by the text format. Too long values are truncated.
+ */
+static void labels_render(const struct metric *metric, const char *label0,
+                          const char *label1, char *buf, size_t size)
+{
+    const char *values[] = { label0, label1 };
+    size_t len = 0;
+    int i;
+
+    buf[0] = '\0';
+    for (i = 0; i < ARRAY_SIZE(values) && metric->labels[i]; i++) {
+        const char *c;
+
+        len += snprintf(buf + len, size - len, "%s%s=\"", i ? "," : "",
+                        metric->labels[i]);
+        if (len >= size)
+            goto truncated;
+
+        for (c = values[i] ? : ""; *c; c++) {
+            /* room for an escaped char and the closing quote */
+            if (len + 3 >= size)
+                break;
+
+            if (*c == '\\' || *c == '"') {
+                buf[len++] = '\\';
+                buf[len++] = *c;
+            } else if (*c == '\n') {
+                buf[len++] = '\\';
+                buf[len++] = 'n';
+            } else {
+                buf[len++] = *c;
+            }
+        }
+        buf[len++] = '"';
+        buf[len] = '\0';
+    }
+
+    return;
+
+truncated:
+    buf[size - 1] = '\0';
+}
+
+/**
+ * Get the series of \p metric with the rendered labels \p labels, creating it
+ * if needed.
+ *
+ * A series is prepended to the list with a compare-and-swap. When it fails,
+ * only the series inserted meanwhile are checked again before retrying.
+ */
+static struct metric_series *series_get(struct metric *metric,
+                                        const char *labels)
+{
+    struct metric_series *head;
+    struct metric_series *series;
+    struct metric_series *new;
+
+    head = __atomic_load_n(&metric->series, __ATOMIC_ACQUIRE);
+    for (series = head; series; series = series->next)
+        if (!strcmp(series->labels, labels))
+            return series;
+
+    new = calloc(1, sizeof(*new));
+    if (!new)
+        return NULL;
+
+    new->labels = strdup(labels);
+    if (!new->labels) {
+        free(new);
+        return NULL;
+    }
+
+    new->next = head;
+    while (!__atomic_compare_exchange_n(&metric->series, &head, new, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        for (series = head; series != new->next; series = series->next) {
+            if (!strcmp(series->labels, labels)) {
+                free(new->labels);
+                free(new);
+                return series;
+            }
+        }
+        new->next = head;
+    }
+
+    return new;
+}
+
+void lrs_metric_add(enum lrs_metric metric, const char *label0,
+                    const char *label1, int64_t value)
+{
+    char labels[LABELS_MAX_LEN];
+    struct metric_series *series;
+
+    if (!__atomic_load_n(&metrics_enabled, __ATOMIC_RELAXED))
+        return;
+
+    assert(metrics[metric].type != METRIC_HISTOGRAM);
+
+    labels_render(&metrics[metric], label0, label1, labels, sizeof(labels));
+    series = series_get(&metrics[metric], labels);
+    if (!series) {
+        pho_warn("Cannot allocate a series of metric '%s'",
+                 metrics[metric].name);
+        return;
+    }
+
+    __atomic_add_fetch(&series->value, value, __ATOMIC_RELAXED);
+}
+
+void lrs_metric_observe(enum lrs_metric metric, const char *label0,
+                        double seconds)
+{
+    char labels[LABELS_MAX_LEN];
+    struct metric_series *series;
+    int i;
+
+    if (!__atomic_load_n(&metrics_enabled, __ATOMIC_RELAXED))
+        return;
+
+    assert(metrics[metric].type == METRIC_HISTOGRAM);
+
+    labels_render(&metrics[metric], label0, NULL, labels, sizeof(labels));
+    series = series_get(&metrics[metric], labels);
+    if (!series) {
+        pho_warn("Cannot allocate a series of metric '%s'",
+                 metrics[metric].name);
+        return;
+    }
+
+    if (seconds < 0)
+        seconds = 0;
+
+    for (i = 0; i < ARRAY_SIZE(histogram_bounds); i++)
+        if (seconds <= histogram_bounds[i])
+            break;
+
+    __atomic_add_fetch(&series->buckets[i], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&series->sum_ns, (uint64_t)(seconds * 1e9),
+                       __ATOMIC_RELAXED);
+}
+
+static void histogram_render(GString *out, const struct metric *metric,
+                             const struct metric_series *series)
+{
+    const char *sep = series->labels[0] ? "," : "";
+    const char *lbrace = "";
+    const char *rbrace = "";
+    uint64_t count = 0;
+    int i;
+
+    for (i = 0; i < N_BUCKETS; i++) {
+        count += __atomic_load_n(&series->buckets[i], __ATOMIC_RELAXED);
+        if (i < ARRAY_SIZE(histogram_bounds))
+            g_string_append_printf(out,
+                                   "%s_bucket{%s%sle=\"%g\"} %" PRIu64 "\n",
+                                   metric->name, series->labels, sep,
+                                   histogram_bounds[i], count);
+        else
+            g_string_append_printf(out,
+                                   "%s_bucket{%s%sle=\"+Inf\"} %" PRIu64 "\n",
+                                   metric->name, series->labels, sep, count);
+    }
+
+    /* no braces at all for a series without label */
+    if (series->labels[0]) {
+        lbrace = "{";
+        rbrace = "}";
+    }
+
+    g_string_append_printf(out, "%s_sum%s%s%s %.9f\n", metric->name,
+                           lbrace, series->labels, rbrace,
+                           __atomic_load_n(&series->sum_ns,
+                                           __ATOMIC_RELAXED) / 1e9);
+    g_string_append_printf(out, "%s_count%s%s%s %" PRIu64 "\n", metric->name,
+                           lbrace, series->labels, rbrace, count);
+}
+
+void lrs_metrics_render(GString *out)
+{
+    int i;
+
+    for (i = 0; i < LRS_METRIC_LAST; i++) {
+        const struct metric *metric = &metrics[i];
+        const struct metric_series *series;
+
+        g_string_append_printf(out, "# HELP %s %s\n# TYPE %s %s\n",
+                               metric->name, metric->help, metric->name,
+                               metric_type_names[metric->type]);
+
+        for (series = __atomic_load_n(&metric->series, __ATOMIC_ACQUIRE);
+             series;
+             series = series->next) {
+            if (metric->type == METRIC_HISTOGRAM)
+                histogram_render(out, metric, series);
+            else
+                g_string_append_printf(out, "%s{%s} %" PRId64 "\n",
+                                       metric->name, series->labels,
+                                       __atomic_load_n(&series->value,
+                                                       __ATOMIC_RELAXED));
+        }
+    }
+}
+
+static void metrics_dss_query_hook(double duration)
+{
+    lrs_metric_observe(LRS_METRIC_DSS_QUERY_DURATION, NULL, duration);
+}
+
+/* ****************************************************************************/
+/* HTTP exporter **************************************************************/
+/* ****************************************************************************/
+
+static int send_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t rc = send(fd, buf, len, MSG_NOSIGNAL);
+
+        if (rc < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+
+        buf += rc;
+        len -= rc;
+    }
+
+    return 0;
+}
+
+/**
+ * Answer the HTTP request of the client connected on \p fd. Only the headers
+ * of the request are read, and the connection is closed after the response.
+ */
+static void exporter_serve(int fd)
+{
+    struct timeval timeout = { .tv_sec = EXPORTER_RECV_TIMEOUT_S };
+    const char *status = "200 OK";
+    char request[1024];
+    GString *response;
+    GString *body;
+    size_t len = 0;
+    int rc;
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    while (len < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+
+        len += n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n") || strstr(request, "\n\n"))
+            break;
+    }
+    request[len] = '\0';
+
+    body = g_string_new(NULL);
+    if (strncmp(request, "GET ", 4) != 0) {
+        status = "405 Method Not Allowed";
+    } else if (strncmp(request + 4, "/ ", 2) != 0 &&
+               strncmp(request + 4, "/metrics ", 9) != 0 &&
+               strncmp(request + 4, "/metrics?", 9) != 0) {
+        status = "404 Not Found";
+    } else {
+        lrs_metrics_render(body);
+    }
+
+    response = g_string_new(NULL);
+    g_string_printf(response,
+                    "HTTP/1.0 %s\r\n"
+                    "Content-Type: text/plain; version=0.0.4\r\n"
+                    "Content-Length: %zu\r\n"
+                    "Connection: close\r\n"
+                    "\r\n", status, body->len);
+    g_string_append_len(response, body->str, body->len);
+
+    rc = send_all(fd, response->str, response->len);
+    if (rc)
+        pho_verb("Cannot send the metrics: %s", strerror(-rc));
+
+    g_string_free(response, TRUE);
+    g_string_free(body, TRUE);
+}
+
+static void *exporter_thread(void *data)
+{
+    struct lrs_metrics_exporter *exporter = data;
+    struct thread_info *thread = &exporter->thread;
+
+    while (thread_is_running(thread)) {
+        struct pollfd pfd = { .fd = exporter->socket_fd, .events = POLLIN };
+        int client;
+        int rc;
+
+        rc = poll(&pfd, 1, EXPORTER_POLL_MS);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0)
+            LOG_GOTO(end_thread, thread->status = -errno,
+                     "Metrics exporter: poll failed");
+        if (rc == 0)
+            continue;
+
+        client = accept(exporter->socket_fd, NULL, NULL);
+        if (client < 0) {
+            pho_warn("Metrics exporter: cannot accept connection: %s",
+                     strerror(errno));
+            continue;
+        }
+
+        exporter_serve(client);
+        close(client);
+    }
+
+end_thread:
+    thread->state = THREAD_STOPPED;
+    pthread_exit(&thread->status);
+}
+
+/** Open the socket listening on \p address, see lrs_metrics_init() */
+static int exporter_listen(struct lrs_metrics_exporter *exporter,
+                           const char *address)
+{
+    struct sockaddr_storage socka = {0};
+    socklen_t socka_len;
+    char *end;
+    int rc;
+
+    if (strchr(address, '/')) {
+        struct sockaddr_un *socka_un = (struct sockaddr_un *)&socka;
+
+        if (strlen(address) >= sizeof(socka_un->sun_path))
+            LOG_RETURN(-EINVAL, "Metrics socket path '%s' is too long",
+                       address);
+
+        socka_un->sun_family = AF_UNIX;
+        strcpy(socka_un->sun_path, address);
+        socka_len = sizeof(*socka_un);
+
+        if (unlink(address) == 0)
+            pho_warn("Socket already exists(%s), removed the old one",
+                     address);
+
+        exporter->path = strdup(address);
+        if (!exporter->path)
+            return -ENOMEM;
+    } else {
+        struct sockaddr_in *socka_in = (struct sockaddr_in *)&socka;
+        unsigned long port = strtoul(address, &end, 10);
+
+        if (!isdigit((unsigned char)*address) || *end != '\0' ||
+            port == 0 || port > 65535)
+            LOG_RETURN(-EINVAL, "Invalid metrics address '%s', expected a "
+                       "port or a socket path", address);
+
+        socka_in->sin_family = AF_INET;
+        socka_in->sin_port = htons(port);
+        socka_in->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socka_len = sizeof(*socka_in);
+    }
+
+    exporter->socket_fd = socket(socka.ss_family, SOCK_STREAM | SOCK_CLOEXEC,
+                                 0);
+    if (exporter->socket_fd < 0)
+        LOG_GOTO(err_path, rc = -errno, "Cannot open the metrics socket");
+
+    if (socka.ss_family == AF_INET) {
+        int one = 1;
+
+        setsockopt(exporter->socket_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                   sizeof(one));
+    }
+
+    if (bind(exporter->socket_fd, (struct sockaddr *)&socka, socka_len))
+        LOG_GOTO(err_close, rc = -errno, "Cannot bind the metrics socket to "
+                 "'%s'", address);
+
+    if (listen(exporter->socket_fd, SOMAXCONN))
+        LOG_GOTO(err_close, rc = -errno, "Cannot listen on '%s'", address);
+
+    return 0;
+
+err_close:
+    close(exporter->socket_fd);
+    exporter->socket_fd = -1;
+err_path:
+    free(exporter->path);
+    exporter->path = NULL;
+    return rc;
+}
+
+/** Close the listening socket of \p exporter and disable the metrics */
+static void exporter_close(struct lrs_metrics_exporter *exporter)
+{
+    dss_query_hook_set(NULL);
+    __atomic_store_n(&metrics_enabled, false, __ATOMIC_RELAXED);
+
+    close(exporter->socket_fd);
+    exporter->socket_fd = -1;
+    if (exporter->path) {
+        unlink(exporter->path);
+        free(exporter->path);
+        exporter->path = NULL;
+    }
+}
+
+int lrs_metrics_init(struct lrs_metrics_exporter *exporter,
+                     const char *address)
+{
+    int rc;
+
+    exporter->socket_fd = -1;
+    exporter->path = NULL;
+
+    if (!address || address[0] == '\0')
+        return 0;
+
+    rc = exporter_listen(exporter, address);
+    if (rc)
+        return rc;
+
+    __atomic_store_n(&metrics_enabled, true, __ATOMIC_RELAXED);
+    dss_query_hook_set(metrics_dss_query_hook);
+
+    rc = thread_init(&exporter->thread, exporter_thread, exporter);
+    if (rc) {
+        exporter_close(exporter);
+        LOG_RETURN(-rc, "Cannot start the metrics exporter");
+    }
+
+    pho_info("Metrics served on '%s'", address);
+    return 0;
+}
+
+void lrs_metrics_fini(struct lrs_metrics_exporter *exporter)
+{
+    int i;
+
+    if (exporter->socket_fd < 0)
+        return;
+
+    if (!thread_is_stopped(&exporter->thread))
+        thread_signal_stop(&exporter->thread);
+    thread_wait_end(&exporter->thread);
+
+    exporter_close(exporter);
+
+    for (i = 0; i < LRS_METRIC_LAST; i++) {
+        struct metric_series *series = metrics[i].series;
+
+        while (series) {
+            struct metric_series *next = series->next;
+
+            free(series->labels);
+            free(series);
+            series = next;
+        }
+        metrics[i].series = NULL;
+    }
+}
@@ -0,0 +1,107 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  LRS metrics, served in the Prometheus text format
+ *
+ * Each metric is a set of series told apart by the values of its labels. The
+ * series are created on their first update and live until lrs_metrics_fini(),
+ * so that the scheduler and device threads update them without any lock.
+ */
+#ifndef _PHO_LRS_METRICS_H
+#define _PHO_LRS_METRICS_H
+
+#include <glib.h>
+#include <stdint.h>
+
+#include "lrs_thread.h"
+
+/** Metrics of the LRS, along with the names of their labels */
+enum lrs_metric {
+    /** Histogram of the time between a request and its response: type */
+    LRS_METRIC_REQUEST_DURATION,
+    /** Gauge of the requests queued in an I/O scheduler: family, queue */
+    LRS_METRIC_QUEUE_DEPTH,
+    /** Counter of the media mounted by a device: family, device */
+    LRS_METRIC_DEVICE_MOUNTS,
+    /** Counter of the media unloaded by a device: family, device */
+    LRS_METRIC_DEVICE_UNLOADS,
+    /** Counter of the syncs done by a device: family, device */
+    LRS_METRIC_DEVICE_SYNCS,
+    /** Counter of the bytes synced on a medium: family, medium */
+    LRS_METRIC_MEDIUM_WRITTEN_BYTES,
+    /** Histogram of the duration of the DSS requests, without label */
+    LRS_METRIC_DSS_QUERY_DURATION,
+    LRS_METRIC_LAST
+};
+
+/**
+ * Add \p value to the series of the counter or gauge \p metric with labels
+ * \p label0 and \p label1, NULL for the labels \p metric does not have.
+ *
+ * Does nothing if the metrics are not enabled, see lrs_metrics_init().
+ */
+void lrs_metric_add(enum lrs_metric metric, const char *label0,
+                    const char *label1, int64_t value);
+
+/**
+ * Record a sample of \p seconds in the series of the histogram \p metric with
+ * label \p label0, NULL if \p metric has no label.
+ *
+ * Does nothing if the metrics are not enabled, see lrs_metrics_init().
+ */
+void lrs_metric_observe(enum lrs_metric metric, const char *label0,
+                        double seconds);
+
+/**
+ * Append the current value of every metric to \p out, in the Prometheus text
+ * exposition format.
+ */
+void lrs_metrics_render(GString *out);
+
+/** HTTP server of the metrics */
+struct lrs_metrics_exporter {
+    struct thread_info thread;      /**< Thread answering the requests */
+    int                socket_fd;   /**< Listening socket, -1 if disabled */
+    char              *path;        /**< Path of the UNIX socket, if any */
+};
+
+/**
+ * Enable the metrics and serve them over HTTP on \p address, which is either
+ * a TCP port of the loopback interface or the path of a UNIX socket. Nothing
+ * is done if \p address is empty.
+ *
+ * \param[out]  exporter    Exporter to stop with lrs_metrics_fini()
+ * \param[in]   address     Port or socket path, see the 'metrics_address'
+ *                          parameter of the 'lrs' section
+ *
+ * \return 0 on success, negative error code on failure
+ */
+int lrs_metrics_init(struct lrs_metrics_exporter *exporter,
+                     const char *address);
+
+/**
+ * Stop the exporter, disable the metrics and free their series. Must be
+ * called once no other thread updates them.
+ */
+void lrs_metrics_fini(struct lrs_metrics_exporter *exporter);
+
+#endif
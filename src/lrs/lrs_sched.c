@@ -36,6 +36,7 @@
 #include "pho_srl_common.h"
 #include "pho_type_utils.h"
 #include "lrs_device.h"
+#include "lrs_trace.h"
 #include "lrs_utils.h"
 
 #include <assert.h>
@@ -494,7 +495,7 @@ int sched_fill_dev_info(struct lrs_sched *sched, struct lib_handle *lib_hdl,
                                 OPERATION_TYPE_NAMES[PHO_DEVICE_LOOKUP],
                                 device_lookup_json);
             log.error_number = rc;
-            dss_emit_log(&dev->ld_device_thread.dss, &log);
+            dss_emit_log(&sched->sched_thread.dss, &log);
         } else {
             destroy_json(device_lookup_json);
         }
@@ -706,7 +707,7 @@ static int sched_clean_medium_locks(struct lrs_sched *sched)
 }
 
 int sched_init(struct lrs_sched *sched, enum rsc_family family,
-               struct tsqueue *resp_queue)
+               struct tsqueue *resp_queue, struct dss_pool *dss_pool)
 {
     int rc;
 
@@ -720,8 +721,12 @@ int sched_init(struct lrs_sched *sched, enum rsc_family family,
     if (rc)
         LOG_GOTO(err_format_media, rc, "Failed to initialize device handle");
 
-    /* Connect to the DSS */
-    rc = dss_init(&sched->sched_thread.dss);
+    /* The scheduler keeps its own connection: taking it from the pool would
+     * make the dispatch of every request wait for a device operation to end
+     * when all the pooled connections are used by device threads.
+     */
+    sched->dss_pool = dss_pool;
+    rc = thread_dss_init(&sched->sched_thread, NULL);
     if (rc)
         LOG_GOTO(err_hdl_fini, rc, "Failed to init sched dss handle");
 
@@ -778,7 +783,7 @@ err_retry_queue_fini:
 err_incoming_fini:
     tsqueue_destroy(&sched->incoming, sched_req_free);
 err_dss_fini:
-    dss_fini(&sched->sched_thread.dss);
+    thread_dss_fini(&sched->sched_thread);
 err_hdl_fini:
     lrs_dev_hdl_fini(&sched->devices);
 err_format_media:
@@ -792,6 +797,8 @@ int prepare_error(struct resp_container *resp_cont, int req_rc,
     int rc;
 
     resp_cont->socket_id = req_cont->socket_id;
+    resp_cont->received_at = req_cont->received_at;
+    resp_cont->trace_id = req_cont->trace_id;
     rc = pho_srl_response_error_alloc(resp_cont->resp);
     if (rc)
         LOG_RETURN(rc, "Failed to allocate response");
@@ -799,7 +806,9 @@ int prepare_error(struct resp_container *resp_cont, int req_rc,
     resp_cont->resp->error->rc = req_rc;
 
     resp_cont->resp->req_id = req_cont->req->id;
-    if (pho_request_is_write(req_cont->req))
+    if (pho_request_is_mixed(req_cont->req))
+        resp_cont->resp->error->req_kind = PHO_REQUEST_KIND__RQ_MIXED;
+    else if (pho_request_is_write(req_cont->req))
         resp_cont->resp->error->req_kind = PHO_REQUEST_KIND__RQ_WRITE;
     else if (pho_request_is_read(req_cont->req))
         resp_cont->resp->error->req_kind = PHO_REQUEST_KIND__RQ_READ;
@@ -882,7 +891,7 @@ void sched_fini(struct lrs_sched *sched)
     io_sched_fini(&sched->io_sched_hdl);
     lrs_dev_hdl_clear(&sched->devices);
     lrs_dev_hdl_fini(&sched->devices);
-    dss_fini(&sched->sched_thread.dss);
+    thread_dss_fini(&sched->sched_thread);
     tsqueue_destroy(&sched->incoming, sched_req_free);
     tsqueue_destroy(&sched->retry_queue, sub_request_free_cb);
     format_media_clean(&sched->ongoing_format);
@@ -911,74 +920,44 @@ bool sched_has_running_devices(struct lrs_sched *sched)
 }
 
 /**
- * Build a filter string fragment to filter on a given tag set. The returned
- * string is allocated with malloc. NULL is returned when ENOMEM is encountered.
- *
- * The returned string looks like the following:
- * {"$AND": [{"DSS:MDA::tags": "tag1"}]}
+ * Number of parameters of the filter template of sched_select_medium() before
+ * the tags: family, "unlocked" admin status, "blank" and "full" filesystem
+ * statuses.
  */
-static char *build_tag_filter(const struct tags *tags)
-{
-    json_t *and_filter = NULL;
-    json_t *tag_filters = NULL;
-    char   *tag_filter_json = NULL;
-    size_t  i;
-
-    /* Build a json array to properly format tag related DSS filter */
-    tag_filters = json_array();
-    if (!tag_filters)
-        return NULL;
-
-    /* Build and append one filter per tag */
-    for (i = 0; i < tags->n_tags; i++) {
-        json_t *tag_flt;
-        json_t *xjson;
-
-        tag_flt = json_object();
-        if (!tag_flt)
-            GOTO(out, -ENOMEM);
-
-        xjson = json_object();
-        if (!xjson) {
-            json_decref(tag_flt);
-            GOTO(out, -ENOMEM);
-        }
-
-        if (json_object_set_new(tag_flt, "DSS::MDA::tags",
-                                json_string(tags->tags[i]))) {
-            json_decref(tag_flt);
-            json_decref(xjson);
-            GOTO(out, -ENOMEM);
-        }
+#define SELECT_MEDIUM_BASE_PARAMS 4
 
-        if (json_object_set_new(xjson, "$XJSON", tag_flt)) {
-            json_decref(xjson);
-            GOTO(out, -ENOMEM);
-        }
-
-        if (json_array_append_new(tag_filters, xjson))
-            GOTO(out, -ENOMEM);
-    }
-
-    and_filter = json_object();
-    if (!and_filter)
-        GOTO(out, -ENOMEM);
-
-    /* Do not use the _new function and decref inconditionnaly later */
-    if (json_object_set(and_filter, "$AND", tag_filters))
-        GOTO(out, -ENOMEM);
-
-    /* Convert to string for formatting */
-    tag_filter_json = json_dumps(tag_filters, 0);
-
-out:
-    json_decref(tag_filters);
-
-    /* json_decref(NULL) is safe but not documented */
-    if (and_filter)
-        json_decref(and_filter);
+/**
+ * Build the filter template of the media that can be written to, with
+ * \p n_tags tags to match. The returned string is to be freed with g_free().
+ */
+static char *select_medium_template(size_t n_tags)
+{
+    GString *tmpl;
+    size_t i;
 
-    return tag_filter_json;
+    tmpl = g_string_new("{\"$AND\": ["
+                        /* Basic criteria */
+                        "  {\"DSS::MDA::family\": \"$1\"},"
+                        /* Check put media operation flags */
+                        "  {\"DSS::MDA::put\": \"t\"},"
+                        /* Exclude media locked by admin */
+                        "  {\"DSS::MDA::adm_status\": \"$2\"},"
+                        "  {\"$NOR\": ["
+                             /* Exclude non-formatted media */
+                        "    {\"DSS::MDA::fs_status\": \"$3\"},"
+                             /* Exclude full media */
+                        "    {\"DSS::MDA::fs_status\": \"$4\"}"
+                        "  ]}");
+
+    /* The medium must have all the tags */
+    for (i = 0; i < n_tags; i++)
+        g_string_append_printf(tmpl,
+                               ", {\"$XJSON\": {\"DSS::MDA::tags\": \"$%zu\"}}",
+                               SELECT_MEDIUM_BASE_PARAMS + i + 1);
+
+    g_string_append(tmpl, "]}");
+
+    return g_string_free(tmpl, false);
 }
 
 /**
@@ -1030,6 +1009,28 @@ static int medium_in_devices(const struct media_info *medium,
         }
     }
 
+    /* the media to read of a mixed request are allocated before the media to
+     * write, and must not be chosen for writing
+     */
+    if (pho_request_is_mixed(reqc->req)) {
+        for (i = rwalloc_n_write_media(reqc); i < reqc->params.rwalloc.n_media;
+             i++) {
+            struct media_info *read_medium = media[i].alloc_medium;
+
+            if (!devices[i])
+                continue;
+
+            if (!read_medium)
+                read_medium = devices[i]->ld_dss_media_info;
+
+            if (read_medium &&
+                pho_id_equal(&medium->rsc.id, &read_medium->rsc.id)) {
+                *already_alloc = true;
+                return 0;
+            }
+        }
+    }
+
     *already_alloc = false;
     return 0;
 }
@@ -1060,74 +1061,52 @@ int sched_select_medium(struct io_scheduler *io_sched,
                         size_t not_alloc)
 {
     struct lock_handle *lock_handle = io_sched->io_sched_hdl->lock_handle;
-    bool with_tags = tags != NULL && tags->n_tags > 0;
     struct media_info *split_media_best = NULL;
     struct media_info *whole_media_best = NULL;
     struct media_info *chosen_media = NULL;
     struct media_info *pmedia_res = NULL;
-    char *tag_filter_json = NULL;
-    struct dss_filter filter;
+    size_t n_tags = tags ? tags->n_tags : 0;
     size_t avail_size = 0;
+    const char **params;
+    char *tmpl;
     int mcnt = 0;
     int rc;
     int i;
 
     ENTRY;
 
-    if (with_tags) {
-        tag_filter_json = build_tag_filter(tags);
-        if (!tag_filter_json)
-            LOG_GOTO(err_nores, rc = -ENOMEM, "while building tags dss filter");
-    }
-
-    rc = dss_filter_build(&filter,
-                          "{\"$AND\": ["
-                          /* Basic criteria */
-                          "  {\"DSS::MDA::family\": \"%s\"},"
-                          /* Check put media operation flags */
-                          "  {\"DSS::MDA::put\": \"t\"},"
-                          /* Exclude media locked by admin */
-                          "  {\"DSS::MDA::adm_status\": \"%s\"},"
-                          "  {\"$NOR\": ["
-                               /* Exclude non-formatted media */
-                          "    {\"DSS::MDA::fs_status\": \"%s\"},"
-                               /* Exclude full media */
-                          "    {\"DSS::MDA::fs_status\": \"%s\"}"
-                          "  ]}"
-                          "  %s%s"
-                          "]}",
-                          rsc_family2str(family),
-                          rsc_adm_status2str(PHO_RSC_ADM_ST_UNLOCKED),
-                          /**
-                           * @TODO add criteria to limit the maximum number of
-                           * data fragments:
-                           * vol_free >= required_size/max_fragments
-                           * with a configurable max_fragments of 4 for example)
-                           */
-                          fs_status2str(PHO_FS_STATUS_BLANK),
-                          fs_status2str(PHO_FS_STATUS_FULL),
-                          with_tags ? ", " : "",
-                          with_tags ? tag_filter_json : "");
-
-    free(tag_filter_json);
+    /**
+     * @TODO add criteria to limit the maximum number of data fragments:
+     * vol_free >= required_size/max_fragments
+     * with a configurable max_fragments of 4 for example)
+     */
+    params = malloc((SELECT_MEDIUM_BASE_PARAMS + n_tags) * sizeof(*params));
+    if (!params)
+        LOG_GOTO(err_nores, rc = -ENOMEM, "while building media dss filter");
+
+    params[0] = rsc_family2str(family);
+    params[1] = rsc_adm_status2str(PHO_RSC_ADM_ST_UNLOCKED);
+    params[2] = fs_status2str(PHO_FS_STATUS_BLANK);
+    params[3] = fs_status2str(PHO_FS_STATUS_FULL);
+    for (i = 0; i < n_tags; i++)
+        params[SELECT_MEDIUM_BASE_PARAMS + i] = tags->tags[i];
+
+    /* only the number of tags changes the shape of the filter */
+    tmpl = select_medium_template(n_tags);
+    rc = dss_template_get(lock_handle->dss, DSS_MEDIA, tmpl, params,
+                          SELECT_MEDIUM_BASE_PARAMS + n_tags,
+                          (void **)&pmedia_res, &mcnt);
+    g_free(tmpl);
+    free(params);
     if (rc)
-        return rc;
+        GOTO(err_nores, rc);
 
-    rc = dss_media_get(lock_handle->dss, &filter, &pmedia_res,
-                       &mcnt);
     if (mcnt == 0) {
-        char *dump = json_dumps(filter.df_json, JSON_COMPACT);
-
-        pho_warn("No medium found matching query: %s", dump);
-        dss_filter_free(&filter);
-        free(dump);
+        pho_warn("No %s medium found available for writing with %zu tag(s)",
+                 rsc_family2str(family), n_tags);
         GOTO(free_res, rc = -ENOSPC);
     }
 
-    dss_filter_free(&filter);
-    if (rc)
-        GOTO(err_nores, rc);
-
     /* get the best fit */
     for (i = 0; i < mcnt; i++) {
         struct media_info *curr = &pmedia_res[i];
@@ -1686,6 +1665,8 @@ static int push_sub_request_to_device(struct req_container *reqc)
     }
 
     for (i = 0; i < devices_len; i++) {
+        lrs_trace_request(reqc, LRS_TRACE_DEVICE_CHOSEN,
+                          devices[i]->ld_dss_dev_info->rsc.id.name);
         devices[i]->ld_sub_request = sub_requests[i];
         devices[i]->ld_ongoing_scheduled = false;
 
@@ -1724,9 +1705,16 @@ static int publish_or_cancel(struct lrs_sched *sched,
         rc = push_sub_request_to_device(reqc);
 
     if (reqc_rc || rc) {
-        for (i = 0; i < n_selected; i++)
-            reqc->params.rwalloc.respc->devices[i]->ld_ongoing_scheduled =
-                                                                        false;
+        for (i = 0; i < n_selected; i++) {
+            struct lrs_dev **dev = &reqc->params.rwalloc.respc->devices[i];
+
+            /* the media of a mixed request are not selected in order */
+            if (!*dev)
+                continue;
+
+            (*dev)->ld_ongoing_scheduled = false;
+            *dev = NULL;
+        }
 
         if (reqc_rc != -EAGAIN || rc) {
             int rc2 = queue_error_response(sched->response_queue,
@@ -2135,6 +2123,197 @@ static int count_suitable_devices(struct lrs_sched *sched,
     return count;
 }
 
+/**
+ * Replace the medium to read at \p med_index of a mixed request by its last
+ * alternative candidate.
+ *
+ * @return  0 on success, \p rc if there is no alternative candidate left
+ */
+static int mixed_read_next_candidate(struct req_container *reqc,
+                                     size_t med_index, int rc)
+{
+    pho_req_read_t *rreq = reqc->req->ralloc;
+
+    if (rreq->n_med_ids <= rreq->n_required)
+        return rc;
+
+    pho_verb("Cannot read medium '%s' (%s), trying '%s' instead",
+             rreq->med_ids[med_index]->name, strerror(-rc),
+             rreq->med_ids[rreq->n_med_ids - 1]->name);
+    med_ids_switch(rreq->med_ids, med_index, rreq->n_med_ids - 1);
+    rreq->n_med_ids--;
+
+    return 0;
+}
+
+/**
+ * Alloc a device to one of the media to read of a mixed request.
+ *
+ * The read part of a mixed request does not go through the read I/O
+ * scheduler: the medium is imposed by the request, so it is either already
+ * in use by a device or must be loaded in an empty or unused one.
+ *
+ * @param[in]   sched               Scheduler handle
+ * @param[in]   reqc                Mixed request container
+ * @param[in]   index               Index of the medium in rwalloc media
+ * @param[in]   failure_on_medium   True if the current medium at \p index
+ *                                  failed and must be replaced
+ *
+ * @return  0 on success, -EAGAIN if the request should be rescheduled later,
+ *          another negative error code on failure.
+ */
+static int sched_mixed_read_alloc_one_medium(struct lrs_sched *sched,
+                                             struct req_container *reqc,
+                                             size_t index,
+                                             bool failure_on_medium)
+{
+    struct media_info **alloc_medium =
+        &reqc->params.rwalloc.media[index].alloc_medium;
+    size_t med_index = rwalloc_read_index(reqc, index);
+    struct lrs_dev *dev;
+    bool sched_ready;
+    int rc;
+
+    media_info_free(*alloc_medium);
+    *alloc_medium = NULL;
+
+    if (failure_on_medium) {
+        rc = mixed_read_next_candidate(reqc, med_index, -EIO);
+        if (rc)
+            return rc;
+    }
+
+next_candidate:
+    rc = fetch_and_check_medium_info(&sched->lock_handle, reqc, NULL,
+                                     med_index, alloc_medium);
+    if (rc)
+        goto skip_medium;
+
+    dev = search_in_use_medium(sched->devices.ldh_devices,
+                               (*alloc_medium)->rsc.id.name, &sched_ready);
+    if (dev && !sched_ready)
+        GOTO(free_medium, rc = -EAGAIN);
+
+    if (!dev)
+        dev = dev_picker(sched->devices.ldh_devices, PHO_DEV_OP_ST_UNSPEC,
+                         select_empty_loaded_mount, 0, &NO_TAGS,
+                         *alloc_medium, false);
+
+    if (!dev) {
+        if (compatible_drive_exists(sched, *alloc_medium, NULL, 0, 0))
+            rc = -EAGAIN;
+        else
+            pho_error(rc = -ENODEV,
+                      "No compatible device found to read medium '%s'",
+                      (*alloc_medium)->rsc.id.name);
+
+        goto free_medium;
+    }
+
+    rc = ensure_medium_lock(&sched->lock_handle, *alloc_medium);
+    if (rc)
+        goto free_medium;
+
+    if (medium_is_loaded_in_device(dev, *alloc_medium)) {
+        media_info_free(*alloc_medium);
+        *alloc_medium = NULL;
+    }
+
+    dev->ld_ongoing_scheduled = true;
+    reqc->params.rwalloc.respc->devices[index] = dev;
+    return 0;
+
+free_medium:
+    media_info_free(*alloc_medium);
+    *alloc_medium = NULL;
+skip_medium:
+    if (rc == -EAGAIN)
+        return rc;
+
+    rc = mixed_read_next_candidate(reqc, med_index, rc);
+    if (rc)
+        return rc;
+
+    goto next_candidate;
+}
+
+/**
+ * Count the devices which may take part in an allocation.
+ *
+ * @param[in]   sched       Scheduler handle
+ *
+ * @return                  Number of running and not failed devices
+ */
+static size_t count_usable_devices(struct lrs_sched *sched)
+{
+    size_t count = 0;
+    int i;
+
+    for (i = 0; i < sched->devices.ldh_devices->len; i++) {
+        struct lrs_dev *iter = lrs_dev_hdl_get(&sched->devices, i);
+
+        if (iter->ld_op_status == PHO_DEV_OP_ST_FAILED)
+            continue;
+
+        if (!thread_is_running(&iter->ld_device_thread))
+            continue;
+
+        count++;
+    }
+
+    return count;
+}
+
+/**
+ * Handle a mixed allocation request by choosing the devices to read the
+ * specified media and the medium/device couples to write.
+ *
+ * Every medium of the request is granted at once or none is, so that a client
+ * waiting for both parts never holds a device while waiting for another one.
+ *
+ * @return  0 on success, -EAGAIN if the request should be rescheduled later,
+ *          a negative error code if a failure occurs in scheduler thread.
+ */
+static int sched_handle_mixed_alloc(struct lrs_sched *sched,
+                                    struct req_container *reqc)
+{
+    size_t n_media = reqc->params.rwalloc.n_media;
+    size_t n_write = rwalloc_n_write_media(reqc);
+    device_select_func_t dev_select_policy;
+    int rc = 0;
+    size_t i;
+
+    pho_debug("mixed: allocation request (%lu medias to read, "
+              "%lu medias to write)", n_media - n_write, n_write);
+
+    if (count_usable_devices(sched) < n_media)
+        LOG_GOTO(end, rc = -ENODEV,
+                 "Not enough devices for a mixed allocation of %lu medias",
+                 n_media);
+
+    dev_select_policy = get_dev_policy();
+    if (!dev_select_policy)
+        LOG_GOTO(end, rc = -EINVAL,
+                 "Unable to get device select policy during mixed alloc");
+
+    /* media to read are chosen first to be excluded from the write part */
+    for (i = n_write; i < n_media; i++) {
+        rc = sched_mixed_read_alloc_one_medium(sched, reqc, i, false);
+        if (rc)
+            goto end;
+    }
+
+    for (i = 0; i < n_write; i++) {
+        rc = sched_write_alloc_one_medium(sched, reqc, i, dev_select_policy,
+                                          false);
+        if (rc)
+            break;
+    }
+
+end:
+    return publish_or_cancel(sched, reqc, rc, n_media);
+}
+
 /**
  * Handle a format request
  *
@@ -2227,6 +2406,8 @@ static int sched_handle_format(struct lrs_sched *sched,
         LOG_GOTO(remove_format_err_out, rc,
                  "Failed to remove request from I/O scheduler");
 
+    lrs_trace_request(reqc, LRS_TRACE_DEVICE_CHOSEN,
+                      device->ld_dss_dev_info->rsc.id.name);
     MUTEX_LOCK(&device->ld_mutex);
     device->ld_sub_request = format_sub_request;
     MUTEX_UNLOCK(&device->ld_mutex);
@@ -2288,6 +2469,7 @@ static int queue_notify_response(struct lrs_sched *sched,
         return -errno;
 
     respc->socket_id = reqc->socket_id;
+    respc->trace_id = reqc->trace_id;
 
     respc->resp = malloc(sizeof(*respc->resp));
     if (respc->resp == NULL) {
@@ -2378,7 +2560,6 @@ err:
 
 void rwalloc_cancel_DONE_devices(struct req_container *reqc)
 {
-    bool is_write = pho_request_is_write(reqc->req);
     size_t i;
 
     for (i = 0; i < reqc->params.rwalloc.n_media; i++) {
@@ -2391,7 +2572,7 @@ void rwalloc_cancel_DONE_devices(struct req_container *reqc)
             respc->devices[i]->ld_ongoing_io = false;
             MUTEX_UNLOCK(&respc->devices[i]->ld_mutex);
             respc->devices[i] = NULL;
-            if (is_write) {
+            if (rwalloc_index_is_write(reqc, i)) {
                 pho_resp_write_elt_t *wresp = resp->walloc->media[i];
 
                 free(wresp->root_path);
@@ -2399,7 +2580,8 @@ void rwalloc_cancel_DONE_devices(struct req_container *reqc)
                 free(wresp->med_id->name);
                 wresp->med_id->name = NULL;
             } else {
-                pho_resp_read_elt_t *rresp = resp->ralloc->media[i];
+                pho_resp_read_elt_t *rresp =
+                    resp->ralloc->media[rwalloc_read_index(reqc, i)];
 
                 free(rresp->root_path);
                 rresp->root_path = NULL;
@@ -2423,7 +2605,12 @@ static int sched_handle_read_or_write_error(struct lrs_sched *sched,
 
     *sreq_pushed_or_requeued = false;
     *req_ended = false;
-    if (pho_request_is_read(sreq->reqc->req)) {
+    if (pho_request_is_mixed(sreq->reqc->req) &&
+        !rwalloc_index_is_write(sreq->reqc, sreq->medium_index)) {
+        rc = sched_mixed_read_alloc_one_medium(sched, sreq->reqc,
+                                               sreq->medium_index,
+                                               sreq->failure_on_medium);
+    } else if (!rwalloc_index_is_write(sreq->reqc, sreq->medium_index)) {
         size_t nb_already_eagain = 0;
         struct allocation alloc = {
             .is_sub_request = true,
@@ -2451,6 +2638,8 @@ static int sched_handle_read_or_write_error(struct lrs_sched *sched,
         struct lrs_dev *selected_device =
             rwalloc->respc->devices[sreq->medium_index];
 
+        lrs_trace_request(sreq->reqc, LRS_TRACE_DEVICE_CHOSEN,
+                          selected_device->ld_dss_dev_info->rsc.id.name);
         MUTEX_LOCK(&selected_device->ld_mutex);
         selected_device->ld_sub_request = sreq;
         selected_device->ld_ongoing_scheduled = false;
@@ -2607,6 +2796,8 @@ int lrs_schedule_work(struct lrs_sched *sched)
 
         if (pho_request_is_format(reqc->req))
             rc = sched_handle_format(sched, reqc);
+        else if (pho_request_is_mixed(reqc->req))
+            rc = sched_handle_mixed_alloc(sched, reqc);
         else if (pho_request_is_read(reqc->req))
             rc = sched_handle_read_alloc(sched, reqc);
         else if (pho_request_is_write(reqc->req))
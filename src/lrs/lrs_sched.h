@@ -99,6 +99,9 @@ struct lrs_sched {
                                              *  executed by the scheduler
                                              */
     struct io_sched_handle io_sched_hdl;   /**< I/O scheduler handle */
+    struct dss_pool       *dss_pool;       /**< DSS connections of the device
+                                             *  threads, may be NULL
+                                             */
 };
 
 /**
@@ -180,6 +183,9 @@ struct rwalloc_medium {
 
 /**
  * Parameters of a request container dedicated to a read or write alloc request
+ *
+ * For a mixed alloc request, the media to write come first in \p media,
+ * followed by the media to read.
  */
 struct rwalloc_params {
     struct rwalloc_medium *media;   /**< Array of media to alloc */
@@ -205,6 +211,9 @@ struct req_container {
     int socket_id;                  /**< Socket ID to pass to the response. */
     pho_req_t *req;                 /**< Request. */
     struct timespec received_at;    /**< Request reception timestamp */
+    uint64_t trace_id;              /**< Identifier of the request in the
+                                      * trace, see lrs_trace.h
+                                      */
     union {                         /**< Parameters used by the LRS. */
         struct release_params release;
         struct format_params format;
@@ -265,6 +274,35 @@ static inline void destroy_container_params(struct req_container *cont)
 /** sched_req_free can be used as glib callback */
 void sched_req_free(void *reqc);
 
+/**
+ * Number of media to write of a read or write alloc request, which are the
+ * first ones of its rwalloc parameters.
+ */
+static inline size_t rwalloc_n_write_media(const struct req_container *reqc)
+{
+    return pho_request_is_write(reqc->req) ? reqc->req->walloc->n_media : 0;
+}
+
+/**
+ * Test if the medium at \p index of the rwalloc parameters of \p reqc is
+ * allocated for writing, or for reading otherwise.
+ */
+static inline bool rwalloc_index_is_write(const struct req_container *reqc,
+                                          size_t index)
+{
+    return index < rwalloc_n_write_media(reqc);
+}
+
+/**
+ * Index in the read part of the request and of its response of the medium at
+ * \p index of the rwalloc parameters of \p reqc, which must be read.
+ */
+static inline size_t rwalloc_read_index(const struct req_container *reqc,
+                                        size_t index)
+{
+    return index - rwalloc_n_write_media(reqc);
+}
+
 /**
  * Test is the rwalloc request is ended
  *
@@ -298,6 +336,13 @@ struct resp_container {
                                       * (used only for read or write alloc)
                                       */
     size_t devices_len;             /**< size of \p devices */
+    struct timespec received_at;    /**< Reception timestamp of the request,
+                                      * set for read, write, release and
+                                      * format responses and errors
+                                      */
+    uint64_t trace_id;              /**< Trace identifier of the request, 0
+                                      * for the quick requests
+                                      */
 };
 
 /**
@@ -346,11 +391,16 @@ int sched_fill_dev_info(struct lrs_sched *sched, struct lib_handle *lib_hdl,
  * \param[in]       sched       The sched to be initialized.
  * \param[in]       family      Resource family managed by the scheduler.
  * \param[in]       resp_queue  Global response queue.
+ * \param[in]       dss_pool    DSS connection pool shared by the device
+ *                              threads, NULL to give each of them its own
+ *                              connection. The scheduler thread always has its
+ *                              own connection, so that it never waits for a
+ *                              device operation to get one.
  *
  * \return                      0 on success, -1 * posix error code on failure.
  */
 int sched_init(struct lrs_sched *sched, enum rsc_family family,
-               struct tsqueue *resp_queue);
+               struct tsqueue *resp_queue, struct dss_pool *dss_pool);
 
 /**
  * Free all resources associated with this sched except for the dss, which must
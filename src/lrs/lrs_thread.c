@@ -25,6 +25,8 @@
 
 #include "lrs_thread.h"
 
+#include <string.h>
+
 int thread_init(struct thread_info *thread, void *(*thread_routine)(void *),
                 void *data)
 {
@@ -97,3 +99,38 @@ int thread_wait_end(struct thread_info *thread)
 
     return *threadrc;
 }
+
+int thread_dss_init(struct thread_info *thread, struct dss_pool *pool)
+{
+    thread->dss_pool = pool;
+    if (pool) {
+        memset(&thread->dss, 0, sizeof(thread->dss));
+        return 0;
+    }
+
+    return dss_init(&thread->dss);
+}
+
+void thread_dss_fini(struct thread_info *thread)
+{
+    if (thread->dss_pool)
+        thread_dss_release(thread);
+    else
+        dss_fini(&thread->dss);
+}
+
+int thread_dss_acquire(struct thread_info *thread)
+{
+    if (!thread->dss_pool || thread->dss.dh_conn)
+        return 0;
+
+    return dss_pool_acquire(thread->dss_pool, &thread->dss);
+}
+
+void thread_dss_release(struct thread_info *thread)
+{
+    if (!thread->dss_pool)
+        return;
+
+    dss_pool_release(thread->dss_pool, &thread->dss);
+}
@@ -62,6 +62,9 @@ struct thread_info {
                                          *  the execution.
                                          */
     struct dss_handle  dss;            /**< per thread DSS handle */
+    struct dss_pool   *dss_pool;       /**< Pool \a dss is borrowed from, if
+                                         *  any, see thread_dss_acquire()
+                                         */
 };
 
 static inline bool thread_is_running(struct thread_info *thread)
@@ -139,4 +142,34 @@ int thread_signal_timed_wait(struct thread_info *thread, struct timespec *time);
  */
 int thread_wait_end(struct thread_info *thread);
 
+/**
+ * Set up the DSS handle of the thread.
+ *
+ * Without \p pool, the thread gets its own connection, opened here. With a
+ * pool, the handle is only usable between thread_dss_acquire() and
+ * thread_dss_release() calls.
+ *
+ * \return 0 on success, negative error code on failure
+ */
+int thread_dss_init(struct thread_info *thread, struct dss_pool *pool);
+
+/**
+ * Close the connection of the thread, or give it back to its pool.
+ */
+void thread_dss_fini(struct thread_info *thread);
+
+/**
+ * Borrow a connection from the DSS pool of the thread for the duration of an
+ * operation, waiting for one to be available. This is a no-op if the thread
+ * has no pool or already holds a connection.
+ *
+ * \return 0 on success, negative error code on failure
+ */
+int thread_dss_acquire(struct thread_info *thread);
+
+/**
+ * Give the connection borrowed by thread_dss_acquire() back to the pool.
+ */
+void thread_dss_release(struct thread_info *thread);
+
 #endif
@@ -0,0 +1,162 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  LRS request tracing
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "lrs_trace.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pho_common.h"
+
+static const char * const phase_names[] = {
+    [LRS_TRACE_RECEIVED]      = "received",
+    [LRS_TRACE_QUEUED]        = "queued",
+    [LRS_TRACE_DEVICE_CHOSEN] = "device_chosen",
+    [LRS_TRACE_MEDIUM_READY]  = "medium_ready",
+    [LRS_TRACE_RESPONDED]     = "responded",
+};
+
+struct trace_event {
+    uint64_t              trace_id;
+    int                   req_id;
+    const char           *kind;
+    enum lrs_trace_phase  phase;
+    struct timespec       time;
+    char                 *resource;
+};
+
+static struct trace_event ring[LRS_TRACE_SIZE];
+/** Total number of events recorded, the next one goes to ring[count % size] */
+static uint64_t ring_count;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t last_trace_id;
+
+uint64_t lrs_trace_next_id(void)
+{
+    return __atomic_add_fetch(&last_trace_id, 1, __ATOMIC_RELAXED);
+}
+
+void lrs_trace_record(uint64_t trace_id, int req_id, const char *kind,
+                      enum lrs_trace_phase phase, const char *resource)
+{
+    struct trace_event *event;
+    struct timespec now;
+    char *resource_copy = NULL;
+    char *old_resource;
+
+    if (!trace_id)
+        return;
+
+    /* a failure to trace must not impact the request */
+    if (clock_gettime(CLOCK_REALTIME, &now))
+        return;
+
+    if (resource)
+        resource_copy = strdup(resource);
+
+    MUTEX_LOCK(&ring_mutex);
+    event = &ring[ring_count++ % LRS_TRACE_SIZE];
+    old_resource = event->resource;
+    event->trace_id = trace_id;
+    event->req_id = req_id;
+    event->kind = kind;
+    event->phase = phase;
+    event->time = now;
+    event->resource = resource_copy;
+    MUTEX_UNLOCK(&ring_mutex);
+
+    free(old_resource);
+}
+
+static json_t *event2json(const struct trace_event *event)
+{
+    json_t *object;
+    int rc = 0;
+
+    object = json_object();
+    if (!object)
+        return NULL;
+
+    rc |= json_object_set_new(object, "id",
+                              json_integer(event->trace_id));
+    rc |= json_object_set_new(object, "req_id", json_integer(event->req_id));
+    rc |= json_object_set_new(object, "kind", json_string(event->kind));
+    rc |= json_object_set_new(object, "phase",
+                              json_string(phase_names[event->phase]));
+    rc |= json_object_set_new(object, "time",
+                              json_real(event->time.tv_sec +
+                                        event->time.tv_nsec / 1e9));
+    if (event->resource)
+        rc |= json_object_set_new(object, "resource",
+                                  json_string(event->resource));
+
+    if (rc) {
+        json_decref(object);
+        return NULL;
+    }
+
+    return object;
+}
+
+int lrs_trace_dump(json_t *trace)
+{
+    uint64_t first;
+    uint64_t i;
+    int rc = 0;
+
+    MUTEX_LOCK(&ring_mutex);
+    first = ring_count > LRS_TRACE_SIZE ? ring_count - LRS_TRACE_SIZE : 0;
+    for (i = first; i < ring_count; i++) {
+        json_t *event = event2json(&ring[i % LRS_TRACE_SIZE]);
+
+        if (!event || json_array_append_new(trace, event)) {
+            rc = -ENOMEM;
+            break;
+        }
+    }
+    MUTEX_UNLOCK(&ring_mutex);
+
+    return rc;
+}
+
+void lrs_trace_fini(void)
+{
+    int i;
+
+    MUTEX_LOCK(&ring_mutex);
+    for (i = 0; i < LRS_TRACE_SIZE; i++) {
+        free(ring[i].resource);
+        ring[i].resource = NULL;
+    }
+    ring_count = 0;
+    MUTEX_UNLOCK(&ring_mutex);
+}
@@ -0,0 +1,93 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  LRS request tracing
+ *
+ * Each step of the life of a request in the LRS is timestamped in a fixed-size
+ * ring of events, which only keeps the most recent ones. The ring is dumped by
+ * the monitor requests asking for the trace.
+ */
+#ifndef _PHO_LRS_TRACE_H
+#define _PHO_LRS_TRACE_H
+
+#include <jansson.h>
+#include <stdint.h>
+
+#include "lrs_sched.h"
+
+/** Number of events kept in the ring */
+#define LRS_TRACE_SIZE 4096
+
+/** Steps of the life of a request, in the order they happen */
+enum lrs_trace_phase {
+    LRS_TRACE_RECEIVED,         /**< Request read from its socket */
+    LRS_TRACE_QUEUED,           /**< Request pushed to an I/O scheduler */
+    LRS_TRACE_DEVICE_CHOSEN,    /**< Sub-request handed to a device */
+    LRS_TRACE_MEDIUM_READY,     /**< Medium loaded, and mounted if needed */
+    LRS_TRACE_RESPONDED,        /**< Response sent to the client */
+    LRS_TRACE_LAST
+};
+
+/**
+ * Identifier of a new request to trace, never 0.
+ */
+uint64_t lrs_trace_next_id(void);
+
+/**
+ * Record that the request \p trace_id reached \p phase.
+ *
+ * \param[in]  trace_id     Identifier given by lrs_trace_next_id(), nothing is
+ *                          recorded if 0
+ * \param[in]  req_id       Identifier of the request given by the client
+ * \param[in]  kind         Kind of request or response, as a static string
+ * \param[in]  phase        Step reached by the request
+ * \param[in]  resource     Name of the device or medium involved, may be NULL
+ */
+void lrs_trace_record(uint64_t trace_id, int req_id, const char *kind,
+                      enum lrs_trace_phase phase, const char *resource);
+
+/**
+ * Record that the request of \p reqc reached \p phase, see lrs_trace_record().
+ */
+static inline void lrs_trace_request(const struct req_container *reqc,
+                                     enum lrs_trace_phase phase,
+                                     const char *resource)
+{
+    lrs_trace_record(reqc->trace_id, reqc->req->id,
+                     pho_srl_request_kind_str(reqc->req), phase, resource);
+}
+
+/**
+ * Append the events of the ring to \p trace, from the oldest to the most
+ * recent one. Each event is an object with the 'id', 'req_id', 'kind',
+ * 'phase', 'time' and optional 'resource' keys.
+ *
+ * \return 0 on success, -ENOMEM on failure
+ */
+int lrs_trace_dump(json_t *trace);
+
+/**
+ * Free the events of the ring.
+ */
+void lrs_trace_fini(void);
+
+#endif
@@ -31,6 +31,7 @@
 #include "pho_common.h"
 
 enum _RESP_KIND {
+    _RESP_MIXED,
     _RESP_WRITE,
     _RESP_READ,
     _RESP_RELEASE,
@@ -49,9 +50,11 @@ static const char *const SRL_REQ_KIND_STRS[] = {
     [PHO_REQUEST_KIND__RQ_NOTIFY]    = "notify",
     [PHO_REQUEST_KIND__RQ_MONITOR]   = "monitor",
     [PHO_REQUEST_KIND__RQ_CONFIGURE] = "configure",
+    [PHO_REQUEST_KIND__RQ_MIXED]     = "mixed alloc",
 };
 
 static const char *const SRL_RESP_KIND_STRS[] = {
+    [_RESP_MIXED]     = "mixed alloc",
     [_RESP_WRITE]     = "write alloc",
     [_RESP_READ]      = "read alloc",
     [_RESP_RELEASE]   = "release",
@@ -64,6 +67,8 @@ static const char *const SRL_RESP_KIND_STRS[] = {
 
 const char *pho_srl_request_kind_str(pho_req_t *req)
 {
+    if (pho_request_is_mixed(req))
+        return SRL_REQ_KIND_STRS[PHO_REQUEST_KIND__RQ_MIXED];
     if (pho_request_is_write(req))
         return SRL_REQ_KIND_STRS[PHO_REQUEST_KIND__RQ_WRITE];
     if (pho_request_is_read(req))
@@ -84,6 +89,8 @@ const char *pho_srl_request_kind_str(pho_req_t *req)
 
 const char *pho_srl_response_kind_str(pho_resp_t *resp)
 {
+    if (pho_response_is_mixed(resp))
+        return SRL_RESP_KIND_STRS[_RESP_MIXED];
     if (pho_response_is_write(resp))
         return SRL_RESP_KIND_STRS[_RESP_WRITE];
     if (pho_response_is_read(resp))
@@ -106,6 +113,9 @@ const char *pho_srl_response_kind_str(pho_resp_t *resp)
 
 const char *pho_srl_error_kind_str(pho_resp_error_t *err)
 {
+    if (err->req_kind == PHO_REQUEST_KIND__RQ_MIXED)
+        return SRL_REQ_KIND_STRS[err->req_kind];
+
     if (err->req_kind > PHO_REQUEST_KIND__RQ_RELEASE)
         return "<invalid>";
 
@@ -203,6 +213,30 @@ err_ralloc:
     return -ENOMEM;
 }
 
+int pho_srl_request_mixed_alloc(pho_req_t *req, size_t n_read_media,
+                                size_t n_write_media, size_t *n_tags)
+{
+    pho_req_write_t *walloc;
+    int rc;
+
+    rc = pho_srl_request_write_alloc(req, n_write_media, n_tags);
+    if (rc)
+        return rc;
+
+    /* the read allocation initializes the whole request again */
+    walloc = req->walloc;
+    rc = pho_srl_request_read_alloc(req, n_read_media);
+    req->walloc = walloc;
+    if (rc) {
+        pho_srl_request_free(req, false);
+        return rc;
+    }
+
+    req->ralloc->n_required = n_read_media;
+
+    return 0;
+}
+
 int pho_srl_request_release_alloc(pho_req_t *req, size_t n_media)
 {
     int i;
@@ -502,6 +536,28 @@ err_ralloc:
     return -ENOMEM;
 }
 
+int pho_srl_response_mixed_alloc(pho_resp_t *resp, size_t n_read_media,
+                                 size_t n_write_media)
+{
+    pho_resp_write_t *walloc;
+    int rc;
+
+    rc = pho_srl_response_write_alloc(resp, n_write_media);
+    if (rc)
+        return rc;
+
+    /* the read allocation initializes the whole response again */
+    walloc = resp->walloc;
+    rc = pho_srl_response_read_alloc(resp, n_read_media);
+    resp->walloc = walloc;
+    if (rc) {
+        pho_srl_response_free(resp, false);
+        return rc;
+    }
+
+    return 0;
+}
+
 int pho_srl_response_release_alloc(pho_resp_t *resp, size_t n_media)
 {
     int i;
@@ -38,6 +38,10 @@
 #include "pho_type_utils.h"
 #include "pho_types.h"
 #include "store_alias.h"
+#include "store_cache.h"
+#include "store_dedup.h"
+#include "store_inline.h"
+#include "store_staging.h"
 #include "store_utils.h"
 
 #include <attr/xattr.h>
@@ -90,6 +94,28 @@ struct phobos_handle {
                                      *  may need to roll them back in case of
                                      *  failure)
                                      */
+    bool *layout_pending;          /**< Array of bool, true means that the
+                                     *  layout of this transfer was queued on
+                                     *  the DSS pipeline and that its end has
+                                     *  to be completed once the pipeline is
+                                     *  flushed
+                                     */
+    off_t *cache_offsets;          /**< Array of offsets of the GET outputs
+                                     *  from which the retrieved objects have
+                                     *  to be added to the read cache, -1 if
+                                     *  they must not be cached
+                                     */
+    struct staging_target *staging;  /**< Array of the destinations of the
+                                       *  PUTs redirected to the staging
+                                       *  family
+                                       */
+    struct inline_content *inlined;  /**< Array of the contents of the PUTs
+                                       *  stored in the DSS
+                                       */
+    bool *deduped;                 /**< Array of bool, true means that the
+                                     *  PUT refers to the extents of another
+                                     *  object holding the same data
+                                     */
 
     struct pho_comm_info comm;      /**< Communication socket info. */
 
@@ -190,6 +216,15 @@ static int decoder_build(struct pho_encoder *dec, struct pho_xfer_desc *xfer,
     if (cnt == 0)
         GOTO(err, rc = -ENOENT);
 
+    /* objects stored in the DSS need no layout module, see store_inline.c */
+    if (store_inline_is_inline(layout)) {
+        dec->xfer = xfer;
+        dec->is_decoder = true;
+        dec->done = false;
+        dec->layout = layout;
+        return 0;
+    }
+
     /* @FIXME: duplicate layout to avoid calling dss functions to free this? */
     rc = layout_decode(dec, xfer, layout);
     if (rc)
@@ -895,6 +930,9 @@ static const char *oid_or_uuid_val(struct pho_xfer_desc *xfer)
  * @param[in]   rc          The outcome of the xfer (replaces the xfer's xd_rc
  *                          if it was 0).
  */
+static void store_complete_xfer(struct phobos_handle *pho, size_t xfer_idx,
+                                int rc);
+
 static void store_end_xfer(struct phobos_handle *pho, size_t xfer_idx, int rc)
 {
     struct pho_encoder *enc = &pho->encoders[xfer_idx];
@@ -913,10 +951,73 @@ static void store_end_xfer(struct phobos_handle *pho, size_t xfer_idx, int rc)
     if (!enc->is_decoder && xfer->xd_rc == 0 && rc == 0) {
         pho_debug("Saving layout for objid:'%s'", xfer->xd_objid);
         rc = dss_layout_set(&pho->dss, enc->layout, 1, DSS_SET_INSERT);
-        if (rc)
+        /* staged layouts are saved along with their destination */
+        if (!rc && pho->staging &&
+            pho->staging[xfer_idx].family != PHO_RSC_INVAL)
+            rc = dss_layout_staging_set(&pho->dss, enc->layout,
+                                        pho->staging[xfer_idx].family,
+                                        &pho->staging[xfer_idx].tags);
+        if (!rc && pho->inlined && pho->inlined[xfer_idx].inlined)
+            rc = dss_layout_inline_set(&pho->dss, enc->layout,
+                                       pho->inlined[xfer_idx].data,
+                                       pho->inlined[xfer_idx].size);
+        if (rc) {
             pho_error(rc, "Error while saving layout for objid:'%s'",
                       xfer->xd_objid);
+        } else if (dss_pipeline_is_active(&pho->dss)) {
+            /* The outcome is only known once the pipeline is flushed */
+            pho->layout_pending[xfer_idx] = true;
+            return;
+        }
+    }
+
+    /* Once a GET is successful, keep a copy of the object in the read cache */
+    if (enc->is_decoder && xfer->xd_op == PHO_XFER_OP_GET &&
+        xfer->xd_rc == 0 && rc == 0 && pho->cache_offsets &&
+        pho->cache_offsets[xfer_idx] >= 0)
+        store_cache_put(enc->layout, xfer, pho->cache_offsets[xfer_idx]);
+
+    store_complete_xfer(pho, xfer_idx, rc);
+}
+
+/**
+ * Flush the layouts saved on the DSS pipeline by store_end_xfer and complete
+ * the corresponding transfers.
+ *
+ * The layouts queued on the pipeline are saved as a whole: if one of them
+ * cannot be saved, all the corresponding transfers fail.
+ */
+static void store_flush_layouts(struct phobos_handle *pho)
+{
+    size_t i;
+    int rc;
+
+    rc = dss_pipeline_end(&pho->dss);
+    if (rc)
+        pho_error(rc, "Error while saving layouts");
+
+    for (i = 0; i < pho->n_xfers; i++) {
+        if (!pho->layout_pending[i])
+            continue;
+
+        pho->layout_pending[i] = false;
+        store_complete_xfer(pho, i, rc);
     }
+}
+
+/**
+ * Second part of store_end_xfer, once the layout of the transfer is saved:
+ * properly position xfer->xd_rc, cleanup the metadata of failed PUT and call
+ * the termination callback.
+ */
+static void store_complete_xfer(struct phobos_handle *pho, size_t xfer_idx,
+                                int rc)
+{
+    struct pho_xfer_desc *xfer = &pho->xfers[xfer_idx];
+
+    /* The caller gets back the family and tags of a staged PUT */
+    if (pho->staging)
+        store_staging_restore(xfer, &pho->staging[xfer_idx]);
 
     /* Only overwrite xd_rc if it was 0 */
     if (xfer->xd_rc == 0 && rc != 0)
@@ -937,6 +1038,92 @@ static void store_end_xfer(struct phobos_handle *pho, size_t xfer_idx, int rc)
         pho->cb(pho->udata, xfer, rc);
 }
 
+/**
+ * Serve the GET transfer at \a xfer_idx from the read cache if possible, in
+ * which case its decoder is marked as done and no medium is requested to the
+ * LRS. On a miss, remember where the object will be written to the output so
+ * that it can be cached once retrieved.
+ */
+static int store_cache_try_get(struct phobos_handle *pho, size_t xfer_idx)
+{
+    struct pho_encoder *dec = &pho->encoders[xfer_idx];
+    int rc;
+
+    rc = store_cache_get(dec->layout, &pho->xfers[xfer_idx],
+                         &pho->cache_offsets[xfer_idx]);
+    if (rc == -ENOENT)
+        return 0;
+
+    pho->cache_offsets[xfer_idx] = -1;
+    if (rc == 0)
+        dec->done = true;
+
+    return rc;
+}
+
+/**
+ * Initialize the encoder writing the data of the PUT at \a xfer_idx on media,
+ * of the staging family if its family is staged.
+ */
+static int store_put_write_init(struct phobos_handle *pho, size_t xfer_idx)
+{
+    struct pho_xfer_desc *xfer = &pho->xfers[xfer_idx];
+    int rc;
+
+    rc = store_staging_redirect(xfer, &pho->staging[xfer_idx]);
+    if (rc)
+        return rc;
+
+    return init_enc_or_dec(&pho->encoders[xfer_idx], &pho->dss, xfer);
+}
+
+/**
+ * Initialize the encoder of the PUT at \a xfer_idx: small objects are stored
+ * in the DSS, objects whose data is already on media refer to it, the others
+ * are written on media.
+ */
+static int store_put_init(struct phobos_handle *pho, size_t xfer_idx)
+{
+    struct pho_xfer_desc *xfer = &pho->xfers[xfer_idx];
+    int rc;
+
+    rc = store_inline_encode(&pho->encoders[xfer_idx], xfer,
+                             &pho->inlined[xfer_idx]);
+    if (rc || pho->inlined[xfer_idx].inlined)
+        return rc;
+
+    rc = store_dedup_encode(&pho->encoders[xfer_idx], xfer, &pho->dss,
+                            &pho->deduped[xfer_idx]);
+    if (rc || pho->deduped[xfer_idx])
+        return rc;
+
+    return store_put_write_init(pho, xfer_idx);
+}
+
+/**
+ * The deduplicated PUT at \a xfer_idx could not be recorded on the shared
+ * extents, which have no room left for it: write its data instead.
+ */
+static int store_dedup_fallback(struct phobos_handle *pho, size_t xfer_idx)
+{
+    struct pho_encoder *enc = &pho->encoders[xfer_idx];
+    int rc;
+
+    pho_verb("objid:'%s' cannot refer to the shared extents, writing its data",
+             enc->xfer->xd_objid);
+
+    layout_destroy(enc);
+    enc->ops = NULL;
+    pho->deduped[xfer_idx] = false;
+    enc->xfer->xd_rc = 0;
+
+    rc = store_put_write_init(pho, xfer_idx);
+    if (rc)
+        return rc;
+
+    return encoder_communicate(enc, &pho->comm, NULL, xfer_idx);
+}
+
 /**
  * Destroy a phobos handle and all associated resources. All unfinished
  * transfers will end with return code \a rc.
@@ -965,14 +1152,27 @@ static void store_fini(struct phobos_handle *pho, int rc)
             }
             layout_destroy(&pho->encoders[i]);
         }
+
+        if (pho->inlined)
+            free(pho->inlined[i].data);
     }
 
     free(pho->encoders);
     free(pho->ended_xfers);
     free(pho->md_created);
+    free(pho->layout_pending);
+    free(pho->cache_offsets);
+    free(pho->staging);
+    free(pho->inlined);
+    free(pho->deduped);
     pho->encoders = NULL;
     pho->ended_xfers = NULL;
     pho->md_created = NULL;
+    pho->layout_pending = NULL;
+    pho->cache_offsets = NULL;
+    pho->staging = NULL;
+    pho->inlined = NULL;
+    pho->deduped = NULL;
 
     rc = pho_comm_close(&pho->comm);
     if (rc)
@@ -1054,15 +1254,46 @@ static int store_init(struct phobos_handle *pho, struct pho_xfer_desc *xfers,
     if (pho->md_created == NULL)
         GOTO(out, rc = -ENOMEM);
 
+    pho->layout_pending = calloc(n_xfers, sizeof(*pho->layout_pending));
+    if (pho->layout_pending == NULL)
+        GOTO(out, rc = -ENOMEM);
+
+    pho->cache_offsets = malloc(n_xfers * sizeof(*pho->cache_offsets));
+    if (pho->cache_offsets == NULL)
+        GOTO(out, rc = -ENOMEM);
+
+    pho->staging = calloc(n_xfers, sizeof(*pho->staging));
+    if (pho->staging == NULL)
+        GOTO(out, rc = -ENOMEM);
+
+    pho->inlined = calloc(n_xfers, sizeof(*pho->inlined));
+    if (pho->inlined == NULL)
+        GOTO(out, rc = -ENOMEM);
+
+    pho->deduped = calloc(n_xfers, sizeof(*pho->deduped));
+    if (pho->deduped == NULL)
+        GOTO(out, rc = -ENOMEM);
+
     /* Initialize all the encoders */
     for (i = 0; i < n_xfers; i++) {
         pho_debug("Initializing %s %ld for objid:'%s'",
                   pho->encoders[i].is_decoder ? "decoder" : "encoder",
                   i, pho->xfers[i].xd_objid);
-        rc = init_enc_or_dec(&pho->encoders[i], &pho->dss, &pho->xfers[i]);
+        pho->cache_offsets[i] = -1;
+        pho->staging[i].family = PHO_RSC_INVAL;
+        if (xfers[i].xd_op == PHO_XFER_OP_PUT)
+            rc = store_put_init(pho, i);
+        else
+            rc = init_enc_or_dec(&pho->encoders[i], &pho->dss,
+                                 &pho->xfers[i]);
         if (rc)
             pho_error(rc, "Error while creating encoders for objid:'%s'",
                       xfers[i].xd_objid);
+        else if (xfers[i].xd_op == PHO_XFER_OP_GET &&
+                 store_inline_is_inline(pho->encoders[i].layout))
+            rc = store_inline_decode(&pho->encoders[i], &pho->dss);
+        else if (xfers[i].xd_op == PHO_XFER_OP_GET)
+            rc = store_cache_try_get(pho, i);
         if (rc || pho->encoders[i].done)
             store_end_xfer(pho, i, rc);
         rc = 0;
@@ -1088,6 +1319,10 @@ static int store_lrs_response_process(struct phobos_handle *pho,
 
     rc = encoder_communicate(encoder, &pho->comm, resp, resp->req_id);
 
+    if (!rc && encoder->done && pho->deduped && pho->deduped[resp->req_id] &&
+        encoder->xfer->xd_rc == -ENOSPC)
+        rc = store_dedup_fallback(pho, resp->req_id);
+
     /* Success or failure final callback */
     if (rc || encoder->done)
         store_end_xfer(pho, resp->req_id, rc);
@@ -1102,6 +1337,7 @@ static int store_lrs_response_process(struct phobos_handle *pho,
 static int store_dispatch_loop(struct phobos_handle *pho)
 {
     struct pho_comm_data *responses = NULL;
+    bool pipelined = false;
     int n_responses = 0;
     int rc = 0;
     int i;
@@ -1129,7 +1365,11 @@ static int store_dispatch_loop(struct phobos_handle *pho)
         free(responses);
     }
 
-    /* Dispatch LRS responses to encoders */
+    /*
+     * Dispatch LRS responses to encoders, the layouts of the transfers ending
+     * in this batch are saved together once all the responses are processed.
+     */
+    pipelined = n_responses > 0 && dss_pipeline_begin(&pho->dss) == 0;
     for (i = 0; i < n_responses; i++) {
         /*
          * If an error occured on the deserialization, resps[i] is now null
@@ -1147,6 +1387,9 @@ static int store_dispatch_loop(struct phobos_handle *pho)
             break;
     }
 
+    if (pipelined)
+        store_flush_layouts(pho);
+
     /*
      * If there are no new answer, it means no resource is available yet,
      * wait a bit before retrying.
@@ -1226,6 +1469,10 @@ static int store_perform_xfers(struct phobos_handle *pho)
             store_end_xfer(pho, i, rc);
         }
         pho->md_created[i] = true;
+
+        /* the layout of an object stored in the DSS is saved right away */
+        if (pho->inlined[i].inlined && !pho->encoders[i].done)
+            store_end_xfer(pho, i, 0);
     }
 
     /* Generate all first requests of encoders */
@@ -1513,8 +1760,17 @@ int phobos_locate(const char *oid, const char *uuid, int version,
 
     assert(cnt == 1);
 
-    /* locate media */
-    rc = layout_locate(&dss, layout, focus_host, hostname, nb_new_lock);
+    /* objects stored in the DSS can be retrieved from any node */
+    if (store_inline_is_inline(layout)) {
+        const char *host = focus_host ? : get_hostname();
+
+        *nb_new_lock = 0;
+        *hostname = host ? strdup(host) : NULL;
+        rc = *hostname ? 0 : -ENOMEM;
+    } else {
+        /* locate media */
+        rc = layout_locate(&dss, layout, focus_host, hostname, nb_new_lock);
+    }
     dss_res_free(layout, cnt);
 
 clean:
@@ -0,0 +1,426 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Read cache of Phobos store
+ *
+ * Objects retrieved from the media families listed in 'cache_families' are
+ * copied to 'cache_dir', one file per object version, named after the uuid,
+ * the version and the checksum of the first extent of the object. Later GETs
+ * of the same object version are served from this copy, without any request
+ * to the LRS.
+ *
+ * The modification time of the cached files is updated on each hit, and the
+ * least recently used files are removed when a new object does not fit in
+ * 'cache_size' bytes.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "store_cache.h"
+
+#include "pho_cfg.h"
+#include "pho_common.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_TMP_TEMPLATE ".tmp.XXXXXX"
+#define CACHE_IO_SIZE (1024 * 1024)
+
+/**
+ * List of configuration parameters for the read cache
+ */
+enum pho_cfg_params_store_cache {
+    PHO_CFG_STORE_CACHE_FIRST,
+
+    /* store cache parameters */
+    PHO_CFG_STORE_CACHE_cache_dir = PHO_CFG_STORE_CACHE_FIRST,
+    PHO_CFG_STORE_CACHE_cache_size,
+    PHO_CFG_STORE_CACHE_cache_families,
+
+    PHO_CFG_STORE_CACHE_LAST
+};
+
+const struct pho_config_item cfg_store_cache[] = {
+    [PHO_CFG_STORE_CACHE_cache_dir] = {
+        .section = "store",
+        .name    = "cache_dir",
+        .value   = NULL
+    },
+    [PHO_CFG_STORE_CACHE_cache_size] = {
+        .section = "store",
+        .name    = "cache_size",
+        .value   = "10737418240" /* 10 GiB */
+    },
+    [PHO_CFG_STORE_CACHE_cache_families] = {
+        .section = "store",
+        .name    = "cache_families",
+        .value   = "tape"
+    },
+};
+
+/** An entry of the cache directory, considered for eviction */
+struct cache_entry {
+    char *name;
+    off_t size;
+    struct timespec atime;  /**< last use, from the file mtime */
+};
+
+/**
+ * Return the cache directory if objects of \a layout have to be cached, NULL
+ * otherwise.
+ */
+static const char *cache_dir_for(const struct layout_info *layout)
+{
+    const char *families_csv;
+    enum rsc_family family;
+    const char *dir;
+    char **families;
+    bool found = false;
+    size_t n;
+    size_t i;
+
+    dir = PHO_CFG_GET(cfg_store_cache, PHO_CFG_STORE_CACHE, cache_dir);
+    if (dir == NULL || dir[0] == '\0' || layout->ext_count == 0)
+        return NULL;
+
+    families_csv = PHO_CFG_GET(cfg_store_cache, PHO_CFG_STORE_CACHE,
+                               cache_families);
+    if (families_csv == NULL)
+        return NULL;
+
+    if (get_val_csv(families_csv, &families, &n)) {
+        pho_warn("Invalid value for 'cache_families': '%s'", families_csv);
+        return NULL;
+    }
+
+    family = layout->extents[0].media.family;
+    for (i = 0; i < n; i++) {
+        if (str2rsc_family(families[i]) == family)
+            found = true;
+        free(families[i]);
+    }
+    free(families);
+
+    return found ? dir : NULL;
+}
+
+static int64_t cache_size_get(void)
+{
+    const char *size_str;
+    int64_t size;
+
+    size_str = PHO_CFG_GET(cfg_store_cache, PHO_CFG_STORE_CACHE, cache_size);
+    size = size_str ? str2int64(size_str) : INT64_MIN;
+    if (size < 0) {
+        pho_warn("Invalid value for 'cache_size': '%s'", size_str);
+        return 0;
+    }
+
+    return size;
+}
+
+/**
+ * Build the path of the cached copy of \a layout: the object version is
+ * identified by its uuid and version, and the checksum of its first extent
+ * tells apart an object rebuilt with the same uuid and version (e.g. after a
+ * DSS import).
+ */
+static char *cache_path(const char *dir, const struct layout_info *layout)
+{
+    const struct extent *ext = &layout->extents[0];
+    char *digest = NULL;
+    char *path;
+    int rc;
+
+    if (ext->with_xxh128)
+        digest = uchar2hex(ext->xxh128, sizeof(ext->xxh128));
+    else if (ext->with_md5)
+        digest = uchar2hex(ext->md5, sizeof(ext->md5));
+
+    rc = asprintf(&path, "%s/%s.%d.%s", dir, layout->uuid, layout->version,
+                  digest ? digest : "none");
+    free(digest);
+
+    return rc < 0 ? NULL : path;
+}
+
+/**
+ * Copy \a count bytes of \a fd_in, starting at \a offset_in, to the current
+ * offset of \a fd_out.
+ */
+static int cache_copy(int fd_in, off_t offset_in, int fd_out, off_t count)
+{
+    char *buf;
+    int rc = 0;
+
+    buf = malloc(CACHE_IO_SIZE);
+    if (!buf)
+        return -ENOMEM;
+
+    while (count > 0) {
+        size_t to_read = count < CACHE_IO_SIZE ? count : CACHE_IO_SIZE;
+        ssize_t n_read;
+        ssize_t done;
+
+        n_read = pread(fd_in, buf, to_read, offset_in);
+        if (n_read < 0)
+            GOTO(out, rc = -errno);
+        if (n_read == 0)
+            GOTO(out, rc = -EIO);
+
+        for (done = 0; done < n_read; ) {
+            ssize_t n_written = write(fd_out, buf + done, n_read - done);
+
+            if (n_written < 0)
+                GOTO(out, rc = -errno);
+            done += n_written;
+        }
+
+        offset_in += n_read;
+        count -= n_read;
+    }
+
+out:
+    free(buf);
+    return rc;
+}
+
+int store_cache_get(const struct layout_info *layout,
+                    struct pho_xfer_desc *xfer, off_t *offset)
+{
+    struct stat st;
+    const char *dir;
+    off_t start;
+    char *path;
+    int rc;
+    int fd;
+
+    *offset = -1;
+
+    dir = cache_dir_for(layout);
+    if (!dir)
+        return -ENOENT;
+
+    /* the object is read back from xd_fd to be cached, only files allow it */
+    if (fstat(xfer->xd_fd, &st) || !S_ISREG(st.st_mode))
+        return -ENOENT;
+
+    start = lseek(xfer->xd_fd, 0, SEEK_CUR);
+    if (start < 0)
+        return -ENOENT;
+
+    *offset = start;
+
+    path = cache_path(dir, layout);
+    if (!path)
+        return -ENOENT;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(path);
+        return -ENOENT;
+    }
+
+    rc = fstat(fd, &st);
+    if (rc)
+        GOTO(out, rc = -ENOENT);
+
+    /* the modification time records the last use, for eviction */
+    futimens(fd, NULL);
+
+    rc = cache_copy(fd, 0, xfer->xd_fd, st.st_size);
+    if (rc) {
+        pho_warn("Cannot copy '%s' from the read cache: %s, reading media",
+                 path, strerror(-rc));
+        if (lseek(xfer->xd_fd, start, SEEK_SET) == start &&
+            ftruncate(xfer->xd_fd, start) == 0)
+            rc = -ENOENT;
+        GOTO(out, rc);
+    }
+
+    pho_verb("objid:'%s' retrieved from the read cache", xfer->xd_objid);
+
+out:
+    close(fd);
+    free(path);
+    return rc;
+}
+
+static int cache_entry_cmp(const void *a, const void *b)
+{
+    const struct cache_entry *ea = a;
+    const struct cache_entry *eb = b;
+
+    if (ea->atime.tv_sec != eb->atime.tv_sec)
+        return ea->atime.tv_sec < eb->atime.tv_sec ? -1 : 1;
+    if (ea->atime.tv_nsec != eb->atime.tv_nsec)
+        return ea->atime.tv_nsec < eb->atime.tv_nsec ? -1 : 1;
+    return 0;
+}
+
+/**
+ * Remove the least recently used files of \a dir until \a needed more bytes
+ * fit in \a max_size.
+ */
+static int cache_evict(const char *dir, off_t needed, int64_t max_size)
+{
+    struct cache_entry *entries = NULL;
+    size_t n_entries = 0;
+    size_t n_alloc = 0;
+    struct dirent *dent;
+    int64_t used = 0;
+    int rc = 0;
+    DIR *dirp;
+    size_t i;
+
+    dirp = opendir(dir);
+    if (!dirp)
+        LOG_RETURN(-errno, "Cannot open read cache '%s'", dir);
+
+    while ((dent = readdir(dirp)) != NULL) {
+        struct stat st;
+
+        /* skip '.', '..' and the files being written */
+        if (dent->d_name[0] == '.')
+            continue;
+
+        if (fstatat(dirfd(dirp), dent->d_name, &st, 0) || !S_ISREG(st.st_mode))
+            continue;
+
+        if (n_entries == n_alloc) {
+            struct cache_entry *tmp;
+
+            n_alloc = n_alloc ? 2 * n_alloc : 64;
+            tmp = realloc(entries, n_alloc * sizeof(*entries));
+            if (!tmp)
+                GOTO(out, rc = -ENOMEM);
+            entries = tmp;
+        }
+
+        entries[n_entries].name = strdup(dent->d_name);
+        if (!entries[n_entries].name)
+            GOTO(out, rc = -ENOMEM);
+        entries[n_entries].size = st.st_size;
+        entries[n_entries].atime = st.st_mtim;
+        n_entries++;
+        used += st.st_size;
+    }
+
+    qsort(entries, n_entries, sizeof(*entries), cache_entry_cmp);
+
+    for (i = 0; i < n_entries && used + needed > max_size; i++) {
+        if (unlinkat(dirfd(dirp), entries[i].name, 0) && errno != ENOENT) {
+            pho_warn("Cannot evict '%s/%s' from the read cache: %s",
+                     dir, entries[i].name, strerror(errno));
+            continue;
+        }
+
+        pho_debug("Evicted '%s/%s' from the read cache", dir, entries[i].name);
+        used -= entries[i].size;
+    }
+
+    if (used + needed > max_size)
+        rc = -ENOSPC;
+
+out:
+    for (i = 0; i < n_entries; i++)
+        free(entries[i].name);
+    free(entries);
+    closedir(dirp);
+
+    return rc;
+}
+
+void store_cache_put(const struct layout_info *layout,
+                     struct pho_xfer_desc *xfer, off_t offset)
+{
+    char fd_path[PATH_MAX];
+    int64_t max_size;
+    char *tmp_path;
+    const char *dir;
+    char *path;
+    off_t size;
+    int fd_in;
+    int fd;
+    int rc;
+
+    dir = cache_dir_for(layout);
+    if (!dir)
+        return;
+
+    size = lseek(xfer->xd_fd, 0, SEEK_CUR) - offset;
+    max_size = cache_size_get();
+    if (size < 0 || size > max_size)
+        return;
+
+    path = cache_path(dir, layout);
+    if (!path)
+        return;
+
+    if (asprintf(&tmp_path, "%s/" CACHE_TMP_TEMPLATE, dir) < 0) {
+        free(path);
+        return;
+    }
+
+    rc = cache_evict(dir, size, max_size);
+    if (rc)
+        GOTO(free_path, rc);
+
+    /* xd_fd may be write only, read it back through another open file */
+    snprintf(fd_path, sizeof(fd_path), "/proc/self/fd/%d", xfer->xd_fd);
+    fd_in = open(fd_path, O_RDONLY);
+    if (fd_in < 0)
+        GOTO(free_path, rc = -errno);
+
+    fd = mkstemp(tmp_path);
+    if (fd < 0)
+        GOTO(close_in, rc = -errno);
+
+    rc = cache_copy(fd_in, offset, fd, size);
+    if (close(fd) && !rc)
+        rc = -errno;
+
+    /* only complete copies are visible under their final name */
+    if (!rc && rename(tmp_path, path))
+        rc = -errno;
+    if (rc)
+        unlink(tmp_path);
+    else
+        pho_verb("objid:'%s' added to the read cache", xfer->xd_objid);
+
+close_in:
+    close(fd_in);
+free_path:
+    if (rc)
+        pho_warn("Cannot add objid:'%s' to the read cache '%s': %s",
+                 xfer->xd_objid, dir, strerror(-rc));
+    free(tmp_path);
+    free(path);
+}
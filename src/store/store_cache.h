@@ -0,0 +1,69 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Read cache of Phobos store, keeping on a POSIX directory the objects
+ *         retrieved from slow media families
+ */
+#ifndef _STORE_CACHE_H
+#define _STORE_CACHE_H
+
+#include "phobos_store.h"
+#include "pho_types.h"
+
+#include <sys/types.h>
+
+/**
+ * Try to serve a GET from the read cache.
+ *
+ * On a hit, the cached copy of the object is written to xfer->xd_fd and the
+ * transfer does not need any medium.
+ *
+ * On a miss, \a offset is set to the current offset of xfer->xd_fd if the
+ * object may be added to the cache once retrieved (see store_cache_put), or to
+ * -1 otherwise.
+ *
+ * @param[in]   layout  Layout of the object to retrieve.
+ * @param[in]   xfer    GET transfer.
+ * @param[out]  offset  Offset of xfer->xd_fd from which the object will be
+ *                      written, -1 if it must not be cached.
+ *
+ * @return 0 on a hit, -ENOENT on a miss, another -errno if the cached copy
+ *         could only be partially written to xfer->xd_fd.
+ */
+int store_cache_get(const struct layout_info *layout,
+                    struct pho_xfer_desc *xfer, off_t *offset);
+
+/**
+ * Add to the read cache an object that was just retrieved to xfer->xd_fd,
+ * evicting the least recently used objects if the cache is full.
+ *
+ * Failures are only reported as warnings, since the transfer itself succeeded.
+ *
+ * @param[in]   layout  Layout of the retrieved object.
+ * @param[in]   xfer    Successful GET transfer.
+ * @param[in]   offset  Offset of xfer->xd_fd from which the object was
+ *                      written, as set by store_cache_get.
+ */
+void store_cache_put(const struct layout_info *layout,
+                     struct pho_xfer_desc *xfer, off_t offset);
+
+#endif
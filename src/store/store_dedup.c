@@ -0,0 +1,520 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Deduplicated objects of Phobos store
+ *
+ * When 'dedup' is enabled, the XXH128 of the data of each raid1 PUT is
+ * computed before it is written and looked up in the layout_extent table. If
+ * a layout of the same family, tags and replica count already holds the same
+ * data, the new layout refers to its extents instead, and the data is not
+ * written.
+ *
+ * The extended attributes of an extent describe the object version that wrote
+ * it, so the deduplicated PUT records itself on each of the shared extents, as
+ * a "ref.<n>" attribute: the media are allocated for reading, the first free
+ * reference is set, and the media are released and synced. A medium import
+ * then rebuilds every object referring to the extent. If the extent has no
+ * room left for another attribute, the data is written as for any other PUT.
+ *
+ * Extents are then shared by several layouts: the data of an extent is only
+ * removed from its medium once no layout refers to it anymore, see
+ * dss_extent_refcount_get().
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "store_dedup.h"
+
+#include "pho_attrs.h"
+#include "pho_cfg.h"
+#include "pho_checksum.h"
+#include "pho_common.h"
+#include "pho_io.h"
+#include "pho_srl_lrs.h"
+#include "pho_type_utils.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+/** Only raid1 layouts are deduplicated */
+#define DEDUP_LAYOUT_NAME "raid1"
+
+#define DEDUP_READ_SIZE (1024 * 1024)
+
+/**
+ * List of configuration parameters for deduplicated objects
+ */
+enum pho_cfg_params_store_dedup {
+    PHO_CFG_STORE_DEDUP_FIRST,
+
+    /* store dedup parameters */
+    PHO_CFG_STORE_DEDUP_dedup = PHO_CFG_STORE_DEDUP_FIRST,
+
+    PHO_CFG_STORE_DEDUP_LAST
+};
+
+const struct pho_config_item cfg_store_dedup[] = {
+    [PHO_CFG_STORE_DEDUP_dedup] = {
+        .section = "store",
+        .name    = "dedup",
+        .value   = "no"
+    },
+};
+
+/**
+ * Value of a raid1 parameter for \a xfer: from its layout parameters, else
+ * from the [layout_raid1] section, else \a def.
+ */
+static const char *raid1_param_get(struct pho_xfer_desc *xfer,
+                                   const char *name, const char *def)
+{
+    const char *value = NULL;
+
+    if (!pho_attrs_is_empty(&xfer->xd_params.put.lyt_params))
+        value = pho_attr_get(&xfer->xd_params.put.lyt_params, name);
+
+    if (value == NULL && pho_cfg_get_val("layout_raid1", name, &value))
+        value = NULL;
+
+    return value ? : def;
+}
+
+/** Compute the XXH128 of the \a size bytes of \a fd from its current offset */
+static int dedup_hash(int fd, ssize_t size, unsigned char *xxh128)
+{
+    struct pho_checksum checksum;
+    struct extent digest = {0};
+    ssize_t done = 0;
+    off_t offset;
+    char *buffer;
+    int rc;
+
+    offset = lseek(fd, 0, SEEK_CUR);
+    if (offset < 0)
+        return -errno;
+
+    buffer = malloc(DEDUP_READ_SIZE);
+    if (!buffer)
+        return -ENOMEM;
+
+    rc = pho_checksum_init(&checksum, false, true, false);
+    if (rc)
+        goto free_buffer;
+
+    /* the data is read without moving the offset, to be written if needed */
+    while (done < size) {
+        ssize_t n = pread(fd, buffer, min(size - done, DEDUP_READ_SIZE),
+                          offset + done);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            GOTO(fini, rc = -errno);
+        if (n == 0)
+            GOTO(fini, rc = -EIO);
+
+        rc = pho_checksum_update(&checksum, buffer, n);
+        if (rc)
+            goto fini;
+
+        done += n;
+    }
+
+    rc = pho_checksum_digest(&checksum, &digest);
+    if (!rc)
+        memcpy(xxh128, digest.xxh128, sizeof(digest.xxh128));
+
+fini:
+    pho_checksum_fini(&checksum);
+free_buffer:
+    free(buffer);
+    return rc;
+}
+
+static int attr_copy_cb(const char *key, const char *value, void *udata)
+{
+    return pho_attr_set(udata, key, value);
+}
+
+/** State of the recording of a deduplicated PUT on its shared extents */
+struct dedup_encoder {
+    int rc;                     /**< Outcome of the recording */
+};
+
+/**
+ * Build the reference of the object version put by \a xfer, as recorded on
+ * the extents it shares, see PHO_EA_REF_NAME.
+ */
+static int dedup_ref_build(struct pho_xfer_desc *xfer, GString *ref)
+{
+    struct pho_attrs attrs = {0};
+    GString *user_md = NULL;
+    char write_time[24];
+    struct timeval now;
+    char version[16];
+    int rc;
+
+    gettimeofday(&now, NULL);
+    snprintf(write_time, sizeof(write_time), "%" PRId64,
+             (int64_t)now.tv_sec * 1000000 + now.tv_usec);
+    snprintf(version, sizeof(version), "%d", xfer->xd_version);
+
+    rc = pho_attr_set(&attrs, PHO_EA_ID_NAME, xfer->xd_objid);
+    rc = rc ? : pho_attr_set(&attrs, PHO_EA_UUID_NAME, xfer->xd_objuuid);
+    rc = rc ? : pho_attr_set(&attrs, PHO_EA_VERSION_NAME, version);
+    rc = rc ? : pho_attr_set(&attrs, PHO_EA_CTIME_NAME, write_time);
+    if (rc)
+        goto free_attrs;
+
+    if (!pho_attrs_is_empty(&xfer->xd_attrs)) {
+        user_md = g_string_new(NULL);
+        rc = pho_attrs_to_json(&xfer->xd_attrs, user_md, 0);
+        rc = rc ? : pho_attr_set(&attrs, PHO_EA_UMD_NAME, user_md->str);
+        g_string_free(user_md, true);
+        if (rc)
+            goto free_attrs;
+    }
+
+    rc = pho_attrs_to_json(&attrs, ref, JSON_COMPACT);
+
+free_attrs:
+    pho_attrs_free(&attrs);
+    return rc;
+}
+
+/**
+ * Record \a ref on the extents of \a enc stored on the allocated \a medium,
+ * as the first free reference.
+ *
+ * @return 0 on success, -ENOSPC if an extent has no room left for another
+ *         attribute, another negative error code on failure.
+ */
+static int dedup_ref_record(struct pho_encoder *enc, const char *ref,
+                            const pho_resp_read_elt_t *medium)
+{
+    struct io_adapter_module *ioa;
+    int rc;
+    int i;
+
+    rc = get_io_adapter((enum fs_type)medium->fs_type, &ioa);
+    if (rc)
+        return rc;
+
+    for (i = 0; i < enc->layout->ext_count; i++) {
+        struct extent *extent = &enc->layout->extents[i];
+        struct pho_io_descr iod = {0};
+        struct pho_attrs refs = {0};
+        struct pho_ext_loc loc;
+        char name[32];
+        int n_refs;
+
+        if (strcmp(extent->media.name, medium->med_id->name))
+            continue;
+
+        loc.root_path = medium->root_path;
+        loc.extent = extent;
+        loc.addr_type = (enum address_type)medium->addr_type;
+
+        rc = get_extent_refs(ioa, &loc, &refs, &n_refs);
+        pho_attrs_free(&refs);
+        if (rc)
+            LOG_RETURN(rc, "Cannot read the references of extent '%s'",
+                       extent->address.buff);
+
+        /* the medium is allocated to this PUT, no other one can take it */
+        snprintf(name, sizeof(name), PHO_EA_REF_NAME "%d", n_refs);
+        rc = pho_attr_set(&iod.iod_attrs, name, ref);
+        if (rc)
+            return rc;
+
+        iod.iod_flags = PHO_IO_MD_ONLY;
+        iod.iod_loc = &loc;
+        rc = ioa_set_md(ioa, NULL, NULL, &iod);
+        pho_attrs_free(&iod.iod_attrs);
+        if (rc == -ENOSPC || rc == -E2BIG || rc == -ERANGE)
+            LOG_RETURN(-ENOSPC, "Extent '%s' has no room left for reference %d",
+                       extent->address.buff, n_refs);
+        if (rc)
+            LOG_RETURN(rc, "Cannot record reference %d on extent '%s'",
+                       n_refs, extent->address.buff);
+    }
+
+    return 0;
+}
+
+/** Whether the medium of extent \a idx also holds a previous extent */
+static bool dedup_medium_seen(struct layout_info *layout, int idx)
+{
+    int i;
+
+    for (i = 0; i < idx; i++)
+        if (!strcmp(layout->extents[i].media.name,
+                    layout->extents[idx].media.name))
+            return true;
+
+    return false;
+}
+
+/** Allocate every medium holding a copy of the shared data, for reading */
+static int dedup_read_req(struct pho_encoder *enc, pho_req_t *req)
+{
+    struct layout_info *layout = enc->layout;
+    int n_media = 0;
+    int rc;
+    int i;
+
+    for (i = 0; i < layout->ext_count; i++)
+        if (!dedup_medium_seen(layout, i))
+            n_media++;
+
+    rc = pho_srl_request_read_alloc(req, n_media);
+    if (rc)
+        return rc;
+
+    /* each copy records the reference, so that each medium describes it */
+    req->ralloc->n_required = n_media;
+    n_media = 0;
+    for (i = 0; i < layout->ext_count; i++) {
+        pho_rsc_id_t *med_id;
+
+        if (dedup_medium_seen(layout, i))
+            continue;
+
+        med_id = req->ralloc->med_ids[n_media++];
+        med_id->family = layout->extents[i].media.family;
+        med_id->name = strdup(layout->extents[i].media.name);
+        if (!med_id->name)
+            return -ENOMEM;
+    }
+
+    return 0;
+}
+
+/** Record the reference on the allocated media and release them */
+static int dedup_release_req(struct pho_encoder *enc, pho_resp_t *resp,
+                             pho_req_t *req)
+{
+    struct dedup_encoder *dedup = enc->priv_enc;
+    GString *ref;
+    int rc;
+    int i;
+
+    rc = pho_srl_request_release_alloc(req, resp->ralloc->n_media);
+    if (rc)
+        return rc;
+
+    ref = g_string_new(NULL);
+    dedup->rc = dedup_ref_build(enc->xfer, ref);
+
+    for (i = 0; i < resp->ralloc->n_media; i++) {
+        pho_req_release_elt_t *release = req->release->media[i];
+        int rc2 = dedup->rc;
+
+        rsc_id_cpy(release->med_id, resp->ralloc->media[i]->med_id);
+        if (!rc2)
+            rc2 = dedup_ref_record(enc, ref->str, resp->ralloc->media[i]);
+
+        /* a full attribute space is not an error of the medium */
+        release->rc = rc2 == -ENOSPC ? 0 : rc2;
+        release->to_sync = true;
+        dedup->rc = dedup->rc ? : rc2;
+    }
+
+    g_string_free(ref, true);
+    return 0;
+}
+
+/**
+ * Deduplicated PUT implementation of the `step` method: the media of the
+ * shared extents are allocated, the reference recorded on them, and they are
+ * released (see `layout_step` doc).
+ */
+static int dedup_encoder_step(struct pho_encoder *enc, pho_resp_t *resp,
+                              pho_req_t **reqs, size_t *n_reqs)
+{
+    struct dedup_encoder *dedup = enc->priv_enc;
+    int rc = 0;
+
+    *reqs = calloc(1, sizeof(**reqs));
+    if (*reqs == NULL)
+        return -ENOMEM;
+    *n_reqs = 0;
+
+    if (resp == NULL) {
+        rc = dedup_read_req(enc, *reqs);
+        (*n_reqs)++;
+    } else if (pho_response_is_error(resp)) {
+        enc->xfer->xd_rc = resp->error->rc;
+        enc->done = true;
+        pho_error(enc->xfer->xd_rc,
+                  "Encoder for objid:'%s' received error %s to last request",
+                  enc->xfer->xd_objid, pho_srl_error_kind_str(resp->error));
+    } else if (pho_response_is_read(resp)) {
+        rc = dedup_release_req(enc, resp, *reqs);
+        (*n_reqs)++;
+    } else if (pho_response_is_release(resp)) {
+        enc->xfer->xd_rc = dedup->rc;
+        enc->done = true;
+    } else {
+        rc = -EPROTO;
+        pho_error(rc, "Invalid response type");
+    }
+
+    if (*n_reqs == 0) {
+        free(*reqs);
+        *reqs = NULL;
+    }
+
+    return rc;
+}
+
+static void dedup_encoder_destroy(struct pho_encoder *enc)
+{
+    free(enc->priv_enc);
+    enc->priv_enc = NULL;
+}
+
+static const struct pho_enc_ops DEDUP_ENCODER_OPS = {
+    .step       = dedup_encoder_step,
+    .destroy    = dedup_encoder_destroy,
+};
+
+/** Build the layout of \a enc from the extents of \a shared */
+static int dedup_layout_build(struct pho_encoder *enc,
+                              struct pho_xfer_desc *xfer,
+                              struct layout_info *shared)
+{
+    struct layout_info *layout;
+    int rc;
+    int i;
+
+    layout = calloc(1, sizeof(*layout));
+    if (!layout)
+        return -ENOMEM;
+
+    enc->is_decoder = false;
+    enc->done = false;
+    enc->xfer = xfer;
+    enc->layout = layout;
+    enc->ops = &DEDUP_ENCODER_OPS;
+    enc->priv_enc = calloc(1, sizeof(struct dedup_encoder));
+    if (!enc->priv_enc)
+        return -ENOMEM;
+
+    layout->oid = xfer->xd_objid;
+    layout->wr_size = xfer->xd_params.put.size;
+    layout->state = PHO_EXT_ST_SYNC;
+    layout->layout_desc.mod_name = DEDUP_LAYOUT_NAME;
+    layout->layout_desc.mod_major = shared->layout_desc.mod_major;
+    layout->layout_desc.mod_minor = shared->layout_desc.mod_minor;
+
+    rc = pho_attrs_foreach(&shared->layout_desc.mod_attrs, attr_copy_cb,
+                           &layout->layout_desc.mod_attrs);
+    if (rc)
+        return rc;
+
+    layout->extents = calloc(shared->ext_count, sizeof(*layout->extents));
+    if (!layout->extents)
+        return -ENOMEM;
+
+    for (i = 0; i < shared->ext_count; i++) {
+        struct extent *extent = &layout->extents[i];
+
+        *extent = shared->extents[i];
+        extent->address.buff = strdup(shared->extents[i].address.buff);
+        if (!extent->address.buff)
+            return -ENOMEM;
+
+        layout->ext_count++;
+    }
+
+    return 0;
+}
+
+int store_dedup_encode(struct pho_encoder *enc, struct pho_xfer_desc *xfer,
+                       struct dss_handle *dss, bool *deduped)
+{
+    ssize_t size = xfer->xd_params.put.size;
+    struct dedup_filter filter = {0};
+    struct layout_info *shared;
+    const char *value;
+    struct stat st;
+    int rc;
+
+    *deduped = false;
+
+    value = PHO_CFG_GET(cfg_store_dedup, PHO_CFG_STORE_DEDUP, dedup);
+    if (!value || strcmp(value, "yes"))
+        return 0;
+
+    /* compressed layouts do not hold the data itself */
+    if (size <= 0 || !xfer->xd_params.put.layout_name ||
+        strcmp(xfer->xd_params.put.layout_name, DEDUP_LAYOUT_NAME) ||
+        strcmp(raid1_param_get(xfer, "compression", "none"), "none") ||
+        !pho_checksum_xxh128_available())
+        return 0;
+
+    if (fstat(xfer->xd_fd, &st) || !S_ISREG(st.st_mode))
+        return 0;
+
+    rc = dedup_hash(xfer->xd_fd, size, filter.xxh128);
+    if (rc) {
+        pho_warn("Cannot hash objid:'%s' for deduplication: %s",
+                 xfer->xd_objid, strerror(-rc));
+        return 0;
+    }
+
+    filter.size = size;
+    filter.family = xfer->xd_params.put.family;
+    filter.tags = &xfer->xd_params.put.tags;
+    filter.repl_count = raid1_param_get(xfer, "repl_count", "2");
+
+    rc = dss_layout_dedup_get(dss, &filter, &shared);
+    if (rc == -ENOENT)
+        return 0;
+    if (rc) {
+        pho_warn("Cannot look up the data of objid:'%s' for deduplication: %s",
+                 xfer->xd_objid, strerror(-rc));
+        return 0;
+    }
+
+    rc = dedup_layout_build(enc, xfer, shared);
+    if (rc) {
+        pho_error(rc, "Cannot build the deduplicated layout of objid:'%s'",
+                  xfer->xd_objid);
+    } else {
+        *deduped = true;
+        pho_verb("objid:'%s' refers to the extents of objid:'%s'",
+                 xfer->xd_objid, shared->oid);
+    }
+
+    dss_res_free(shared, 1);
+    return rc;
+}
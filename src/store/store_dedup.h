@@ -0,0 +1,57 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Deduplicated objects of Phobos store: objects whose data is already
+ *         on media refer to the existing extents instead of writing it again
+ */
+#ifndef _STORE_DEDUP_H
+#define _STORE_DEDUP_H
+
+#include "phobos_store.h"
+#include "pho_dss.h"
+#include "pho_layout.h"
+
+#include <stdbool.h>
+
+/**
+ * Make a PUT refer to existing extents holding the same data, if
+ * deduplication is enabled.
+ *
+ * The data is hashed from xfer->xd_fd, which must be a regular file so that
+ * it can be read again if no layout holds it. The layout of \a enc is then
+ * built from the extents found, and its steps record the PUT on them instead
+ * of writing the data. If they have no room left for it, the PUT ends with
+ * -ENOSPC and its data is to be written on media.
+ *
+ * @param[out]      enc     Encoder of the PUT, only initialized if the PUT is
+ *                          deduplicated.
+ * @param[in]       xfer    PUT transfer.
+ * @param[in]       dss     DSS handle.
+ * @param[out]      deduped true if the PUT is deduplicated, false if the
+ *                          object is to be written on media.
+ *
+ * @return 0 on success, -errno on failure.
+ */
+int store_dedup_encode(struct pho_encoder *enc, struct pho_xfer_desc *xfer,
+                       struct dss_handle *dss, bool *deduped);
+
+#endif
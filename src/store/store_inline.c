@@ -0,0 +1,196 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Inline objects of Phobos store
+ *
+ * Each small object costs an LRS allocation, a file creation and several
+ * extended attributes on its medium, and a sync. Objects of at most
+ * 'inline_max_size' bytes are instead saved in the DSS, in the inline_extent
+ * table, with a layout named "inline" that has no extent. They are retrieved
+ * from the DSS, without any medium.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "store_inline.h"
+
+#include "pho_cfg.h"
+#include "pho_common.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * List of configuration parameters for inline objects
+ */
+enum pho_cfg_params_store_inline {
+    PHO_CFG_STORE_INLINE_FIRST,
+
+    /* store inline parameters */
+    PHO_CFG_STORE_INLINE_inline_max_size = PHO_CFG_STORE_INLINE_FIRST,
+
+    PHO_CFG_STORE_INLINE_LAST
+};
+
+const struct pho_config_item cfg_store_inline[] = {
+    [PHO_CFG_STORE_INLINE_inline_max_size] = {
+        .section = "store",
+        .name    = "inline_max_size",
+        .value   = "0" /* disabled */
+    },
+};
+
+/** Maximal size of the objects stored in the DSS, 0 if none is */
+static int64_t inline_max_size_get(void)
+{
+    const char *size_str;
+    int64_t size;
+
+    size_str = PHO_CFG_GET(cfg_store_inline, PHO_CFG_STORE_INLINE,
+                           inline_max_size);
+    size = size_str ? str2int64(size_str) : INT64_MIN;
+    if (size < 0) {
+        pho_warn("Invalid value for 'inline_max_size': '%s'", size_str);
+        return 0;
+    }
+
+    return size;
+}
+
+bool store_inline_is_inline(const struct layout_info *layout)
+{
+    return layout && layout->layout_desc.mod_name &&
+           !strcmp(layout->layout_desc.mod_name, INLINE_LAYOUT_NAME);
+}
+
+/** Read exactly \a size bytes of \a fd */
+static int inline_read(int fd, void *buf, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t rc = read(fd, (char *)buf + done, size - done);
+
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0)
+            return -errno;
+        if (rc == 0)
+            return -EIO;
+        done += rc;
+    }
+
+    return 0;
+}
+
+/** Write the \a size bytes of \a buf to \a fd */
+static int inline_write(int fd, const void *buf, size_t size)
+{
+    size_t done = 0;
+
+    while (done < size) {
+        ssize_t rc = write(fd, (const char *)buf + done, size - done);
+
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc < 0)
+            return -errno;
+        done += rc;
+    }
+
+    return 0;
+}
+
+int store_inline_encode(struct pho_encoder *enc, struct pho_xfer_desc *xfer,
+                        struct inline_content *content)
+{
+    ssize_t size = xfer->xd_params.put.size;
+    int rc;
+
+    content->inlined = false;
+    content->data = NULL;
+    content->size = 0;
+
+    if (size < 0 || size > inline_max_size_get())
+        return 0;
+
+    content->data = malloc(size ? : 1);
+    if (!content->data)
+        return -ENOMEM;
+
+    rc = inline_read(xfer->xd_fd, content->data, size);
+    if (rc)
+        LOG_GOTO(err, rc, "Cannot read the content of objid:'%s'",
+                 xfer->xd_objid);
+
+    enc->is_decoder = false;
+    enc->done = false;
+    enc->xfer = xfer;
+    enc->layout = calloc(1, sizeof(*enc->layout));
+    if (!enc->layout)
+        GOTO(err, rc = -ENOMEM);
+
+    enc->layout->oid = xfer->xd_objid;
+    enc->layout->wr_size = size;
+    enc->layout->state = PHO_EXT_ST_SYNC;
+    enc->layout->layout_desc.mod_name = INLINE_LAYOUT_NAME;
+    enc->layout->layout_desc.mod_major = 0;
+    enc->layout->layout_desc.mod_minor = 1;
+
+    content->inlined = true;
+    content->size = size;
+
+    pho_verb("objid:'%s' of %zd bytes is stored in the DSS", xfer->xd_objid,
+             size);
+    return 0;
+
+err:
+    free(content->data);
+    content->data = NULL;
+    return rc;
+}
+
+int store_inline_decode(struct pho_encoder *dec, struct dss_handle *dss)
+{
+    struct pho_xfer_desc *xfer = dec->xfer;
+    size_t size;
+    void *data;
+    int rc;
+
+    rc = dss_layout_inline_get(dss, dec->layout, &data, &size);
+    if (rc)
+        LOG_RETURN(rc, "Cannot retrieve the content of objid:'%s'",
+                   xfer->xd_objid);
+
+    rc = inline_write(xfer->xd_fd, data, size);
+    free(data);
+    if (rc)
+        LOG_RETURN(rc, "Cannot write the content of objid:'%s'",
+                   xfer->xd_objid);
+
+    pho_verb("objid:'%s' retrieved from the DSS", xfer->xd_objid);
+    dec->done = true;
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Inline objects of Phobos store: objects smaller than
+ *         'inline_max_size' are stored in the DSS instead of on media
+ */
+#ifndef _STORE_INLINE_H
+#define _STORE_INLINE_H
+
+#include "phobos_store.h"
+#include "pho_dss.h"
+#include "pho_layout.h"
+#include "pho_types.h"
+
+#include <stdbool.h>
+
+/** Layout name of the objects stored in the DSS */
+#define INLINE_LAYOUT_NAME "inline"
+
+/** Content of a PUT stored in the DSS */
+struct inline_content {
+    bool inlined;               /**< true if the PUT is stored in the DSS */
+    void *data;                 /**< content of the object, read from xd_fd */
+    size_t size;                /**< size of \a data */
+};
+
+/** Tell whether \a layout is stored in the DSS */
+bool store_inline_is_inline(const struct layout_info *layout);
+
+/**
+ * Store a PUT in the DSS if it is small enough.
+ *
+ * The content of the object is read from xfer->xd_fd to \a content, and the
+ * layout of \a enc is built without any extent, so that no medium is
+ * requested to the LRS. The content is saved along with the layout, see
+ * dss_layout_inline_set().
+ *
+ * @param[out]      enc     Encoder of the PUT, only initialized if the PUT is
+ *                          stored in the DSS.
+ * @param[in]       xfer    PUT transfer.
+ * @param[out]      content Content of the PUT, content->inlined being false if
+ *                          the object is to be written on media.
+ *
+ * @return 0 on success, -errno if the content could not be read.
+ */
+int store_inline_encode(struct pho_encoder *enc, struct pho_xfer_desc *xfer,
+                        struct inline_content *content);
+
+/**
+ * Serve a GET of an object stored in the DSS: its content is written to
+ * xfer->xd_fd and the decoder is marked as done.
+ *
+ * @param[in,out]   dec     Decoder of the GET, with its layout retrieved from
+ *                          the DSS.
+ * @param[in]       dss     DSS handle.
+ *
+ * @return 0 on success, -errno on failure.
+ */
+int store_inline_decode(struct pho_encoder *dec, struct dss_handle *dss);
+
+#endif
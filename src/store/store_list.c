@@ -82,25 +82,34 @@ static void phobos_construct_res(GString *res_str, const char **res,
         g_string_append_printf(res_str, "]}");
 }
 
-int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
-                             const char **metadata, int n_metadata,
-                             bool deprecated, struct object_info **objs,
-                             int *n_objs)
+/**
+ * Build the object list filter from the requested objids or patterns and
+ * metadata.
+ *
+ * \param[in]       res             Objids or patterns.
+ * \param[in]       n_res           Number of requested objids or patterns.
+ * \param[in]       is_pattern      True if search using POSIX pattern.
+ * \param[in]       metadata        Metadata filter.
+ * \param[in]       n_metadata      Number of requested metadata.
+ * \param[out]      filter          Filter to build.
+ * \param[out]      filter_ptr      Set to \a filter if a filter is needed,
+ *                                  NULL otherwise.
+ *
+ * \return                          0     on success,
+ *                                 -errno on failure.
+ */
+static int phobos_construct_object_filter(const char **res, int n_res,
+                                          bool is_pattern,
+                                          const char **metadata,
+                                          int n_metadata,
+                                          struct dss_filter *filter,
+                                          struct dss_filter **filter_ptr)
 {
-    struct dss_filter *filter_ptr = NULL;
-    struct dss_filter filter;
-    struct dss_handle dss;
     GString *metadata_str;
     GString *res_str;
-    int rc;
+    int rc = 0;
 
-    rc = pho_cfg_init_local(NULL);
-    if (rc && rc != -EALREADY)
-        return rc;
-
-    rc = dss_init(&dss);
-    if (rc != 0)
-        return rc;
+    *filter_ptr = NULL;
 
     metadata_str = g_string_new(NULL);
     res_str = g_string_new(NULL);
@@ -130,7 +139,7 @@ int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
          * if any is present, which are the second and fourth "%s".
          * Finally, is both are present, a comma is necessary.
          */
-        rc = dss_filter_build(&filter,
+        rc = dss_filter_build(filter,
                               "%s %s %s %s %s",
                               ((n_metadata && n_res) || (n_metadata > 1)) ?
                                 "{\"$AND\" : [" : "",
@@ -140,12 +149,39 @@ int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
                                 metadata_str->str : "",
                               ((n_metadata && n_res) || (n_metadata > 1)) ?
                                 "]}" : "");
-        if (rc)
-            GOTO(err, rc);
-
-        filter_ptr = &filter;
+        if (!rc)
+            *filter_ptr = filter;
     }
 
+    g_string_free(metadata_str, TRUE);
+    g_string_free(res_str, TRUE);
+
+    return rc;
+}
+
+int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
+                             const char **metadata, int n_metadata,
+                             bool deprecated, struct object_info **objs,
+                             int *n_objs)
+{
+    struct dss_filter *filter_ptr;
+    struct dss_filter filter;
+    struct dss_handle dss;
+    int rc;
+
+    rc = pho_cfg_init_local(NULL);
+    if (rc && rc != -EALREADY)
+        return rc;
+
+    rc = dss_init(&dss);
+    if (rc != 0)
+        return rc;
+
+    rc = phobos_construct_object_filter(res, n_res, is_pattern, metadata,
+                                        n_metadata, &filter, &filter_ptr);
+    if (rc)
+        GOTO(err, rc);
+
     if (deprecated)
         rc = dss_deprecated_object_get(&dss, filter_ptr, objs, n_objs);
     else
@@ -157,8 +193,6 @@ int phobos_store_object_list(const char **res, int n_res, bool is_pattern,
     dss_filter_free(filter_ptr);
 
 err:
-    g_string_free(metadata_str, TRUE);
-    g_string_free(res_str, TRUE);
     dss_fini(&dss);
 
     return rc;
@@ -168,3 +202,60 @@ void phobos_store_object_list_free(struct object_info *objs, int n_objs)
 {
     dss_res_free(objs, n_objs);
 }
+
+int phobos_store_object_list_iter(const char **res, int n_res,
+                                  bool is_pattern, const char **metadata,
+                                  int n_metadata, bool deprecated,
+                                  struct dss_iter **iter)
+{
+    struct dss_filter *filter_ptr;
+    struct dss_filter filter;
+    struct dss_handle dss;
+    int rc;
+
+    rc = pho_cfg_init_local(NULL);
+    if (rc && rc != -EALREADY)
+        return rc;
+
+    rc = dss_init(&dss);
+    if (rc != 0)
+        return rc;
+
+    rc = phobos_construct_object_filter(res, n_res, is_pattern, metadata,
+                                        n_metadata, &filter, &filter_ptr);
+    if (rc)
+        GOTO(err, rc);
+
+    /* the iterator has a connection of its own, dss can be released */
+    if (deprecated)
+        rc = dss_deprecated_object_iter_open(&dss, filter_ptr, iter);
+    else
+        rc = dss_object_iter_open(&dss, filter_ptr, iter);
+
+    if (rc)
+        pho_error(rc, "Cannot fetch objects");
+
+    dss_filter_free(filter_ptr);
+
+err:
+    dss_fini(&dss);
+
+    return rc;
+}
+
+int phobos_store_object_list_next(struct dss_iter *iter,
+                                  struct object_info **obj)
+{
+    int rc;
+
+    rc = dss_iter_next(iter, (void **)obj);
+    if (rc)
+        pho_error(rc, "Cannot fetch next object");
+
+    return rc;
+}
+
+void phobos_store_object_list_iter_free(struct dss_iter *iter)
+{
+    dss_iter_close(iter);
+}
@@ -0,0 +1,151 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Write-back staging of Phobos store
+ *
+ * PUTs to the families listed in 'staged_families' are written on
+ * 'staging_family' and acknowledged once there. Their destination is recorded
+ * in the DSS along with their layout, and phobos_admin_flush() later copies
+ * them to their family by large batches.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "store_staging.h"
+
+#include "pho_cfg.h"
+#include "pho_common.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * List of configuration parameters for write-back staging
+ */
+enum pho_cfg_params_store_staging {
+    PHO_CFG_STORE_STAGING_FIRST,
+
+    /* store staging parameters */
+    PHO_CFG_STORE_STAGING_staging_family = PHO_CFG_STORE_STAGING_FIRST,
+    PHO_CFG_STORE_STAGING_staged_families,
+
+    PHO_CFG_STORE_STAGING_LAST
+};
+
+const struct pho_config_item cfg_store_staging[] = {
+    [PHO_CFG_STORE_STAGING_staging_family] = {
+        .section = "store",
+        .name    = "staging_family",
+        .value   = NULL
+    },
+    [PHO_CFG_STORE_STAGING_staged_families] = {
+        .section = "store",
+        .name    = "staged_families",
+        .value   = "tape"
+    },
+};
+
+/** Tell whether PUTs to \a family are staged */
+static int family_is_staged(enum rsc_family family, bool *staged)
+{
+    const char *families_csv;
+    char **families;
+    size_t n;
+    size_t i;
+    int rc;
+
+    *staged = false;
+
+    families_csv = PHO_CFG_GET(cfg_store_staging, PHO_CFG_STORE_STAGING,
+                               staged_families);
+    if (families_csv == NULL)
+        return 0;
+
+    rc = get_val_csv(families_csv, &families, &n);
+    if (rc)
+        LOG_RETURN(rc, "Invalid value for 'staged_families': '%s'",
+                   families_csv);
+
+    for (i = 0; i < n; i++) {
+        if (str2rsc_family(families[i]) == family)
+            *staged = true;
+        free(families[i]);
+    }
+    free(families);
+
+    return 0;
+}
+
+int store_staging_redirect(struct pho_xfer_desc *xfer,
+                           struct staging_target *target)
+{
+    struct pho_xfer_put_params *put = &xfer->xd_params.put;
+    enum rsc_family staging_family;
+    const char *cfg_val;
+    bool staged;
+    int rc;
+
+    target->family = PHO_RSC_INVAL;
+    memset(&target->tags, 0, sizeof(target->tags));
+
+    cfg_val = PHO_CFG_GET(cfg_store_staging, PHO_CFG_STORE_STAGING,
+                          staging_family);
+    if (cfg_val == NULL || cfg_val[0] == '\0')
+        return 0;
+
+    staging_family = str2rsc_family(cfg_val);
+    if (staging_family == PHO_RSC_INVAL)
+        LOG_RETURN(-EINVAL, "Invalid value for 'staging_family': '%s'",
+                   cfg_val);
+
+    if (put->family == staging_family)
+        return 0;
+
+    rc = family_is_staged(put->family, &staged);
+    if (rc || !staged)
+        return rc;
+
+    pho_verb("objid:'%s' is staged on %s before being flushed to %s",
+             xfer->xd_objid, rsc_family2str(staging_family),
+             rsc_family2str(put->family));
+
+    /* the tags of the destination do not apply to the staging media */
+    target->family = put->family;
+    target->tags = put->tags;
+    memset(&put->tags, 0, sizeof(put->tags));
+    put->family = staging_family;
+
+    return 0;
+}
+
+void store_staging_restore(struct pho_xfer_desc *xfer,
+                           struct staging_target *target)
+{
+    if (target->family == PHO_RSC_INVAL)
+        return;
+
+    xfer->xd_params.put.family = target->family;
+    xfer->xd_params.put.tags = target->tags;
+    target->family = PHO_RSC_INVAL;
+    memset(&target->tags, 0, sizeof(target->tags));
+}
@@ -0,0 +1,65 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Write-back staging of Phobos store: PUTs to slow media families
+ *         are written on a faster staging family, then flushed by
+ *         phobos_admin_flush()
+ */
+#ifndef _STORE_STAGING_H
+#define _STORE_STAGING_H
+
+#include "phobos_store.h"
+#include "pho_types.h"
+
+/** Destination of a PUT written on the staging family */
+struct staging_target {
+    enum rsc_family family;     /**< family the object is flushed to,
+                                  *  PHO_RSC_INVAL if the PUT is not staged
+                                  */
+    struct tags tags;           /**< tags of the PUT, to select the media the
+                                  *  object is flushed to
+                                  */
+};
+
+/**
+ * Redirect a PUT to the staging family if its family is staged.
+ *
+ * The family and tags of the PUT are moved to \a target and replaced by the
+ * staging family and no tags, until store_staging_restore() is called.
+ *
+ * @param[in,out]   xfer    PUT transfer.
+ * @param[out]      target  Destination of the PUT, with PHO_RSC_INVAL as
+ *                          family if it is not staged.
+ *
+ * @return 0 on success, -errno if the staging configuration is invalid.
+ */
+int store_staging_redirect(struct pho_xfer_desc *xfer,
+                           struct staging_target *target);
+
+/**
+ * Give back to a redirected PUT its family and tags. This is a no-op if the
+ * PUT was not redirected or was already restored.
+ */
+void store_staging_restore(struct pho_xfer_desc *xfer,
+                           struct staging_target *target);
+
+#endif
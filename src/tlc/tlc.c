@@ -207,13 +207,17 @@ int main(int argc, char **argv)
     if (param.is_daemon)
         daemon_notify_init_done(write_pipe_from_child_to_father, &rc);
 
-    if (rc)
+    if (rc) {
+        daemon_fini();
         return -rc;
+    }
 
     while (true) {
         if (should_tlc_stop())
             break;
 
+        daemon_reload_config();
+
         /* recv_work waits on input sockets */
         rc = recv_work(&tlc);
         if (rc) {
@@ -223,5 +227,6 @@ int main(int argc, char **argv)
     }
 
     tlc_fini(&tlc);
+    daemon_fini();
     return EXIT_SUCCESS;
 }
@@ -42,7 +42,7 @@
 #include "lrs_cfg.h"
 
 enum action {
-    READ, WRITE, RELEASE, FORMAT,
+    READ, WRITE, RELEASE, FORMAT, MIXED,
 };
 
 static const char * const action_str[] = {
@@ -50,6 +50,7 @@ static const char * const action_str[] = {
     [WRITE]   = "write",
     [RELEASE] = "release",
     [FORMAT]  = "format",
+    [MIXED]   = "mixed",
 };
 
 static void error(const char *func, const char *msg)
@@ -82,6 +83,8 @@ static void parse_args(int argc, char **argv, struct option *option)
         option->action = FORMAT;
     else if (!strcmp(argv[1], "release"))
         option->action = RELEASE;
+    else if (!strcmp(argv[1], "mixed"))
+        option->action = MIXED;
     else
         goto err_usage;
 
@@ -108,7 +111,8 @@ err_usage:
           "    put [<family>]\n"
           "    get <medium> [<family>]\n"
           "    format <medium> [<family>]\n"
-          "    release <medium> [<family>]");
+          "    release <medium> [<family>]\n"
+          "    mixed <medium> [<family>]");
 }
 
 static void send_and_receive(struct pho_comm_info *comm,
@@ -208,6 +212,46 @@ static void send_release(struct pho_comm_info *comm,
     pho_srl_response_free(resp, true);
 }
 
+/**
+ * Allocate \p medium_name for reading and another medium for writing in one
+ * mixed request, print the medium to write then release both.
+ */
+static void send_mixed(struct pho_comm_info *comm,
+                       enum rsc_family family,
+                       const char *medium_name)
+{
+    pho_resp_t *resp = NULL;
+    pho_req_t req;
+    size_t n = 0;
+    int rc;
+
+    rc = pho_srl_request_mixed_alloc(&req, 1, 1, &n);
+    if (rc)
+        error(__func__, strerror(-rc));
+    req.ralloc->med_ids[0]->name = strdup(medium_name);
+    req.ralloc->med_ids[0]->family = family;
+    req.walloc->media[0]->size = 0;
+    req.walloc->family = family;
+
+    send_and_receive(comm, &req, &resp);
+    if (!pho_response_is_mixed(resp))
+        error(__func__, "expected a mixed response");
+    printf("%s", resp->walloc->media[0]->med_id->name);
+
+    rc = pho_srl_request_release_alloc(&req, 2);
+    if (rc)
+        error(__func__, strerror(-rc));
+
+    rsc_id_cpy(req.release->media[0]->med_id, resp->ralloc->media[0]->med_id);
+    req.release->media[0]->to_sync = false;
+    rsc_id_cpy(req.release->media[1]->med_id, resp->walloc->media[0]->med_id);
+    req.release->media[1]->to_sync = true;
+    pho_srl_response_free(resp, true);
+
+    send_and_receive(comm, &req, &resp);
+    pho_srl_response_free(resp, true);
+}
+
 static void send_format(struct pho_comm_info *comm,
                         enum rsc_family family,
                         const char *medium_name)
@@ -277,6 +321,9 @@ int main(int argc, char **argv)
     case RELEASE:
         send_release(&comm, option.family, option.medium_name);
         break;
+    case MIXED:
+        send_mixed(&comm, option.family, option.medium_name);
+        break;
     }
 
     return EXIT_SUCCESS;
@@ -0,0 +1,116 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for raid1 compression: compressed objects take less space
+# on their media and are retrieved as they were put.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function skip_without_zstd
+{
+    echo "zstd" > $files/probe
+    if ! $phobos put --family dir --lyt-params compression=zstd \
+            $files/probe probe 2>&1 | grep -q "is not available"; then
+        $phobos delete probe
+        return 0
+    fi
+
+    echo "Phobos is built without zstd: test skipped"
+    exit 77
+}
+
+function test_compressed_put_get
+{
+    local size=$((100 * 1024 * 1024))
+
+    yes "phobos compression test" | head -c $size > $files/in
+
+    $valg_phobos put --family dir --lyt-params repl_count=1,compression=zstd \
+        $files/in obj_zstd
+
+    [[ $(count_rows "SELECT lyt_info->'attrs'->>'compression' FROM extent
+                     WHERE oid = 'obj_zstd';") == zstd ]] ||
+        error "The codec should be recorded in the layout"
+    [[ $(count_rows "SELECT lyt_info->'attrs'->>'raw_size' FROM extent
+                     WHERE oid = 'obj_zstd';") == $size ]] ||
+        error "The size of the data should be recorded in the layout"
+    (( $(count_rows "SELECT sum(le.size) FROM layout_extent le
+                     JOIN extent e USING (uuid, version)
+                     WHERE e.oid = 'obj_zstd';") < size / 10 )) ||
+        error "The extent of a compressible object should be smaller"
+
+    $valg_phobos get obj_zstd $files/out
+    cmp $files/in $files/out ||
+        error "obj_zstd should be retrieved as it was put"
+}
+
+function test_compression_config
+{
+    head -c 1M /dev/urandom > $files/random
+
+    # incompressible data and empty objects are compressed as well
+    PHOBOS_LAYOUT_RAID1_compression=zstd \
+        $valg_phobos put --family dir $files/random obj_random
+    touch $files/empty
+    PHOBOS_LAYOUT_RAID1_compression=zstd \
+        $valg_phobos put --family dir $files/empty obj_empty
+
+    # the layout alone tells how to read the object back
+    $valg_phobos get obj_random $files/random_out
+    cmp $files/random $files/random_out
+    $valg_phobos get obj_empty $files/empty_out
+    cmp $files/empty $files/empty_out
+
+    $phobos put --family dir --lyt-params compression=lzma $files/random \
+        obj_bad && error "An unknown codec should be rejected"
+    return 0
+}
+
+trap cleanup EXIT
+setup
+
+skip_without_zstd
+test_compressed_put_get
+test_compression_config
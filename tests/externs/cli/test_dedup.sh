@@ -0,0 +1,155 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for deduplicated objects: puts of the same data share a
+# single file, which keeps the data of the deleted objects and describes every
+# object referring to it for a medium import.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=10
+
+function setup
+{
+    export PHOBOS_STORE_dedup=yes
+
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function skip_without_xxh128
+{
+    head -c 1024 /dev/urandom > $files/probe
+    $phobos put --family dir --lyt-params repl_count=1 $files/probe probe
+
+    if [[ -n $(count_rows "SELECT xxh128 FROM layout_extent;") ]]; then
+        $phobos delete probe
+        return 0
+    fi
+
+    echo "Phobos is built without xxh128: test skipped"
+    exit 77
+}
+
+function test_dedup_put_get
+{
+    local i
+
+    head -c 50M /dev/urandom > $files/in
+
+    for i in $(seq $NB_OBJECTS); do
+        $valg_phobos put --family dir --lyt-params repl_count=1 \
+            --metadata rank=$i $files/in obj_$i
+    done
+
+    # the file of the probe is only removed by the garbage collector
+    [[ $(find $dir -type f -size +1k | wc -l) == 1 ]] ||
+        error "Identical objects should be written once"
+    [[ $(count_rows "SELECT count(DISTINCT address) FROM layout_extent
+                     WHERE size > 1024;") == 1 ]] ||
+        error "Identical objects should share their extent"
+    [[ $(count_rows "SELECT live_count, live_size FROM medium_stats;") == \
+       "1 | $((50 * 1024 * 1024))" ]] ||
+        error "A shared extent should be accounted for once"
+
+    for i in $(seq $NB_OBJECTS); do
+        $valg_phobos get obj_$i $files/out_$i
+        cmp $files/in $files/out_$i ||
+            error "obj_$i should be retrieved as it was put"
+    done
+
+    # other data is not deduplicated
+    head -c 1M /dev/urandom > $files/other
+    $phobos put --family dir --lyt-params repl_count=1 $files/other obj_other
+    [[ $(find $dir -type f -size +1k | wc -l) == 2 ]] ||
+        error "Different objects should be written separately"
+}
+
+function test_dedup_delete
+{
+    local i
+
+    # obj_1 wrote the shared file, deleting it does not remove the data
+    for i in $(seq $((NB_OBJECTS - 1))); do
+        $valg_phobos delete obj_$i
+    done
+
+    $valg_phobos gc
+
+    [[ $(find $dir -type f -size +2M | wc -l) == 1 ]] ||
+        error "The shared file should be kept while an object refers to it"
+
+    $valg_phobos get obj_$NB_OBJECTS $files/out_last
+    cmp $files/in $files/out_last ||
+        error "The last object should still be retrieved after the deletions"
+}
+
+function test_dedup_import
+{
+    local i
+
+    # every object sharing the file is described by it
+    waive_lrs
+    drop_tables
+    setup_tables
+    invoke_lrs
+
+    $phobos dir add --unlock $dir
+    $valg_phobos dir import $dir
+
+    [[ $(count_rows "SELECT count(*) FROM layout_extent
+                     WHERE size = $((50 * 1024 * 1024));") == $NB_OBJECTS ]] ||
+        error "Every object sharing the file should be imported"
+
+    for i in $(seq $NB_OBJECTS); do
+        $phobos get obj_$i $files/out_$i
+        cmp $files/in $files/out_$i ||
+            error "obj_$i should be retrieved from the imported file"
+        $phobos getmd obj_$i | grep rank=$i ||
+            error "The user metadata of obj_$i should be imported"
+    done
+}
+
+trap cleanup EXIT
+setup
+
+skip_without_xxh128
+test_dedup_put_get
+test_dedup_delete
+test_dedup_import
@@ -0,0 +1,138 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for the garbage collector: the file of a killed put and the
+# extent of a purged object are removed from a directory, live and deprecated
+# objects are left untouched.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=5
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function kill_put_during_transfer
+{
+    local pid
+
+    # one byte per write so that the transfer lasts long enough to be killed
+    dd if=/dev/urandom of=$files/in_crash bs=1M count=20
+    PHOBOS_IO_io_block_size=1 $phobos put --family dir $files/in_crash \
+        obj_crash &
+    pid=$!
+
+    while [[ -z "$(find $dir -type f -name '*obj_crash*' -size +0)" ]]; do
+        kill -0 $pid || error "Put of obj_crash ended before being killed"
+        sleep 0.1
+    done
+
+    kill -9 $pid
+    wait $pid && error "Put of obj_crash should have been killed" || true
+
+    # the daemon of the crashed client is restarted as well
+    waive_lrs
+    invoke_lrs
+}
+
+function test_gc
+{
+    local i
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+
+    for i in $(seq $NB_OBJECTS); do
+        dd if=/dev/urandom of=$files/in_$i bs=1k count=$((i * 10))
+        $phobos put --family dir $files/in_$i obj_$i
+    done
+
+    # a deprecated version must be kept
+    $phobos put --family dir /etc/hosts obj_over
+    $phobos put --family dir --overwrite $files/in_1 obj_over
+
+    # nothing to collect yet
+    $valg_phobos gc --grace-time 0 --scan
+    [[ $(find $dir -type f | wc -l) == $((NB_OBJECTS + 2)) ]] ||
+        error "No file should have been removed from $dir"
+
+    # a purged deprecated object leaves an extent referenced by no object
+    $phobos put --family dir /etc/hosts obj_purged
+    $phobos delete obj_purged
+    $PSQL -c "DELETE FROM deprecated_object WHERE oid = 'obj_purged';"
+
+    kill_put_during_transfer
+    [[ $(count_rows "SELECT count(*) FROM object
+                     WHERE oid = 'obj_crash';") == 1 ]] ||
+        error "The killed put should have left its object"
+
+    # the files of running puts are protected by the grace time
+    $valg_phobos gc --scan
+    [[ -n "$(find $dir -type f -name '*obj_crash*')" ]] ||
+        error "Recent files should be left by the garbage collector"
+
+    $valg_phobos gc --grace-time 0 --scan
+
+    [[ -z "$(find $dir -type f -name '*obj_crash*')" ]] ||
+        error "The file of the killed put should have been removed"
+    [[ -z "$(find $dir -type f -name '*obj_purged*')" ]] ||
+        error "The extent of the purged object should have been removed"
+    [[ $(count_rows "SELECT count(*) FROM object
+                     WHERE oid = 'obj_crash';") == 0 ]] ||
+        error "The object of the killed put should have been deleted"
+    [[ $(count_rows "SELECT count(*) FROM extent
+                     WHERE oid = 'obj_purged';") == 0 ]] ||
+        error "The layout of the purged object should have been deleted"
+    [[ $(count_rows "SELECT count(*) FROM layout_extent;") == \
+       $((NB_OBJECTS + 2)) ]] ||
+        error "The extents of live and deprecated objects should be kept"
+
+    for i in $(seq $NB_OBJECTS); do
+        $phobos get obj_$i $files/out_$i
+        cmp $files/in_$i $files/out_$i ||
+            error "obj_$i should be left untouched"
+    done
+    $phobos get obj_over $files/out_over
+    cmp $files/in_1 $files/out_over || error "obj_over should be left untouched"
+}
+
+trap cleanup EXIT
+setup
+
+test_gc
@@ -0,0 +1,119 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for medium import: objects are put on directories, the DSS
+# tables are dropped, and the objects are rebuilt from the extended attributes
+# of their extents.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=10
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dirs="$(mktemp -d /tmp/test.pho.XXXX) $(mktemp -d /tmp/test.pho.XXXX)"
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dirs $files
+}
+
+function test_import
+{
+    local i
+
+    $phobos dir add $dirs
+    $phobos dir format --fs posix --unlock $dirs
+
+    for i in $(seq $NB_OBJECTS); do
+        dd if=/dev/urandom of=$files/in_$i bs=1k count=$((i * 10))
+        $phobos put --family dir --lyt-params repl_count=2 \
+            --metadata rank=$i $files/in_$i obj_$i
+    done
+
+    # the previous version must come back as a deprecated object
+    $phobos put --family dir /etc/hosts obj_over
+    $phobos put --family dir --overwrite $files/in_1 obj_over
+
+    # a new generation restarts at version 1, below the deleted one
+    $phobos put --family dir /etc/hosts obj_gen
+    $phobos put --family dir --overwrite $files/in_2 obj_gen
+    $phobos delete obj_gen
+    $phobos put --family dir $files/in_3 obj_gen
+
+    # lose the whole DSS, media have to be added again
+    waive_lrs
+    drop_tables
+    setup_tables
+    invoke_lrs
+
+    $phobos dir add --unlock $dirs
+    $valg_phobos dir import --parallel 2 $dirs
+
+    [[ $(count_rows "SELECT count(*) FROM object;") == \
+       $((NB_OBJECTS + 2)) ]] || error "Every object should be imported"
+    [[ $(count_rows "SELECT count(*) FROM deprecated_object
+                     WHERE oid = 'obj_over';") == 1 ]] ||
+        error "The previous version of obj_over should be deprecated"
+    [[ $(count_rows "SELECT count(*) FROM deprecated_object
+                     WHERE oid = 'obj_gen';") == 2 ]] ||
+        error "The deleted generation of obj_gen should be deprecated"
+    [[ $(count_rows "SELECT version FROM object WHERE oid = 'obj_gen';") \
+       == 1 ]] || error "The new generation of obj_gen should be live"
+    [[ $(count_rows "SELECT count(*) FROM layout_extent;") == \
+       $((NB_OBJECTS * 2 + 5)) ]] || error "Every extent should be imported"
+
+    for i in $(seq $NB_OBJECTS); do
+        $phobos get obj_$i $files/out_$i
+        cmp $files/in_$i $files/out_$i ||
+            error "obj_$i should be retrieved as it was put"
+        $phobos getmd obj_$i | grep rank=$i ||
+            error "The user metadata of obj_$i should be imported"
+    done
+    $phobos get obj_over $files/out_over
+    cmp $files/in_1 $files/out_over ||
+        error "The latest version of obj_over should be retrieved"
+    $phobos get obj_gen $files/out_gen
+    cmp $files/in_3 $files/out_gen ||
+        error "The object put after the deletion of obj_gen should be retrieved"
+
+    # importing twice leaves the DSS as it is
+    $valg_phobos dir import $dirs
+    [[ $(count_rows "SELECT count(*) FROM object;") == \
+       $((NB_OBJECTS + 2)) ]] || error "A new import should not add objects"
+}
+
+trap cleanup EXIT
+setup
+
+test_import
@@ -0,0 +1,123 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for inline objects: small objects are stored in the DSS,
+# without any file on their medium, and retrieved from there.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=1000
+
+function setup
+{
+    export PHOBOS_STORE_inline_max_size=4096
+
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function test_inline_put_get
+{
+    local i
+
+    # sizes from 0 to 4095 bytes, including arbitrary bytes
+    for i in $(seq $NB_OBJECTS); do
+        head -c $(( (i - 1) * 4 )) /dev/urandom > $files/in_$i
+        echo "$files/in_$i obj_$i -"
+    done > $files/mput_list
+
+    $valg_phobos mput --family dir $files/mput_list
+
+    [[ $(count_rows "SELECT count(*) FROM inline_extent;") == $NB_OBJECTS ]] ||
+        error "Every small object should be stored in the DSS"
+    [[ $(count_rows "SELECT count(*) FROM layout_extent;") == 0 ]] ||
+        error "Inline objects should not have any extent"
+    [[ $(find $dir -type f | wc -l) == 0 ]] ||
+        error "No file should be created on the medium for inline objects"
+
+    $phobos extent list --output oid,layout obj_1 | grep inline ||
+        error "Inline objects should have an inline layout"
+
+    for i in 1 2 $((NB_OBJECTS / 2)) $NB_OBJECTS; do
+        $valg_phobos get obj_$i $files/out_$i
+        cmp $files/in_$i $files/out_$i ||
+            error "obj_$i should be retrieved from the DSS as it was put"
+    done
+
+    $phobos locate obj_1 || error "Inline objects should be located anywhere"
+}
+
+function test_large_put
+{
+    head -c 4097 /dev/urandom > $files/large
+
+    $valg_phobos put --family dir $files/large obj_large
+
+    [[ $(count_rows "SELECT count(*) FROM layout_extent;") == 1 ]] ||
+        error "Objects above inline_max_size should be written on media"
+    [[ $(find $dir -type f | wc -l) == 1 ]] ||
+        error "Objects above inline_max_size should create a file"
+
+    $phobos get obj_large $files/large_out
+    cmp $files/large $files/large_out
+}
+
+function test_inline_overwrite_delete
+{
+    echo "first" > $files/small
+    $phobos put --family dir $files/small obj_ow
+    echo "second version" > $files/small
+    $valg_phobos put --overwrite --family dir $files/small obj_ow
+
+    $phobos get obj_ow $files/small_out
+    cmp $files/small $files/small_out ||
+        error "The last version of an overwritten inline object is retrieved"
+
+    $valg_phobos delete obj_ow
+    $phobos get obj_ow $files/small_out2 &&
+        error "A deleted inline object should not be retrieved"
+    return 0
+}
+
+trap cleanup EXIT
+setup
+
+test_inline_put_get
+test_large_put
+test_inline_overwrite_delete
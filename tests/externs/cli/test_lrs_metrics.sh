@@ -0,0 +1,130 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for the metrics of the daemon: they are scraped from their
+# UNIX socket before and after puts on a directory.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_PUTS=5
+PUT_SIZE=1000
+
+function setup
+{
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+
+    export PHOBOS_LRS_metrics_address="$files/metrics.sock"
+    # one sync per put
+    export PHOBOS_LRS_sync_nb_req="dir=1,tape=1"
+
+    setup_tables
+    invoke_lrs
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function scrape
+{
+    python3 - "$PHOBOS_LRS_metrics_address" <<'EOF'
+import socket
+import sys
+
+sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+sock.connect(sys.argv[1])
+sock.sendall(b"GET /metrics HTTP/1.0\r\n\r\n")
+response = b""
+while True:
+    data = sock.recv(65536)
+    if not data:
+        break
+    response += data
+headers, body = response.decode().split("\r\n\r\n", 1)
+if not headers.startswith("HTTP/1.0 200"):
+    sys.exit(headers)
+print(body, end="")
+EOF
+}
+
+# Sum of the series of metric $1 in the scrape $2
+function metric_sum
+{
+    echo "$2" | awk -v name="$1" \
+        '$1 == name || index($1, name "{") == 1 { sum += $2 }
+         END { printf "%d\n", sum }'
+}
+
+function test_metrics_puts
+{
+    local before
+    local after
+    local i
+
+    before=$(scrape)
+    grep "# TYPE phobosd_request_duration_seconds histogram" <<< "$before" ||
+        error "The metrics should be served in the Prometheus format"
+
+    for i in $(seq $NB_PUTS); do
+        head -c $PUT_SIZE /dev/urandom > $files/in_$i
+        $phobos put --family dir --lyt-params repl_count=1 $files/in_$i obj_$i
+    done
+
+    after=$(scrape)
+
+    for metric in \
+            'phobosd_request_duration_seconds_count{type="write"}' \
+            'phobosd_request_duration_seconds_count{type="release"}' \
+            phobosd_device_syncs_total; do
+        (( $(metric_sum "$metric" "$after") -
+           $(metric_sum "$metric" "$before") == NB_PUTS )) ||
+            error "$metric should be increased by one per put"
+    done
+
+    (( $(metric_sum phobosd_medium_written_bytes_total "$after") -
+       $(metric_sum phobosd_medium_written_bytes_total "$before") ==
+       NB_PUTS * PUT_SIZE )) ||
+        error "The written bytes should be increased by the size of the puts"
+
+    (( $(metric_sum phobosd_dss_query_duration_seconds_count "$after") >
+       $(metric_sum phobosd_dss_query_duration_seconds_count "$before") )) ||
+        error "The DSS requests of the daemon should be measured"
+
+    (( $(metric_sum phobosd_io_sched_queue_depth "$after") == 0 )) ||
+        error "No request should be left in the I/O schedulers"
+}
+
+trap cleanup EXIT
+setup
+
+test_metrics_puts
@@ -0,0 +1,92 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+
+#
+# Integration test for the reload of the configuration of the daemon: its
+# configuration file is modified, then read again on SIGHUP.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+function set_fair_share_max
+{
+    sed -i '/^\[io_sched_tape\]/,$d' $PHOBOS_CFG_FILE
+    printf "[io_sched_tape]\nfair_share_LTO5_max = %s\n" "$1" \
+        >> $PHOBOS_CFG_FILE
+}
+
+function setup
+{
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    # the daemon reads a copy of the test configuration, modified below
+    cp $PHOBOS_CFG_FILE $files/phobos.conf
+    export PHOBOS_CFG_FILE=$files/phobos.conf
+    set_fair_share_max 1,1,1
+
+    setup_tables
+    invoke_lrs
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $files
+}
+
+function reload_lrs
+{
+    kill -HUP $PID_LRS
+    # the daemon checks for a reload between two polls of its socket
+    sleep 1
+    ps $PID_LRS || error "The daemon should keep running after a reload"
+}
+
+function test_reload
+{
+    $phobos sched fair_share --type LTO5 |
+        grep "fair_share_LTO5_max: 1,1,1" ||
+        error "The daemon should read the initial configuration"
+
+    set_fair_share_max 2,2,2
+    reload_lrs
+    $phobos sched fair_share --type LTO5 |
+        grep "fair_share_LTO5_max: 2,2,2" ||
+        error "The daemon should read the new configuration"
+
+    # an invalid file keeps the previous configuration
+    echo "[broken" >> $PHOBOS_CFG_FILE
+    reload_lrs
+    set_fair_share_max 3,3,3
+    $phobos sched fair_share --type LTO5 |
+        grep "fair_share_LTO5_max: 2,2,2" ||
+        error "The daemon should keep its configuration if it is invalid"
+}
+
+trap cleanup EXIT
+setup
+
+test_reload
@@ -0,0 +1,108 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for the request trace of the daemon: every phase of the
+# format and write requests on a directory must be traced, in order.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+function setup
+{
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+
+    setup_tables
+    invoke_lrs
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+# Check that the requests of kind $1 in the trace $2 went through every phase,
+# in order and with non-decreasing timestamps
+function check_trace
+{
+    python3 - "$1" "$2" <<'EOF'
+import json
+import sys
+
+PHASES = ["received", "queued", "device_chosen", "medium_ready", "responded"]
+
+events = {}
+for line in sys.argv[2].splitlines():
+    event = json.loads(line)
+    events.setdefault(event["id"], []).append(event)
+
+requests = [evts for evts in events.values()
+            if evts[0]["phase"] == "received" and evts[0]["kind"] == sys.argv[1]]
+if not requests:
+    sys.exit("no %s request traced" % sys.argv[1])
+
+for evts in requests:
+    phases = [evt["phase"] for evt in evts]
+    if phases != PHASES:
+        sys.exit("unexpected phases %s" % phases)
+
+    times = [evt["time"] for evt in evts]
+    if times != sorted(times):
+        sys.exit("timestamps are not monotonic: %s" % times)
+
+    for evt in evts:
+        if evt["phase"] in ("device_chosen", "medium_ready") and \
+           not evt.get("resource"):
+            sys.exit("%s event without resource" % evt["phase"])
+EOF
+}
+
+function test_trace_put
+{
+    local trace
+
+    echo "data" > $files/in
+    $phobos put --family dir --lyt-params repl_count=1 $files/in obj
+
+    trace=$($phobos lrs trace)
+
+    check_trace "format" "$trace" ||
+        error "The format request should be fully traced"
+    check_trace "write alloc" "$trace" ||
+        error "The write request should be fully traced"
+
+    grep '"phase": "responded"' <<< "$trace" | grep '"kind": "release"' ||
+        error "The release request should be traced"
+}
+
+trap cleanup EXIT
+setup
+
+test_trace_put
@@ -189,3 +189,16 @@ waive_lrs
 invoke_lrs
 # try to get
 $phobos get obj_to_get /tmp/gotten_obj && rm /tmp/gotten_obj
+
+echo "**** TESTS: MEDIA STATS ****"
+# obj_to_get is stored on a single medium, deleting it deprecates its extent
+medium=$($phobos extent list --output media_name obj_to_get |
+         tr -d "[]'")
+size=$(stat -c %s /etc/hosts)
+[[ $($valg_phobos dir stats --output nb_extents_deprecated $medium) == 0 ]] ||
+    error "No extent should be deprecated on $medium"
+$phobos delete obj_to_get
+[[ $($valg_phobos dir stats --output nb_extents_deprecated $medium) == 1 ]] ||
+    error "The extent of obj_to_get should be deprecated on $medium"
+[[ $($phobos dir stats --output deprecated_size $medium) == $size ]] ||
+    error "The deprecated size of $medium should be $size"
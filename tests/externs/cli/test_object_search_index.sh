@@ -0,0 +1,134 @@
+#!/bin/bash
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+#
+# Check that object searches by metadata and oid pattern are served by the
+# user_md and oid indexes instead of scanning the object tables.
+#
+# The number of generated objects can be set with PHOBOS_SEARCH_NB_OBJECTS to
+# run it as a benchmark (e.g. 100000000 for 100M rows per table), the time
+# taken by each "phobos object list" is then printed.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+
+set -xe
+
+NB_OBJECTS=${PHOBOS_SEARCH_NB_OBJECTS:-100000}
+
+function setup
+{
+    # start with a clean and empty DB
+    setup_tables
+
+    $PSQL << EOF
+insert into object (oid, user_md)
+    select 'object_' || i, ('{"rank": "' || i || '", "parity": "' ||
+                            i % 2 || '"}')::jsonb
+    from generate_series(1, $NB_OBJECTS) as i;
+insert into deprecated_object (oid, uuid, version, user_md)
+    select 'deprec_' || i, uuid_generate_v4(), 1,
+           ('{"rank": "' || i || '"}')::jsonb
+    from generate_series(1, $NB_OBJECTS) as i;
+analyze object;
+analyze deprecated_object;
+EOF
+}
+
+function cleanup
+{
+    drop_tables
+}
+
+# Check that the plan of a query on the object tables uses a given index
+function check_plan
+{
+    local query="$1"
+    local index="$2"
+    local plan
+
+    plan=$($PSQL -t -c "EXPLAIN $query")
+    if ! echo "$plan" | grep -q "$index"; then
+        echo "Query '$query' does not use index '$index':"
+        echo "$plan"
+        exit 1
+    fi
+}
+
+function timed_list
+{
+    local start=$(date +%s%N)
+    local res
+
+    res=$($valg_phobos object list "$@")
+    echo "'phobos object list $*' took" \
+         "$(( ($(date +%s%N) - start) / 1000000 ))ms" >&2
+    echo "$res"
+}
+
+function test_search_plans
+{
+    local target=$(( NB_OBJECTS / 2 + 7 ))
+
+    # these queries are the ones generated by the DSS filters
+    check_plan "SELECT oid FROM object WHERE user_md @> \
+                '{\"rank\":\"$target\"}'::jsonb" \
+               "object_user_md_idx"
+    check_plan "SELECT oid FROM object WHERE oid ~ '_$target\$'" \
+               "object_oid_trgm_idx"
+    check_plan "SELECT oid FROM deprecated_object WHERE user_md @> \
+                '{\"rank\":\"$target\"}'::jsonb" \
+               "deprecated_object_user_md_idx"
+    check_plan "SELECT oid FROM deprecated_object WHERE oid ~ '_$target\$'" \
+               "deprecated_object_oid_trgm_idx"
+    check_plan "SELECT oid FROM deprecated_object WHERE oid = 'deprec_1'" \
+               "deprecated_object_oid_idx"
+}
+
+function test_search_results
+{
+    local target=$(( NB_OBJECTS / 2 + 7 ))
+    local res
+
+    res=$(timed_list --metadata rank=$target)
+    [ "$res" == "object_$target" ] || error "Unexpected result: '$res'"
+
+    res=$(timed_list --metadata rank=$target,parity=$(( target % 2 )))
+    [ "$res" == "object_$target" ] || error "Unexpected result: '$res'"
+
+    res=$(timed_list --metadata rank=$target,parity=$(( (target + 1) % 2 )))
+    [ -z "$res" ] || error "Unexpected result: '$res'"
+
+    res=$(timed_list --pattern "_$target\$")
+    [ "$res" == "object_$target" ] || error "Unexpected result: '$res'"
+
+    res=$(timed_list --deprecated --metadata rank=$target)
+    [ "$res" == "deprec_$target" ] || error "Unexpected result: '$res'"
+
+    res=$(timed_list --deprecated --pattern "_$target\$")
+    [ "$res" == "deprec_$target" ] || error "Unexpected result: '$res'"
+}
+
+trap cleanup EXIT
+setup
+
+test_search_plans
+test_search_results
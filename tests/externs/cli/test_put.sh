@@ -194,6 +194,70 @@ function test_md5_checksum
 
 test_md5_checksum
 
+function crc32c_sum
+{
+    python3 -c '
+import sys
+crc = 0xffffffff
+for byte in open(sys.argv[1], "rb").read():
+    crc ^= byte
+    for _ in range(8):
+        crc = (crc >> 1) ^ (0x82f63b78 if crc & 1 else 0)
+print("%08x" % (crc ^ 0xffffffff))' $1
+}
+
+function test_crc32c_checksum
+{
+    # enable extent crc32c
+    PHOBOS_LAYOUT_RAID1_extent_crc32c="yes" \
+        $valg_phobos put --family dir --lyt-params repl_count=1 /etc/hosts \
+            object_with_crc32c ||
+            error "failed to put 'object_with_crc32c' object"
+
+    local crc32c_value=$(crc32c_sum /etc/hosts)
+    local extent_crc32c_value=$($valg_phobos extent list -o crc32c \
+                                object_with_crc32c)
+
+    if [[ "['${crc32c_value}']" != "${extent_crc32c_value}" ]]; then
+        error "'phobos extent list -o crc32c object_with_crc32c' returned" \
+              "'${extent_crc32c_value}' instead of '${crc32c_value}'"
+    fi
+
+    $valg_phobos get object_with_crc32c /tmp/crc32c_out ||
+        error "'object_with_crc32c' should be retrieved"
+    cmp /etc/hosts /tmp/crc32c_out
+    rm /tmp/crc32c_out
+
+    # flip the bits of the first byte of the extent
+    local medium=$($phobos extent list -o media_name object_with_crc32c |
+                   tr -d "[]' ")
+    local address=$($phobos extent list -o address object_with_crc32c |
+                    tr -d "[]' ")
+    python3 -c '
+import sys
+with open(sys.argv[1], "r+b") as extent:
+    byte = extent.read(1)[0]
+    extent.seek(0)
+    extent.write(bytes([byte ^ 0xff]))' $medium/$address
+
+    $valg_phobos get object_with_crc32c /tmp/crc32c_out &&
+        error "A corrupted extent should not be retrieved"
+    rm -f /tmp/crc32c_out
+
+    # disable extent crc32c
+    PHOBOS_LAYOUT_RAID1_extent_crc32c="no" \
+        $valg_phobos put --family dir /etc/hosts object_no_crc32c ||
+            error "failed to put 'object_no_crc32c' object"
+
+    extent_crc32c_value=$($valg_phobos extent list -o crc32c object_no_crc32c)
+    if [[ "[None]" != "${extent_crc32c_value}" ]]; then
+        error "'phobos extent list -o crc32c object_no_crc32c' returned" \
+              "'${extent_crc32c_value}' instead of '[None]'"
+    fi
+}
+
+test_crc32c_checksum
+
 ################################################################################
 #                         TEST EMPTY PUT ON TAGGED DIR                         #
 ################################################################################
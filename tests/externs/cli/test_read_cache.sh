@@ -0,0 +1,108 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for the read cache: objects retrieved from the cached
+# families are kept in the cache directory and served again without any
+# medium.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+    export PHOBOS_STORE_cache_dir=$(mktemp -d /tmp/test.pho.XXXX)
+    export PHOBOS_STORE_cache_families=dir
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files $PHOBOS_STORE_cache_dir
+}
+
+function test_cache_hit
+{
+    dd if=/dev/urandom of=$files/in bs=1k count=100
+    $phobos put --family dir $files/in obj
+
+    $valg_phobos get obj $files/out_1
+    cmp $files/in $files/out_1 || error "obj should be retrieved as it was put"
+    [[ $(ls $PHOBOS_STORE_cache_dir | wc -l) == 1 ]] ||
+        error "obj should be added to the read cache"
+
+    # no medium can be read anymore, only the cache can serve obj
+    $phobos dir lock $dir
+    $valg_phobos get obj $files/out_2 ||
+        error "obj should be retrieved from the read cache"
+    cmp $files/in $files/out_2 ||
+        error "obj should be retrieved from the cache as it was put"
+    $phobos dir unlock $dir
+
+    # a new version of the object is not served from the cache
+    $phobos put --family dir --overwrite /etc/hosts obj
+    $phobos get obj $files/out_3
+    cmp /etc/hosts $files/out_3 ||
+        error "The new version of obj should be retrieved"
+
+    rm -f $PHOBOS_STORE_cache_dir/*
+}
+
+function test_cache_eviction
+{
+    dd if=/dev/urandom of=$files/in_a bs=1k count=10
+    dd if=/dev/urandom of=$files/in_b bs=1k count=10
+    $phobos put --family dir $files/in_a obj_a
+    $phobos put --family dir $files/in_b obj_b
+
+    # only one of the objects fits in the cache
+    export PHOBOS_STORE_cache_size=15360
+    $phobos get obj_a $files/out_a
+    $phobos get obj_b $files/out_b
+    [[ $(ls $PHOBOS_STORE_cache_dir | wc -l) == 1 ]] ||
+        error "obj_a should be evicted from the read cache"
+
+    $phobos dir lock $dir
+    $phobos get obj_b $files/out_b_2 ||
+        error "obj_b should be retrieved from the read cache"
+    $phobos get obj_a $files/out_a_2 &&
+        error "obj_a should not be retrieved from a locked medium"
+    $phobos dir unlock $dir
+    unset PHOBOS_STORE_cache_size
+}
+
+trap cleanup EXIT
+setup
+
+test_cache_hit
+test_cache_eviction
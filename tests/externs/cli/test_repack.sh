@@ -0,0 +1,116 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for medium repack: the live objects of a directory are moved
+# to another one and can still be read afterwards.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=10
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dirs="$(mktemp -d /tmp/test.pho.XXXX) $(mktemp -d /tmp/test.pho.XXXX)"
+    set -- $dirs
+    src=$1
+    dst=$2
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dirs $files
+}
+
+function test_repack
+{
+    local i
+
+    # only the source directory is available when objects are put
+    $phobos dir add $src
+    $phobos dir format --fs posix --unlock $src
+
+    for i in $(seq $NB_OBJECTS); do
+        dd if=/dev/urandom of=$files/in_$i bs=1k count=$((i * 10))
+        $phobos put --family dir -m rank=$i $files/in_$i obj_$i
+    done
+
+    # half of the objects are deprecated and must stay on the source
+    for i in $(seq 2 2 $NB_OBJECTS); do
+        $phobos delete obj_$i
+    done
+
+    $phobos dir add $dst
+    $phobos dir format --fs posix --unlock $dst
+
+    $valg_phobos dir repack $src
+
+    [[ $($phobos dir stats --output nb_extents $src) == 0 ]] ||
+        error "No live extent should remain on $src"
+    [[ $($phobos dir stats --output nb_extents $dst) == $((NB_OBJECTS / 2)) ]] ||
+        error "Live extents should have been moved to $dst"
+    [[ $($phobos dir stats --output nb_extents_deprecated $src) == \
+       $((NB_OBJECTS / 2)) ]] ||
+        error "Deprecated extents should have been left on $src"
+
+    $phobos dir list --output put_access $src | grep False ||
+        error "$src should not accept new objects anymore"
+
+    for i in $(seq 1 2 $NB_OBJECTS); do
+        [[ $($phobos extent list --output media_name obj_$i | tr -d "[]'") == \
+           $dst ]] || error "obj_$i should be located on $dst"
+        $phobos get obj_$i $files/out_$i
+        cmp $files/in_$i $files/out_$i ||
+            error "obj_$i content changed during repack"
+        $phobos getmd obj_$i | grep rank=$i ||
+            error "obj_$i metadata changed during repack"
+    done
+
+    # repacking an empty medium is a no-op
+    $valg_phobos dir repack $src
+}
+
+function test_repack_no_destination
+{
+    # the repacked source is the only other directory and is closed to puts
+    $phobos put --family dir /etc/hosts obj_nodst
+    $valg_phobos dir repack $dst &&
+        error "Repack should fail without any destination medium"
+
+    $phobos get obj_nodst $files/out_nodst
+    cmp /etc/hosts $files/out_nodst
+}
+
+trap cleanup EXIT
+setup
+
+test_repack
+test_repack_no_destination
@@ -0,0 +1,110 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for medium scrub: a corrupted extent of a directory is
+# detected and reported, the other ones are verified.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+
+set -xe
+
+NB_OBJECTS=10
+
+# make sure every extent has a checksum, whatever the build
+export PHOBOS_LAYOUT_RAID1_extent_md5=yes
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dir=$(mktemp -d /tmp/test.pho.XXXX)
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dir $files
+}
+
+function test_scrub
+{
+    local extent
+    local byte
+    local output
+    local i
+
+    $phobos dir add $dir
+    $phobos dir format --fs posix --unlock $dir
+
+    for i in $(seq $NB_OBJECTS); do
+        dd if=/dev/urandom of=$files/in_$i bs=1k count=$((i * 10))
+        $phobos put --family dir $files/in_$i obj_$i
+    done
+
+    # a clean medium is scrubbed successfully
+    $valg_phobos dir scrub --bandwidth 0 --iops 0 $dir
+
+    # invert the first byte of one extent
+    extent=$(find $dir -type f -name "*obj_3*")
+    [[ -n "$extent" ]] || error "Extent of obj_3 not found in $dir"
+    byte=$(head -c 1 $extent | od -An -tu1 | xargs)
+    printf "\\$(printf '%03o' $((255 - byte)))" |
+        dd of=$extent bs=1 count=1 conv=notrunc
+
+    output=$($valg_phobos dir scrub $dir 2>&1) &&
+        error "Scrub should fail on a corrupted extent"
+
+    [[ $(echo "$output" | grep -c "is corrupted") == 1 ]] ||
+        error "Exactly one extent should be reported as corrupted"
+    echo "$output" | grep "is corrupted" | grep "obj_3" ||
+        error "The corrupted extent of obj_3 should be reported"
+
+    [[ $($PSQL -t -c "select count(*) from layout_extent
+                      where scrub_rc is not null and scrub_rc != 0;" |
+         xargs) == 1 ]] ||
+        error "One extent should be recorded as corrupted"
+    [[ $($PSQL -t -c "select count(*) from layout_extent
+                      where scrub_time is null;" | xargs) == 0 ]] ||
+        error "Every extent should have been scrubbed"
+
+    # a missing extent is counted apart from the corrupted ones
+    rm $(find $dir -type f -name "*obj_5*")
+    output=$($valg_phobos dir scrub $dir 2>&1) &&
+        error "Scrub should fail on a missing extent"
+
+    echo "$output" | grep "Cannot verify extent" | grep "obj_5" ||
+        error "The missing extent of obj_5 should be reported"
+    echo "$output" | grep "1 extents of medium '$dir' could not be read" ||
+        error "The missing extent should be counted as unreadable"
+    echo "$output" | grep "1 extents of medium '$dir' are corrupted" ||
+        error "The corrupted extent should be counted apart"
+}
+
+trap cleanup EXIT
+setup
+
+test_scrub
@@ -0,0 +1,125 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for write-back staging: puts to tape land on directories,
+# then "phobos flush" copies them to tape and removes the staged copies.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+. $test_dir/../../tape_drive.sh
+
+set -xe
+
+NB_OBJECTS=20
+
+function setup
+{
+    export PHOBOS_STORE_staging_family=dir
+    export PHOBOS_STORE_staged_families=tape
+
+    setup_tables
+    invoke_lrs
+
+    dirs="$(mktemp -d /tmp/test.pho.XXXX) $(mktemp -d /tmp/test.pho.XXXX)"
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    $phobos dir add $dirs
+    $phobos dir format --fs posix --unlock $dirs
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dirs $files
+
+    if [[ -w /dev/changer ]]; then
+        drain_all_drives
+    fi
+}
+
+function test_staged_put
+{
+    local i
+
+    for i in $(seq $NB_OBJECTS); do
+        dd if=/dev/urandom of=$files/in_$i bs=1k count=$i
+        $valg_phobos put --family tape $files/in_$i obj_$i
+    done
+
+    [[ $(count_rows "SELECT count(*) FROM staging WHERE family = 'tape';") \
+       == $NB_OBJECTS ]] || error "Every put to tape should be staged"
+    [[ $(count_rows "SELECT count(*) FROM layout_extent
+                     WHERE medium_family = 'dir';") == $NB_OBJECTS ]] ||
+        error "Staged objects should be written on directories"
+
+    $phobos get obj_1 $files/out_1
+    cmp $files/in_1 $files/out_1 ||
+        error "A staged object should be retrieved from its staging medium"
+
+    # puts to other families are not staged
+    $phobos put --family dir /etc/hosts obj_dir
+    [[ $(count_rows "SELECT count(*) FROM staging;") == $NB_OBJECTS ]] ||
+        error "A put to dir should not be staged"
+}
+
+function test_flush
+{
+    local i
+
+    drain_all_drives
+    $phobos drive add --unlock /dev/st0
+    $phobos tape add -t lto5 P00000L5
+    $phobos tape format --unlock P00000L5
+
+    $valg_phobos flush
+
+    [[ $(count_rows "SELECT count(*) FROM staging;") == 0 ]] ||
+        error "Flushed objects should not be staged anymore"
+    [[ $(count_rows "SELECT count(*) FROM layout_extent
+                     WHERE medium_family = 'tape';") == $NB_OBJECTS ]] ||
+        error "Flushed objects should be on tape"
+    # obj_dir was put on a directory and stays there
+    [[ $(find $dirs -type f -name 'obj_[0-9]*' | wc -l) == 0 ]] ||
+        error "The staged copies should be removed"
+
+    for i in $(seq $NB_OBJECTS); do
+        $phobos get obj_$i $files/out_$i
+        cmp $files/in_$i $files/out_$i ||
+            error "obj_$i should be retrieved from tape as it was put"
+    done
+
+    # nothing is left to flush
+    $valg_phobos flush
+}
+
+trap cleanup EXIT
+setup
+
+test_staged_put
+
+# Tape tests are available only if /dev/changer exists, which is the entry
+# point for the tape library.
+if [[ -w /dev/changer ]]; then
+    test_flush
+fi
@@ -0,0 +1,201 @@
+#!/bin/bash
+
+#
+#  All rights reserved (c) 2014-2022 CEA/DAM.
+#
+#  This file is part of Phobos.
+#
+#  Phobos is free software: you can redistribute it and/or modify it under
+#  the terms of the GNU Lesser General Public License as published by
+#  the Free Software Foundation, either version 2.1 of the Licence, or
+#  (at your option) any later version.
+#
+#  Phobos is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU Lesser General Public License for more details.
+#
+#  You should have received a copy of the GNU Lesser General Public License
+#  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+#
+# Integration test for tiering: "phobos tier" migrates the objects of
+# directories selected by age, size and user metadata to other directories
+# selected by tags, or to tape.
+#
+
+test_dir=$(dirname $(readlink -e $0))
+. $test_dir/../../test_env.sh
+. $test_dir/../../setup_db.sh
+. $test_dir/../../test_launch_daemon.sh
+. $test_dir/../../tape_drive.sh
+
+set -xe
+
+function setup
+{
+    setup_tables
+    invoke_lrs
+
+    dirs="$(mktemp -d /tmp/test.pho.XXXX) $(mktemp -d /tmp/test.pho.XXXX)"
+    files=$(mktemp -d /tmp/test.pho.XXXX)
+
+    $phobos dir add $dirs
+    $phobos dir format --fs posix --unlock $dirs
+}
+
+function cleanup
+{
+    waive_lrs
+    drop_tables
+    rm -rf $dirs $files
+
+    if [[ -w /dev/changer ]]; then
+        drain_all_drives
+    fi
+}
+
+function count_on
+{
+    count_rows "SELECT count(*) FROM object JOIN layout_extent
+                USING (uuid, version)
+                WHERE medium_family = '$1' AND oid LIKE '$2%';"
+}
+
+function count_on_medium
+{
+    count_rows "SELECT count(*) FROM object JOIN layout_extent
+                USING (uuid, version)
+                WHERE medium_id = '$1' AND oid LIKE '$2%';"
+}
+
+# make the objects whose oid starts with $1 older than the min_age of the rules
+function backdate_objects
+{
+    $PSQL -c "UPDATE object SET creation_time = now() - interval '2 hours'
+              WHERE oid LIKE '$1%';"
+}
+
+function put_objects
+{
+    local prefix=$1
+    local nb=$2
+    local i
+
+    for i in $(seq $nb); do
+        dd if=/dev/urandom of=$files/${prefix}_$i bs=1k count=$i
+        $phobos put --family dir $files/${prefix}_$i ${prefix}_$i
+    done
+}
+
+function test_rules
+{
+    put_objects young 4
+
+    $valg_phobos tier loop-test &&
+        error "A rule migrating a family to itself should be rejected"
+    $valg_phobos tier no-target-test &&
+        error "A rule without target should be rejected"
+    $valg_phobos tier unknown-test &&
+        error "An undefined rule should be rejected"
+    $valg_phobos tier &&
+        error "Tiering without any configured rule should fail"
+
+    # no object is old enough, nothing is migrated nor allocated
+    $valg_phobos tier frozen-test
+    PHOBOS_TIERING_rules=frozen-test $valg_phobos tier
+
+    [[ $(count_on dir young) == 4 ]] ||
+        error "Objects not selected by a rule should not be migrated"
+}
+
+function test_dir_migration
+{
+    local hot=${dirs%% *}
+    local cold=${dirs##* }
+    local i
+
+    $phobos dir update --tags hot $hot
+    $phobos dir update --tags cold $cold
+
+    for i in $(seq 4); do
+        dd if=/dev/urandom of=$files/dir_$i bs=1k count=$i
+        $phobos put --family dir --tags hot $files/dir_$i dir_$i
+    done
+    backdate_objects dir_1
+    backdate_objects dir_2
+
+    $valg_phobos tier dir-test
+
+    [[ $(count_on_medium $cold dir_) == 2 ]] ||
+        error "Old objects of the hot directory should be migrated"
+    [[ $(count_on_medium $hot dir_) == 2 ]] ||
+        error "Young objects of the hot directory should stay on it"
+    [[ $(find $hot -type f -name 'dir_[12]*' | wc -l) == 0 ]] ||
+        error "The hot copies of migrated objects should be removed"
+
+    for i in $(seq 2); do
+        $phobos get dir_$i $files/out_$i
+        cmp $files/dir_$i $files/out_$i ||
+            error "dir_$i should be retrieved from the cold directory"
+    done
+
+    # migrated objects are not on a source medium anymore
+    $valg_phobos tier dir-test
+    [[ $(count_on_medium $cold dir_) == 2 ]] ||
+        error "A second run should not migrate anything"
+}
+
+function test_migration
+{
+    local i
+
+    drain_all_drives
+    $phobos drive add --unlock /dev/st0
+    $phobos tape add -t lto5 P00000L5
+    $phobos tape format --unlock P00000L5
+
+    put_objects old 10
+    put_objects new 10
+    backdate_objects old_
+
+    $valg_phobos tier cold-test
+
+    [[ $(count_on tape old) == 10 ]] ||
+        error "Objects older than min_age should be migrated to tape"
+    [[ $(count_on dir new) == 10 ]] ||
+        error "Objects younger than min_age should stay on directories"
+    [[ $(find $dirs -type f -name 'old_*' | wc -l) == 0 ]] ||
+        error "The directory copies of migrated objects should be removed"
+
+    for i in $(seq 10); do
+        $phobos get old_$i $files/out_$i
+        cmp $files/old_$i $files/out_$i ||
+            error "old_$i should be retrieved from tape as it was put"
+    done
+
+    # size and user_md selection
+    $phobos put --family dir --metadata class=archive $files/new_1 arch_small
+    $phobos put --family dir --metadata class=archive $files/new_10 arch_big
+    $phobos put --family dir --metadata class=other $files/new_2 other_small
+
+    PHOBOS_TIERING_rules=archive-test $valg_phobos tier
+
+    [[ $(count_on tape arch_small) == 1 ]] ||
+        error "Small archive objects should be migrated"
+    [[ $(count_on dir arch_big) == 1 ]] ||
+        error "Objects larger than max_size should not be migrated"
+    [[ $(count_on dir other_small) == 1 ]] ||
+        error "Objects with other user_md should not be migrated"
+}
+
+trap cleanup EXIT
+setup
+
+test_rules
+test_dir_migration
+
+# Tape tests are available only if /dev/changer exists, which is the entry
+# point for the tape library.
+if [[ -w /dev/changer ]]; then
+    test_migration
+fi
@@ -30,6 +30,7 @@
 #include "pho_test_utils.h"
 #include "pho_common.h"
 #include <libgen.h>
+#include <pthread.h>
 #include <attr/xattr.h>
 
 struct test_item {
@@ -240,6 +241,135 @@ static int test_get_csv(void *param)
     return rc;
 }
 
+/** values of the config file, read before and after reloading it */
+static int test_reload(void *hint)
+{
+    const char *before[ARRAY_SIZE(test_file_items)] = { NULL };
+    struct test_item *item;
+    int rc;
+    int i;
+
+    for (i = 0, item = hint; item->variable != NULL; i++, item++)
+        pho_cfg_get_val(item->section, item->variable, &before[i]);
+
+    rc = pho_cfg_reload_local();
+    if (rc) {
+        pho_error(rc, "failed to reload the config");
+        return rc;
+    }
+
+    rc = test(hint);
+    if (rc)
+        return rc;
+
+    /* the values read before the reload must still be usable */
+    for (i = 0, item = hint; item->variable != NULL; i++, item++) {
+        if (!item->value)
+            continue;
+
+        if (!before[i] || strcmp(before[i], item->value)) {
+            pho_error(-EINVAL, "value of '%s'::'%s' changed by the reload",
+                      item->section, item->variable);
+            return -EINVAL;
+        }
+    }
+
+    return 0;
+}
+
+enum pho_cfg_params_bench {
+    PHO_CFG_BENCH_FIRST,
+
+    PHO_CFG_BENCH_bar,
+    PHO_CFG_BENCH_connect_string,
+
+    PHO_CFG_BENCH_LAST,
+};
+
+const struct pho_config_item cfg_bench[] = {
+    [PHO_CFG_BENCH_bar] = {
+        .section = "foo",
+        .name    = "bar",
+        .value   = "0",
+    },
+
+    [PHO_CFG_BENCH_connect_string] = {
+        .section = "dss",
+        .name    = "connect_string",
+        .value   = "",
+    },
+};
+
+#define BENCH_LOOKUPS   10000000
+#define BENCH_THREADS   16
+#define BENCH_RELOADS   10
+
+static void *bench_lookups(void *arg)
+{
+    intptr_t n = (intptr_t)arg;
+    intptr_t i;
+
+    for (i = 0; i < n; i += 2) {
+        const char *str;
+
+        if (PHO_CFG_GET_INT(cfg_bench, PHO_CFG_BENCH, bar, -1) != 42)
+            return (void *)-EINVAL;
+
+        str = PHO_CFG_GET(cfg_bench, PHO_CFG_BENCH, connect_string);
+        if (strcmp(str, "dbname = phobos"))
+            return (void *)-EINVAL;
+    }
+
+    return NULL;
+}
+
+/** lookups from several threads while the config file is reloaded */
+static int test_concurrent_lookups(void *hint)
+{
+    pthread_t threads[BENCH_THREADS];
+    struct timespec start, end, elapsed;
+    int nb_threads = (intptr_t)hint;
+    int rc = 0;
+    int i;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (i = 0; i < nb_threads; i++) {
+        rc = pthread_create(&threads[i], NULL, bench_lookups,
+                            (void *)(intptr_t)(BENCH_LOOKUPS / nb_threads));
+        if (rc)
+            LOG_RETURN(-rc, "failed to create thread #%d", i);
+    }
+
+    for (i = 0; i < BENCH_RELOADS; i++) {
+        int rc2 = pho_cfg_reload_local();
+
+        if (rc2) {
+            pho_error(rc2, "failed to reload the config");
+            rc = rc ? : rc2;
+        }
+        usleep(1000);
+    }
+
+    for (i = 0; i < nb_threads; i++) {
+        void *thread_rc;
+
+        pthread_join(threads[i], &thread_rc);
+        if (thread_rc) {
+            pho_error((intptr_t)thread_rc, "unexpected value in thread #%d",
+                      i);
+            rc = rc ? : (intptr_t)thread_rc;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    elapsed = diff_timespec(&end, &start);
+    pho_info("%d lookups from %d thread(s) in %ld.%09lds", BENCH_LOOKUPS,
+             nb_threads, elapsed.tv_sec, elapsed.tv_nsec);
+
+    return rc;
+}
+
 int main(int argc, char **argv)
 {
     static const char * const expected_items[] = {
@@ -401,6 +531,14 @@ int main(int argc, char **argv)
     run_test("Test 14: get CSV param", test_get_csv,
              (void *)&td, PHO_TEST_SUCCESS);
 
+    run_test("Test 15: reload config file", test_reload, test_file_items,
+             PHO_TEST_SUCCESS);
+
+    run_test("Test 16: lookups from 1 thread during reloads",
+             test_concurrent_lookups, (void *)1, PHO_TEST_SUCCESS);
+    run_test("Test 17: lookups from 16 threads during reloads",
+             test_concurrent_lookups, (void *)BENCH_THREADS, PHO_TEST_SUCCESS);
+
     pho_info("CFG: All tests succeeded");
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,210 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for DSS iterators
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+/* more objects than rows fetched at once by an iterator */
+#define N_OBJS 2503
+#define OID_LEN 16
+
+static struct object_info *OBJS;
+static char (*OIDS)[OID_LEN];
+
+static int di_objects_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int i;
+
+    OBJS = calloc(N_OBJS, sizeof(*OBJS));
+    OIDS = calloc(N_OBJS, sizeof(*OIDS));
+    if (!OBJS || !OIDS)
+        return -1;
+
+    for (i = 0; i < N_OBJS; i++) {
+        snprintf(OIDS[i], OID_LEN, "iter_%d", i);
+        OBJS[i].oid = OIDS[i];
+        OBJS[i].user_md = "{}";
+    }
+
+    return dss_object_set(handle, OBJS, N_OBJS, DSS_SET_INSERT) ? -1 : 0;
+}
+
+static int di_objects_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+
+    rc = dss_object_set(handle, OBJS, N_OBJS, DSS_SET_DELETE);
+    free(OBJS);
+    free(OIDS);
+
+    return rc ? -1 : 0;
+}
+
+/* di_objects_ok: every object is retrieved once, across several batches */
+static void di_objects_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct object_info *obj;
+    struct dss_filter filter;
+    struct dss_iter *iter;
+    int cnt = 0;
+    int rc;
+
+    rc = dss_filter_build(&filter,
+                          "{\"$REGEXP\": {\"DSS::OBJ::oid\": \"^iter_\"}}");
+    assert_return_code(rc, -rc);
+
+    rc = dss_object_iter_open(handle, &filter, &iter);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+
+    while (true) {
+        rc = dss_iter_next(iter, (void **)&obj);
+        assert_return_code(rc, -rc);
+        if (!obj)
+            break;
+
+        assert_int_equal(strncmp(obj->oid, "iter_", 5), 0);
+        assert_int_equal(obj->version, 1);
+        cnt++;
+    }
+    assert_int_equal(cnt, N_OBJS);
+
+    /* an exhausted iterator keeps returning no item */
+    rc = dss_iter_next(iter, (void **)&obj);
+    assert_return_code(rc, -rc);
+    assert_null(obj);
+
+    dss_iter_close(iter);
+}
+
+/* di_layouts_ok: layouts are retrieved with all their extents */
+static struct extent EXTENTS[] = {
+    { .size = 1, .media = { .family = PHO_RSC_DIR, .name = "iter_medium" },
+      .address = { .buff = "addr_0", .size = 7 } },
+    { .size = 2, .media = { .family = PHO_RSC_DIR, .name = "iter_medium" },
+      .address = { .buff = "addr_1", .size = 7 } },
+};
+
+#define N_LAYOUTS 3
+
+static struct layout_info LAYOUTS[N_LAYOUTS];
+
+static int di_layouts_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int i;
+
+    if (di_objects_setup(state))
+        return -1;
+
+    for (i = 0; i < N_LAYOUTS; i++) {
+        LAYOUTS[i] = (struct layout_info) {
+            .oid = OIDS[i],
+            .state = PHO_EXT_ST_SYNC,
+            .layout_desc = { .mod_name = "raid1", .mod_major = 0,
+                             .mod_minor = 2 },
+            .extents = EXTENTS,
+            .ext_count = 2,
+        };
+    }
+
+    return dss_layout_set(handle, LAYOUTS, N_LAYOUTS, DSS_SET_INSERT) ? -1 : 0;
+}
+
+static int di_layouts_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    if (dss_layout_set(handle, LAYOUTS, N_LAYOUTS, DSS_SET_DELETE))
+        return -1;
+
+    return di_objects_teardown(state);
+}
+
+static void di_layouts_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct layout_info *layout;
+    struct dss_iter *iter;
+    int cnt = 0;
+    int rc;
+    int i;
+
+    rc = dss_layout_iter_open(handle, NULL, &iter);
+    assert_return_code(rc, -rc);
+
+    while (true) {
+        rc = dss_iter_next(iter, (void **)&layout);
+        assert_return_code(rc, -rc);
+        if (!layout)
+            break;
+
+        assert_int_equal(strncmp(layout->oid, "iter_", 5), 0);
+        assert_int_equal(layout->ext_count, 2);
+        for (i = 0; i < 2; i++) {
+            assert_int_equal(layout->extents[i].layout_idx, i);
+            assert_int_equal(layout->extents[i].size, EXTENTS[i].size);
+            assert_string_equal(layout->extents[i].address.buff,
+                                EXTENTS[i].address.buff);
+        }
+        cnt++;
+    }
+    assert_int_equal(cnt, N_LAYOUTS);
+
+    dss_iter_close(iter);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_iter_cases[] = {
+        cmocka_unit_test_setup_teardown(di_objects_ok, di_objects_setup,
+                                        di_objects_teardown),
+        cmocka_unit_test_setup_teardown(di_layouts_ok, di_layouts_setup,
+                                        di_layouts_teardown),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_iter_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
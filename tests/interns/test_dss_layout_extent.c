@@ -0,0 +1,209 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for layout extents stored in the layout_extent table
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <stdlib.h>
+#include <string.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+static struct object_info OBJ = {
+    .oid = "object_with_extents",
+    .user_md = "{}"
+};
+
+#define MEDIUM_A { .family = PHO_RSC_DIR, .name = "dle_medium_a" }
+#define MEDIUM_B { .family = PHO_RSC_DIR, .name = "dle_medium_b" }
+
+static struct extent EXTENTS[] = {
+    { .size = 10, .media = MEDIUM_A,
+      .address = { .buff = "addr_b", .size = 7 },
+      .with_md5 = true, .md5 = { 0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd } },
+    { .size = 20, .media = MEDIUM_B,
+      .address = { .buff = "addr_x", .size = 7 },
+      .with_crc32c = true, .crc32c = { 0xe3, 0x06, 0x92, 0x83 } },
+    { .size = 30, .media = MEDIUM_A,
+      .address = { .buff = "addr_a", .size = 7 } },
+};
+
+static struct layout_info LAYOUT = {
+    .oid = "object_with_extents",
+    .state = PHO_EXT_ST_SYNC,
+    .layout_desc = { .mod_name = "raid1", .mod_major = 0, .mod_minor = 2 },
+    .extents = EXTENTS,
+    .ext_count = 3,
+};
+
+static int dle_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    if (dss_object_set(handle, &OBJ, 1, DSS_SET_INSERT))
+        return -1;
+
+    if (dss_layout_set(handle, &LAYOUT, 1, DSS_SET_INSERT))
+        return -1;
+
+    return 0;
+}
+
+static int dle_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    if (dss_layout_set(handle, &LAYOUT, 1, DSS_SET_DELETE))
+        return -1;
+
+    if (dss_object_set(handle, &OBJ, 1, DSS_SET_DELETE))
+        return -1;
+
+    return 0;
+}
+
+static void get_layout(struct dss_handle *handle, struct layout_info **layout)
+{
+    struct dss_filter filter;
+    int cnt;
+    int rc;
+
+    rc = dss_filter_build(&filter, "{\"DSS::EXT::oid\": \"%s\"}", OBJ.oid);
+    assert_return_code(rc, -rc);
+
+    rc = dss_layout_get(handle, &filter, layout, &cnt);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+    assert_int_equal(cnt, 1);
+}
+
+/* dle_get_ok: extents are retrieved in layout order with their checksums */
+static void dle_get_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct layout_info *layout;
+    int i;
+
+    get_layout(handle, &layout);
+
+    assert_string_equal(layout->layout_desc.mod_name, "raid1");
+    assert_int_equal(layout->ext_count, 3);
+    for (i = 0; i < 3; i++) {
+        assert_int_equal(layout->extents[i].layout_idx, i);
+        assert_int_equal(layout->extents[i].size, EXTENTS[i].size);
+        assert_string_equal(layout->extents[i].media.name,
+                            EXTENTS[i].media.name);
+        assert_string_equal(layout->extents[i].address.buff,
+                            EXTENTS[i].address.buff);
+        assert_int_equal(layout->extents[i].with_md5, EXTENTS[i].with_md5);
+        assert_false(layout->extents[i].with_xxh128);
+        assert_int_equal(layout->extents[i].with_crc32c,
+                         EXTENTS[i].with_crc32c);
+    }
+    assert_memory_equal(layout->extents[0].md5, EXTENTS[0].md5,
+                        sizeof(EXTENTS[0].md5));
+    assert_memory_equal(layout->extents[1].crc32c, EXTENTS[1].crc32c,
+                        sizeof(EXTENTS[1].crc32c));
+
+    dss_res_free(layout, 1);
+}
+
+/* dle_medium_extents_ok: only the extents of the medium are retrieved, sorted
+ * by address
+ */
+static void dle_medium_extents_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct pho_id medium = MEDIUM_A;
+    struct layout_info *layout;
+    int cnt;
+    int rc;
+
+    rc = dss_medium_extents_get(handle, &medium, &layout, &cnt);
+    assert_return_code(rc, -rc);
+    assert_int_equal(cnt, 1);
+
+    assert_string_equal(layout->oid, OBJ.oid);
+    assert_int_equal(layout->ext_count, 2);
+    assert_int_equal(layout->extents[0].layout_idx, 2);
+    assert_string_equal(layout->extents[0].address.buff, "addr_a");
+    assert_int_equal(layout->extents[1].layout_idx, 0);
+    assert_string_equal(layout->extents[1].address.buff, "addr_b");
+
+    dss_res_free(layout, cnt);
+}
+
+/* dle_update_ok: updating a layout replaces and truncates its extents */
+static void dle_update_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct layout_info *layout;
+    struct extent extent;
+    int ext_count;
+    int rc;
+
+    get_layout(handle, &layout);
+
+    extent = layout->extents[1];
+    ext_count = layout->ext_count;
+    layout->extents[1].size = 42;
+    layout->ext_count = 2;
+    rc = dss_layout_set(handle, layout, 1, DSS_SET_UPDATE);
+    layout->extents[1] = extent;
+    layout->ext_count = ext_count;
+    assert_return_code(rc, -rc);
+    dss_res_free(layout, 1);
+
+    get_layout(handle, &layout);
+    assert_int_equal(layout->ext_count, 2);
+    assert_int_equal(layout->extents[0].size, EXTENTS[0].size);
+    assert_int_equal(layout->extents[1].size, 42);
+    dss_res_free(layout, 1);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_layout_extent_cases[] = {
+        cmocka_unit_test_setup_teardown(dle_get_ok, dle_setup, dle_teardown),
+        cmocka_unit_test_setup_teardown(dle_medium_extents_ok, dle_setup,
+                                        dle_teardown),
+        cmocka_unit_test_setup_teardown(dle_update_ok, dle_setup,
+                                        dle_teardown),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_layout_extent_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
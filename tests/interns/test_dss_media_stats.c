@@ -0,0 +1,232 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for the live and deprecated volume of media
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <stdlib.h>
+#include <string.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+#define MEDIUM { .family = PHO_RSC_DIR, .name = "dms_medium" }
+
+static struct media_info MEDIUM_INFO = {
+    .rsc = { .id = MEDIUM, .model = "dir",
+             .adm_status = PHO_RSC_ADM_ST_UNLOCKED },
+    .addr_type = PHO_ADDR_HASH1,
+    .fs = { .type = PHO_FS_POSIX, .status = PHO_FS_STATUS_USED },
+    .flags = { .put = true, .get = true, .delete = true },
+};
+
+static struct object_info OBJ = {
+    .oid = "dms_object",
+    .user_md = "{}"
+};
+
+static struct extent EXTENTS[] = {
+    { .size = 10, .media = MEDIUM,
+      .address = { .buff = "addr_0", .size = 7 } },
+    { .size = 20, .media = MEDIUM,
+      .address = { .buff = "addr_1", .size = 7 } },
+};
+
+static struct layout_info LAYOUT = {
+    .oid = "dms_object",
+    .state = PHO_EXT_ST_SYNC,
+    .layout_desc = { .mod_name = "raid1", .mod_major = 0, .mod_minor = 2 },
+    .extents = EXTENTS,
+    .ext_count = 2,
+};
+
+static int dms_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    if (dss_media_set(handle, &MEDIUM_INFO, 1, DSS_SET_INSERT, 0))
+        return -1;
+
+    if (dss_object_set(handle, &OBJ, 1, DSS_SET_INSERT))
+        return -1;
+
+    if (dss_layout_set(handle, &LAYOUT, 1, DSS_SET_INSERT))
+        return -1;
+
+    return 0;
+}
+
+static int dms_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct object_info *deprec;
+    struct dss_filter filter;
+    int cnt;
+    int rc;
+
+    if (dss_layout_set(handle, &LAYOUT, 1, DSS_SET_DELETE))
+        return -1;
+
+    if (dss_object_set(handle, &OBJ, 1, DSS_SET_DELETE))
+        return -1;
+
+    if (dss_filter_build(&filter, "{\"DSS::OBJ::oid\": \"%s\"}", OBJ.oid))
+        return -1;
+
+    rc = dss_deprecated_object_get(handle, &filter, &deprec, &cnt);
+    dss_filter_free(&filter);
+    if (rc)
+        return -1;
+
+    if (cnt)
+        rc = dss_deprecated_object_set(handle, deprec, cnt, DSS_SET_DELETE);
+    dss_res_free(deprec, cnt);
+    if (rc)
+        return -1;
+
+    if (dss_media_set(handle, &MEDIUM_INFO, 1, DSS_SET_DELETE, 0))
+        return -1;
+
+    return 0;
+}
+
+static void check_stats(struct dss_handle *handle, ssize_t live_size,
+                        long long live_count, ssize_t deprec_size,
+                        long long deprec_count)
+{
+    struct enriched_media_stats *stats;
+    struct dss_filter filter;
+    int cnt;
+    int rc;
+
+    rc = dss_filter_build(&filter, "{\"DSS::MDA::id\": \"dms_medium\"}");
+    assert_return_code(rc, -rc);
+
+    rc = dss_media_enriched_stats(handle, &filter, &stats, &cnt);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+    assert_int_equal(cnt, 1);
+
+    assert_string_equal(stats->rsc.id.name, "dms_medium");
+    assert_int_equal(stats->rsc.adm_status, PHO_RSC_ADM_ST_UNLOCKED);
+    assert_int_equal(stats->fs_status, PHO_FS_STATUS_USED);
+    assert_int_equal(stats->live_size, live_size);
+    assert_int_equal(stats->live_count, live_count);
+    assert_int_equal(stats->deprec_size, deprec_size);
+    assert_int_equal(stats->deprec_count, deprec_count);
+
+    dss_res_free(stats, cnt);
+}
+
+/* dms_live_ok: the extents of a live object are accounted as live */
+static void dms_live_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    check_stats(handle, 30, 2, 0, 0);
+}
+
+/* dms_deprecate_ok: deprecating an object moves its extents to the deprecated
+ * volume, deleting them withdraws them
+ */
+static void dms_deprecate_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+
+    rc = dss_object_move(handle, DSS_OBJECT, DSS_DEPREC, &OBJ, 1);
+    assert_return_code(rc, -rc);
+    check_stats(handle, 0, 0, 30, 2);
+
+    rc = dss_layout_set(handle, &LAYOUT, 1, DSS_SET_DELETE);
+    assert_return_code(rc, -rc);
+    check_stats(handle, 0, 0, 0, 0);
+}
+
+/* dms_delete_object_ok: deleting the object first also withdraws its extents,
+ * whatever the order the store removes rows in
+ */
+static void dms_delete_object_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+
+    rc = dss_object_set(handle, &OBJ, 1, DSS_SET_DELETE);
+    assert_return_code(rc, -rc);
+    check_stats(handle, 0, 0, 0, 0);
+}
+
+/* dms_update_ok: updating the extents of a layout updates the live volume */
+static void dms_update_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct layout_info *layout;
+    struct dss_filter filter;
+    int ext_count;
+    int cnt;
+    int rc;
+
+    rc = dss_filter_build(&filter, "{\"DSS::EXT::oid\": \"%s\"}", OBJ.oid);
+    assert_return_code(rc, -rc);
+
+    rc = dss_layout_get(handle, &filter, &layout, &cnt);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+    assert_int_equal(cnt, 1);
+
+    ext_count = layout->ext_count;
+    layout->ext_count = 1;
+    rc = dss_layout_set(handle, layout, 1, DSS_SET_UPDATE);
+    layout->ext_count = ext_count;
+    dss_res_free(layout, cnt);
+    assert_return_code(rc, -rc);
+    check_stats(handle, 10, 1, 0, 0);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_media_stats_cases[] = {
+        cmocka_unit_test_setup_teardown(dms_live_ok, dms_setup, dms_teardown),
+        cmocka_unit_test_setup_teardown(dms_deprecate_ok, dms_setup,
+                                        dms_teardown),
+        cmocka_unit_test_setup_teardown(dms_delete_object_ok, dms_setup,
+                                        dms_teardown),
+        cmocka_unit_test_setup_teardown(dms_update_ok, dms_setup,
+                                        dms_teardown),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_media_stats_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
@@ -0,0 +1,246 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for pipelined DSS requests
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <errno.h>
+#include <stdlib.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+static struct object_info OBJ_3[] = {
+    { .oid = "pipelined_0", .user_md = "{}" },
+    { .oid = "pipelined_1", .user_md = "{}" },
+    { .oid = "pipelined_2", .user_md = "{}" }
+};
+
+static int count_objects(struct dss_handle *handle)
+{
+    struct object_info *obj_res;
+    struct dss_filter filter;
+    int obj_cnt;
+    int rc;
+
+    rc = dss_filter_build(&filter,
+                          "{\"$REGEXP\": {\"DSS::OBJ::oid\": \"^pipelined_\"}}");
+    assert_return_code(rc, -rc);
+
+    rc = dss_object_get(handle, &filter, &obj_res, &obj_cnt);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+    dss_res_free(obj_res, obj_cnt);
+
+    return obj_cnt;
+}
+
+static int dp_objects_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int i;
+
+    /* the objects may not all exist, delete them one by one */
+    for (i = 0; i < 3; i++)
+        dss_object_set(handle, &OBJ_3[i], 1, DSS_SET_DELETE);
+
+    return 0;
+}
+
+/* dp_insert_ok: pipelined insertions are visible to later synchronous gets */
+static void dp_insert_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+    int i;
+
+    rc = dss_pipeline_begin(handle);
+    assert_return_code(rc, -rc);
+    assert_true(dss_pipeline_is_active(handle));
+
+    for (i = 0; i < 3; i++) {
+        rc = dss_object_set(handle, &OBJ_3[i], 1, DSS_SET_INSERT);
+        assert_return_code(rc, -rc);
+    }
+
+    /* a synchronous request first completes the pending ones */
+    assert_int_equal(count_objects(handle), 3);
+
+    rc = dss_pipeline_end(handle);
+    assert_return_code(rc, -rc);
+    assert_false(dss_pipeline_is_active(handle));
+}
+
+/* dp_nested: only the outermost end completes the pipeline */
+static void dp_nested(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+
+    rc = dss_pipeline_begin(handle);
+    assert_return_code(rc, -rc);
+    rc = dss_pipeline_begin(handle);
+    assert_return_code(rc, -rc);
+
+    rc = dss_object_set(handle, OBJ_3, 3, DSS_SET_INSERT);
+    assert_return_code(rc, -rc);
+
+    rc = dss_pipeline_end(handle);
+    assert_return_code(rc, -rc);
+    assert_true(dss_pipeline_is_active(handle));
+
+    rc = dss_pipeline_end(handle);
+    assert_return_code(rc, -rc);
+    assert_false(dss_pipeline_is_active(handle));
+
+    assert_int_equal(count_objects(handle), 3);
+}
+
+/* dp_failure_atomic: a failure cancels every statement of the pipeline */
+static void dp_failure_atomic(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    int rc;
+
+    rc = dss_pipeline_begin(handle);
+    assert_return_code(rc, -rc);
+
+    rc = dss_object_set(handle, &OBJ_3[0], 1, DSS_SET_INSERT);
+    assert_return_code(rc, -rc);
+    rc = dss_object_set(handle, &OBJ_3[1], 1, DSS_SET_INSERT);
+    assert_return_code(rc, -rc);
+    /* duplicated oid */
+    rc = dss_object_set(handle, &OBJ_3[0], 1, DSS_SET_INSERT);
+    assert_return_code(rc, -rc);
+
+    rc = dss_pipeline_end(handle);
+    assert_int_equal(rc, -EEXIST);
+
+    assert_int_equal(count_objects(handle), 0);
+}
+
+/* dp_end_einval: ending a pipeline that was not started fails */
+static void dp_end_einval(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    assert_int_equal(dss_pipeline_end(handle), -EINVAL);
+}
+
+/* dp_media_stats_add: concurrent stat increments are all taken into account */
+static struct media_info MEDIUM = {
+    .rsc = {
+        .id = { .family = PHO_RSC_DIR, .name = "pipelined_medium" },
+        .model = NULL,
+        .adm_status = PHO_RSC_ADM_ST_UNLOCKED,
+    },
+    .addr_type = PHO_ADDR_HASH1,
+    .fs = {
+        .type = PHO_FS_POSIX,
+        .status = PHO_FS_STATUS_USED,
+        .label = "",
+    },
+    .stats = {
+        .nb_obj = 1,
+        .logc_spc_used = 10,
+    },
+    .flags = { .put = true, .get = true, .delete = true },
+};
+
+static int dp_medium_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    return dss_media_set(handle, &MEDIUM, 1, DSS_SET_INSERT, 0) ? -1 : 0;
+}
+
+static int dp_medium_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    return dss_media_set(handle, &MEDIUM, 1, DSS_SET_DELETE, 0) ? -1 : 0;
+}
+
+static void dp_media_stats_add(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct media_info update = MEDIUM;
+    struct media_info *medium;
+    struct dss_filter filter;
+    int cnt;
+    int rc;
+    int i;
+
+    rc = dss_pipeline_begin(handle);
+    assert_return_code(rc, -rc);
+
+    update.stats.nb_obj = 2;
+    update.stats.logc_spc_used = 100;
+    for (i = 0; i < 3; i++) {
+        rc = dss_media_set(handle, &update, 1, DSS_SET_UPDATE,
+                           NB_OBJ_ADD | LOGC_SPC_USED_ADD);
+        assert_return_code(rc, -rc);
+    }
+
+    rc = dss_pipeline_end(handle);
+    assert_return_code(rc, -rc);
+
+    rc = dss_filter_build(&filter, "{\"DSS::MDA::id\": \"%s\"}",
+                          MEDIUM.rsc.id.name);
+    assert_return_code(rc, -rc);
+    rc = dss_media_get(handle, &filter, &medium, &cnt);
+    dss_filter_free(&filter);
+    assert_return_code(rc, -rc);
+    assert_int_equal(cnt, 1);
+
+    assert_int_equal(medium->stats.nb_obj, 1 + 3 * 2);
+    assert_int_equal(medium->stats.logc_spc_used, 10 + 3 * 100);
+    dss_res_free(medium, cnt);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_pipeline_cases[] = {
+        cmocka_unit_test_teardown(dp_insert_ok, dp_objects_teardown),
+        cmocka_unit_test_teardown(dp_nested, dp_objects_teardown),
+        cmocka_unit_test_teardown(dp_failure_atomic, dp_objects_teardown),
+        cmocka_unit_test(dp_end_einval),
+        cmocka_unit_test_setup_teardown(dp_media_stats_add, dp_medium_setup,
+                                        dp_medium_teardown),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_pipeline_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
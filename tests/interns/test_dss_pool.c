@@ -0,0 +1,191 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for the DSS connection pool
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* postgres stuff */
+#include <libpq-fe.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+/* dp_reuse: a released connection is handed out again */
+static void dp_reuse(void **state)
+{
+    struct dss_handle first;
+    struct dss_handle second;
+    struct object_info *objs;
+    struct dss_pool *pool;
+    int obj_cnt;
+    void *conn;
+    int rc;
+
+    (void)state;
+
+    rc = dss_pool_init(&pool, 2);
+    assert_return_code(rc, -rc);
+
+    rc = dss_pool_acquire(pool, &first);
+    assert_return_code(rc, -rc);
+    conn = first.dh_conn;
+
+    dss_pool_release(pool, &first);
+    assert_null(first.dh_conn);
+
+    rc = dss_pool_acquire(pool, &second);
+    assert_return_code(rc, -rc);
+    assert_ptr_equal(second.dh_conn, conn);
+
+    /* the connection can still be used */
+    rc = dss_object_get(&second, NULL, &objs, &obj_cnt);
+    assert_return_code(rc, -rc);
+    dss_res_free(objs, obj_cnt);
+
+    dss_pool_release(pool, &second);
+    dss_pool_fini(pool);
+}
+
+struct acquirer {
+    struct dss_pool    *pool;
+    struct dss_handle   handle;
+    volatile bool       done;
+    int                 rc;
+};
+
+static void *acquire_thread(void *arg)
+{
+    struct acquirer *acquirer = arg;
+
+    acquirer->rc = dss_pool_acquire(acquirer->pool, &acquirer->handle);
+    acquirer->done = true;
+
+    return NULL;
+}
+
+/* dp_bound: no more connections than the pool size are opened */
+static void dp_bound(void **state)
+{
+    struct acquirer acquirer = {};
+    struct dss_handle handle;
+    pthread_t thread;
+    void *conn;
+    int rc;
+
+    (void)state;
+
+    rc = dss_pool_init(&acquirer.pool, 1);
+    assert_return_code(rc, -rc);
+
+    rc = dss_pool_acquire(acquirer.pool, &handle);
+    assert_return_code(rc, -rc);
+    conn = handle.dh_conn;
+
+    rc = pthread_create(&thread, NULL, acquire_thread, &acquirer);
+    assert_int_equal(rc, 0);
+
+    /* the second acquirer waits for the connection to be released */
+    usleep(200000);
+    assert_false(acquirer.done);
+
+    dss_pool_release(acquirer.pool, &handle);
+    pthread_join(thread, NULL);
+    assert_true(acquirer.done);
+    assert_return_code(acquirer.rc, -acquirer.rc);
+    assert_ptr_equal(acquirer.handle.dh_conn, conn);
+
+    dss_pool_release(acquirer.pool, &acquirer.handle);
+    dss_pool_fini(acquirer.pool);
+}
+
+/* dp_unclean_release: a connection left in a transaction is not reused */
+static void dp_unclean_release(void **state)
+{
+    struct dss_handle handle;
+    struct dss_pool *pool;
+    PGresult *res;
+    int rc;
+
+    (void)state;
+
+    rc = dss_pool_init(&pool, 1);
+    assert_return_code(rc, -rc);
+
+    rc = dss_pool_acquire(pool, &handle);
+    assert_return_code(rc, -rc);
+
+    res = PQexec(handle.dh_conn, "BEGIN");
+    assert_int_equal(PQresultStatus(res), PGRES_COMMAND_OK);
+    PQclear(res);
+
+    /* the pool slot is freed for a new connection */
+    dss_pool_release(pool, &handle);
+
+    rc = dss_pool_acquire(pool, &handle);
+    assert_return_code(rc, -rc);
+    assert_int_equal(PQtransactionStatus(handle.dh_conn), PQTRANS_IDLE);
+
+    dss_pool_release(pool, &handle);
+    dss_pool_fini(pool);
+}
+
+/* dp_invalid: the pool size must be positive */
+static void dp_invalid(void **state)
+{
+    struct dss_pool *pool;
+
+    (void)state;
+
+    assert_int_equal(dss_pool_init(&pool, 0), -EINVAL);
+    assert_int_equal(dss_pool_init(&pool, -1), -EINVAL);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_pool_cases[] = {
+        cmocka_unit_test(dp_reuse),
+        cmocka_unit_test(dp_bound),
+        cmocka_unit_test(dp_unclean_release),
+        cmocka_unit_test(dp_invalid),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_pool_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
@@ -0,0 +1,176 @@
+/* -*- mode: c; c-basic-offset: 4; indent-tabs-mode: nil; -*-
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+/*
+ *  All rights reserved (c) 2014-2022 CEA/DAM.
+ *
+ *  This file is part of Phobos.
+ *
+ *  Phobos is free software: you can redistribute it and/or modify it under
+ *  the terms of the GNU Lesser General Public License as published by
+ *  the Free Software Foundation, either version 2.1 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Phobos is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public License
+ *  along with Phobos. If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ * \brief  Tests for DSS filter templates
+ */
+
+/* phobos stuff */
+#include "../test_setup.h"
+#include "pho_dss.h"
+#include "pho_types.h"
+
+/* standard stuff */
+#include <errno.h>
+#include <stdlib.h>
+
+/* cmocka stuff */
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <cmocka.h>
+
+#define OID_TMPL "{\"DSS::OBJ::oid\": \"$1\"}"
+
+static struct object_info OBJ_3[] = {
+    { .oid = "tmpl_0", .user_md = "{\"color\": \"blue\"}" },
+    { .oid = "tmpl_1", .user_md = "{\"color\": \"red\"}" },
+    { .oid = "other_2", .user_md = "{\"color\": \"blue\"}" },
+};
+
+static int dt_objects_setup(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    return dss_object_set(handle, OBJ_3, 3, DSS_SET_INSERT) ? -1 : 0;
+}
+
+static int dt_objects_teardown(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+
+    return dss_object_set(handle, OBJ_3, 3, DSS_SET_DELETE) ? -1 : 0;
+}
+
+static int template_count(struct dss_handle *handle, enum dss_type type,
+                          const char *tmpl, const char * const *params,
+                          int n_params)
+{
+    struct object_info *obj_res;
+    int obj_cnt;
+    int rc;
+
+    rc = dss_template_get(handle, type, tmpl, params, n_params,
+                          (void **)&obj_res, &obj_cnt);
+    assert_return_code(rc, -rc);
+    dss_res_free(obj_res, obj_cnt);
+
+    return obj_cnt;
+}
+
+/* dt_object_ok: the same template is executed with different values */
+static void dt_object_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    struct object_info *obj_res;
+    const char *oid;
+    int obj_cnt;
+    int rc;
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        oid = OBJ_3[i].oid;
+        rc = dss_template_get(handle, DSS_OBJECT, OID_TMPL, &oid, 1,
+                              (void **)&obj_res, &obj_cnt);
+        assert_return_code(rc, -rc);
+        assert_int_equal(obj_cnt, 1);
+        assert_string_equal(obj_res->oid, OBJ_3[i].oid);
+        dss_res_free(obj_res, obj_cnt);
+    }
+
+    /* the template is prepared per type */
+    assert_int_equal(template_count(handle, DSS_DEPREC, OID_TMPL, &oid, 1),
+                     0);
+}
+
+/* dt_operators_ok: slots can be used with any filter operator */
+static void dt_operators_ok(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    const char *params[2];
+
+    params[0] = "^tmpl_";
+    params[1] = "{\"color\": \"blue\"}";
+    assert_int_equal(template_count(handle, DSS_OBJECT,
+                                    "{\"$AND\": ["
+                                    "  {\"$REGEXP\": "
+                                    "     {\"DSS::OBJ::oid\": \"$1\"}},"
+                                    "  {\"$KVINJSON\": "
+                                    "     {\"DSS::OBJ::user_md\": \"$2\"}}"
+                                    "]}",
+                                    params, 2), 1);
+
+    /* literal values are kept along with slots */
+    assert_int_equal(template_count(handle, DSS_OBJECT,
+                                    "{\"$AND\": ["
+                                    "  {\"$REGEXP\": "
+                                    "     {\"DSS::OBJ::oid\": \"$1\"}},"
+                                    "  {\"$KVINJSON\": "
+                                    "     {\"DSS::OBJ::user_md\": "
+                                    "         \"color=red\"}}"
+                                    "]}",
+                                    params, 1), 1);
+}
+
+/* dt_invalid: invalid templates and types are rejected */
+static void dt_invalid(void **state)
+{
+    struct dss_handle *handle = (struct dss_handle *)*state;
+    const char *params[] = { "tmpl_0" };
+    void *res;
+    int cnt;
+    int rc;
+
+    rc = dss_template_get(handle, DSS_OBJECT, "{\"DSS::OBJ::oid\": ", params,
+                          1, &res, &cnt);
+    assert_int_equal(rc, -EINVAL);
+
+    rc = dss_template_get(handle, DSS_OBJECT, "{\"DSS::OBJ::nope\": \"$1\"}",
+                          params, 1, &res, &cnt);
+    assert_int_equal(rc, -EINVAL);
+
+    rc = dss_template_get(handle, DSS_LAYOUT, OID_TMPL, params, 1, &res,
+                          &cnt);
+    assert_int_equal(rc, -ENOTSUP);
+
+    /* a failed template is not cached, nor breaks the valid ones */
+    assert_int_equal(template_count(handle, DSS_OBJECT, OID_TMPL, params, 1),
+                     1);
+}
+
+int main(void)
+{
+    const struct CMUnitTest dss_template_cases[] = {
+        cmocka_unit_test_setup_teardown(dt_object_ok, dt_objects_setup,
+                                        dt_objects_teardown),
+        cmocka_unit_test_setup_teardown(dt_operators_ok, dt_objects_setup,
+                                        dt_objects_teardown),
+        cmocka_unit_test_setup_teardown(dt_invalid, dt_objects_setup,
+                                        dt_objects_teardown),
+    };
+
+    pho_context_init();
+    atexit(pho_context_fini);
+
+    return cmocka_run_group_tests(dss_template_cases,
+                                  global_setup_dss_with_dbinit,
+                                  global_teardown_dss_with_dbdrop);
+}
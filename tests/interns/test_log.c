@@ -26,10 +26,19 @@
 #include "config.h"
 #endif
 
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
 #include "pho_common.h"
 #include "pho_test_utils.h"
 
+#define ASYNC_THREADS 8
+#define ASYNC_RECORDS_PER_THREAD 125000
+#define ASYNC_RECORDS (ASYNC_THREADS * ASYNC_RECORDS_PER_THREAD)
+#define ASYNC_EMIT_TIMEOUT_S 60
+
 
 static bool recv_dbg;
 static bool recv_vrb;
@@ -144,6 +153,141 @@ static int test3(void *hint)
     return 0;
 }
 
+static uint64_t async_received;
+static bool async_blocked;
+
+static void async_cb(const struct pho_logrec *rec)
+{
+    /* block the logger thread as long as requested */
+    while (__atomic_load_n(&async_blocked, __ATOMIC_ACQUIRE))
+        usleep(1000);
+
+    /* ignore the reports of dropped records, emitters write synchronously once
+     * stopped
+     */
+    if (!strncmp(rec->plr_msg, "async record", strlen("async record")))
+        __atomic_add_fetch(&async_received, 1, __ATOMIC_RELAXED);
+}
+
+static void *async_emitter(void *arg)
+{
+    int i;
+
+    for (i = 0; i < ASYNC_RECORDS_PER_THREAD; i++)
+        pho_info("async record %d", i);
+
+    return NULL;
+}
+
+/**
+ * Emit ASYNC_RECORDS records from ASYNC_THREADS threads while the logger thread
+ * is blocked if \p hint is not NULL, and check that every record is either
+ * written or dropped.
+ */
+static int test_async(void *hint)
+{
+    pthread_t threads[ASYNC_THREADS];
+    bool blocked = hint != NULL;
+    struct timespec deadline;
+    uint64_t dropped;
+    int rc = 0;
+    int i;
+
+    pho_log_level_set(PHO_LOG_INFO);
+    pho_log_callback_set(async_cb);
+    async_received = 0;
+    async_blocked = blocked;
+
+    if (pho_log_async_start())
+        return -EINVAL;
+
+    for (i = 0; i < ASYNC_THREADS; i++)
+        if (pthread_create(&threads[i], NULL, async_emitter, NULL))
+            abort();
+
+    /* emitting must complete even if the logger thread is stuck */
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ASYNC_EMIT_TIMEOUT_S;
+    for (i = 0; i < ASYNC_THREADS; i++) {
+        if (pthread_timedjoin_np(threads[i], NULL, &deadline)) {
+            fprintf(stderr, "Emitting records blocked\n");
+            __atomic_store_n(&async_blocked, false, __ATOMIC_RELEASE);
+            pthread_join(threads[i], NULL);
+            rc = -ETIMEDOUT;
+        }
+    }
+
+    dropped = pho_log_async_dropped();
+    __atomic_store_n(&async_blocked, false, __ATOMIC_RELEASE);
+    pho_log_async_stop();
+    pho_log_callback_set(NULL);
+
+    printf("%" PRIu64 " records written, %" PRIu64 " dropped\n",
+           async_received, dropped);
+    if (async_received + dropped != ASYNC_RECORDS)
+        return -EINVAL;
+
+    /* the records exceeding the rings of the threads must be dropped */
+    if (blocked && async_received > ASYNC_RECORDS / 2)
+        return -EINVAL;
+
+    return rc;
+}
+
+/**
+ * A thread still logging once the logger thread is stopped must fall back to
+ * synchronous logging.
+ */
+static int test_async_stopped(void *hint)
+{
+    pho_log_level_set(PHO_LOG_INFO);
+    pho_log_callback_set(async_cb);
+    async_received = 0;
+
+    if (pho_log_async_start())
+        return -EINVAL;
+
+    pho_log_async_stop();
+    pho_info("async record after stop");
+    pho_log_callback_set(NULL);
+
+    return async_received == 1 ? 0 : -EINVAL;
+}
+
+/**
+ * Stop the logger thread while ASYNC_THREADS threads emit records: each of them
+ * must still be written or counted as dropped.
+ */
+static int test_async_stop_racing(void *hint)
+{
+    pthread_t threads[ASYNC_THREADS];
+    uint64_t dropped;
+    int i;
+
+    pho_log_level_set(PHO_LOG_INFO);
+    pho_log_callback_set(async_cb);
+    async_received = 0;
+
+    if (pho_log_async_start())
+        return -EINVAL;
+
+    for (i = 0; i < ASYNC_THREADS; i++)
+        if (pthread_create(&threads[i], NULL, async_emitter, NULL))
+            abort();
+
+    pho_log_async_stop();
+    for (i = 0; i < ASYNC_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    dropped = pho_log_async_dropped();
+    pho_log_callback_set(NULL);
+
+    printf("%" PRIu64 " records written, %" PRIu64 " dropped\n",
+           async_received, dropped);
+
+    return async_received + dropped == ASYNC_RECORDS ? 0 : -EINVAL;
+}
+
 int main(int ac, char **av)
 {
     test_env_initialize();
@@ -157,6 +301,20 @@ int main(int ac, char **av)
     run_test("Test 3: emitting logs should not alter errno",
              test3, NULL, PHO_TEST_SUCCESS);
 
+    run_test("Test 4: asynchronous logs are written or counted as dropped",
+             test_async, NULL, PHO_TEST_SUCCESS);
+
+    run_test("Test 5: emitting asynchronous logs does not wait for the "
+             "logger thread",
+             test_async, (void *)1, PHO_TEST_SUCCESS);
+
+    run_test("Test 6: logs emitted once stopped are written synchronously",
+             test_async_stopped, NULL, PHO_TEST_SUCCESS);
+
+    run_test("Test 7: logs emitted while stopping are written or counted as "
+             "dropped",
+             test_async_stop_racing, NULL, PHO_TEST_SUCCESS);
+
     pho_info("MAPPER: All tests succeeded\n");
     exit(EXIT_SUCCESS);
 }
@@ -288,6 +288,40 @@ static void gcwtv_invalid_numbers(void **state)
     assert_int_equal(rc, -ERANGE);
 }
 
+static void gcsftv_valid_multiple_tokens(void **state)
+{
+    struct timespec res;
+    int rc;
+
+    (void)state;
+
+    rc = setenv("PHOBOS_LRS_stats_flush_time_ms", "dir=0,tape=2500", 1);
+    assert_int_equal(rc, -rc);
+
+    rc = get_cfg_stats_flush_time_ms_value(PHO_RSC_DIR, &res);
+    ASSERT_VALID_GET_TIME(rc, res, 0, 0);
+
+    rc = get_cfg_stats_flush_time_ms_value(PHO_RSC_TAPE, &res);
+    ASSERT_VALID_GET_TIME(rc, res, 2, 500000000);
+}
+
+static void gcsftv_invalid_numbers(void **state)
+{
+    struct timespec res;
+    int rc;
+
+    (void)state;
+
+    rc = setenv("PHOBOS_LRS_stats_flush_time_ms", "dir=-1,tape=10", 1);
+    assert_int_equal(rc, -rc);
+
+    rc = get_cfg_stats_flush_time_ms_value(PHO_RSC_DIR, &res);
+    assert_int_equal(rc, -ERANGE);
+
+    rc = get_cfg_stats_flush_time_ms_value(PHO_RSC_RADOS_POOL, &res);
+    assert_int_equal(rc, -EINVAL);
+}
+
 int main(void)
 {
     const struct CMUnitTest get_time_threshold_test_cases[] = {
@@ -314,10 +348,16 @@ int main(void)
         cmocka_unit_test(gcwtv_invalid_numbers),
     };
 
+    const struct CMUnitTest get_stats_flush_time_test_cases[] = {
+        cmocka_unit_test(gcsftv_valid_multiple_tokens),
+        cmocka_unit_test(gcsftv_invalid_numbers),
+    };
+
     pho_context_init();
     atexit(pho_context_fini);
 
     return cmocka_run_group_tests(get_time_threshold_test_cases, NULL, NULL) +
         cmocka_run_group_tests(get_nb_req_threshold_test_cases, NULL, NULL) +
-        cmocka_run_group_tests(get_wsize_threshold_test_cases, NULL, NULL);
+        cmocka_run_group_tests(get_wsize_threshold_test_cases, NULL, NULL) +
+        cmocka_run_group_tests(get_stats_flush_time_test_cases, NULL, NULL);
 }
@@ -1350,6 +1350,79 @@ static void io_sched_eagain(void **data)
     g_ptr_array_free(device_array, true);
 }
 
+static void io_sched_mixed_request(void **data)
+{
+    struct io_sched_handle *io_sched = (struct io_sched_handle *) *data;
+    GPtrArray *devices;
+    struct req_container *new_reqc;
+    struct req_container reqc;
+    size_t nb_writes;
+    struct lrs_dev device;
+    struct media_info M2;
+    struct lrs_dev *dev;
+    size_t n_tags = 0;
+    size_t index = 0;
+    int rc;
+
+    if (IO_REQ_TYPE != IO_REQ_WRITE)
+        skip();
+
+    devices = g_ptr_array_new();
+    io_sched->global_device_list = devices;
+    create_device(&device, "test", LTO5_MODEL);
+    create_medium(&M2, "M2");
+    mount_medium(&device, &M2);
+    gptr_array_from_list(devices, &device, 1, sizeof(device));
+
+    /* read M1 and write on any other medium */
+    reqc.req = calloc(1, sizeof(*reqc.req));
+    assert_non_null(reqc.req);
+    rc = pho_srl_request_mixed_alloc(reqc.req, 1, 1, &n_tags);
+    assert_return_code(rc, -rc);
+    reqc.req->ralloc->med_ids[0]->name = strdup("M1");
+    reqc.req->ralloc->med_ids[0]->family = PHO_RSC_DIR;
+    reqc.req->walloc->media[0]->size = 0;
+    reqc.params.rwalloc.n_media = 2;
+    reqc.params.rwalloc.media = calloc(2, sizeof(*reqc.params.rwalloc.media));
+    assert_non_null(reqc.params.rwalloc.media);
+
+    assert_true(pho_request_is_mixed(reqc.req));
+    assert_true(rwalloc_index_is_write(&reqc, 0));
+    assert_false(rwalloc_index_is_write(&reqc, 1));
+    assert_int_equal(rwalloc_read_index(&reqc, 1), 0);
+
+    /* a mixed request is handled by the write I/O scheduler */
+    nb_writes = io_sched->io_stats.nb_writes;
+    rc = io_sched_push_request(io_sched, &reqc);
+    assert_return_code(rc, -rc);
+    assert_int_equal(io_sched->io_stats.nb_writes, nb_writes + 1);
+
+    rc = io_sched_dispatch_devices(io_sched, devices);
+    assert_return_code(rc, -rc);
+
+    rc = io_sched_peek_request(io_sched, &new_reqc);
+    assert_return_code(rc, -rc);
+    assert_ptr_equal(&reqc, new_reqc);
+
+    rc = io_sched_get_device_medium_pair(io_sched, &reqc, &dev, &index);
+    assert_return_code(rc, -rc);
+    assert_int_equal(index, 0);
+    assert_ptr_equal(dev, &device);
+
+    rc = io_sched_remove_request(io_sched, &reqc);
+    assert_return_code(rc, -rc);
+    assert_int_equal(io_sched->io_stats.nb_writes, nb_writes);
+
+    rc = io_sched_remove_device(io_sched, &device);
+    cleanup_device(&device);
+    assert_return_code(rc, -rc);
+
+    free(reqc.params.rwalloc.media);
+    pho_srl_request_free(reqc.req, false);
+    free(reqc.req);
+    g_ptr_array_free(devices, true);
+}
+
 static int set_schedulers(const char *read_algo,
                           const char *write_algo,
                           const char *format_algo,
@@ -2074,6 +2147,7 @@ int main(void)
         cmocka_unit_test(io_sched_one_error),
         cmocka_unit_test(io_sched_one_error_no_device_available),
         cmocka_unit_test(io_sched_eagain),
+        cmocka_unit_test(io_sched_mixed_request),
         /* TODO test out of order medium?
          * Add med_ids_switch when necessary.
          */
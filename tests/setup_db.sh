@@ -29,6 +29,12 @@ test_db="$(grep "dbname" "$phobos_conf" | awk -F 'dbname=' '{print $2}' | \
 PSQL="psql $test_db -U phobos"
 . "$cur_dir/test_env.sh"
 
+# print the single value returned by a query, e.g. a count
+function count_rows
+{
+    $PSQL -t -c "$1" | xargs
+}
+
 # host name to insert examples in DB
 host=$(hostname -s)
 
@@ -76,13 +82,16 @@ insert into object (oid, user_md)
 insert into deprecated_object (oid, uuid, version, user_md)
     values ('01230123ABD', '00112233445566778899aabbccddeeff', 1, '{}');
 
-insert into extent (oid, uuid, state, lyt_info, extents)
+insert into extent (oid, uuid, state, lyt_info)
     values ('01230123ABC', (select uuid from object where oid = '01230123ABC'),
-            'pending', '{"name":"simple","major":0,"minor":1}',
-           '[{"media":"/tmp/pho_testdir1","addr":"test3",
-	   "sz":21123456,"fam":"dir"},\
-            {"media":"/tmp/pho_testdir2","addr":"test4",
-	   "sz":2112555,"fam":"dir"}]');
+            'pending', '{"name":"simple","major":0,"minor":1}');
+
+insert into layout_extent (uuid, version, layout_idx, medium_family,
+                           medium_id, address, size)
+    values ((select uuid from object where oid = '01230123ABC'), 1, 0, 'dir',
+            '/tmp/pho_testdir1', 'test3', 21123456),
+           ((select uuid from object where oid = '01230123ABC'), 1, 1, 'dir',
+            '/tmp/pho_testdir2', 'test4', 2112555);
 EOF
 }
 